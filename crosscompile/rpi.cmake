@@ -6,10 +6,14 @@ unset(CMAKE_CXX_IMPLICIT_INCLUDE_DIRECTORIES)
 
 set(ROOT_PATH "")                       # Path to the root of the tools. Tested with https://github.com/abhiTronix/raspberry-pi-cross-compilers
 set(HOST_NAME "arm-linux-gnueabihf")    # For Autoconf
+set(ARCH_FLAGS "-march=armv7-a -mfpu=neon-vfpv4 -mfloat-abi=hard")  # Raspberry Pi 2 and newer, enables the NEON audio kernels. Leave empty for the armv6 boards (Pi 1, Zero).
 
 SET(CMAKE_C_COMPILER ${ROOT_PATH}/bin/${HOST_NAME}-gcc)
 SET(CMAKE_CXX_COMPILER ${ROOT_PATH}/bin/${HOST_NAME}-g++)
 
+SET(CMAKE_C_FLAGS_INIT "${ARCH_FLAGS}")
+SET(CMAKE_CXX_FLAGS_INIT "${ARCH_FLAGS}")
+
 SET(CMAKE_FIND_ROOT_PATH ${ROOT_PATH})
 set(CMAKE_BUILD_WITH_INSTALL_RPATH ON)
 
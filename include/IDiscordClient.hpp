@@ -26,14 +26,23 @@
 #define IDISCORDCLIENT_HPP
 
 #include <memory>
+#include <future>
+#include <vector>
 #include <controller/IController.hpp>
 #include <controller/IAudioSource.hpp>
+#include <controller/AudioBroadcast.hpp>
+#include <controller/OggOpusSource.hpp>
+#include <controller/IFormatAudioSource.hpp>
 #include <models/Embed.hpp>
 #include <controller/IMusicQueue.hpp>
 #include <controller/Factory.hpp>
 #include <config.h>
 #include <models/OnlineState.hpp>
 #include <controller/IGuildAdmin.hpp>
+#include <models/ReplayStats.hpp>
+#include <models/VoiceStats.hpp>
+#include <models/FrameCacheStats.hpp>
+#include <models/EncoderProfile.hpp>
 
 namespace DiscordBot
 {
@@ -124,6 +133,13 @@ namespace DiscordBot
         return static_cast<Intent>(static_cast<unsigned>(lhs) |static_cast<unsigned>(rhs));
     }  
 
+    //Payload encoding of the gateway https://discord.com/developers/docs/topics/gateway#encoding-and-compression
+    enum class GatewayEncoding
+    {
+        JSON,
+        ETF         //!< Erlang term format. Smaller payloads and snowflakes as integers.
+    };
+
     class DISCORDBOT_EXPORT IDiscordClient
     {
         public:
@@ -184,6 +200,150 @@ namespace DiscordBot
              */
             virtual void SetActivity(const std::string &Text, const std::string &URL = "") = 0;
 
+            /**
+             * @brief Sets the number of gateway connections (shards). Must be called before Run().
+             *
+             * @param Count: Number of shards. 0 uses the shard count recommended by Discord. (Default)
+             */
+            virtual void SetShardCount(uint32_t Count) = 0;
+
+            /**
+             * @return Gets the number of gateway connections. 0 before Run() is called.
+             */
+            virtual uint32_t GetShardCount() = 0;
+
+            /**
+             * @return Gets the number of shards which are connected. Use this or IController::OnShardReady to track the start up.
+             */
+            virtual uint32_t GetReadyShardCount() = 0;
+
+            /**
+             * @brief Enables the zlib-stream transport compression of the gateway. Must be called before Run().
+             * 
+             * @param Enable: True to receive compressed gateway messages. (Default false)
+             */
+            virtual void SetTransportCompression(bool Enable) = 0;
+
+            /**
+             * @brief Overrides the base url of the rest api, e.g. to run the bot against a local mock server. Must be called before Run().
+             * 
+             * @param URL: Base url without a trailing slash. (Default https://discord.com/api)
+             */
+            virtual void SetAPIURL(const std::string &URL) = 0;
+
+            /**
+             * @brief Overrides the gateway url returned by /gateway/bot. Must be called before Run().
+             * 
+             * @param URL: Websocket url without query parameters. An empty string uses the url returned by /gateway/bot. (Default empty)
+             */
+            virtual void SetGatewayURL(const std::string &URL) = 0;
+
+            /**
+             * @brief Sets the payload encoding of the gateway. Must be called before Run().
+             * 
+             * @param Encoding: JSON or ETF. (Default JSON)
+             */
+            virtual void SetGatewayEncoding(GatewayEncoding Encoding) = 0;
+
+            /**
+             * @brief Sets the number of threads which are handling the gateway events and calling the controller. Events of the same guild are handled in order, events of different guilds in parallel. Must be called before Run().
+             * 
+             * @param Count: Number of worker threads. 0 calls the controller from the websocket threads. (Default: Number of cpu cores)
+             * @param QueueDepth: Max number of waiting events per worker. If a worker is full, the events are queued beyond the depth, so the websocket keeps receiving the heartbeats. @see GetSpilledEventCount
+             * 
+             * @note The controller and the commands are called from multiple threads. The built-in commands config is thread safe, own state which is shared between guilds needs a lock.
+             */
+            virtual void SetEventWorkers(uint32_t Count, uint32_t QueueDepth = 1024) = 0;
+
+            /**
+             * @return Gets the count of events, which were queued beyond the depth of a full worker. A growing count means that a handler is too slow.
+             */
+            virtual uint64_t GetSpilledEventCount() = 0;
+
+            /**
+             * @return Gets the count of received gateway events, which this library doesn't know. Each new event name is logged once.
+             */
+            virtual uint64_t GetUnknownEventCount() = 0;
+
+            /**
+             * @brief Records all received gateway payloads with their timestamps. The file can be replayed with Replay().
+             * 
+             * @param File: Output file.
+             * @param Compress: True to compress the file with zlib (gzip format).
+             * 
+             * @return Returns false if the file can't be created.
+             */
+            virtual bool StartRecording(const std::string &File, bool Compress = true) = 0;
+
+            /**
+             * @brief Stops the recording and closes the file.
+             */
+            virtual void StopRecording() = 0;
+
+            /**
+             * @brief Feeds a recording into the event handlers and the controller without a connection to discord. REST calls and voice connections are disabled during the replay.
+             * Must not be called while the client is running.
+             * 
+             * @param File: Recording of StartRecording().
+             * @param RealTime: True to keep the recorded timing, false to replay as fast as possible.
+             * 
+             * @return Returns the statistics of the replay or null if the file can't be read.
+             */
+            virtual ReplayStats Replay(const std::string &File, bool RealTime = false) = 0;
+
+            /**
+             * @brief Enables the lazy member loading. Guilds with more members than the threshold only contain the bot and the members inside voice channels,
+             * all other members are loaded on demand with RequestMembers() or if they write a message. Presence updates of not loaded members are ignored. Must be called before Run().
+             * 
+             * @param Threshold: Value between 50 and 250 which is sent as large_threshold. 0 disables the lazy member loading. (Default 0)
+             */
+            virtual void SetLargeThreshold(uint32_t Threshold) = 0;
+
+            /**
+             * @brief Sets the number of audio frames (20 ms each), which are encoded before the first packet is sent.
+             * The buffer grows afterwards if the encoding time of the audio source jitters. Used by all following voice connections.
+             * 
+             * @param Frames: Value between 1 and 3. (Default 2)
+             */
+            virtual void SetVoicePreBuffer(uint32_t Frames) = 0;
+
+            /**
+             * @brief Enables the cache of encoded songs. Songs of the music queues which are played again, e.g. in another guild, are sent
+             * from the cache without calling IMusicQueue::OnNext and without encoding. The songs are keyed by CSongInfo::Path. Must be called before songs are queued.
+             * 
+             * @param RAMBytes: Max size of the songs in memory. The least recently played songs are moved to the spill file or dropped.
+             * @param SpillFile: File which is memory mapped for songs which don't fit into memory. Empty to drop them. Only supported on unix. (Default empty)
+             * @param SpillBytes: Size of the spill file. (Default 0)
+             */
+            virtual void SetFrameCache(uint64_t RAMBytes, const std::string &SpillFile = "", uint64_t SpillBytes = 0) = 0;
+
+            /**
+             * @brief Loads guild members by their ids via the gateway. The loaded members are added to the guild. Needs the GUILD_MEMBERS intent.
+             * 
+             * @attention Don't wait for the future inside a controller callback. The chunks are handled by the same event workers, so get() blocks until the timeout.
+             * 
+             * @param guild: Guild of the members.
+             * @param UserIDs: Ids of the members. Ids are sent in batches of 100.
+             * @param TimeoutMS: Milliseconds after which the future is completed with the members received so far. (Default 10000)
+             * 
+             * @return Returns a future, which contains the found members after all chunks are received.
+             */
+            virtual std::future<std::vector<GuildMember>> RequestMembers(Guild guild, const std::vector<std::string> &UserIDs, uint32_t TimeoutMS = 10000) = 0;
+
+            /**
+             * @brief Loads guild members whose username starts with the query via the gateway. The loaded members are added to the guild. Needs the GUILD_MEMBERS intent.
+             * 
+             * @attention Don't wait for the future inside a controller callback. The chunks are handled by the same event workers, so get() blocks until the timeout.
+             * 
+             * @param guild: Guild of the members.
+             * @param Query: Username prefix. An empty query together with a limit of 0 loads all members.
+             * @param Limit: Max number of members. 0 for no limit.
+             * @param TimeoutMS: Milliseconds after which the future is completed with the members received so far. (Default 10000)
+             * 
+             * @return Returns a future, which contains the found members after all chunks are received.
+             */
+            virtual std::future<std::vector<GuildMember>> RequestMembers(Guild guild, const std::string &Query, uint32_t Limit = 0, uint32_t TimeoutMS = 10000) = 0;
+
             /**
              * @brief Adds a song to the music queue.
              * 
@@ -196,20 +356,35 @@ namespace DiscordBot
              * @brief Connects to the given channel and uses the queue to speak.
              * 
              * @param channel: The voice channel to connect to.
+             * @param profile: Settings of the opus encoder for this connection. Null uses the defaults of CEncoderProfile.
+             * The bitrate is limited to the bitrate of the channel.
              * 
              * @return Returns true if the connection succeeded.
              */
-            virtual bool StartSpeaking(Channel channel) = 0;
+            virtual bool StartSpeaking(Channel channel, EncoderProfile profile = nullptr) = 0;
 
             /**
              * @brief Connects to the given channel and uses the source to speak.
              * 
              * @param channel: The voice channel to connect to.
              * @param source: The audio source for speaking.
+             * @param profile: Settings of the opus encoder for this connection. Null uses the defaults of CEncoderProfile.
+             * The bitrate is limited to the bitrate of the channel.
              * 
              * @return Returns true if the connection succeeded.
              */
-            virtual bool StartSpeaking(Channel channel, AudioSource source) = 0;
+            virtual bool StartSpeaking(Channel channel, AudioSource source, EncoderProfile profile = nullptr) = 0;
+
+            /**
+             * @brief Connects to the given channel and plays the broadcast. The same broadcast can play in many guilds,
+             * its audio is encoded once and only encrypted per connection.
+             * 
+             * @param channel: The voice channel to connect to.
+             * @param broadcast: The broadcast to play. Use std::make_shared<CAudioBroadcast>(Source) to create one.
+             * 
+             * @return Returns true if the connection succeeded.
+             */
+            virtual bool StartBroadcast(Channel channel, AudioBroadcast broadcast) = 0;
 
             /**
              * @brief Pauses the audio source. @see ResumeSpeaking to continue streaming.
@@ -232,6 +407,34 @@ namespace DiscordBot
              */
             virtual void StopSpeaking(Guild guild) = 0;
 
+            /**
+             * @brief Mixes a source over the audio which is playing, e.g. a sound effect over music. All sources of a guild share one encoder.
+             * Starts sending if nothing is playing. The mixed sources continue if the song changes.
+             * 
+             * @param guild: The guild to mix into. The bot must be connected to a voice channel of this guild.
+             * @param source: The audio source to mix. It's removed after it returned less samples than requested.
+             * @param Gain: Value between 0.0 and 1.0. (Default 1.0)
+             * 
+             * @return Returns false if the bot isn't connected to a voice channel of the guild.
+             */
+            virtual bool MixAudio(Guild guild, AudioSource source, float Gain = 1.f) = 0;
+
+            /**
+             * @brief Changes the gain of a mixed audio source.
+             * 
+             * @param Gain: Value between 0.0 and 1.0.
+             * 
+             * @return Returns false if the source isn't mixed.
+             */
+            virtual bool SetMixGain(Guild guild, AudioSource source, float Gain) = 0;
+
+            /**
+             * @brief Removes a mixed audio source. @see StopSpeaking stops all audio.
+             * 
+             * @return Returns false if the source isn't mixed.
+             */
+            virtual bool StopMixAudio(Guild guild, AudioSource source) = 0;
+
             /**
              * @brief Removes a song from the queue by its index.
              */
@@ -289,6 +492,16 @@ namespace DiscordBot
              */
             virtual bool IsPlaying(Guild guild) = 0;
 
+            /**
+             * @return Returns the statistics of the voice engine, which sends the audio of all voice connections of the process.
+             */
+            virtual VoiceStats GetVoiceStats() = 0;
+
+            /**
+             * @return Returns the statistics of the cache of encoded songs or null if the cache is disabled. @see SetFrameCache
+             */
+            virtual FrameCacheStats GetFrameCacheStats() = 0;
+
             /**
              * @brief Runs the bot. The call returns if you calls Quit(). @see Quit()
              */
@@ -0,0 +1,126 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef AUDIOBROADCAST_HPP
+#define AUDIOBROADCAST_HPP
+
+#include <controller/IAudioSource.hpp>
+#include <controller/IOpusAudioSource.hpp>
+#include <models/EncoderProfile.hpp>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+#include <config.h>
+
+struct OpusEncoder;
+struct OpusDecoder;
+
+namespace DiscordBot
+{
+    /**
+     * @brief Plays one audio source in many voice connections, e.g. for a radio. Every frame is read and opus encoded once,
+     * the connections only add their own rtp header and encryption.
+     * 
+     * @note Connections which start later join the broadcast live. The source is read as fast as the connection with the largest buffer needs it.
+     */
+    class DISCORDBOT_EXPORT CAudioBroadcast
+    {
+        public:
+            static const uint32_t RING_SIZE = 64;   //!< Frames which are kept for slower connections. Larger than the max buffer of a connection.
+
+            /**
+             * @param Source: Audio source to broadcast.
+             * @param Profile: Settings of the encoder, which are used for all connections. Null uses the defaults of CEncoderProfile. 
+             * Opus sources are sent as they are.
+             */
+            CAudioBroadcast(AudioSource Source, EncoderProfile Profile = nullptr);
+
+            /**
+             * @return Gets the count of frames which were encoded.
+             */
+            uint64_t GetEncodedFrames();
+
+            /**
+             * @brief Called from the voice engine. Gets the index of the frame where a new connection starts.
+             * 
+             * @param Frames: Already encoded frames which the connection may start with, to prevent encoding ahead of the others.
+             */
+            uint64_t Join(uint32_t Frames);
+
+            /**
+             * @brief Called from the voice engine. Copies the frame with the given index and encodes it, if it's the next one.
+             * 
+             * @param Index: Frame to get. Set to the frame which follows the copied one. Skips to the oldest kept frame if the frame was already overwritten.
+             * @param Opus: Receives the opus frame. Must be large enough for a frame of CVoiceStream.
+             * @param OpusSize: Receives the size of the opus frame. 0 for silence, negative on an encoder error.
+             * @param PCM: Receives the samples of the frame, if not null. Used if the connection mixes other sources over the broadcast.
+             * 
+             * @return Returns the samples per channel of the frame. Less than a full frame if the source is finished.
+             */
+            uint32_t Read(uint64_t &Index, uint8_t *Opus, int32_t &OpusSize, uint16_t *PCM);
+
+            ~CAudioBroadcast();
+
+        private:
+            static const uint32_t DECODE_WARMUP = 2;    //!< Packets which are decoded before the needed one, if the decoder skipped packets.
+
+            struct SFrame
+            {
+                uint32_t Samples;
+                int32_t OpusSize;
+                bool Decoded;   //!< PCM contains the samples. False for pre-encoded packets, until a connection needs them.
+                std::vector<uint8_t> Opus;
+                std::vector<uint16_t> PCM;
+            };
+
+            std::mutex m_Lock;
+            AudioSource m_Source;
+            IOpusAudioSource *m_Opus;   //!< Set if the source is pre-encoded.
+            OpusEncoder *m_Encoder;
+            OpusDecoder *m_Decoder;     //!< Decodes pre-encoded packets for connections which mix other sources over the broadcast.
+            bool m_Mono;    //!< The encoder is forced to mono packets.
+            uint32_t m_SilentFrames;    //!< Silent frames in a row.
+
+            std::vector<SFrame> m_Frames;
+            uint64_t m_Next;    //!< Index of the next frame which is encoded.
+            uint64_t m_Decoded; //!< Index of the next frame which is decoded.
+            bool m_Finished;
+
+            /**
+             * @brief Reads and encodes the next frame into the ring.
+             */
+            void EncodeNext();
+
+            /**
+             * @brief Decodes the pre-encoded packets up to the given frame. The packets are decoded in order, so the decoder state stays valid.
+             */
+            void DecodeUntil(uint64_t Index);
+    };
+
+    using AudioBroadcast = std::shared_ptr<CAudioBroadcast>;
+} // namespace DiscordBot
+
+
+#endif //AUDIOBROADCAST_HPP
@@ -64,7 +64,8 @@ namespace DiscordBot
     /**
      * @brief Controller interface which receives events from the client.
      * 
-     * @note All callbacks can called from different threads.
+     * @note The callbacks of different guilds are called concurrently by the event workers, the callbacks of one guild are called in order. @see IDiscordClient::SetEventWorkers
+     *       Own state which is shared between guilds needs a lock. Commands must be registered before IDiscordClient::Run() is called.
      */
     class DISCORDBOT_EXPORT IController
     {
@@ -76,6 +77,15 @@ namespace DiscordBot
              */
             virtual void OnReady() {}
 
+            /**
+             * @brief Called if a shard finished its handshake with discord. OnReady is called after all shards are ready.
+             * 
+             * @param ShardID: Id of the connected shard.
+             * @param ReadyShards: Number of shards which are ready.
+             * @param ShardCount: Total number of shards.
+             */
+            virtual void OnShardReady(uint32_t ShardID, uint32_t ReadyShards, uint32_t ShardCount) {}
+
             /** 
              * @brief Called if the voice state of a guild member updates. Eg. move, connect, disconnect.
              * 
@@ -234,9 +244,17 @@ namespace DiscordBot
                 return IT != m_CommandDescs.end();
             }
 
+            /**
+             * @return Returns the default access mode of a command or AccessMode::OWNER for unknown commands.
+             */
             inline AccessMode GetAccessMode(const std::string &Cmd)
             {
-                return m_CommandDescs[Cmd].Mode;
+                //Never insert here, the commands are read by multiple workers.
+                auto IT = m_CommandDescs.find(Cmd);
+                if(IT == m_CommandDescs.end())
+                    return AccessMode::OWNER;
+
+                return IT->second.Mode;
             }
 
             /**
@@ -0,0 +1,109 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IFORMATAUDIOSOURCE_HPP
+#define IFORMATAUDIOSOURCE_HPP
+
+#include <controller/IAudioSource.hpp>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include <config.h>
+
+namespace DiscordBot
+{
+    class CResampler;
+
+    enum class SampleFormat
+    {
+        S16,    //!< Signed 16 bit integer samples.
+        F32     //!< Float samples between -1.0 and 1.0.
+    };
+
+    /**
+     * @brief Interface for audio in any sample rate, channel count and sample format. The audio is converted to 48000 Hz stereo 16 bit for the voice connection.
+     * 
+     * @note Mono is copied to both channels. More than two channels are mixed down by ITU-R BS.775. The channels must have the WAVE order:
+     * 3: L R C, 4: L R BL BR, 5: L R C BL BR, 6: L R C LFE BL BR, 7: L R C LFE BC SL SR, 8: L R C LFE BL BR SL SR.
+     * The center goes with -3 dB into both sides, the surround channels with -3 dB into their side and the LFE is dropped.
+     */
+    class DISCORDBOT_EXPORT IFormatAudioSource : public IAudioSource
+    {
+        public:
+            static const uint32_t MAX_CHANNELS = 8;
+
+            /**
+             * @param Rate: Sample rate of the audio, e.g. 44100.
+             * @param Channels: Channel count of the audio, between 1 and MAX_CHANNELS.
+             * @param Format: Format of the samples.
+             */
+            IFormatAudioSource(uint32_t Rate, uint32_t Channels, SampleFormat Format);
+
+            /**
+             * @brief Called if more audio data is needed.
+             * 
+             * @param Buf: Buffer for Frames * Channels interleaved samples, int16_t or float like the format of the source.
+             * @param Frames: Samples per channel.
+             * 
+             * @return Must return the filled samples per channel. 0 if the source is finished.
+             */
+            virtual uint32_t OnReadFormat(void *Buf, uint32_t Frames) = 0;
+
+            /**
+             * @brief Converts the audio of OnReadFormat.
+             */
+            uint32_t OnRead(uint16_t *Buf, uint32_t Samples) override;
+
+            virtual ~IFormatAudioSource();
+
+        private:
+            static const uint32_t FREQUENCY = 48000;
+            static const uint32_t CHANNEL = 2;
+            static const uint32_t MAX_FRAMES = 4096;   //!< Max samples per channel of one OnReadFormat call.
+
+            uint32_t m_Rate;
+            uint32_t m_Channels;
+            SampleFormat m_Format;
+            bool m_Finished;
+
+            std::unique_ptr<CResampler> m_Resampler;    //!< Null for 48000 Hz.
+            std::vector<uint8_t> m_In;
+            std::vector<float> m_Float;     //!< Samples of the source as float.
+            std::vector<float> m_Stereo;
+            std::vector<float> m_Out;
+            std::vector<float> m_Downmix;   //!< Left and right gain of each channel, if the source has more than two channels.
+
+            /**
+             * @brief Reads and converts samples of the source to stereo float.
+             * 
+             * @return Returns the samples per channel in m_Stereo.
+             */
+            uint32_t ReadStereo(uint32_t Frames);
+    };
+
+    using FormatAudioSource = std::shared_ptr<IFormatAudioSource>;
+} // namespace DiscordBot
+
+
+#endif //IFORMATAUDIOSOURCE_HPP
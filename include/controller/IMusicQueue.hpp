@@ -27,6 +27,7 @@
 
 #include <memory>
 #include <models/SongInfo.hpp>
+#include <models/EncoderProfile.hpp>
 #include <controller/IAudioSource.hpp>
 #include <vector>
 #include <mutex>
@@ -36,6 +37,8 @@
 
 namespace DiscordBot
 {
+    class CFrameCache;
+
     using OnWaitFinish = std::function<void(const std::string&, AudioSource)>;
 
     /**
@@ -77,6 +80,14 @@ namespace DiscordBot
              */
             virtual AudioSource Next();
 
+            /**
+             * @brief Prepares the audio source of the next song, while the current one is still playing. Called from the client.
+             * The following call of Next() returns the prepared source without calling OnNext again.
+             * 
+             * @return Returns null if there is no next song or if it isn't ready.
+             */
+            AudioSource PrepareNext();
+
             /**
              * @return Returns true if there is a next song.
              */
@@ -103,6 +114,23 @@ namespace DiscordBot
                 m_WaitFinishCallback = Call;
             }
 
+            /**
+             * @brief Called by the client. Songs with a path are played from this cache, if they were played before.
+             */
+            inline void SetFrameCache(std::shared_ptr<CFrameCache> Cache)
+            {
+                m_FrameCache = Cache;
+            }
+
+            /**
+             * @brief Called by the client. Settings of the encoder of the voice connection, which are part of the key of the frame cache.
+             */
+            inline void SetEncoderProfile(EncoderProfile Profile)
+            {
+                std::lock_guard<std::mutex> lock(m_ProfileLock);
+                m_EncoderProfile = Profile;
+            }
+
             virtual ~IMusicQueue() 
             {
                 ClearQueue();
@@ -161,10 +189,17 @@ namespace DiscordBot
              * 
              * @param Info: Song to play.
              * 
+             * @note Isn't called if the song is played from the frame cache. @see IDiscordClient::SetFrameCache
+             * 
              * @return Returns a new audio source to play or null if the song isn't ready.
              */
             virtual AudioSource OnNext(SongInfo Info) = 0;
         private:
+            /**
+             * @brief Gets the audio source of a song from the frame cache or from OnNext.
+             */
+            AudioSource Open(SongInfo Info);
+
             /**
              * @brief Needs to call if a song is not ready to play. For example if you download a song on the fly. Should called in Next.
              */
@@ -182,6 +217,14 @@ namespace DiscordBot
             std::atomic<size_t> m_QueueSize;    //!< Used to prevent dead locks.
             SongInfo m_WaitSong;
 
+            SongInfo m_PreparedSong;
+            AudioSource m_Prepared;
+
+            std::shared_ptr<CFrameCache> m_FrameCache;
+
+            std::mutex m_ProfileLock;
+            EncoderProfile m_EncoderProfile;
+
             std::mutex m_QueueLock;
             std::vector<SongInfo> m_Queue;
     };
@@ -0,0 +1,104 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IOPUSAUDIOSOURCE_HPP
+#define IOPUSAUDIOSOURCE_HPP
+
+#include <controller/IAudioSource.hpp>
+#include <vector>
+#include <stdint.h>
+#include <config.h>
+
+struct OpusDecoder;
+
+namespace DiscordBot
+{
+    /**
+     * @brief Interface for pre-encoded audio. The voice connection sends the opus packets without encoding them again.
+     * 
+     * @note Packets with a duration other than 20 ms, or packets which are played while other sources are mixed over them,
+     * are decoded and encoded again.
+     */
+    class DISCORDBOT_EXPORT IOpusAudioSource : public IAudioSource
+    {
+        public:
+            static const uint32_t MAX_PACKET_SIZE = 1275;   //!< Max size of an opus packet.
+
+            IOpusAudioSource();
+
+            /**
+             * @brief Called if the next opus packet is needed.
+             * 
+             * @param Buf: Buffer for the packet.
+             * @param Size: Size of the buffer, at least MAX_PACKET_SIZE.
+             * 
+             * @note The packets must be encoded with 48000 Hz. Mono and stereo packets are allowed.
+             * 
+             * @return Must return the size of the packet. 0 if the source is finished.
+             */
+            virtual uint32_t OnReadOpus(uint8_t *Buf, uint32_t Size) = 0;
+
+            /**
+             * @brief Decodes the packets to pcm. Used if the packets can't be sent as they are.
+             */
+            uint32_t OnRead(uint16_t *Buf, uint32_t Samples) override;
+
+            /**
+             * @brief Called from the voice engine. Reads the next packet, which is sent as it is if it has a duration of 20 ms.
+             * 
+             * @param Buf: Buffer for the packet.
+             * @param Size: Size of the buffer.
+             * @param PCM: Receives the decoded packet, if not null.
+             * 
+             * @return Returns the size of the packet. Returns 0 if the source is finished or a negative value if the audio must be read with OnRead.
+             */
+            int32_t ReadPacket(uint8_t *Buf, uint32_t Size, uint16_t *PCM = nullptr);
+
+            virtual ~IOpusAudioSource();
+
+        private:
+            static const int FREQUENCY = 48000;
+            static const int CHANNEL = 2;
+            static const int FRAME_SAMPLES = FREQUENCY / 50;       //!< Samples per channel of 20 ms.
+            static const int MAX_FRAME_SAMPLES = FREQUENCY * 3 / 25; //!< Samples per channel of the longest opus packet, 120 ms.
+
+            OpusDecoder *m_Decoder;
+            bool m_Finished;
+
+            std::vector<uint8_t> m_Packet;
+            std::vector<uint16_t> m_PCM;
+            uint32_t m_PCMPos;
+            uint32_t m_PCMSize;
+
+            /**
+             * @brief Decodes a packet into the pcm buffer.
+             */
+            void Decode(const uint8_t *Packet, uint32_t Size);
+    };
+
+    using OpusAudioSource = std::shared_ptr<IOpusAudioSource>;
+} // namespace DiscordBot
+
+
+#endif //IOPUSAUDIOSOURCE_HPP
@@ -0,0 +1,129 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef OGGOPUSSOURCE_HPP
+#define OGGOPUSSOURCE_HPP
+
+#include <controller/IOpusAudioSource.hpp>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <config.h>
+
+namespace DiscordBot
+{
+    /**
+     * @brief Streams the opus packets of an Ogg/Opus file or stream. The packets are read page by page, so the source can be e.g. a network stream.
+     * 
+     * @note Chained streams are played one after another, other multiplexed streams are skipped. Streams with more than two channels aren't supported.
+     * The pre-skip of the encoder isn't removed. Damaged pages are skipped by their checksum.
+     */
+    class DISCORDBOT_EXPORT COggOpusSource : public IOpusAudioSource
+    {
+        public:
+            /**
+             * @param File: Path of the .opus or .ogg file.
+             */
+            COggOpusSource(const std::string &File);
+
+            /**
+             * @param Stream: Binary stream which contains the Ogg/Opus data. Read as needed.
+             */
+            COggOpusSource(std::shared_ptr<std::istream> Stream);
+
+            /**
+             * @return Returns false if the stream can't be read.
+             */
+            bool IsOpen() const
+            {
+                return m_Stream && m_Stream->good();
+            }
+
+            uint32_t OnReadOpus(uint8_t *Buf, uint32_t Size) override;
+
+        private:
+            static const uint8_t FLAG_CONTINUED = 0x01;
+            static const uint8_t FLAG_BOS = 0x02;
+            static const uint8_t FLAG_EOS = 0x04;
+            static const size_t HEADER_SIZE = 27;
+            static const size_t CRC_OFFSET = 22;
+
+            std::shared_ptr<std::istream> m_Stream;
+            std::vector<uint8_t> m_Rescan;  //!< Bytes of an invalid page, which are searched again for a capture pattern before the stream is read.
+            size_t m_RescanPos;
+
+            bool m_HasSerial;
+            uint32_t m_Serial;      //!< Serial of the played logical stream.
+            bool m_Headers;         //!< The next packet is a header of the opus stream.
+
+            //Current page.
+            uint8_t m_PageFlags;
+            uint32_t m_NextPageNo;  //!< Expected sequence number of the next page.
+            bool m_PageLost;        //!< A page before the current one is missing.
+            std::vector<uint8_t> m_Lacing;
+            size_t m_Segment;
+            std::vector<uint8_t> m_Body;
+            size_t m_BodyPos;
+
+            std::vector<uint8_t> m_Packet;
+
+            /**
+             * @brief Reads from the rescan buffer and then from the stream.
+             * 
+             * @return Returns false if not enough bytes are left.
+             */
+            bool Read(uint8_t *Buf, size_t Size);
+
+            /**
+             * @brief Computes the crc32 of an Ogg page. The crc field of the header must be zeroed.
+             */
+            static uint32_t PageCRC(const uint8_t *Header, const std::vector<uint8_t> &Lacing, const std::vector<uint8_t> &Body);
+
+            /**
+             * @brief Reads the next page of the played logical stream. Pages with an unknown version or a wrong checksum are skipped.
+             * 
+             * @return Returns false at the end of the stream.
+             */
+            bool ReadPage();
+
+            /**
+             * @brief Assembles the next packet of the played logical stream, also over page boundaries.
+             * 
+             * @return Returns false at the end of the stream.
+             */
+            bool ReadPacket();
+
+            /**
+             * @brief Checks the OpusHead packet.
+             * 
+             * @return Returns false if the stream isn't supported.
+             */
+            bool ParseHead();
+    };
+} // namespace DiscordBot
+
+
+#endif //OGGOPUSSOURCE_HPP
@@ -37,6 +37,7 @@ namespace DiscordBot
         PARAMETER_IS_NULL,      //!< Throws if a required parameter is a nullptr.
         MISSING_USER_REF,       //!< Throws if a user reference is null.
         ACTION_ALREADY_REG,     //!< Throws if the given action is already registered.
+        UNKNOWN_EVENT,          //!< Throws if a handler is registered for an event, which isn't a gateway event.
     };
 
     class CDiscordClientException : public std::exception
@@ -0,0 +1,71 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ENCODERPROFILE_HPP
+#define ENCODERPROFILE_HPP
+
+#include <memory>
+#include <string>
+#include <stdint.h>
+
+namespace DiscordBot
+{
+    enum class EncoderApplication
+    {
+        AUDIO,      //!< Best quality for music.
+        VOIP,       //!< Best intelligibility for speech.
+        LOWDELAY    //!< Lowest delay, disables the speech optimizations.
+    };
+
+    /**
+     * @brief Settings of the opus encoder of a voice connection. @see IDiscordClient::StartSpeaking
+     */
+    class CEncoderProfile
+    {
+        public:
+            CEncoderProfile() : Application(EncoderApplication::AUDIO), Bitrate(0), Complexity(10), FEC(false), PacketLossPerc(0), DTX(false), VBR(true) {}
+
+            EncoderApplication Application;
+            uint32_t Bitrate;           //!< Bits per second. 0 uses the bitrate of the voice channel. Higher values are limited to the bitrate of the channel.
+            uint32_t Complexity;        //!< 0 to 10. Lower values need less cpu time per stream, with a lower quality.
+            bool FEC;                   //!< Inband forward error correction, which recovers lost packets. Only used if PacketLossPerc isn't 0.
+            uint32_t PacketLossPerc;    //!< Expected packet loss in percent, 0 to 100.
+            bool DTX;                   //!< Discontinuous transmission, which reduces the bitrate during silence.
+            bool VBR;                   //!< Variable bitrate.
+
+            /**
+             * @return Gets a key which is equal for profiles with the same settings.
+             */
+            inline std::string GetKey() const
+            {
+                return std::to_string((int)Application) + "/" + std::to_string(Bitrate) + "/" + std::to_string(Complexity) + "/" + std::to_string(FEC) + "/" + 
+                       std::to_string(PacketLossPerc) + "/" + std::to_string(DTX) + "/" + std::to_string(VBR);
+            }
+    };
+
+    using EncoderProfile = std::shared_ptr<CEncoderProfile>;
+} // namespace DiscordBot
+
+
+#endif //ENCODERPROFILE_HPP
@@ -0,0 +1,59 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FRAMECACHESTATS_HPP
+#define FRAMECACHESTATS_HPP
+
+#include <memory>
+#include <stdint.h>
+
+namespace DiscordBot
+{
+    /**
+     * @brief Statistics of the cache of encoded songs. @see IDiscordClient::SetFrameCache
+     */
+    class CFrameCacheStats
+    {
+        public:
+            CFrameCacheStats() : Hits(0), Misses(0), Entries(0), RAMBytes(0), DiskBytes(0), Spills(0), Evictions(0) {}
+
+            uint64_t Hits;          //!< Number of songs which were played from the cache.
+            uint64_t Misses;        //!< Number of songs which had to be encoded.
+            uint32_t Entries;       //!< Number of cached songs, in memory and on disk.
+            uint64_t RAMBytes;      //!< Size of the songs in memory.
+            uint64_t DiskBytes;     //!< Size of the songs in the spill file.
+            uint64_t Spills;        //!< Number of songs which were moved from memory to the spill file.
+            uint64_t Evictions;     //!< Number of songs which were dropped from the cache.
+
+            inline double GetHitRate() const
+            {
+                return (Hits + Misses) != 0 ? (double)Hits / (Hits + Misses) : 0.0;
+            }
+    };
+
+    using FrameCacheStats = std::shared_ptr<CFrameCacheStats>;
+} // namespace DiscordBot
+
+
+#endif //FRAMECACHESTATS_HPP
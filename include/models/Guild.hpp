@@ -44,6 +44,7 @@ namespace DiscordBot
             atomic<std::string> ID;
             atomic<std::string> Name;
             atomic<std::string> Icon;
+            atomic<std::string> OwnerID;
 
             GuildMember Owner;
 
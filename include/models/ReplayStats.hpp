@@ -0,0 +1,72 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef REPLAYSTATS_HPP
+#define REPLAYSTATS_HPP
+
+#include <memory>
+#include <string>
+#include <map>
+#include <stdint.h>
+
+namespace DiscordBot
+{
+    /**
+     * @brief Handler latency of one event type. The latency is measured from receiving the event until its handler returns.
+     */
+    class CEventLatency
+    {
+        public:
+            CEventLatency() : Count(0), TotalUS(0), MaxUS(0) {}
+
+            uint64_t Count;
+            uint64_t TotalUS;   //!< Sum of all latencies in microseconds.
+            uint64_t MaxUS;     //!< Highest latency in microseconds.
+
+            inline double GetAverageUS() const
+            {
+                return Count != 0 ? (double)TotalUS / Count : 0.0;
+            }
+    };
+
+    /**
+     * @brief Result of IDiscordClient::Replay().
+     */
+    class CReplayStats
+    {
+        public:
+            CReplayStats() : Events(0), DurationMS(0), EventsPerSecond(0), PeakRSSKB(0) {}
+
+            uint64_t Events;                                //!< Number of replayed dispatch events.
+            uint64_t DurationMS;                            //!< Time until all events were handled.
+            double EventsPerSecond;
+            uint64_t PeakRSSKB;                             //!< Peak resident memory of the process in KB. 0 if unsupported.
+            std::map<std::string, CEventLatency> Latencies; //!< Latency per event type.
+    };
+
+    using ReplayStats = std::shared_ptr<CReplayStats>;
+} // namespace DiscordBot
+
+
+#endif //REPLAYSTATS_HPP
@@ -0,0 +1,78 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VOICESTATS_HPP
+#define VOICESTATS_HPP
+
+#include <memory>
+#include <string>
+#include <map>
+#include <stdint.h>
+
+namespace DiscordBot
+{
+    /**
+     * @brief Pacing of the audio packets of one voice connection. The deadline of a packet is the start of its 20 ms tick.
+     */
+    class CVoiceConnectionStats
+    {
+        public:
+            CVoiceConnectionStats() : Packets(0), LateFrames(0), MaxLatenessUS(0), JitterUS(0) {}
+
+            uint64_t Packets;           //!< Number of sent audio packets.
+            uint64_t LateFrames;        //!< Number of packets which were sent more than half a frame after their deadline.
+            uint64_t MaxLatenessUS;     //!< Highest delay between the deadline and the send of a packet in microseconds.
+            double JitterUS;            //!< Smoothed inter-packet jitter in microseconds, calculated like the interarrival jitter of RFC 3550.
+    };
+
+    /**
+     * @brief Statistics of the voice engine, which sends the audio of all voice connections of the process in 20 ms ticks.
+     */
+    class CVoiceStats
+    {
+        public:
+            CVoiceStats() : Ticks(0), SkippedTicks(0), Streams(0), Packets(0), SendErrors(0), TickCPUUS(0), MaxTickCPUUS(0), TotalTickCPUUS(0), TickUS(0) {}
+
+            uint64_t Ticks;             //!< Number of ticks with at least one active stream.
+            uint64_t SkippedTicks;      //!< Number of ticks which were dropped after a stall, instead of being caught up.
+            uint32_t Streams;           //!< Number of active streams.
+            uint64_t Packets;           //!< Number of sent audio packets.
+            uint64_t SendErrors;        //!< Number of packets which couldn't be sent.
+            uint64_t TickCPUUS;         //!< CPU time of the last tick over all workers in microseconds.
+            uint64_t MaxTickCPUUS;      //!< Highest CPU time of a tick in microseconds.
+            uint64_t TotalTickCPUUS;    //!< Sum of the CPU time of all ticks in microseconds.
+            uint64_t TickUS;            //!< Time from the start of the last tick until all packets were sent and the next frames encoded in microseconds.
+            std::map<std::string, CVoiceConnectionStats> Connections;  //!< Pacing per guild id.
+
+            inline double GetAverageCPUUS() const
+            {
+                return Ticks != 0 ? (double)TotalTickCPUUS / Ticks : 0.0;
+            }
+    };
+
+    using VoiceStats = std::shared_ptr<CVoiceStats>;
+} // namespace DiscordBot
+
+
+#endif //VOICESTATS_HPP
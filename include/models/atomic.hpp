@@ -120,6 +120,14 @@ namespace DiscordBot
                 return {m_Lock, &m_Value};
             }
 
+            /**
+             * @brief Locks the value until the returned lock is destroyed. Used to run several calls like find and erase as one step.
+             */
+            inline std::unique_lock<std::recursive_mutex> Lock()
+            {
+                return std::unique_lock<std::recursive_mutex>(m_Lock);
+            }
+
             ~atomic() {}
 
         private:
@@ -0,0 +1,195 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <controller/AudioBroadcast.hpp>
+#include <Log.hpp>
+#include <opus.h>
+#include <string.h>
+#include <algorithm>
+#include "VoiceStream.hpp"
+
+namespace DiscordBot
+{
+    const uint32_t CAudioBroadcast::RING_SIZE;
+    const uint32_t CAudioBroadcast::DECODE_WARMUP;
+
+    CAudioBroadcast::CAudioBroadcast(AudioSource Source, EncoderProfile Profile) : m_Source(Source), m_Opus(dynamic_cast<IOpusAudioSource*>(Source.get())), m_Encoder(nullptr), m_Decoder(nullptr), m_Mono(false), m_SilentFrames(0), m_Next(0), m_Decoded(0), m_Finished(false)
+    {
+        m_Frames.resize(RING_SIZE);
+        for (auto &&e : m_Frames)
+        {
+            e.Samples = 0;
+            e.OpusSize = 0;
+            e.Decoded = true;
+            e.Opus.resize(CVoiceStream::MAX_OPUS_SIZE);
+            e.PCM.resize(CVoiceStream::FREQUENCY * CVoiceStream::CHANNEL * CVoiceStream::MILLISECONDS / 1000);
+        }
+
+        m_Encoder = CVoiceStream::CreateEncoder(Profile);
+    }
+
+    /**
+     * @return Gets the count of frames which were encoded.
+     */
+    uint64_t CAudioBroadcast::GetEncodedFrames()
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        return m_Next;
+    }
+
+    /**
+     * @brief Called from the voice engine. Gets the index of the frame where a new connection starts.
+     */
+    uint64_t CAudioBroadcast::Join(uint32_t Frames)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        return m_Next - std::min<uint64_t>(std::min(Frames, RING_SIZE), m_Next);
+    }
+
+    /**
+     * @brief Called from the voice engine. Copies the frame with the given index and encodes it, if it's the next one.
+     */
+    uint32_t CAudioBroadcast::Read(uint64_t &Index, uint8_t *Opus, int32_t &OpusSize, uint16_t *PCM)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+
+        //The connection is too slow, the frame was already overwritten.
+        if(m_Next > RING_SIZE && Index < m_Next - RING_SIZE)
+            Index = m_Next - RING_SIZE;
+
+        if(Index >= m_Next)
+        {
+            if(m_Finished)
+            {
+                OpusSize = 0;
+                return 0;
+            }
+
+            EncodeNext();
+            Index = m_Next - 1;
+        }
+
+        const SFrame &Frame = m_Frames[Index % RING_SIZE];
+        OpusSize = Frame.OpusSize;
+        if(Frame.OpusSize > 0)
+            memcpy(Opus, Frame.Opus.data(), Frame.OpusSize);
+
+        if(PCM)
+        {
+            if(!Frame.Decoded)
+                DecodeUntil(Index);
+
+            memcpy(PCM, Frame.PCM.data(), Frame.PCM.size() * sizeof(uint16_t));
+        }
+
+        Index++;
+        return Frame.Samples;
+    }
+
+    /**
+     * @brief Reads and encodes the next frame into the ring.
+     */
+    void CAudioBroadcast::EncodeNext()
+    {
+        SFrame &Frame = m_Frames[m_Next % RING_SIZE];
+        uint32_t Samples = Frame.PCM.size() / CVoiceStream::CHANNEL;
+
+        //Pre-encoded packets are kept as they are. They are only decoded if a connection mixes other sources over the broadcast.
+        int32_t Size = m_Opus ? m_Opus->ReadPacket(Frame.Opus.data(), Frame.Opus.size()) : -1;
+        if(Size > 0)
+        {
+            Frame.Samples = Samples;
+            Frame.OpusSize = Size;
+            Frame.Decoded = false;
+            m_Next++;
+            return;
+        }
+
+        Frame.Decoded = true;
+
+        Frame.Samples = m_Source->OnRead(Frame.PCM.data(), Samples);
+        if(Frame.Samples < Samples)
+        {
+            memset(Frame.PCM.data() + Frame.Samples * CVoiceStream::CHANNEL, 0, (Samples - Frame.Samples) * CVoiceStream::CHANNEL * sizeof(uint16_t));
+            m_Finished = true;
+        }
+
+        //During a longer silence the connections send their silence frames instead.
+        if(!m_Encoder)
+            Frame.OpusSize = -1;
+        else if(Frame.Samples == 0)
+            Frame.OpusSize = 0;
+        else
+            Frame.OpusSize = CVoiceStream::EncodeFrame(m_Encoder, Frame.PCM.data(), Samples, Frame.Opus.data(), Frame.Opus.size(), m_Mono, m_SilentFrames);
+
+        m_Next++;
+    }
+
+    void CAudioBroadcast::DecodeUntil(uint64_t Index)
+    {
+        if(!m_Decoder)
+        {
+            int err;
+            m_Decoder = opus_decoder_create(CVoiceStream::FREQUENCY, CVoiceStream::CHANNEL, &err);
+            if(err)
+            {
+                llog << lerror << "Error to create opus decoder" << lendl;
+                m_Decoder = nullptr;
+            }
+        }
+
+        //Nobody needed the packets in between. The decoder starts again a few packets before, which is enough to settle its state.
+        uint64_t Oldest = m_Next > RING_SIZE ? m_Next - RING_SIZE : 0;
+        uint64_t Start = std::max(Oldest, Index - std::min<uint64_t>(Index, DECODE_WARMUP));
+        if(m_Decoded < Start)
+        {
+            if(m_Decoder)
+                opus_decoder_ctl(m_Decoder, OPUS_RESET_STATE);
+
+            m_Decoded = Start;
+        }
+
+        for (; m_Decoded <= Index; m_Decoded++)
+        {
+            SFrame &Frame = m_Frames[m_Decoded % RING_SIZE];
+            if(Frame.Decoded)
+                continue;
+
+            int Ret = m_Decoder ? opus_decode(m_Decoder, Frame.Opus.data(), Frame.OpusSize, (opus_int16*)Frame.PCM.data(), Frame.Samples, 0) : -1;
+            if(Ret < 0)
+                memset(Frame.PCM.data(), 0, Frame.PCM.size() * sizeof(uint16_t));
+
+            Frame.Decoded = true;
+        }
+    }
+
+    CAudioBroadcast::~CAudioBroadcast()
+    {
+        if(m_Encoder)
+            opus_encoder_destroy(m_Encoder);
+
+        if(m_Decoder)
+            opus_decoder_destroy(m_Decoder);
+    }
+} // namespace DiscordBot
@@ -0,0 +1,129 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "AudioMixer.hpp"
+#include <algorithm>
+#include "../helpers/AudioKernels.hpp"
+
+namespace DiscordBot
+{
+    CAudioMixer::CAudioMixer(uint32_t Channels, uint32_t MaxSamples) : m_Channels(Channels), m_Count(0)
+    {
+        m_Buffer.resize(Channels * MaxSamples);
+    }
+
+    /**
+     * @brief Adds a source or changes the gain of an already added one.
+     */
+    void CAudioMixer::Add(AudioSource Source, float Gain)
+    {
+        if(!Source)
+            return;
+
+        std::lock_guard<std::mutex> lock(m_Lock);
+        for (auto &&e : m_Inputs)
+        {
+            if(e.Source == Source)
+            {
+                e.Gain = CAudioKernels::ToGain(Gain);
+                return;
+            }
+        }
+
+        m_Inputs.push_back({Source, CAudioKernels::ToGain(Gain)});
+        m_Count = m_Inputs.size();
+    }
+
+    /**
+     * @brief Changes the gain of a source.
+     */
+    bool CAudioMixer::SetGain(AudioSource Source, float Gain)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        for (auto &&e : m_Inputs)
+        {
+            if(e.Source == Source)
+            {
+                e.Gain = CAudioKernels::ToGain(Gain);
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Removes a source.
+     */
+    bool CAudioMixer::Remove(AudioSource Source)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        auto IT = std::find_if(m_Inputs.begin(), m_Inputs.end(), [&Source](const SInput &e){ return e.Source == Source; });
+        if(IT == m_Inputs.end())
+            return false;
+
+        m_Inputs.erase(IT);
+        m_Count = m_Inputs.size();
+        return true;
+    }
+
+    /**
+     * @brief Removes all sources.
+     */
+    void CAudioMixer::Clear()
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Inputs.clear();
+        m_Count = 0;
+    }
+
+    /**
+     * @brief Encoding thread only. Reads all sources and adds them to the frame.
+     */
+    uint32_t CAudioMixer::Mix(uint16_t *Frame, uint32_t Samples)
+    {
+        uint32_t Ret = 0;
+        Samples = std::min(Samples, (uint32_t)(m_Buffer.size() / m_Channels));
+
+        std::lock_guard<std::mutex> lock(m_Lock);
+        for (size_t i = 0; i < m_Inputs.size();)
+        {
+            SInput &Input = m_Inputs[i];
+            uint32_t Read = Input.Source->OnRead(m_Buffer.data(), Samples);
+            Read = std::min(Read, Samples);
+
+            CAudioKernels::MixSaturate((int16_t*)Frame, (const int16_t*)m_Buffer.data(), Read * m_Channels, Input.Gain);
+            Ret = std::max(Ret, Read);
+
+            //The source is finished.
+            if(Read < Samples)
+                m_Inputs.erase(m_Inputs.begin() + i);
+            else
+                i++;
+        }
+
+        m_Count = m_Inputs.size();
+        return Ret;
+    }
+} // namespace DiscordBot
@@ -0,0 +1,114 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef AUDIOMIXER_HPP
+#define AUDIOMIXER_HPP
+
+#include <controller/IAudioSource.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+namespace DiscordBot
+{
+    /**
+     * @brief Sums any number of audio sources with a gain per source into the frame of a voice stream, so all of them share one encoder.
+     * Sources are removed after they returned less samples than requested.
+     */
+    class CAudioMixer
+    {
+        public:
+            /**
+             * @param Channels: Channel count of the sources.
+             * @param MaxSamples: Max samples per channel of one frame.
+             */
+            CAudioMixer(uint32_t Channels, uint32_t MaxSamples);
+
+            /**
+             * @brief Adds a source or changes the gain of an already added one.
+             * 
+             * @param Gain: Value between 0.0 and 1.0.
+             */
+            void Add(AudioSource Source, float Gain);
+
+            /**
+             * @brief Changes the gain of a source.
+             * 
+             * @return Returns false if the source isn't mixed.
+             */
+            bool SetGain(AudioSource Source, float Gain);
+
+            /**
+             * @brief Removes a source.
+             * 
+             * @return Returns false if the source isn't mixed.
+             */
+            bool Remove(AudioSource Source);
+
+            /**
+             * @brief Removes all sources.
+             */
+            void Clear();
+
+            /**
+             * @return Returns true if no source is mixed.
+             */
+            bool Empty() const
+            {
+                return m_Count == 0;
+            }
+
+            /**
+             * @brief Encoding thread only. Reads all sources and adds them to the frame.
+             * 
+             * @param Frame: Frame to mix into. Must contain silence where nothing was written before.
+             * @param Samples: Samples per channel of the frame.
+             * 
+             * @return Returns the most samples per channel which one of the sources has returned.
+             */
+            uint32_t Mix(uint16_t *Frame, uint32_t Samples);
+
+        private:
+            struct SInput
+            {
+                AudioSource Source;
+                uint16_t Gain;      //!< Q15
+            };
+
+            uint32_t m_Channels;
+
+            std::mutex m_Lock;
+            std::vector<SInput> m_Inputs;
+            std::atomic<size_t> m_Count;
+
+            std::vector<uint16_t> m_Buffer;
+    };
+
+    using AudioMixer = std::shared_ptr<CAudioMixer>;
+} // namespace DiscordBot
+
+
+#endif //AUDIOMIXER_HPP
@@ -33,6 +33,7 @@
 
 #ifdef DISCORDBOT_UNIX
 #include <signal.h>
+#include <sys/resource.h>
 #endif
 
 namespace DiscordBot
@@ -49,7 +50,7 @@ namespace DiscordBot
         return DiscordClient(new CDiscordClient(Token, Intents));
     }
 
-    CDiscordClient::CDiscordClient(const std::string &Token, Intent Intents) : m_Intents(Intents), m_Token(Token), m_Terminate(false), m_HeartACKReceived(false), m_Quit(false), m_LastSeqNum(-1), m_IsAFK(false), m_State(OnlineState::ONLINE)
+    CDiscordClient::CDiscordClient(const std::string &Token, Intent Intents) : m_Intents(Intents), m_Token(Token), m_APIURL("https://discord.com/api"), m_Quit(false), m_ShardCount(0), m_StartTime(0), m_Compress(false), m_Encoding(GatewayEncoding::JSON), m_WorkerCount(std::max(std::thread::hardware_concurrency(), 1u)), m_WorkerQueueDepth(1024), m_Offline(false), m_LargeThreshold(0), m_VoicePreBuffer(2), m_IsAFK(false), m_State(OnlineState::ONLINE)
     {
 #ifdef DISCORDBOT_UNIX
         //Ignores the SIGPIPE signal.
@@ -58,16 +59,19 @@ namespace DiscordBot
         USER_AGENT = std::string("libDiscordBot (https://github.com/tostc/libDiscordBot, ") + VERSION + ")";
 
         m_EVManger.SubscribeMessage(QUEUE_NEXT_SONG, std::bind(&CDiscordClient::OnMessageReceive, this, std::placeholders::_1));  
+        m_EVManger.SubscribeMessage(PREFETCH_NEXT_SONG, std::bind(&CDiscordClient::OnMessageReceive, this, std::placeholders::_1));  
         m_EVManger.SubscribeMessage(RESUME, std::bind(&CDiscordClient::OnMessageReceive, this, std::placeholders::_1));  
         m_EVManger.SubscribeMessage(RECONNECT, std::bind(&CDiscordClient::OnMessageReceive, this, std::placeholders::_1));   
+        m_EVManger.SubscribeMessage(VOICE_RESUME, std::bind(&CDiscordClient::OnMessageReceive, this, std::placeholders::_1));   
+        m_EVManger.SubscribeMessage(REQUEST_OWNERS, std::bind(&CDiscordClient::OnMessageReceive, this, std::placeholders::_1));   
         m_EVManger.SubscribeMessage(QUIT, std::bind(&CDiscordClient::OnMessageReceive, this, std::placeholders::_1));   
+        RegisterEvents();
 
         //Disable client side checking.
         ix::SocketTLSOptions DisabledTrust;
         DisabledTrust.caFile = "NONE";
 
         m_HTTPClient.setTLSOptions(DisabledTrust);
-        m_Socket.setTLSOptions(DisabledTrust);
     }
 
     void CDiscordClient::SetState(OnlineState state)
@@ -89,6 +93,166 @@ namespace DiscordBot
         UpdateUserInfo();
     }
 
+    void CDiscordClient::SetShardCount(uint32_t Count)
+    {
+        m_ShardCount = Count;
+    }
+
+    void CDiscordClient::SetTransportCompression(bool Enable)
+    {
+        m_Compress = Enable;
+    }
+
+    void CDiscordClient::SetEventWorkers(uint32_t Count, uint32_t QueueDepth)
+    {
+        m_WorkerCount = Count;
+        m_WorkerQueueDepth = QueueDepth;
+    }
+
+    uint64_t CDiscordClient::GetSpilledEventCount()
+    {
+        return m_Workers.GetSpilled();
+    }
+
+    uint64_t CDiscordClient::GetUnknownEventCount()
+    {
+        return m_Events.GetUnknownEventCount();
+    }
+
+    bool CDiscordClient::StartRecording(const std::string &File, bool Compress)
+    {
+        return m_Recorder.Open(File, Compress);
+    }
+
+    void CDiscordClient::StopRecording()
+    {
+        m_Recorder.Close();
+    }
+
+    void CDiscordClient::SetAPIURL(const std::string &URL)
+    {
+        m_APIURL = URL;
+    }
+
+    void CDiscordClient::SetGatewayURL(const std::string &URL)
+    {
+        m_GatewayURL = URL;
+    }
+
+    void CDiscordClient::SetLargeThreshold(uint32_t Threshold)
+    {
+        //Discord only accepts values between 50 and 250.
+        m_LargeThreshold = Threshold != 0 ? std::min(std::max(Threshold, 50u), 250u) : 0;
+    }
+
+    void CDiscordClient::SetVoicePreBuffer(uint32_t Frames)
+    {
+        m_VoicePreBuffer = std::min(std::max(Frames, 1u), CVoiceStream::MAX_PREBUFFER);
+    }
+
+    void CDiscordClient::SetFrameCache(uint64_t RAMBytes, const std::string &SpillFile, uint64_t SpillBytes)
+    {
+        if(RAMBytes == 0)
+            m_FrameCache = nullptr;
+        else
+            m_FrameCache = FrameCache(new CFrameCache(RAMBytes, SpillFile, SpillBytes));
+    }
+
+    std::future<std::vector<GuildMember>> CDiscordClient::RequestMembers(Guild guild, const std::vector<std::string> &UserIDs, uint32_t TimeoutMS)
+    {
+        const size_t MAX_USER_IDS = 100;
+        std::vector<std::vector<std::string>> Batches;
+
+        for (size_t i = 0; i < UserIDs.size(); i += MAX_USER_IDS)
+            Batches.emplace_back(UserIDs.begin() + i, UserIDs.begin() + std::min(i + MAX_USER_IDS, UserIDs.size()));
+
+        return SendMemberRequests(guild, Batches, "", 0, TimeoutMS);
+    }
+
+    std::future<std::vector<GuildMember>> CDiscordClient::RequestMembers(Guild guild, const std::string &Query, uint32_t Limit, uint32_t TimeoutMS)
+    {
+        return SendMemberRequests(guild, {std::vector<std::string>()}, Query, Limit, TimeoutMS);
+    }
+
+    std::future<std::vector<GuildMember>> CDiscordClient::SendMemberRequests(Guild guild, const std::vector<std::vector<std::string>> &Batches, const std::string &Query, uint32_t Limit, uint32_t TimeoutMS, bool Background)
+    {
+        std::vector<std::string> Nonces;
+        auto Ret = m_MemberRequests.Add(guild ? Batches.size() : 0, Nonces, TimeoutMS);
+
+        for (size_t i = 0; i < Nonces.size(); i++)
+        {
+            CJSON json;
+            json.AddPair("guild_id", guild->ID.load());
+
+            if(!Batches[i].empty())
+                json.AddPair("user_ids", Batches[i]);
+            else
+                json.AddPair("query", Query);
+
+            json.AddPair("limit", Limit);
+            json.AddPair("nonce", Nonces[i]);
+
+            SendOP(OPCodes::REQUEST_GUILD_MEMBERS, json.Serialize(), guild->ID, Background);
+        }
+
+        return Ret;
+    }
+
+    void CDiscordClient::RequestOwners()
+    {
+        std::vector<Guild> Pending;
+        {
+            auto lock = m_PendingOwners.Lock();
+            m_PendingOwners->swap(Pending);
+        }
+
+        //The gateway only accepts one guild per request, so the owners of the batch are sent behind all other payloads of their shard.
+        for (auto &&e : Pending)
+        {
+            if(!e->Owner)
+                SendMemberRequests(e, {std::vector<std::string>{e->OwnerID}}, "", 0, OWNER_REQUEST_TIMEOUT, true);
+        }
+
+        if(!Pending.empty())
+        {
+            llog << linfo << "Requested the owners of " << Pending.size() << " guild(s)" << lendl;
+            m_EVManger.PostMessage(CHECK_OWNERS, Pending, OWNER_REQUEST_TIMEOUT);
+        }
+    }
+
+    void CDiscordClient::CheckOwners(const std::vector<Guild> &Requested)
+    {
+        for (auto &&e : Requested)
+        {
+            //The owner is set on the worker of the guild, like by the member chunks.
+            Guild guild = e;
+            m_Workers.Post(ParseSnowflake(guild->ID), [this, guild]()
+            {
+                if(guild->Owner)
+                    return;
+
+                {
+                    auto lock = m_Guilds.Lock();
+                    if(m_Guilds->find(guild->ID) == m_Guilds->end())
+                        return;
+                }
+
+                llog << linfo << "Owner request of guild " << guild->ID.load() << " timed out" << lendl;
+                guild->Owner = GetMember(guild, guild->OwnerID);
+            }, false);
+        }
+    }
+
+    void CDiscordClient::SetGatewayEncoding(GatewayEncoding Encoding)
+    {
+        m_Encoding = Encoding;
+    }
+
+    uint32_t CDiscordClient::GetReadyShardCount()
+    {
+        return (uint32_t)std::count_if(m_Shards.begin(), m_Shards.end(), [](const Shard &e) { return e->IsReady(); });
+    }
+
     std::string CDiscordClient::CreateUserInfoJSON()
     {
         CJSON json;
@@ -117,7 +281,7 @@ namespace DiscordBot
 
     void CDiscordClient::UpdateUserInfo()
     {        
-        SendOP(OPCodes::PRESENCE_UPDATE, CreateUserInfoJSON());
+        BroadcastOP(OPCodes::PRESENCE_UPDATE, CreateUserInfoJSON());
     }
 
     void CDiscordClient::ChangeVoiceState(const std::string &Guild, const std::string &Channel)
@@ -133,7 +297,7 @@ namespace DiscordBot
         json.AddPair("self_mute", false);
         json.AddPair("self_deaf", false);
 
-        SendOP(OPCodes::VOICE_STATE_UPDATE, json.Serialize());
+        SendOP(OPCodes::VOICE_STATE_UPDATE, json.Serialize(), Guild);
     }
 
     void CDiscordClient::Join(Channel channel)
@@ -179,9 +343,9 @@ namespace DiscordBot
             llog << lerror << "Failed to send message HTTP: " << res->statusCode << " MSG: " << res->errorMsg << lendl;
         else
         {
-            json.ParseObject(res->body);
+            CJSONView View(res->body);
             Channel c;
-            (res->body & m_Users) >> c;
+            (View.Root() & m_Users) >> c;
 
             SendMessage(c, Text, embed, TTS);
         }
@@ -216,6 +380,26 @@ namespace DiscordBot
         return GetAudioSource(guild) != nullptr;
     }
 
+    VoiceStats CDiscordClient::GetVoiceStats()
+    {
+        VoiceStats Ret = CVoiceEngine::Get().GetStats();
+
+        VoiceSockets Sockets = m_VoiceSockets;
+        for (auto &&e : Sockets)
+            Ret->Connections[e.first] = e.second->GetStats();
+
+        return Ret;
+    }
+
+    FrameCacheStats CDiscordClient::GetFrameCacheStats()
+    {
+        FrameCache Cache = m_FrameCache;
+        if(!Cache)
+            return nullptr;
+
+        return Cache->GetStats();
+    }
+
     void CDiscordClient::Run()
     {
         //Requests the gateway endpoint for bots.
@@ -233,10 +417,26 @@ namespace DiscordBot
                 return;
             }
 
-            //Connects to discords websocket.
-            m_Socket.setUrl(m_Gateway->URL + "/?v=8&encoding=json");
-            m_Socket.setOnMessageCallback(std::bind(&CDiscordClient::OnWebsocketEvent, this, std::placeholders::_1));
-            m_Socket.start();
+            uint32_t Count = m_ShardCount != 0 ? m_ShardCount : std::max<uint32_t>(m_Gateway->Shards, 1);
+            llog << linfo << "Starting " << Count << " shard(s)" << lendl;
+
+            for (uint32_t i = 0; i < Count; i++)
+                m_Shards.push_back(Shard(new CShard(this, i, Count)));
+
+            const SSessionStartLimit &Limit = m_Gateway->Limit;
+            m_IdentifyQueue.SetLimits(Limit.Total, Limit.Remaining, Limit.ResetAfter, Limit.MaxConcurrency);
+            m_IdentifyQueue.SetOnRefresh(std::bind(&CDiscordClient::RefreshSessionLimit, this));
+            m_StartTime = GetTimeMillis();
+            m_Workers.Start(m_WorkerCount, m_WorkerQueueDepth);
+
+            bool ETF = m_Encoding == GatewayEncoding::ETF;
+            std::string URL = (m_GatewayURL.empty() ? m_Gateway->URL : m_GatewayURL) + (ETF ? "/?v=8&encoding=etf" : "/?v=8&encoding=json");
+            if(m_Compress)
+                URL += "&compress=zlib-stream";
+
+            //Connects to discords websocket. The identify queue takes care of the rate limit.
+            for (auto &&e : m_Shards)
+                e->Connect(URL, m_Compress, ETF);
 
             //Runs until the bot quits.
             while (!m_Quit)
@@ -246,6 +446,74 @@ namespace DiscordBot
             llog << lerror << "HTTP " << res->statusCode << " Error " << res->errorMsg << lendl;
     }
 
+    ReplayStats CDiscordClient::Replay(const std::string &File, bool RealTime)
+    {
+        if(!m_Shards.empty())
+        {
+            llog << lerror << "Can't replay while the client is running" << lendl;
+            return nullptr;
+        }
+
+        CGatewayReader Reader;
+        if(!Reader.Open(File))
+            return nullptr;
+
+        ReplayStats Ret = ReplayStats(new CReplayStats());
+        {
+            std::lock_guard<std::mutex> lock(m_StatsLock);
+            m_Stats = Ret;
+        }
+
+        m_Offline = true;
+        m_StartTime = GetTimeMillis();
+        m_Workers.Start(m_WorkerCount, m_WorkerQueueDepth);
+
+        auto Beg = std::chrono::steady_clock::now();
+        SGatewayRecord Record;
+        while (Reader.Read(Record))
+        {
+            //Offline shards, same layout as the recorded client.
+            if(m_Shards.empty())
+            {
+                uint32_t Count = std::max<uint32_t>(Record.ShardCount, 1);
+                for (uint32_t i = 0; i < Count; i++)
+                    m_Shards.push_back(Shard(new CShard(this, i, Count)));
+            }
+
+            if(Record.ShardID >= m_Shards.size())
+                continue;
+
+            if(RealTime)
+                std::this_thread::sleep_until(Beg + std::chrono::nanoseconds(Record.Timestamp));
+
+            m_Shards[Record.ShardID]->Replay(Record.Data, Record.ETF);
+        }
+
+        m_Workers.Flush();
+        uint64_t Duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - Beg).count();
+
+        m_Workers.Stop();
+        m_Shards.clear();
+        m_Offline = false;
+
+        {
+            std::lock_guard<std::mutex> lock(m_StatsLock);
+            m_Stats = nullptr;
+        }
+
+        Ret->DurationMS = Duration;
+        Ret->EventsPerSecond = Duration != 0 ? Ret->Events * 1000.0 / Duration : 0.0;
+
+#ifdef DISCORDBOT_UNIX
+        struct rusage Usage;
+        if(getrusage(RUSAGE_SELF, &Usage) == 0)
+            Ret->PeakRSSKB = Usage.ru_maxrss;   //Kilobytes on linux.
+#endif
+
+        llog << linfo << "Replayed " << Ret->Events << " events in " << Duration << " ms (" << (uint64_t)Ret->EventsPerSecond << " events/s)" << lendl;
+        return Ret;
+    }
+
     void CDiscordClient::Quit()
     {
         auto IT = m_Guilds->begin();
@@ -255,11 +523,13 @@ namespace DiscordBot
             IT++;
         }
 
-        m_Terminate = true;
-        if (m_Heartbeat.joinable())
-            m_Heartbeat.join();
+        m_IdentifyQueue.Clear();
+        for (auto &&e : m_Shards)
+            e->Disconnect();
 
-        m_Socket.stop();
+        m_Workers.Stop();
+        m_MemberRequests.Clear();
+        m_PendingOwners->clear();
         
         if (m_Controller)
         {
@@ -271,6 +541,8 @@ namespace DiscordBot
         m_Guilds->clear();
         m_VoiceSockets->clear();
         m_AudioSources->clear();
+        m_AudioBroadcasts->clear();
+        m_EncoderProfiles->clear();
         m_Users->clear();
         m_MusicQueues->clear();
         m_Quit = true;
@@ -294,16 +566,24 @@ namespace DiscordBot
             auto Tmp = m_QueueFactory->Create();
             Tmp->SetGuildID(guild->ID);
             Tmp->SetOnWaitFinishCallback(std::bind(&CDiscordClient::OnQueueWaitFinish, this, std::placeholders::_1, std::placeholders::_2));
+            Tmp->SetFrameCache(m_FrameCache);
+
+            auto PIT = m_EncoderProfiles->find(guild->ID);
+            if(PIT != m_EncoderProfiles->end())
+                Tmp->SetEncoderProfile(PIT->second);
+
             Tmp->AddSong(Info);
             m_MusicQueues->insert({guild->ID, Tmp});
         }
     }
 
-    bool CDiscordClient::StartSpeaking(Channel channel)
+    bool CDiscordClient::StartSpeaking(Channel channel, EncoderProfile profile)
     {
         if (!channel || channel->GuildID->empty())
             return false;
 
+        //The queue needs the profile to find the song in the frame cache.
+        SetEncoderProfile(channel, profile);
         AudioSource Source;
 
         auto IT = m_MusicQueues->find(channel->GuildID);
@@ -313,16 +593,21 @@ namespace DiscordBot
                 Source = IT->second->Next();
             else
                 IT->second->ClearQueue();
+
+            if(Source)
+                m_EVManger.PostMessage(PREFETCH_NEXT_SONG, channel->GuildID);
         }
 
-        return StartSpeaking(channel, Source);
+        return StartSpeaking(channel, Source, profile);
     }
 
-    bool CDiscordClient::StartSpeaking(Channel channel, AudioSource source)
+    bool CDiscordClient::StartSpeaking(Channel channel, AudioSource source, EncoderProfile profile)
     {
         if (!channel || channel->GuildID->empty())
             return false;
 
+        SetEncoderProfile(channel, profile);
+
         VoiceSockets::iterator IT = m_VoiceSockets->find(channel->GuildID);
         if (IT != m_VoiceSockets->end() && source)
             IT->second->StartSpeaking(source);
@@ -330,12 +615,32 @@ namespace DiscordBot
         {
             Join(channel);
 
+            m_AudioBroadcasts->erase(channel->GuildID);
             m_AudioSources->insert({channel->GuildID, source});
         }
 
         return true;
     }
 
+    bool CDiscordClient::StartBroadcast(Channel channel, AudioBroadcast broadcast)
+    {
+        if (!channel || channel->GuildID->empty() || !broadcast)
+            return false;
+
+        VoiceSockets::iterator IT = m_VoiceSockets->find(channel->GuildID);
+        if (IT != m_VoiceSockets->end())
+            IT->second->StartBroadcast(broadcast);
+        else
+        {
+            Join(channel);
+
+            m_AudioSources->erase(channel->GuildID);
+            m_AudioBroadcasts->insert({channel->GuildID, broadcast});
+        }
+
+        return true;
+    }
+
     void CDiscordClient::PauseSpeaking(Guild guild)
     {
         if(!guild)
@@ -366,6 +671,43 @@ namespace DiscordBot
             IT->second->StopSpeaking();
     }
 
+    bool CDiscordClient::MixAudio(Guild guild, AudioSource source, float Gain)
+    {
+        if(!guild || !source)
+            return false;
+
+        VoiceSockets::iterator IT = m_VoiceSockets->find(guild->ID);
+        if (IT == m_VoiceSockets->end())
+            return false;
+
+        IT->second->MixSource(source, Gain);
+        return true;
+    }
+
+    bool CDiscordClient::SetMixGain(Guild guild, AudioSource source, float Gain)
+    {
+        if(!guild)
+            return false;
+
+        VoiceSockets::iterator IT = m_VoiceSockets->find(guild->ID);
+        if (IT == m_VoiceSockets->end())
+            return false;
+
+        return IT->second->SetMixGain(source, Gain);
+    }
+
+    bool CDiscordClient::StopMixAudio(Guild guild, AudioSource source)
+    {
+        if(!guild)
+            return false;
+
+        VoiceSockets::iterator IT = m_VoiceSockets->find(guild->ID);
+        if (IT == m_VoiceSockets->end())
+            return false;
+
+        return IT->second->RemoveMixSource(source);
+    }
+
     void CDiscordClient::RemoveSong(Channel channel, size_t Index)
     {
         if (!channel || channel->GuildID->empty())
@@ -407,654 +749,160 @@ namespace DiscordBot
 
                 if(Source)
                 {
+                    //The stream already switched to the prefetched song.
                     auto IT = m_VoiceSockets->find(Data->Value);
-                    if(IT != m_VoiceSockets->end())
+                    if(IT != m_VoiceSockets->end() && IT->second->GetAudioSource() != Source)
                         IT->second->StartSpeaking(Source);
+
+                    m_EVManger.PostMessage(PREFETCH_NEXT_SONG, Data->Value);
                 }
             }break;
 
-            case RESUME:
+            case PREFETCH_NEXT_SONG:
             {
-                m_Socket.start();
+                auto Data = std::static_pointer_cast<TMessage<std::string>>(Msg);
+
+                auto MQIT = m_MusicQueues->find(Data->Value);
+                if(MQIT == m_MusicQueues->end())
+                    break;
+
+                AudioSource Source = MQIT->second->PrepareNext();
+                if(Source)
+                {
+                    auto IT = m_VoiceSockets->find(Data->Value);
+                    if(IT != m_VoiceSockets->end())
+                        IT->second->SetNextSource(Source);
+                }
             }break;
 
-            case RECONNECT:
+            case RESUME:
             {
-                m_SessionID.clear();
-                m_Socket.start();
+                auto Data = std::static_pointer_cast<TMessage<uint32_t>>(Msg);
+                if(Data->Value < m_Shards.size())
+                {
+                    OnShardDisconnect(m_Shards[Data->Value].get());
+                    m_Shards[Data->Value]->Reconnect(true);
+                }
             }break;
 
-            case QUIT:
+            case VOICE_RESUME:
             {
-                Quit();
+                auto Data = std::static_pointer_cast<TMessage<std::string>>(Msg);
+
+                auto IT = m_VoiceSockets->find(Data->Value);
+                if(IT != m_VoiceSockets->end())
+                {
+                    VoiceSocket Socket = IT->second;
+                    Socket->Resume();
+                }
             }break;
-        }
-    }
 
-    void CDiscordClient::OnWebsocketEvent(const ix::WebSocketMessagePtr &msg)
-    {
-        switch (msg->type)
-        {
-            case ix::WebSocketMessageType::Open:
+            case RECONNECT:
             {
-                llog << linfo << "Websocket opened URI: " << msg->openInfo.uri << " Protocol: " << msg->openInfo.protocol << lendl;
+                auto Data = std::static_pointer_cast<TMessage<uint32_t>>(Msg);
+                if(Data->Value < m_Shards.size())
+                    m_Shards[Data->Value]->Reconnect(false);
             }break;
 
-            case ix::WebSocketMessageType::Error:
+            case REQUEST_OWNERS:
             {
-                llog << lerror << "Websocket error " << msg->errorInfo.reason << lendl;
+                RequestOwners();
             }break;
 
-            case ix::WebSocketMessageType::Close:
+            case CHECK_OWNERS:
             {
-                m_Terminate = true;
-                m_HeartACKReceived = false;
-                llog << linfo << "Websocket closed code " << msg->closeInfo.code << " Reason " << msg->closeInfo.reason << lendl;
+                auto Data = std::static_pointer_cast<TMessage<std::vector<Guild>>>(Msg);
+                CheckOwners(Data->Value);
             }break;
 
-            case ix::WebSocketMessageType::Message:
+            case QUIT:
             {
-                CJSON json;
-                SPayload Pay;
-
-                try
-                {
-                    Pay = json.Deserialize<SPayload>(msg->str);
-                }
-                catch (const CJSONException &e)
-                {
-                    llog << lerror << "Failed to parse JSON Enumtype: " << GetEnumName(e.GetErrType()) << " what(): " << e.what() << lendl;
-                    return;
-                }
-
-                switch ((OPCodes)Pay.OP)
-                {
-                    case OPCodes::DISPATCH:
-                    {
-                        m_LastSeqNum = Pay.S;
-                        std::hash<std::string> hash;
-
-                        //Gateway Events https://discordapp.com/developers/docs/topics/gateway#commands-and-events-gateway-events
-                        switch (Adler32(Pay.T.c_str()))
-                        {
-                            //Called after the handshake is completed.
-                            case Adler32("READY"):
-                            {
-                                json.ParseObject(Pay.D);
-                                m_SessionID = json.GetValue<std::string>("session_id");
-
-                                // json.ParseObject();
-                                json.GetValue<std::string>("user") >> m_BotUser >> m_Users;
-
-                                auto Unavailables = json.GetValue<std::vector<std::string>>("guilds");
-                                for (auto &&e : Unavailables)
-                                {
-                                    CJSON tmp;
-                                    tmp.ParseObject(e);
-
-                                    m_Unavailables.push_back(tmp.GetValue<std::string>("id"));
-                                }
-
-                                // m_BotUser = CreateUser(json);
-
-                                llog << linfo << "Connected with Discord! " << m_Socket.getUrl() << lendl;
-
-                                if (m_Controller)
-                                    m_Controller->OnReady();
-                            }
-                            break;
-
-                            /*------------------------GUILDS Intent------------------------*/
-
-                            case Adler32("GUILD_CREATE"):
-                            {
-                                json.ParseObject(Pay.D);
-
-                                Guild guild = Guild(new CGuild());
-                                guild->ID = json.GetValue<std::string>("id");
-                                guild->Name = json.GetValue<std::string>("name");
-                                guild->Icon = json.GetValue<std::string>("icon");
-
-                                //Get all Roles;
-                                std::vector<std::string> Array = json.GetValue<std::vector<std::string>>("roles");
-                                for (auto &&e : Array)
-                                {
-                                    Role Tmp;
-                                    e >> Tmp;
-                                    guild->Roles->insert({Tmp->ID, Tmp});
-                                }
-
-                                //Get all Channels;
-                                Array = json.GetValue<std::vector<std::string>>("channels");
-                                for (auto &&e : Array)
-                                {
-                                    Channel Tmp;
-                                    (e & m_Users) >> Tmp;
-                                    
-                                    Tmp->GuildID = guild->ID;
-                                    guild->Channels->insert({Tmp->ID, Tmp});
-                                }
-
-                                //Get all members.
-                                Array = json.GetValue<std::vector<std::string>>("members");
-                                for (auto &&e : Array)
-                                {
-                                    CJSON Member;
-                                    Member.ParseObject(e);
-
-                                    GuildMember Tmp = CreateMember(Member, guild);
-
-                                    // if (Tmp->UserRef)
-                                    //     guild->Members[Tmp->UserRef->ID] = Tmp;
-                                }
-
-                                //Get all voice states.
-                                Array = json.GetValue<std::vector<std::string>>("voice_states");
-                                for (auto &&e : Array)
-                                {
-                                    CJSON State;
-                                    State.ParseObject(e);
-
-                                    CreateVoiceState(State, guild);
-                                }
-
-                                //Gets the owner object.
-                                std::string OwnerID = json.GetValue<std::string>("owner_id");
-                                guild->Owner = GetMember(guild, OwnerID);
-                                m_Guilds->insert({guild->ID, guild});
-
-                                auto IT = std::find(m_Unavailables.begin(), m_Unavailables.end(), guild->ID);
-                                if(IT != m_Unavailables.end())
-                                {
-                                    m_Unavailables.erase(IT);
-
-                                    if(m_Controller)
-                                        m_Controller->OnGuildAvailable(guild);
-                                }
-                                else if(m_Controller)
-                                    m_Controller->OnGuildJoin(guild);
-                            }break;
-
-                            case Adler32("GUILD_DELETE"):
-                            {
-                                json.ParseObject(Pay.D);
-
-                                auto IT = m_Guilds->find(json.GetValue<std::string>("id"));
-                                if(IT != m_Guilds->end())
-                                {
-                                    bool Unavailable = json.GetValue<bool>("unavailable");
-                                    auto InnerIT = std::find(m_Unavailables.begin(), m_Unavailables.end(), IT->second->ID);
-
-                                    if(Unavailable && m_Controller && InnerIT != m_Unavailables.end())
-                                    {
-                                        m_Unavailables.erase(InnerIT);
-                                        m_Controller->OnGuildUnavailable(IT->second);
-                                    }
-                                    else if(!Unavailable && m_Controller)
-                                        m_Controller->OnGuildLeave(IT->second);
-                                    else
-                                        m_Unavailables.push_back(IT->second->ID);
-
-                                    m_VoiceSockets->erase(IT->second->ID);
-                                    m_MusicQueues->erase(IT->second->ID);
-                                    m_Guilds->erase(IT);
-                                }
-
-                                llog << linfo << "GUILD_DELETE" << lendl;
-                            }break;
-
-                            /*------------------------GUILDS Intent------------------------*/
-
-                            /*------------------------CHANNEL Intent------------------------*/
-
-                            case Adler32("CHANNEL_CREATE"):
-                            {
-                                Channel Tmp;
-                                (Pay.D & m_Users) >> Tmp;
-
-                                auto IT = m_Guilds->find(Tmp->GuildID);
-                                if(IT != m_Guilds->end())
-                                    IT->second->Channels->insert({Tmp->ID, Tmp});
-                            }break;
-
-                            case Adler32("CHANNEL_UPDATE"):
-                            {
-                                Channel Tmp;
-                                (Pay.D & m_Users) >> Tmp;
-
-                                auto IT = m_Guilds->find(Tmp->GuildID);
-                                if(IT != m_Guilds->end())
-                                {
-                                    IT->second->Channels->erase(Tmp->ID);
-                                    IT->second->Channels->insert({Tmp->ID, Tmp});
-                                }
-                            }break;
-
-                            case Adler32("CHANNEL_DELETE"):
-                            {
-                                Channel Tmp;
-                                (Pay.D & m_Users) >> Tmp;
-
-                                auto IT = m_Guilds->find(Tmp->GuildID);
-                                if(IT != m_Guilds->end())
-                                    IT->second->Channels->erase(Tmp->ID);
-                            }break;
-
-                            /*------------------------CHANNEL Intent------------------------*/
-
-                            /*------------------------GUILD_MEMBERS Intent------------------------*/
-                            //ATTENTION: NEEDS "Server Members Intent" ACTIVATED TO WORK, OTHERWISE THE BOT FAIL TO CONNECT AND A ERROR IS WRITTEN TO THE CONSOLE!!!
-
-                            case Adler32("GUILD_MEMBER_ADD"):
-                            {
-                                CJSON Member;
-                                Member.ParseObject(Pay.D);
-
-                                std::string GuildID = Member.GetValue<std::string>("guild_id");
-
-                                auto IT = m_Guilds->find(GuildID);
-                                if(IT != m_Guilds->end())
-                                {
-                                    Guild guild = IT->second;//m_Guilds[GuildID];
-                                    GuildMember Tmp = CreateMember(Member, guild);
-
-                                    if(m_Controller)
-                                        m_Controller->OnMemberAdd(guild, Tmp);
-                                }
-                                else
-                                    llog << ldebug << "Invalid Guild ( " << GuildID << " ) " << lendl;
-                            }break;
-
-                            case Adler32("GUILD_MEMBER_UPDATE"):
-                            {
-                                json.ParseObject(Pay.D);
-                                std::string GuildID = json.GetValue<std::string>("guild_id");
-                                std::string Premium = json.GetValue<std::string>("premium_since");
-                                std::string Nick = json.GetValue<std::string>("nick");
-                                std::vector<std::string> Array = json.GetValue<std::vector<std::string>>("roles");
-
-                                json.ParseObject(json.GetValue<std::string>("user"));
-                                std::string UserID = json.GetValue<std::string>("id");
-
-                                auto GIT = m_Guilds->find(GuildID);
-                                if(GIT != m_Guilds->end())
-                                {
-                                    Guild guild = GIT->second;//m_Guilds[GuildID];
-                                    auto IT = guild->Members->find(UserID);
-                                    if(IT != guild->Members->end())
-                                    {
-                                        IT->second->Roles->clear();
-                                        for (auto &&e : Array)
-                                            IT->second->Roles->push_back(guild->Roles->at(e));                               
-
-                                        IT->second->Nick = Nick;
-                                        IT->second->PremiumSince = Premium;
-
-                                        if(m_Controller)
-                                            m_Controller->OnMemberUpdate(guild, IT->second);
-                                    } 
-                                }
-                                else
-                                    llog << ldebug << "Invalid Guild ( " << GuildID << " ) " << lendl;
-                            }break;
-
-                            case Adler32("GUILD_BAN_ADD"):
-                            case Adler32("GUILD_MEMBER_REMOVE"):
-                            {
-                                json.ParseObject(Pay.D);
-                                std::string GuildID = json.GetValue<std::string>("guild_id");
-
-                                json.ParseObject(json.GetValue<std::string>("user"));
-                                std::string UserID = json.GetValue<std::string>("id");
-
-                                auto GIT = m_Guilds->find(GuildID);
-                                if(GIT != m_Guilds->end())
-                                {
-                                    Guild guild = GIT->second;//m_Guilds[GuildID];
-
-                                    auto IT = guild->Members->find(UserID);
-                                    if(IT != guild->Members->end())
-                                    {
-                                        GuildMember member = IT->second;
-                                        guild->Members->erase(IT);
-
-                                        if(m_Controller)
-                                            m_Controller->OnMemberRemove(guild, member);
-                                    }                                
-
-                                    if(m_Users->find(UserID) != m_Users->end())
-                                    {
-                                        if(m_Users->at(UserID).use_count() == 1)
-                                            m_Users->erase(UserID);
-                                    }
-                                }
-                                else
-                                    llog << ldebug << "Invalid Guild ( " << GuildID << " ) " << lendl;
-                            }break;
-
-                            /*------------------------GUILD_MEMBERS Intent------------------------*/
-
-                            /*------------------------GUILD_PRESENCES Intent------------------------*/
-                            //ATTENTION: NEEDS "Presence Intent" ACTIVATED TO WORK, OTHERWISE THE BOT FAIL TO CONNECT AND A ERROR IS WRITTEN TO THE CONSOLE!!!
-
-                            case Adler32("PRESENCE_UPDATE"):
-                            { 
-                                json.ParseObject(Pay.D);
-                                User user = m_Users | json.GetValue<std::string>("user");
-
-                                if(!json.GetValue<std::string>("game").empty())
-                                {
-                                    CJSON JGame;
-                                    JGame.ParseObject(json.GetValue<std::string>("game"));
-                                    user->Game = CreateActivity(JGame);
-                                }
-
-                                user->State = StrToOnlineState(json.GetValue<std::string>("status"));
-                                std::vector<std::string> Acts = json.GetValue<std::vector<std::string>>("activities");
-                                for (auto &&e : Acts)
-                                {
-                                    CJSON JAct;
-                                    JAct.ParseObject(e);
-                                    user->Activities->push_back(CreateActivity(JAct));
-                                }
-
-                                CJSON JClientState;
-                                JClientState.ParseObject(json.GetValue<std::string>("client_status")); 
-
-                                user->Desktop = StrToOnlineState(JClientState.GetValue<std::string>("desktop"));      
-                                user->Mobile = StrToOnlineState(JClientState.GetValue<std::string>("mobile"));   
-                                user->Web = StrToOnlineState(JClientState.GetValue<std::string>("web"));                      
-
-                                auto GIT = m_Guilds->find(json.GetValue<std::string>("guild_id"));
-                                if(GIT != m_Guilds->end())
-                                {
-                                    GuildMember member;
-                                    auto MIT = GIT->second->Members->find(user->ID);
-                                    if(MIT == GIT->second->Members->end())
-                                        member = GetMember(GIT->second, user->ID);
-                                    else
-                                        member = MIT->second;
-
-                                    if(m_Controller)
-                                        m_Controller->OnPresenceUpdate(GIT->second, member);
-                                }
-                            }break;
-
-                            /*------------------------GUILD_PRESENCES Intent------------------------*/
-
-                            /*------------------------GUILD_VOICE_STATES Intent------------------------*/
-
-                            case Adler32("VOICE_STATE_UPDATE"):
-                            {
-                                json.ParseObject(Pay.D);
-
-                                auto G = m_Guilds->find(json.GetValue<std::string>("guild_id"));
-                                auto M = G->second->Members->find(json.GetValue<std::string>("user_id"));
-                                Channel c;
-                                if(M->second->State)
-                                    c = M->second->State->ChannelRef;   //Saves the old channel.
-
-                                VoiceState Tmp = CreateVoiceState(json, nullptr);
-
-                                if (m_Controller && Tmp->GuildRef)
-                                {
-                                    if(Tmp->UserRef)
-                                    {
-                                        if(Tmp->UserRef->ID == m_BotUser->ID && !Tmp->ChannelRef)
-                                        {
-                                            m_VoiceSockets->erase(Tmp->GuildRef->ID);
-                                            m_MusicQueues->erase(Tmp->GuildRef->ID);
-                                        }
-
-                                        auto IT = Tmp->GuildRef->Members->find(Tmp->UserRef->ID);
-                                        if(IT != Tmp->GuildRef->Members->end())
-                                        {
-                                            m_Controller->OnVoiceStateUpdate(Tmp->GuildRef, IT->second);
-
-                                            auto AIT = m_Admins->find(Tmp->GuildRef->ID);
-                                            if(AIT != m_Admins->end())
-                                            {
-                                                auto Admin = std::dynamic_pointer_cast<CGuildAdmin>(AIT->second);
-
-                                                if(!c)
-                                                    c = Tmp->ChannelRef;
-                                                    
-                                                if(c)
-                                                    Admin->OnUserVoiceStateChanged(c, IT->second);
-                                            }
-                                        }
-                                    }
-                                }   
-                            }break;
-
-                            /*------------------------GUILD_VOICE_STATES Intent------------------------*/
-
-                            //Called if your bot joins a voice channel.
-                            case Adler32("VOICE_SERVER_UPDATE"):
-                            {
-                                json.ParseObject(Pay.D);
-                                Guilds::iterator GIT = m_Guilds->find(json.GetValue<std::string>("guild_id"));
-                                if (GIT != m_Guilds->end())
-                                {
-                                    auto UIT = GIT->second->Members->find(m_BotUser->ID);
-                                    if (UIT != GIT->second->Members->end())
-                                    {
-                                        VoiceSocket Socket = VoiceSocket(new CVoiceSocket(json, UIT->second->State->SessionID, m_BotUser->ID));
-                                        Socket->SetOnSpeakFinish(std::bind(&CDiscordClient::OnSpeakFinish, this, std::placeholders::_1));
-                                        m_VoiceSockets->insert({GIT->second->ID, Socket});
-
-                                        //Creates a music queue for the server.
-                                        if(m_QueueFactory)
-                                        {
-                                            if(m_MusicQueues->find(GIT->second->ID) == m_MusicQueues->end())
-                                            {
-                                                MusicQueue MQ = m_QueueFactory->Create();
-                                                MQ->SetGuildID(GIT->second->ID);
-                                                MQ->SetOnWaitFinishCallback(std::bind(&CDiscordClient::OnQueueWaitFinish, this, std::placeholders::_1, std::placeholders::_2));
-                                                m_MusicQueues->insert({GIT->second->ID, MQ});
-                                            }
-                                        }
-
-                                        //Plays the queued audiosource.
-                                        AudioSources::iterator IT = m_AudioSources->find(GIT->second->ID);
-                                        if (IT != m_AudioSources->end())
-                                        {
-                                            Socket->StartSpeaking(IT->second);
-                                            m_AudioSources->erase(IT);
-                                        }
-                                    }
-                                }
-                            }break;
-
-                            /*------------------------GUILD_MESSAGES Intent------------------------*/
-
-                            case Adler32("MESSAGE_CREATE"):
-                            case Adler32("MESSAGE_UPDATE"):
-                            case Adler32("MESSAGE_DELETE"):
-                            {
-                                json.ParseObject(Pay.D);
-                                Message msg = CreateMessage(json);
-
-                                std::shared_ptr<CGuildAdmin> Admin;
-                                auto AIT = m_Admins->find(msg->GuildRef->ID);
-                                if(AIT != m_Admins->end())
-                                    Admin = std::dynamic_pointer_cast<CGuildAdmin>(AIT->second);
-
-                                switch (Adler32(Pay.T.c_str()))
-                                {
-                                    case Adler32("MESSAGE_CREATE"):
-                                    {
-                                        if (m_Controller)
-                                            m_Controller->OnMessage(msg);
-
-                                        if(Admin)
-                                            Admin->OnMessageEvent(ActionType::MESSAGE_CREATED, msg->ChannelRef, msg);
-                                    }break;
-
-                                    case Adler32("MESSAGE_UPDATE"):
-                                    {
-                                        if (m_Controller)
-                                            m_Controller->OnMessageEdited(msg);
-
-                                        if(Admin)
-                                            Admin->OnMessageEvent(ActionType::MESSAGE_EDITED, msg->ChannelRef, msg);
-                                    }break;
-
-                                    case Adler32("MESSAGE_DELETE"):
-                                    {
-                                        if (m_Controller)
-                                            m_Controller->OnMessageDeleted(msg);
-
-                                        if(Admin)
-                                            Admin->OnMessageEvent(ActionType::MESSAGE_DELETED, msg->ChannelRef, msg);
-                                    }break;
-                                }
-
-                            }break;
-
-                            /*------------------------GUILD_MESSAGES Intent------------------------*/
-
-                            //Called if a session resumed.
-                            case Adler32("RESUMED"):
-                            {
-                                llog << linfo << "Resumed" << lendl;
-
-                                if (m_Controller)
-                                    m_Controller->OnResume();
-                            } break;
-                        }
-                }break;
-
-                case OPCodes::HELLO:
-                {
-                    try
-                    {
-                        json.ParseObject(Pay.D);
-                        m_HeartbeatInterval = json.GetValue<uint32_t>("heartbeat_interval");
-                    }
-                    catch (const CJSONException &e)
-                    {
-                        llog << lerror << "Failed to parse JSON Enumtype: " << GetEnumName(e.GetErrType()) << " what(): " << e.what() << lendl;
-                        return;
-                    }
-
-                    if (m_SessionID.empty())
-                        SendIdentity();
-                    else
-                        SendResume();
-
-                    m_HeartACKReceived = true;
-                    m_Terminate = false;
-
-                    if (m_Heartbeat.joinable())
-                        m_Heartbeat.join();
-
-                    m_Heartbeat = std::thread(&CDiscordClient::Heartbeat, this);
-                }break;
-
-                case OPCodes::HEARTBEAT_ACK:
-                {
-                    m_HeartACKReceived = true;
-                }break;
-
-                //Something is wrong.
-                case OPCodes::INVALID_SESSION:
-                {
-                    if (Pay.D == "true")
-                        SendResume();
-                    else
-                    {
-                        //TODO: Maybe deadlock. Let's find out.
-                        llog << linfo << "INVALID_SESSION CLOSE SOCKET" << lendl;
-                        m_Socket.close();
-                        llog << linfo << "INVALID_SESSION SOCKET CLOSED" << lendl;
-                        m_EVManger.PostMessage(RECONNECT, 0, 5000);
-                    }
-                        //Quit();
-
-                    llog << linfo << "INVALID_SESSION" << lendl;
-                }break;
-                }
+                Quit();
             }break;
         }
     }
 
-    void CDiscordClient::Heartbeat()
+    void CDiscordClient::OnDispatch(CShard *shard, const std::string &Event, GatewayFrame Frame)
     {
-        while (!m_Terminate)
-        {
-            //Start a reconnect.
-            if (!m_HeartACKReceived)
-            {
-                m_Socket.stop();
-
-                // m_Users->clear();
-                // m_Guilds->clear();
+        CJSONValue json = Frame->View->Root()["d"];
+        auto Received = std::chrono::steady_clock::now();
 
-                m_VoiceSockets->clear();
+        //Session events are handled on the receiving thread, all following events depend on them.
+        if(Event == "READY" || Event == "RESUMED")
+        {
+            DispatchEvent(shard, Event, json, Received);
+            return;
+        }
 
-                if (m_Controller)
-                    m_Controller->OnDisconnect();
+        //Events of the same guild are handled in order. DMs are sharing the worker of key 0.
+        std::string GuildID = json.GetValue<std::string>("guild_id");
+        if(GuildID.empty() && Event.compare(0, 6, "GUILD_") == 0)
+            GuildID = json.GetValue<std::string>("id");
 
-                m_Terminate = true;
-                m_EVManger.PostMessage(RESUME, 0, 100);
+        //The job holds the frame, which keeps the json view valid. The websocket thread never waits for a full worker, otherwise the heartbeat acks of the whole shard would be late.
+        //A replay has no heartbeat and waits, so its memory stays bounded.
+        m_Workers.Post(ParseSnowflake(GuildID), [this, shard, Event, Frame, json, Received]()
+        {
+            DispatchEvent(shard, Event, json, Received);
+        }, m_Offline);
+    }
 
-                break;
-            }
+    void CDiscordClient::DispatchEvent(CShard *shard, const std::string &Event, const CJSONValue &json, std::chrono::steady_clock::time_point Received)
+    {
+        m_Events.Dispatch(Event, shard, json);
 
-            SendOP(OPCodes::HEARTBEAT, m_LastSeqNum != -1 ? std::to_string(m_LastSeqNum) : "");
-            m_HeartACKReceived = false;
+        if(!m_Offline)
+            return;
 
-            // Terminateable timeout.
-            int64_t Beg = GetTimeMillis();
-            while (((GetTimeMillis() - Beg) < m_HeartbeatInterval) && !m_Terminate)
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        uint64_t Latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - Received).count();
 
-            // std::this_thread::sleep_for(std::chrono::milliseconds(m_HeartbeatInterval));
+        std::lock_guard<std::mutex> lock(m_StatsLock);
+        if(m_Stats)
+        {
+            CEventLatency &Stat = m_Stats->Latencies[Event];
+            Stat.Count++;
+            Stat.TotalUS += Latency;
+            Stat.MaxUS = std::max(Stat.MaxUS, Latency);
+            m_Stats->Events++;
         }
     }
 
-    void CDiscordClient::SendOP(CDiscordClient::OPCodes OP, const std::string &D)
+    void CDiscordClient::OnShardDisconnect(CShard *shard)
     {
-        SPayload Pay;
-        Pay.OP = (uint32_t)OP;
-        Pay.D = D;
-
-        try
+        //Voice connections of the lost shard are invalid.
+        auto IT = m_VoiceSockets->begin();
+        while (IT != m_VoiceSockets->end())
         {
-            CJSON json;
-            std::string TT = json.Serialize(Pay);
-            m_Socket.send(json.Serialize(Pay));
-        }
-        catch (const CJSONException &e)
-        {
-            llog << lerror << "Failed to serialize the Payload object. Enumtype: " << GetEnumName(e.GetErrType()) << " what(): " << e.what() << lendl;
+            if(GetShard(IT->first).get() == shard)
+                IT = m_VoiceSockets->erase(IT);
+            else
+                IT++;
         }
+
+        if (m_Controller)
+            m_Controller->OnDisconnect();
     }
 
-    void CDiscordClient::SendIdentity()
+    Shard CDiscordClient::GetShard(const std::string &GuildID)
     {
-        SIdentify id;
-        id.Token = m_Token;
-        id.Properties["$os"] = "linux";
-        id.Properties["$browser"] = "libDiscordBot";
-        id.Properties["$device"] = "libDiscordBot";
-        id.Properties["presence"] = CreateUserInfoJSON();
-        id.Intents = m_Intents;
+        if(m_Shards.empty())
+            return nullptr;
 
-        CJSON json;
-        SendOP(OPCodes::IDENTIFY, json.Serialize(id));
+        //https://discord.com/developers/docs/topics/gateway#sharding
+        return m_Shards[(ParseSnowflake(GuildID) >> 22) % m_Shards.size()];
     }
 
-    void CDiscordClient::SendResume()
+    void CDiscordClient::SendOP(OPCodes OP, const std::string &D, const std::string &GuildID, bool Background)
     {
-        SResume resume;
-        resume.Token = m_Token;
-        resume.SessionID = m_SessionID;
-        resume.Seq = m_LastSeqNum;
+        Shard shard = GetShard(GuildID);
+        if(shard)
+            shard->SendOP(OP, D, Background);
+    }
 
-        CJSON json;
-        SendOP(OPCodes::RESUME, json.Serialize(resume));
+    void CDiscordClient::BroadcastOP(OPCodes OP, const std::string &D)
+    {
+        for (auto &&e : m_Shards)
+            e->SendOP(OP, D);
     }
 
     void CDiscordClient::OnSpeakFinish(const std::string &Guild)
@@ -1069,19 +917,33 @@ namespace DiscordBot
         }
     }
 
+    ix::HttpResponsePtr CDiscordClient::OfflineResponse()
+    {
+        ix::HttpResponsePtr Ret = ix::HttpResponsePtr(new ix::HttpResponse());
+        Ret->errorMsg = "REST calls are disabled during a replay";
+
+        return Ret;
+    }
+
     ix::HttpResponsePtr CDiscordClient::Get(const std::string &URL)
     {
+        if(m_Offline)
+            return OfflineResponse();
+
         ix::HttpRequestArgsPtr args = ix::HttpRequestArgsPtr(new ix::HttpRequestArgs());
 
         //Adds the bot token.
         args->extraHeaders["Authorization"] = "Bot " + m_Token;
         args->extraHeaders["User-Agent"] = USER_AGENT;
 
-        return m_HTTPClient.get(std::string(BASE_URL) + URL, args);
+        return m_HTTPClient.get(m_APIURL + URL, args);
     }
 
     ix::HttpResponsePtr CDiscordClient::Post(const std::string &URL, const std::string &Body)
     {
+        if(m_Offline)
+            return OfflineResponse();
+
         ix::HttpRequestArgsPtr args = ix::HttpRequestArgsPtr(new ix::HttpRequestArgs());
 
         //Adds the bot token.
@@ -1089,11 +951,14 @@ namespace DiscordBot
         args->extraHeaders["Content-Type"] = "application/json";
         args->extraHeaders["User-Agent"] = USER_AGENT;
 
-        return m_HTTPClient.post(std::string(BASE_URL) + URL, Body, args);
+        return m_HTTPClient.post(m_APIURL + URL, Body, args);
     }
 
     ix::HttpResponsePtr CDiscordClient::Put(const std::string &URL, const std::string &Body)
     {
+        if(m_Offline)
+            return OfflineResponse();
+
         ix::HttpRequestArgsPtr args = ix::HttpRequestArgsPtr(new ix::HttpRequestArgs());
 
         //Adds the bot token.
@@ -1101,11 +966,14 @@ namespace DiscordBot
         args->extraHeaders["Content-Type"] = "application/json";
         args->extraHeaders["User-Agent"] = USER_AGENT;
 
-        return m_HTTPClient.put(std::string(BASE_URL) + URL, Body, args);
+        return m_HTTPClient.put(m_APIURL + URL, Body, args);
     }
 
     ix::HttpResponsePtr CDiscordClient::Patch(const std::string &URL, const std::string &Body)
     {
+        if(m_Offline)
+            return OfflineResponse();
+
         ix::HttpRequestArgsPtr args = ix::HttpRequestArgsPtr(new ix::HttpRequestArgs());
 
         //Adds the bot token.
@@ -1113,11 +981,14 @@ namespace DiscordBot
         args->extraHeaders["Content-Type"] = "application/json";
         args->extraHeaders["User-Agent"] = USER_AGENT;
 
-        return m_HTTPClient.patch(std::string(BASE_URL) + URL, Body, args);
+        return m_HTTPClient.patch(m_APIURL + URL, Body, args);
     }
 
     ix::HttpResponsePtr CDiscordClient::Delete(const std::string &URL, const std::string &Body)
     {
+        if(m_Offline)
+            return OfflineResponse();
+
         ix::HttpRequestArgsPtr args = ix::HttpRequestArgsPtr(new ix::HttpRequestArgs());
 
         //Adds the bot token.
@@ -1127,10 +998,37 @@ namespace DiscordBot
         if(Body != "")
         {
             args->extraHeaders["Content-Type"] = "application/json";
-            return m_HTTPClient.request(std::string(BASE_URL) + URL, "DELETE", Body, args);
+            return m_HTTPClient.request(m_APIURL + URL, "DELETE", Body, args);
         }
         else
-            return m_HTTPClient.del(std::string(BASE_URL) + URL, args);
+            return m_HTTPClient.del(m_APIURL + URL, args);
+    }
+
+    void CDiscordClient::OnVoiceConnectionLost(const std::string &Guild)
+    {
+        m_EVManger.PostMessage(VOICE_RESUME, Guild, CVoiceSocket::RESUME_DELAY);
+    }
+
+    void CDiscordClient::RefreshSessionLimit()
+    {
+        auto res = Get("/gateway/bot");
+        if (res->statusCode != 200)
+        {
+            llog << lerror << "Failed to refresh the session start limit. HTTP " << res->statusCode << " Error " << res->errorMsg << lendl;
+            return;
+        }
+
+        try
+        {
+            CJSON json;
+            auto Gateway = json.Deserialize<std::shared_ptr<SGateway>>(res->body);
+            const SSessionStartLimit &Limit = Gateway->Limit;
+            m_IdentifyQueue.SetLimits(Limit.Total, Limit.Remaining, Limit.ResetAfter, Limit.MaxConcurrency);
+        }
+        catch (const CJSONException &e)
+        {
+            llog << lerror << "Failed to parse JSON Enumtype: " << GetEnumName(e.GetErrType()) << " what(): " << e.what() << lendl;
+        }
     }
 
     void CDiscordClient::OnQueueWaitFinish(const std::string &Guild, AudioSource Source)
@@ -1144,6 +1042,29 @@ namespace DiscordBot
         VoiceSockets::iterator IT = m_VoiceSockets->find(Guild);
         if(IT != m_VoiceSockets->end())
             IT->second->StartSpeaking(Source);
+
+        m_EVManger.PostMessage(PREFETCH_NEXT_SONG, Guild);
+    }
+
+    void CDiscordClient::SetEncoderProfile(Channel channel, EncoderProfile profile)
+    {
+        EncoderProfile Profile = profile ? std::make_shared<CEncoderProfile>(*profile) : std::make_shared<CEncoderProfile>();
+
+        //Discord doesn't send more than the bitrate of the channel, so higher bitrates are wasted encoding time.
+        int ChannelBitrate = channel->Bitrate;
+        if(ChannelBitrate > 0 && (Profile->Bitrate == 0 || Profile->Bitrate > (uint32_t)ChannelBitrate))
+            Profile->Bitrate = ChannelBitrate;
+
+        m_EncoderProfiles->erase(channel->GuildID);
+        m_EncoderProfiles->insert({channel->GuildID, Profile});
+
+        VoiceSockets::iterator IT = m_VoiceSockets->find(channel->GuildID);
+        if(IT != m_VoiceSockets->end())
+            IT->second->SetEncoderProfile(Profile);
+
+        auto QIT = m_MusicQueues->find(channel->GuildID);
+        if(QIT != m_MusicQueues->end())
+            QIT->second->SetEncoderProfile(Profile);
     }
 
     std::string CDiscordClient::OnlineStateToStr(OnlineState state)
@@ -1234,14 +1155,12 @@ namespace DiscordBot
             {
                 try
                 {    
-                    CJSON JOwner;
-                    JOwner.ParseObject(res->body);
-
-                    Ret = CreateMember(JOwner, guild);
+                    CJSONView JOwner(res->body);
+                    Ret = CreateMember(JOwner.Root(), guild);
                 }
-                catch (const CJSONException &e)
+                catch (const CJSONViewException &e)
                 {
-                    llog << lerror << "Failed to parse owner JSON Enumtype: " << GetEnumName(e.GetErrType()) << " what(): " << e.what() << lendl;
+                    llog << lerror << "Failed to parse owner JSON what(): " << e.what() << lendl;
                     return nullptr;
                 }
             }
@@ -1250,14 +1169,14 @@ namespace DiscordBot
         return Ret;
     }
 
-    GuildMember CDiscordClient::CreateMember(CJSON &json, Guild guild)
+    GuildMember CDiscordClient::CreateMember(const CJSONValue &json, Guild guild, User user)
     {
         GuildMember Ret = GuildMember(new CGuildMember());
-        std::string UserInfo = json.GetValue<std::string>("user");
-        User member;
+        CJSONValue UserInfo = json["user"];
+        User member = user;
 
         //Gets the user which is associated with the member.
-        if (!UserInfo.empty())
+        if (!UserInfo.IsNull())
             member = m_Users | UserInfo;
 
         Ret->GuildID = guild->ID;
@@ -1269,10 +1188,9 @@ namespace DiscordBot
         Ret->Mute = json.GetValue<bool>("mute");
 
         //Adds the roles
-        auto Array = json.GetValue<std::vector<std::string>>("roles");
-        for (auto &&e : Array)
+        for (auto &&e : json["roles"])
         {
-            auto RIT = guild->Roles->find(e);
+            auto RIT = guild->Roles->find(e.Get<std::string>());
             if(RIT != guild->Roles->end())
                 Ret->Roles->push_back(RIT->second);
         }
@@ -1283,7 +1201,7 @@ namespace DiscordBot
         return Ret;
     }
 
-    VoiceState CDiscordClient::CreateVoiceState(CJSON &json, Guild guild)
+    VoiceState CDiscordClient::CreateVoiceState(const CJSONValue &json, Guild guild)
     {
         VoiceState Ret = VoiceState(new CVoiceState());
 
@@ -1296,9 +1214,12 @@ namespace DiscordBot
         else
             Ret->GuildRef = guild;
 
-        auto IT = m_Users->find(json.GetValue<std::string>("user_id"));
-        if (IT != m_Users->end())
-            Ret->UserRef = IT->second;
+        {
+            auto lock = m_Users.Lock();
+            auto IT = m_Users->find(json.GetValue<std::string>("user_id"));
+            if (IT != m_Users->end())
+                Ret->UserRef = IT->second;
+        }
 
         if (Ret->GuildRef)
         {
@@ -1312,22 +1233,8 @@ namespace DiscordBot
             auto MIT = Ret->GuildRef->Members->find(json.GetValue<std::string>("user_id"));
             if (MIT != Ret->GuildRef->Members->end())
                 Member = MIT->second;
-            else
-            {
-                //Creates a new member.
-                try
-                {
-                    CJSON JMember;
-                    JMember.ParseObject(json.GetValue<std::string>("member"));
-
-                    Member = CreateMember(JMember, Ret->GuildRef);
-                }
-                catch (const CJSONException &e)
-                {
-                    llog << lerror << "Failed to parse JSON for VoiceState member Enumtype: " << GetEnumName(e.GetErrType()) << " what(): " << e.what() << lendl;
-                    return Ret;
-                }
-            }
+            else if (!json["member"].IsNull())
+                Member = CreateMember(json["member"], Ret->GuildRef);   //Creates a new member.
 
             //Removes the voice state if the user isn't in a voice channel.
             if (!Ret->ChannelRef && Member)
@@ -1350,7 +1257,7 @@ namespace DiscordBot
         return Ret;
     }
 
-    Message CDiscordClient::CreateMessage(CJSON &json)
+    Message CDiscordClient::CreateMessage(const CJSONValue &json)
     {
         Message Ret = Message(new CMessage());
         Channel channel;
@@ -1375,8 +1282,8 @@ namespace DiscordBot
         Ret->ID = json.GetValue<std::string>("id");
         Ret->ChannelRef = channel;
 
-        std::string UserJson = json.GetValue<std::string>("author");
-        if (!UserJson.empty())
+        CJSONValue UserJson = json["author"];
+        if (!UserJson.IsNull())
         {
             User user = m_Users | UserJson;
             Ret->Author = user;
@@ -1387,6 +1294,8 @@ namespace DiscordBot
                 auto MIT = Ret->GuildRef->Members->find(Ret->Author->ID);
                 if (MIT != Ret->GuildRef->Members->end())
                     Ret->Member = MIT->second;
+                else if (!json["member"].IsNull())
+                    Ret->Member = CreateMember(json["member"], Ret->GuildRef, user);  //Messages contain a partial member without user.
                 else
                     Ret->Member = GetMember(Ret->GuildRef, Ret->Author->ID);
             }
@@ -1397,8 +1306,7 @@ namespace DiscordBot
         Ret->EditedTimestamp = json.GetValue<std::string>("edited_timestamp");
         Ret->Mention = json.GetValue<bool>("mention_everyone");
 
-        std::vector<std::string> Array = json.GetValue<std::vector<std::string>>("mentions");
-        for (auto &&e : Array)
+        for (auto &&e : json["mentions"])
         {
             User user = m_Users | e;
             bool Found = false;
@@ -1424,7 +1332,7 @@ namespace DiscordBot
         return Ret;
     }
 
-    Activity CDiscordClient::CreateActivity(CJSON &json)
+    Activity CDiscordClient::CreateActivity(const CJSONValue &json)
     {
         Activity ret = Activity(new CActivity());
 
@@ -1433,8 +1341,7 @@ namespace DiscordBot
         ret->URL = json.GetValue<std::string>("url");
         ret->CreatedAt = json.GetValue<int>("created_at");
 
-        CJSON Timestamps;
-        Timestamps.ParseObject(json.GetValue<std::string>("timestamps"));
+        CJSONValue Timestamps = json["timestamps"];
         ret->StartTime = Timestamps.GetValue<int>("start");
         ret->EndTime = Timestamps.GetValue<int>("end");
 
@@ -1443,20 +1350,18 @@ namespace DiscordBot
 
         ret->State = json.GetValue<std::string>("state");
 
-        if(!json.GetValue<std::string>("party").empty())
+        if(!json["party"].IsNull())
         {
-            CJSON JParty;
-            JParty.ParseObject(json.GetValue<std::string>("party"));
+            CJSONValue JParty = json["party"];
 
             ret->PartyObject = Party(new CParty());
             ret->PartyObject->ID = JParty.GetValue<std::string>("id");
             ret->PartyObject->Size = JParty.GetValue<std::vector<int>>("size");
         }
 
-        if(!json.GetValue<std::string>("secrets").empty())
+        if(!json["secrets"].IsNull())
         {
-            CJSON JSecret;
-            JSecret.ParseObject(json.GetValue<std::string>("secrets"));
+            CJSONValue JSecret = json["secrets"];
 
             ret->Secret = Secrets(new CSecrets());
             ret->Secret->Join = JSecret.GetValue<std::string>("join");
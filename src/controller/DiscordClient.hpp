@@ -42,8 +42,15 @@
 #include "MessageManager.hpp"
 #include "../models/Payload.hpp"
 #include "VoiceSocket.hpp"
+#include "FrameCache.hpp"
 #include <models/atomic.hpp>
 #include "GuildAdmin.hpp"
+#include "Shard.hpp"
+#include "IdentifyQueue.hpp"
+#include "EventRegistry.hpp"
+#include "EventWorkerPool.hpp"
+#include "GatewayRecorder.hpp"
+#include "MemberRequests.hpp"
 #include "../helpers/JSONHelpers.hpp"
 
 #undef SendMessage
@@ -52,58 +59,10 @@ namespace DiscordBot
 {
     class CDiscordClient : public IDiscordClient
     {
-        public:
-            //All informations from https://discordapp.com/developers/docs/topics/opcodes-and-status-codes
-            enum class OPCodes
-            {
-                //Name                  Code        Client Action       Description
-                DISPATCH                = 0,        //Receive           An event was dispatched.
-                HEARTBEAT               = 1,        //Send/Receive      Fired periodically by the client to keep the connection alive.
-                IDENTIFY                = 2,        //Send              Starts a new session during the initial handshake.
-                PRESENCE_UPDATE         = 3,        //Send	            Update the client's presence.
-                VOICE_STATE_UPDATE      = 4,        //Send              Used to join/leave or move between voice channels.
-                RESUME                  = 6,        //Send	            Resume a previous session that was disconnected.
-                RECONNECT               = 7,        //Receive	        You should attempt to reconnect and resume immediately.
-                REQUEST_GUILD_MEMBERS   = 8,        //Send	            Request information about offline guild members in a large guild.
-                INVALID_SESSION         = 9,        //Receive	        The session has been invalidated. You should reconnect and identify/resume accordingly.
-                HELLO                   = 10,       //Receive	        Sent immediately after connecting, contains the heartbeat_interval to use.
-                HEARTBEAT_ACK           = 11        //Receive           Sent in response to receiving a heartbeat to acknowledge that it has been received.
-            };
-
-            /**
-             * @brief Identifies the bot.
-             */
-            struct SIdentify
-            {
-                std::string Token;
-                std::map<std::string, std::string> Properties;
-                Intent Intents;
-
-                void Serialize(CJSON &json) const
-                {
-                    json.AddPair("token", Token);
-                    json.AddPair("properties", Properties);
-                    json.AddPair("intents", (uint32_t)Intents);
-                }
-            };
-
+        friend class CShard;
 
-            /**
-             * @brief Resumes the bot.
-             */
-            struct SResume
-            {
-                std::string Token;
-                std::string SessionID;
-                uint32_t Seq;
-
-                void Serialize(CJSON &json) const
-                {
-                    json.AddPair("token", Token);
-                    json.AddPair("session_id", SessionID);
-                    json.AddPair("seq", Seq);
-                }
-            };
+        public:
+            using OPCodes = CShard::OPCodes;
 
             /**
              * @brief Sessions limits object which is returned after the bot is connected to the discord servers.
@@ -113,12 +72,14 @@ namespace DiscordBot
                 uint32_t Total;
                 uint32_t Remaining;
                 uint32_t ResetAfter;
+                uint32_t MaxConcurrency;
 
                 void Deserialize(CJSON &json)
                 {
                     Total = json.GetValue<uint32_t>("total");
                     Remaining = json.GetValue<uint32_t>("remaining");
                     ResetAfter = json.GetValue<uint32_t>("reset_after");
+                    MaxConcurrency = json.GetValue<uint32_t>("max_concurrency");
                 }
             };
 
@@ -163,6 +124,93 @@ namespace DiscordBot
              */
             void SetActivity(const std::string &Text, const std::string &URL = "") override;
 
+            /**
+             * @brief Sets the number of gateway connections. Must be called before Run().
+             * 
+             * @param Count: Number of shards. 0 uses the shard count recommended by Discord.
+             */
+            void SetShardCount(uint32_t Count) override;
+
+            /**
+             * @return Gets the number of gateway connections.
+             */
+            uint32_t GetShardCount() override
+            {
+                return (uint32_t)m_Shards.size();
+            }
+
+            /**
+             * @return Gets the number of shards which received their READY event.
+             */
+            uint32_t GetReadyShardCount() override;
+
+            /**
+             * @brief Enables the zlib-stream transport compression of the gateway. Must be called before Run().
+             */
+            void SetTransportCompression(bool Enable) override;
+
+            /**
+             * @brief Overrides the base url of the rest api. Must be called before Run().
+             */
+            void SetAPIURL(const std::string &URL) override;
+
+            /**
+             * @brief Overrides the gateway url returned by /gateway/bot. Must be called before Run().
+             */
+            void SetGatewayURL(const std::string &URL) override;
+
+            /**
+             * @brief Sets the payload encoding of the gateway. Must be called before Run().
+             */
+            void SetGatewayEncoding(GatewayEncoding Encoding) override;
+
+            /**
+             * @brief Sets the number of threads which are handling the gateway events. Must be called before Run().
+             */
+            void SetEventWorkers(uint32_t Count, uint32_t QueueDepth = 1024) override;
+            uint64_t GetSpilledEventCount() override;
+            uint64_t GetUnknownEventCount() override;
+
+            /**
+             * @brief Records all received gateway payloads with their timestamps.
+             */
+            bool StartRecording(const std::string &File, bool Compress = true) override;
+
+            /**
+             * @brief Stops the recording and closes the file.
+             */
+            void StopRecording() override;
+
+            /**
+             * @brief Feeds a recording into the event handlers without a connection to discord.
+             */
+            ReplayStats Replay(const std::string &File, bool RealTime = false) override;
+
+            /**
+             * @brief Enables the lazy member loading for guilds with more members than the threshold. Must be called before Run().
+             */
+            void SetLargeThreshold(uint32_t Threshold) override;
+
+            /**
+             * @brief Sets the number of audio frames, which are encoded before the first packet is sent.
+             */
+            void SetVoicePreBuffer(uint32_t Frames) override;
+
+            /**
+             * @brief Enables the cache of encoded songs, which are played from the music queues.
+             */
+            void SetFrameCache(uint64_t RAMBytes, const std::string &SpillFile = "", uint64_t SpillBytes = 0) override;
+
+            /**
+             * @brief Loads guild members by their ids via the gateway.
+             */
+            std::future<std::vector<GuildMember>> RequestMembers(Guild guild, const std::vector<std::string> &UserIDs, uint32_t TimeoutMS = 10000) override;
+
+            /**
+             * @brief Loads guild members whose username starts with the query via the gateway.
+             */
+            std::future<std::vector<GuildMember>> RequestMembers(Guild guild, const std::string &Query, uint32_t Limit = 0, uint32_t TimeoutMS = 10000) override;
+
             /**
              * @brief Adds a song to the music queue.
              * 
@@ -175,20 +223,35 @@ namespace DiscordBot
              * @brief Connects to the given channel and uses the queue to speak.
              * 
              * @param channel: The voice channel to connect to.
+             * @param profile: Settings of the opus encoder for this connection. Null uses the defaults of CEncoderProfile.
+             * The bitrate is limited to the bitrate of the channel.
              * 
              * @return Returns true if the connection succeeded.
              */
-            bool StartSpeaking(Channel channel) override;
+            bool StartSpeaking(Channel channel, EncoderProfile profile = nullptr) override;
 
             /**
              * @brief Connects to the given channel and uses the source to speak.
              * 
              * @param channel: The voice channel to connect to.
              * @param source: The audio source for speaking.
+             * @param profile: Settings of the opus encoder for this connection. Null uses the defaults of CEncoderProfile.
+             * The bitrate is limited to the bitrate of the channel.
+             * 
+             * @return Returns true if the connection succeeded.
+             */
+            bool StartSpeaking(Channel channel, AudioSource source, EncoderProfile profile = nullptr) override;
+
+            /**
+             * @brief Connects to the given channel and plays the broadcast. The same broadcast can play in many guilds,
+             * its audio is encoded once and only encrypted per connection.
+             * 
+             * @param channel: The voice channel to connect to.
+             * @param broadcast: The broadcast to play. Use std::make_shared<CAudioBroadcast>(Source) to create one.
              * 
              * @return Returns true if the connection succeeded.
              */
-            bool StartSpeaking(Channel channel, AudioSource source) override;
+            bool StartBroadcast(Channel channel, AudioBroadcast broadcast) override;
 
             /**
              * @brief Pauses the audio source. @see ResumeSpeaking to continue streaming.
@@ -211,6 +274,34 @@ namespace DiscordBot
              */
             void StopSpeaking(Guild guild) override;
 
+            /**
+             * @brief Mixes a source over the audio which is playing, e.g. a sound effect over music. All sources of a guild share one encoder.
+             * Starts sending if nothing is playing. The mixed sources continue if the song changes.
+             * 
+             * @param guild: The guild to mix into. The bot must be connected to a voice channel of this guild.
+             * @param source: The audio source to mix. It's removed after it returned less samples than requested.
+             * @param Gain: Value between 0.0 and 1.0. (Default 1.0)
+             * 
+             * @return Returns false if the bot isn't connected to a voice channel of the guild.
+             */
+            bool MixAudio(Guild guild, AudioSource source, float Gain) override;
+
+            /**
+             * @brief Changes the gain of a mixed audio source.
+             * 
+             * @param Gain: Value between 0.0 and 1.0.
+             * 
+             * @return Returns false if the source isn't mixed.
+             */
+            bool SetMixGain(Guild guild, AudioSource source, float Gain) override;
+
+            /**
+             * @brief Removes a mixed audio source. @see StopSpeaking stops all audio.
+             * 
+             * @return Returns false if the source isn't mixed.
+             */
+            bool StopMixAudio(Guild guild, AudioSource source) override;
+
             /**
              * @brief Removes a song from the queue by its index.
              */
@@ -268,6 +359,16 @@ namespace DiscordBot
              */
             bool IsPlaying(Guild guild) override;
 
+            /**
+             * @return Returns the statistics of the voice engine, which sends the audio of all voice connections of the process.
+             */
+            VoiceStats GetVoiceStats() override;
+
+            /**
+             * @return Returns the statistics of the cache of encoded songs or null if the cache is disabled.
+             */
+            FrameCacheStats GetFrameCacheStats() override;
+
             /**
              * @brief Runs the bot. The call returns if you calls Quit(). @see Quit()
              */
@@ -362,7 +463,7 @@ namespace DiscordBot
             ix::HttpResponsePtr Delete(const std::string &URL, const std::string &Body = "");
 
             GuildMember GetMember(Guild guild, const std::string &UserID);
-            User GetUserOrAdd(const std::string &js)
+            User GetUserOrAdd(const CJSONValue &js)
             {
                 return m_Users | js;
             }
@@ -370,16 +471,24 @@ namespace DiscordBot
             enum
             {
                 QUEUE_NEXT_SONG,
+                PREFETCH_NEXT_SONG,
                 RESUME,
                 RECONNECT,
+                VOICE_RESUME,
+                REQUEST_OWNERS,
+                CHECK_OWNERS,
                 QUIT
             };
 
-            const char *BASE_URL = "https://discord.com/api";
+            static const int OWNER_REQUEST_DELAY = 1000;    //!< Milliseconds in which the owner requests of created guilds are collected.
+            static const uint32_t OWNER_REQUEST_TIMEOUT = 60000;   //!< Milliseconds after which missing owners are requested through the rest api.
+
             std::string USER_AGENT;
 
             using VoiceSockets = std::map<std::string, VoiceSocket>;
             using AudioSources = std::map<std::string, AudioSource>;
+            using AudioBroadcasts = std::map<std::string, AudioBroadcast>;
+            using EncoderProfiles = std::map<std::string, EncoderProfile>;
             using MusicQueues = std::map<std::string, MusicQueue>;
             using AdminInterfaces = std::map<std::string, GuildAdmin>;
 
@@ -387,21 +496,46 @@ namespace DiscordBot
             Intent m_Intents;
 
             std::string m_Token;
+            std::string m_APIURL;
+            std::string m_GatewayURL;
             std::shared_ptr<SGateway> m_Gateway;
-            ix::WebSocket m_Socket;
             ix::HttpClient m_HTTPClient;
 
-            std::thread m_Heartbeat;
-            std::atomic<bool> m_Terminate;
-            std::atomic<bool> m_HeartACKReceived;
             std::atomic<bool> m_Quit;
-            uint32_t m_HeartbeatInterval;
-            std::atomic<uint32_t> m_LastSeqNum;
-            std::string m_SessionID;
             User m_BotUser;
 
+            //All gateway connections.
+            std::vector<Shard> m_Shards;
+            uint32_t m_ShardCount;
+            int64_t m_StartTime;
+            bool m_Compress;
+            GatewayEncoding m_Encoding;
+
+            //Handles the events of all guilds.
+            CEventWorkerPool m_Workers;
+            uint32_t m_WorkerCount;
+            uint32_t m_WorkerQueueDepth;
+
+            //Traffic recording and replay.
+            CGatewayRecorder m_Recorder;
+            std::atomic<bool> m_Offline;    //!< True while a recording is replayed, disables REST and voice.
+            std::mutex m_StatsLock;
+            ReplayStats m_Stats;
+
+            CEventRegistry m_Events;
+
+            //Lazy member loading.
+            uint32_t m_LargeThreshold;      //!< 0 if disabled.
+            uint32_t m_VoicePreBuffer;
+            FrameCache m_FrameCache;        //!< Null if disabled.
+            CMemberRequests m_MemberRequests;
+            atomic<std::vector<Guild>> m_PendingOwners;     //!< Lazy loaded guilds, whose owner must be requested.
+
+            //Must be destroyed before the shards.
+            CIdentifyQueue m_IdentifyQueue;
+
             // Unavailable guild IDs.
-            std::vector<std::string> m_Unavailables;
+            atomic<std::vector<std::string>> m_Unavailables;
 
             //Map of all users in different servers.
             atomic<Users> m_Users;
@@ -415,6 +549,8 @@ namespace DiscordBot
             atomic<VoiceSockets> m_VoiceSockets;
 
             atomic<AudioSources> m_AudioSources;
+            atomic<AudioBroadcasts> m_AudioBroadcasts;
+            atomic<EncoderProfiles> m_EncoderProfiles;     //!< Encoder settings of the voice connections, with the bitrate of the channel.
 
             atomic<MusicQueues> m_MusicQueues;
 
@@ -444,29 +580,83 @@ namespace DiscordBot
             void OnMessageReceive(MessageBase Msg);
 
             /**
-             * @brief Receives all websocket events from discord. This is the heart of the bot.
+             * @brief Receives all dispatched events of all shards. This is the heart of the bot.
+             * 
+             * @param Event: Event name of the payload. ("t")
+             * @param Frame: Received payload. Guild events are passed to the worker of their guild.
+             */
+            void OnDispatch(CShard *shard, const std::string &Event, GatewayFrame Frame);
+
+            /**
+             * @brief Calls the handler of an event and measures its latency during a replay.
+             * 
+             * @param Received: Time the event was received.
+             */
+            void DispatchEvent(CShard *shard, const std::string &Event, const CJSONValue &json, std::chrono::steady_clock::time_point Received);
+
+            /**
+             * @return Returns a failed response. Used instead of REST calls during a replay.
+             */
+            ix::HttpResponsePtr OfflineResponse();
+
+            /**
+             * @brief Registers the handlers of all gateway events. Implemented in DiscordClientEvents.cpp.
+             */
+            void RegisterEvents();
+
+            //Gateway event handlers. Implemented in DiscordClientEvents.cpp.
+            void HandleReady(CShard *shard, const CJSONValue &json);
+            void HandleResumed(CShard *shard, const CJSONValue &json);
+            void HandleGuildCreate(CShard *shard, const CJSONValue &json);
+            void HandleGuildDelete(CShard *shard, const CJSONValue &json);
+            void HandleChannelCreate(CShard *shard, const CJSONValue &json);
+            void HandleChannelUpdate(CShard *shard, const CJSONValue &json);
+            void HandleChannelDelete(CShard *shard, const CJSONValue &json);
+            void HandleGuildMemberAdd(CShard *shard, const CJSONValue &json);
+            void HandleGuildMemberUpdate(CShard *shard, const CJSONValue &json);
+            void HandleGuildMemberRemove(CShard *shard, const CJSONValue &json);
+            void HandleGuildMembersChunk(CShard *shard, const CJSONValue &json);
+            void HandlePresenceUpdate(CShard *shard, const CJSONValue &json);
+            void HandleVoiceStateUpdate(CShard *shard, const CJSONValue &json);
+            void HandleVoiceServerUpdate(CShard *shard, const CJSONValue &json);
+            void HandleMessage(const CJSONValue &json, ActionType Type);
+
+            /**
+             * @brief Called from a shard if the heartbeat failed and the connection is lost.
+             */
+            void OnShardDisconnect(CShard *shard);
+
+            /**
+             * @return Gets the shard which handles the given guild. Guild ids which can't be parsed (e.g. DMs) are handled by shard 0.
              */
-            void OnWebsocketEvent(const ix::WebSocketMessagePtr& msg);
+            Shard GetShard(const std::string &GuildID);
 
             /**
-             * @brief Sends a heartbeat.
+             * @brief Builds and sends a payload object to the shard of the given guild.
+             * 
+             * @param Background: True to send the payload after all other waiting payloads of the shard.
              */
-            void Heartbeat();
+            void SendOP(OPCodes OP, const std::string &D, const std::string &GuildID, bool Background = false);
 
             /**
-             * @brief Builds and sends a payload object.
+             * @brief Sends a REQUEST_GUILD_MEMBERS call for every batch of the request.
              */
-            void SendOP(OPCodes OP, const std::string &D);
+            std::future<std::vector<GuildMember>> SendMemberRequests(Guild guild, const std::vector<std::vector<std::string>> &Batches, const std::string &Query, uint32_t Limit, uint32_t TimeoutMS, bool Background = false);
 
             /**
-             * @brief Sends the identity.
+             * @brief Requests the owners of the lazy loaded guilds, which were created since the last call. Called from the message manager.
              */
-            void SendIdentity();
+            void RequestOwners();
 
             /**
-             * @brief Sends a resume request.
+             * @brief Gets the owners, which weren't received until the timeout of their request, through the rest api. Called from the message manager.
              */
-            void SendResume();
+            void CheckOwners(const std::vector<Guild> &Requested);
+
+            /**
+             * @brief Builds and sends a payload object to all shards.
+             */
+            void BroadcastOP(OPCodes OP, const std::string &D);
 
             /**
              * @brief Called from voice socket if a audio source finished.
@@ -475,13 +665,31 @@ namespace DiscordBot
 
             void OnQueueWaitFinish(const std::string &Guild, AudioSource Source);
 
+            /**
+             * @brief Called from the timer service if a voice heartbeat isn't acknowledged. Resumes the connection on the message thread.
+             */
+            void OnVoiceConnectionLost(const std::string &Guild);
+
+            /**
+             * @brief Called from the identify queue after the session start limit was reset. Requests the new limits.
+             */
+            void RefreshSessionLimit();
+
+            /**
+             * @brief Limits the bitrate of the profile to the bitrate of the channel and passes the profile to the voice connection and the queue of the guild.
+             */
+            void SetEncoderProfile(Channel channel, EncoderProfile profile);
+
             std::string OnlineStateToStr(OnlineState state);
             OnlineState StrToOnlineState(const std::string &state);
 
-            GuildMember CreateMember(CJSON &json, Guild guild);
-            VoiceState CreateVoiceState(CJSON &json, Guild guild);
-            Message CreateMessage(CJSON &json);
-            Activity CreateActivity(CJSON &json);
+            /**
+             * @param user: User of the member, if the json has no user object. (e.g.: Member object of a message)
+             */
+            GuildMember CreateMember(const CJSONValue &json, Guild guild, User user = nullptr);
+            VoiceState CreateVoiceState(const CJSONValue &json, Guild guild);
+            Message CreateMessage(const CJSONValue &json);
+            Activity CreateActivity(const CJSONValue &json);
     };
 } // namespace DiscordBot
 
@@ -0,0 +1,565 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "DiscordClient.hpp"
+#include <models/DiscordException.hpp>
+#include "../helpers/Helper.hpp"
+#include <Log.hpp>
+
+namespace DiscordBot
+{
+    void CDiscordClient::RegisterEvents()
+    {
+        m_Events.Register("READY", std::bind(&CDiscordClient::HandleReady, this, std::placeholders::_1, std::placeholders::_2));
+        m_Events.Register("RESUMED", std::bind(&CDiscordClient::HandleResumed, this, std::placeholders::_1, std::placeholders::_2));
+
+        //GUILDS Intent
+        m_Events.Register("GUILD_CREATE", std::bind(&CDiscordClient::HandleGuildCreate, this, std::placeholders::_1, std::placeholders::_2));
+        m_Events.Register("GUILD_DELETE", std::bind(&CDiscordClient::HandleGuildDelete, this, std::placeholders::_1, std::placeholders::_2));
+        m_Events.Register("CHANNEL_CREATE", std::bind(&CDiscordClient::HandleChannelCreate, this, std::placeholders::_1, std::placeholders::_2));
+        m_Events.Register("CHANNEL_UPDATE", std::bind(&CDiscordClient::HandleChannelUpdate, this, std::placeholders::_1, std::placeholders::_2));
+        m_Events.Register("CHANNEL_DELETE", std::bind(&CDiscordClient::HandleChannelDelete, this, std::placeholders::_1, std::placeholders::_2));
+
+        //GUILD_MEMBERS Intent
+        m_Events.Register("GUILD_MEMBER_ADD", std::bind(&CDiscordClient::HandleGuildMemberAdd, this, std::placeholders::_1, std::placeholders::_2));
+        m_Events.Register("GUILD_MEMBER_UPDATE", std::bind(&CDiscordClient::HandleGuildMemberUpdate, this, std::placeholders::_1, std::placeholders::_2));
+        m_Events.Register("GUILD_MEMBER_REMOVE", std::bind(&CDiscordClient::HandleGuildMemberRemove, this, std::placeholders::_1, std::placeholders::_2));
+        m_Events.Register("GUILD_BAN_ADD", std::bind(&CDiscordClient::HandleGuildMemberRemove, this, std::placeholders::_1, std::placeholders::_2));
+        m_Events.Register("GUILD_MEMBERS_CHUNK", std::bind(&CDiscordClient::HandleGuildMembersChunk, this, std::placeholders::_1, std::placeholders::_2));
+
+        //GUILD_PRESENCES Intent
+        m_Events.Register("PRESENCE_UPDATE", std::bind(&CDiscordClient::HandlePresenceUpdate, this, std::placeholders::_1, std::placeholders::_2));
+
+        //GUILD_VOICE_STATES Intent
+        m_Events.Register("VOICE_STATE_UPDATE", std::bind(&CDiscordClient::HandleVoiceStateUpdate, this, std::placeholders::_1, std::placeholders::_2));
+        m_Events.Register("VOICE_SERVER_UPDATE", std::bind(&CDiscordClient::HandleVoiceServerUpdate, this, std::placeholders::_1, std::placeholders::_2));
+
+        //GUILD_MESSAGES Intent
+        m_Events.Register("MESSAGE_CREATE", std::bind(&CDiscordClient::HandleMessage, this, std::placeholders::_2, ActionType::MESSAGE_CREATED));
+        m_Events.Register("MESSAGE_UPDATE", std::bind(&CDiscordClient::HandleMessage, this, std::placeholders::_2, ActionType::MESSAGE_EDITED));
+        m_Events.Register("MESSAGE_DELETE", std::bind(&CDiscordClient::HandleMessage, this, std::placeholders::_2, ActionType::MESSAGE_DELETED));
+    }
+
+    //Called after the handshake is completed.
+    void CDiscordClient::HandleReady(CShard *shard, const CJSONValue &json)
+    {
+        json["user"] >> m_BotUser >> m_Users;
+
+        for (auto &&e : json["guilds"])
+            m_Unavailables->push_back(e.GetValue<std::string>("id"));
+
+        // m_BotUser = CreateUser(json);
+
+        uint32_t Ready = GetReadyShardCount();
+        llog << linfo << "Connected with Discord! " << shard->GetURL() << " Shard: " << shard->GetID() << " Ready: " << Ready << "/" << shard->GetCount() << " after " << GetTimeMillis() - m_StartTime << " ms" << lendl;
+
+        if (m_Controller)
+            m_Controller->OnShardReady(shard->GetID(), Ready, shard->GetCount());
+
+        //The bot is ready, if all shards are connected.
+        if (m_Controller && Ready == shard->GetCount())
+            m_Controller->OnReady();
+    }
+
+    //Called if a session resumed.
+    void CDiscordClient::HandleResumed(CShard *shard, const CJSONValue &json)
+    {
+        llog << linfo << "Resumed" << lendl;
+
+        if (m_Controller)
+            m_Controller->OnResume();
+    }
+
+    /*------------------------GUILDS Intent------------------------*/
+
+    void CDiscordClient::HandleGuildCreate(CShard *shard, const CJSONValue &json)
+    {
+        Guild guild = Guild(new CGuild());
+        guild->ID = json.GetValue<std::string>("id");
+        guild->Name = json.GetValue<std::string>("name");
+        guild->Icon = json.GetValue<std::string>("icon");
+        guild->OwnerID = json.GetValue<std::string>("owner_id");
+
+        //Get all Roles;
+        for (auto &&e : json["roles"])
+        {
+            Role Tmp;
+            e >> Tmp;
+            guild->Roles->insert({Tmp->ID, Tmp});
+        }
+
+        //Get all Channels;
+        for (auto &&e : json["channels"])
+        {
+            Channel Tmp;
+            (e & m_Users) >> Tmp;
+
+            Tmp->GuildID = guild->ID;
+            guild->Channels->insert({Tmp->ID, Tmp});
+        }
+
+        //Lazy member loading only keeps the bot and members inside voice channels of large guilds.
+        bool Lazy = m_LargeThreshold != 0 && json.GetValue<bool>("large");
+        std::vector<std::string> VoiceUsers;
+        if(Lazy)
+        {
+            if(m_BotUser)
+                VoiceUsers.push_back(m_BotUser->ID);
+
+            for (auto &&e : json["voice_states"])
+                VoiceUsers.push_back(e.GetValue<std::string>("user_id"));
+        }
+
+        //Get all members.
+        for (auto &&e : json["members"])
+        {
+            if(Lazy && std::find(VoiceUsers.begin(), VoiceUsers.end(), e["user"].GetValue<std::string>("id")) == VoiceUsers.end())
+                continue;
+
+            GuildMember Tmp = CreateMember(e, guild);
+
+            // if (Tmp->UserRef)
+            //     guild->Members[Tmp->UserRef->ID] = Tmp;
+        }
+
+        //Get all voice states.
+        for (auto &&e : json["voice_states"])
+            CreateVoiceState(e, guild);
+
+        //Gets the owner object. The owners of lazy guilds are requested together and set if their chunk arrives.
+        std::string OwnerID = guild->OwnerID;
+        auto OwnerIT = guild->Members->find(OwnerID);
+        if(OwnerIT != guild->Members->end())
+            guild->Owner = OwnerIT->second;
+        else if(Lazy)
+        {
+            auto lock = m_PendingOwners.Lock();
+            m_PendingOwners->push_back(guild);
+            if(m_PendingOwners->size() == 1)
+                m_EVManger.PostMessage(REQUEST_OWNERS, 0, OWNER_REQUEST_DELAY);
+        }
+        else
+            guild->Owner = GetMember(guild, OwnerID);
+
+        //Other guilds are handled by other workers, so the lookup and the update must be one step.
+        bool Available = false;
+        {
+            auto GuildsLock = m_Guilds.Lock();
+            auto UnavailablesLock = m_Unavailables.Lock();
+            m_Guilds->insert({guild->ID, guild});
+
+            auto IT = std::find(m_Unavailables->begin(), m_Unavailables->end(), guild->ID);
+            if(IT != m_Unavailables->end())
+            {
+                m_Unavailables->erase(IT);
+                Available = true;
+            }
+        }
+
+        if(m_Controller)
+        {
+            if(Available)
+                m_Controller->OnGuildAvailable(guild);
+            else
+                m_Controller->OnGuildJoin(guild);
+        }
+    }
+
+    void CDiscordClient::HandleGuildDelete(CShard *shard, const CJSONValue &json)
+    {
+        Guild guild;
+        bool Unavailable = json.GetValue<bool>("unavailable");
+        bool NotifyUnavailable = false;
+
+        {
+            auto GuildsLock = m_Guilds.Lock();
+            auto UnavailablesLock = m_Unavailables.Lock();
+
+            auto IT = m_Guilds->find(json.GetValue<std::string>("id"));
+            if(IT != m_Guilds->end())
+            {
+                guild = IT->second;
+                auto InnerIT = std::find(m_Unavailables->begin(), m_Unavailables->end(), guild->ID);
+
+                if(Unavailable && m_Controller && InnerIT != m_Unavailables->end())
+                {
+                    m_Unavailables->erase(InnerIT);
+                    NotifyUnavailable = true;
+                }
+                else if(Unavailable || !m_Controller)
+                    m_Unavailables->push_back(guild->ID);
+
+                m_Guilds->erase(IT);
+            }
+        }
+
+        if(guild)
+        {
+            m_VoiceSockets->erase(guild->ID);
+            m_MusicQueues->erase(guild->ID);
+
+            if(NotifyUnavailable)
+                m_Controller->OnGuildUnavailable(guild);
+            else if(!Unavailable && m_Controller)
+                m_Controller->OnGuildLeave(guild);
+        }
+
+        llog << linfo << "GUILD_DELETE" << lendl;
+    }
+
+    void CDiscordClient::HandleChannelCreate(CShard *shard, const CJSONValue &json)
+    {
+        Channel Tmp;
+        (json & m_Users) >> Tmp;
+
+        auto IT = m_Guilds->find(Tmp->GuildID);
+        if(IT != m_Guilds->end())
+            IT->second->Channels->insert({Tmp->ID, Tmp});
+    }
+
+    void CDiscordClient::HandleChannelUpdate(CShard *shard, const CJSONValue &json)
+    {
+        Channel Tmp;
+        (json & m_Users) >> Tmp;
+
+        auto IT = m_Guilds->find(Tmp->GuildID);
+        if(IT != m_Guilds->end())
+        {
+            IT->second->Channels->erase(Tmp->ID);
+            IT->second->Channels->insert({Tmp->ID, Tmp});
+        }
+    }
+
+    void CDiscordClient::HandleChannelDelete(CShard *shard, const CJSONValue &json)
+    {
+        Channel Tmp;
+        (json & m_Users) >> Tmp;
+
+        auto IT = m_Guilds->find(Tmp->GuildID);
+        if(IT != m_Guilds->end())
+            IT->second->Channels->erase(Tmp->ID);
+    }
+
+    /*------------------------GUILDS Intent------------------------*/
+
+    /*------------------------GUILD_MEMBERS Intent------------------------*/
+    //ATTENTION: NEEDS "Server Members Intent" ACTIVATED TO WORK, OTHERWISE THE BOT FAIL TO CONNECT AND A ERROR IS WRITTEN TO THE CONSOLE!!!
+
+    void CDiscordClient::HandleGuildMemberAdd(CShard *shard, const CJSONValue &json)
+    {
+        std::string GuildID = json.GetValue<std::string>("guild_id");
+
+        auto IT = m_Guilds->find(GuildID);
+        if(IT != m_Guilds->end())
+        {
+            Guild guild = IT->second;//m_Guilds[GuildID];
+            GuildMember Tmp = CreateMember(json, guild);
+
+            if(m_Controller)
+                m_Controller->OnMemberAdd(guild, Tmp);
+        }
+        else
+            llog << ldebug << "Invalid Guild ( " << GuildID << " ) " << lendl;
+    }
+
+    void CDiscordClient::HandleGuildMemberUpdate(CShard *shard, const CJSONValue &json)
+    {
+        std::string GuildID = json.GetValue<std::string>("guild_id");
+        std::string Premium = json.GetValue<std::string>("premium_since");
+        std::string Nick = json.GetValue<std::string>("nick");
+        std::vector<std::string> Array = json.GetValue<std::vector<std::string>>("roles");
+        std::string UserID = json["user"].GetValue<std::string>("id");
+
+        auto GIT = m_Guilds->find(GuildID);
+        if(GIT != m_Guilds->end())
+        {
+            Guild guild = GIT->second;//m_Guilds[GuildID];
+            auto IT = guild->Members->find(UserID);
+            if(IT != guild->Members->end())
+            {
+                IT->second->Roles->clear();
+                for (auto &&e : Array)
+                    IT->second->Roles->push_back(guild->Roles->at(e));                               
+
+                IT->second->Nick = Nick;
+                IT->second->PremiumSince = Premium;
+
+                if(m_Controller)
+                    m_Controller->OnMemberUpdate(guild, IT->second);
+            } 
+        }
+        else
+            llog << ldebug << "Invalid Guild ( " << GuildID << " ) " << lendl;
+    }
+
+    //Also called for GUILD_BAN_ADD.
+    void CDiscordClient::HandleGuildMemberRemove(CShard *shard, const CJSONValue &json)
+    {
+        std::string GuildID = json.GetValue<std::string>("guild_id");
+        std::string UserID = json["user"].GetValue<std::string>("id");
+
+        auto GIT = m_Guilds->find(GuildID);
+        if(GIT != m_Guilds->end())
+        {
+            Guild guild = GIT->second;//m_Guilds[GuildID];
+
+            auto IT = guild->Members->find(UserID);
+            if(IT != guild->Members->end())
+            {
+                GuildMember member = IT->second;
+                guild->Members->erase(IT);
+
+                if(m_Controller)
+                    m_Controller->OnMemberRemove(guild, member);
+            }                                
+
+            //The user can be shared with guilds of other workers.
+            auto lock = m_Users.Lock();
+            auto UIT = m_Users->find(UserID);
+            if(UIT != m_Users->end() && UIT->second.use_count() == 1)
+                m_Users->erase(UIT);
+        }
+        else
+            llog << ldebug << "Invalid Guild ( " << GuildID << " ) " << lendl;
+    }
+
+    //Response of REQUEST_GUILD_MEMBERS.
+    void CDiscordClient::HandleGuildMembersChunk(CShard *shard, const CJSONValue &json)
+    {
+        CMemberRequests::Members Chunk;
+
+        auto GIT = m_Guilds->find(json.GetValue<std::string>("guild_id"));
+        if(GIT != m_Guilds->end())
+        {
+            Guild guild = GIT->second;
+            for (auto &&e : json["members"])
+                Chunk.push_back(CreateMember(e, guild));
+
+            if(!guild->Owner)
+            {
+                auto OwnerIT = guild->Members->find(guild->OwnerID);
+                if(OwnerIT != guild->Members->end())
+                    guild->Owner = OwnerIT->second;
+            }
+        }
+
+        //Chunks of unknown guilds must complete their request too.
+        m_MemberRequests.OnChunk(json.GetValue<std::string>("nonce"), json.GetValue<uint32_t>("chunk_count"), Chunk);
+    }
+
+    /*------------------------GUILD_MEMBERS Intent------------------------*/
+
+    /*------------------------GUILD_PRESENCES Intent------------------------*/
+    //ATTENTION: NEEDS "Presence Intent" ACTIVATED TO WORK, OTHERWISE THE BOT FAIL TO CONNECT AND A ERROR IS WRITTEN TO THE CONSOLE!!!
+
+    void CDiscordClient::HandlePresenceUpdate(CShard *shard, const CJSONValue &json)
+    {
+        User user = m_Users | json["user"];
+
+        if(!json["game"].IsNull())
+            user->Game = CreateActivity(json["game"]);
+
+        user->State = StrToOnlineState(json.GetValue<std::string>("status"));
+        for (auto &&e : json["activities"])
+            user->Activities->push_back(CreateActivity(e));
+
+        CJSONValue JClientState = json["client_status"];
+
+        user->Desktop = StrToOnlineState(JClientState.GetValue<std::string>("desktop"));      
+        user->Mobile = StrToOnlineState(JClientState.GetValue<std::string>("mobile"));   
+        user->Web = StrToOnlineState(JClientState.GetValue<std::string>("web"));                      
+
+        auto GIT = m_Guilds->find(json.GetValue<std::string>("guild_id"));
+        if(GIT != m_Guilds->end())
+        {
+            GuildMember member;
+            auto MIT = GIT->second->Members->find(user->ID);
+            if(MIT != GIT->second->Members->end())
+                member = MIT->second;
+            else if(m_LargeThreshold != 0)
+                return;     //Not loaded members are ignored, instead of loading each one via REST.
+            else
+                member = GetMember(GIT->second, user->ID);
+
+            if(m_Controller)
+                m_Controller->OnPresenceUpdate(GIT->second, member);
+        }
+    }
+
+    /*------------------------GUILD_PRESENCES Intent------------------------*/
+
+    /*------------------------GUILD_VOICE_STATES Intent------------------------*/
+
+    void CDiscordClient::HandleVoiceStateUpdate(CShard *shard, const CJSONValue &json)
+    {
+        auto G = m_Guilds->find(json.GetValue<std::string>("guild_id"));
+        if(G == m_Guilds->end())
+            return;
+
+        Channel c;
+        auto M = G->second->Members->find(json.GetValue<std::string>("user_id"));
+        if(M == G->second->Members->end())
+        {
+            //Lazy loaded guilds don't know every member, the voice state contains it.
+            CJSONValue JMember = json["member"];
+            if(!JMember.IsNull())
+                CreateMember(JMember, G->second);
+        }
+        else if(M->second->State)
+            c = M->second->State->ChannelRef;   //Saves the old channel.
+
+        VoiceState Tmp = CreateVoiceState(json, nullptr);
+
+        if (m_Controller && Tmp->GuildRef)
+        {
+            if(Tmp->UserRef)
+            {
+                if(Tmp->UserRef->ID == m_BotUser->ID && !Tmp->ChannelRef)
+                {
+                    m_VoiceSockets->erase(Tmp->GuildRef->ID);
+                    m_MusicQueues->erase(Tmp->GuildRef->ID);
+                }
+
+                auto IT = Tmp->GuildRef->Members->find(Tmp->UserRef->ID);
+                if(IT != Tmp->GuildRef->Members->end())
+                {
+                    m_Controller->OnVoiceStateUpdate(Tmp->GuildRef, IT->second);
+
+                    auto AIT = m_Admins->find(Tmp->GuildRef->ID);
+                    if(AIT != m_Admins->end())
+                    {
+                        auto Admin = std::dynamic_pointer_cast<CGuildAdmin>(AIT->second);
+
+                        if(!c)
+                            c = Tmp->ChannelRef;
+
+                        if(c)
+                            Admin->OnUserVoiceStateChanged(c, IT->second);
+                    }
+                }
+            }
+        }   
+    }
+
+    //Called if your bot joins a voice channel.
+    void CDiscordClient::HandleVoiceServerUpdate(CShard *shard, const CJSONValue &json)
+    {
+        //Voice connections aren't possible during a replay.
+        if(m_Offline)
+            return;
+
+        Guilds::iterator GIT = m_Guilds->find(json.GetValue<std::string>("guild_id"));
+        if (GIT != m_Guilds->end())
+        {
+            auto UIT = GIT->second->Members->find(m_BotUser->ID);
+            if (UIT != GIT->second->Members->end())
+            {
+                VoiceSocket Socket = VoiceSocket(new CVoiceSocket(json, UIT->second->State->SessionID, m_BotUser->ID));
+                Socket->SetOnSpeakFinish(std::bind(&CDiscordClient::OnSpeakFinish, this, std::placeholders::_1));
+                Socket->SetOnConnectionLost(std::bind(&CDiscordClient::OnVoiceConnectionLost, this, std::placeholders::_1));
+                Socket->SetPreBuffer(m_VoicePreBuffer);
+
+                EncoderProfiles::iterator PIT = m_EncoderProfiles->find(GIT->second->ID);
+                EncoderProfile Profile = PIT != m_EncoderProfiles->end() ? PIT->second : nullptr;
+                Socket->SetEncoderProfile(Profile);
+                m_VoiceSockets->insert({GIT->second->ID, Socket});
+
+                //Creates a music queue for the server.
+                if(m_QueueFactory)
+                {
+                    if(m_MusicQueues->find(GIT->second->ID) == m_MusicQueues->end())
+                    {
+                        MusicQueue MQ = m_QueueFactory->Create();
+                        MQ->SetGuildID(GIT->second->ID);
+                        MQ->SetOnWaitFinishCallback(std::bind(&CDiscordClient::OnQueueWaitFinish, this, std::placeholders::_1, std::placeholders::_2));
+                        MQ->SetFrameCache(m_FrameCache);
+                        MQ->SetEncoderProfile(Profile);
+                        m_MusicQueues->insert({GIT->second->ID, MQ});
+                    }
+                }
+
+                //Plays the queued audiosource.
+                AudioSources::iterator IT = m_AudioSources->find(GIT->second->ID);
+                if (IT != m_AudioSources->end())
+                {
+                    Socket->StartSpeaking(IT->second);
+                    m_AudioSources->erase(IT);
+                }
+
+                AudioBroadcasts::iterator BIT = m_AudioBroadcasts->find(GIT->second->ID);
+                if (BIT != m_AudioBroadcasts->end())
+                {
+                    Socket->StartBroadcast(BIT->second);
+                    m_AudioBroadcasts->erase(BIT);
+                }
+            }
+        }
+    }
+
+    /*------------------------GUILD_VOICE_STATES Intent------------------------*/
+
+    /*------------------------GUILD_MESSAGES Intent------------------------*/
+
+    void CDiscordClient::HandleMessage(const CJSONValue &json, ActionType Type)
+    {
+        Message msg = CreateMessage(json);
+
+        std::shared_ptr<CGuildAdmin> Admin;
+        if(msg->GuildRef)
+        {
+            auto AIT = m_Admins->find(msg->GuildRef->ID);
+            if(AIT != m_Admins->end())
+                Admin = std::dynamic_pointer_cast<CGuildAdmin>(AIT->second);
+        }
+
+        if (m_Controller)
+        {
+            switch (Type)
+            {
+                case ActionType::MESSAGE_CREATED:
+                {
+                    m_Controller->OnMessage(msg);
+                }break;
+
+                case ActionType::MESSAGE_EDITED:
+                {
+                    m_Controller->OnMessageEdited(msg);
+                }break;
+
+                case ActionType::MESSAGE_DELETED:
+                {
+                    m_Controller->OnMessageDeleted(msg);
+                }break;
+
+                default:
+                    break;
+            }
+        }
+
+        if(Admin)
+            Admin->OnMessageEvent(Type, msg->ChannelRef, msg);
+    }
+
+    /*------------------------GUILD_MESSAGES Intent------------------------*/
+} // namespace DiscordBot
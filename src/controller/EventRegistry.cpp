@@ -0,0 +1,80 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "EventRegistry.hpp"
+#include <models/DiscordException.hpp>
+#include <Log.hpp>
+
+namespace DiscordBot
+{
+    CEventRegistry::CEventRegistry() : m_UnknownEvents(0)
+    {
+        for (auto &&e : m_Table)
+            e.Name = nullptr;
+
+        for (auto &&e : GATEWAY_EVENTS)
+            m_Table[EventSlot(e, EVENT_SEED)].Name = e;
+    }
+
+    void CEventRegistry::Register(const std::string &Event, EventHandler Handler)
+    {
+        SEntry *Entry = Find(Event);
+        if(!Entry)
+            throw CDiscordClientException("Unknown gateway event: " + Event, DiscordClientErrorType::UNKNOWN_EVENT);
+
+        Entry->Handler = Handler;
+    }
+
+    bool CEventRegistry::Dispatch(const std::string &Event, CShard *shard, const CJSONValue &json)
+    {
+        SEntry *Entry = Find(Event);
+        if(!Entry)
+        {
+            m_UnknownEvents++;
+
+            //Logs each name once, a new event of the api would flood the log otherwise.
+            std::lock_guard<std::mutex> lock(m_UnknownLock);
+            if(m_UnknownNames.size() < MAX_UNKNOWN_NAMES && m_UnknownNames.insert(Event).second)
+                llog << linfo << "Unknown gateway event: " << Event << lendl;
+
+            return false;
+        }
+
+        if(!Entry->Handler)
+            return false;
+
+        Entry->Handler(shard, json);
+        return true;
+    }
+
+    CEventRegistry::SEntry *CEventRegistry::Find(const std::string &Event)
+    {
+        //Different names can share the slot of a known event.
+        SEntry &Entry = m_Table[EventSlot(Event.c_str(), EVENT_SEED)];
+        if(!Entry.Name || Event != Entry.Name)
+            return nullptr;
+
+        return &Entry;
+    }
+} // namespace DiscordBot
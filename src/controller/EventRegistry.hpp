@@ -0,0 +1,213 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EVENTREGISTRY_HPP
+#define EVENTREGISTRY_HPP
+
+#include <string>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <functional>
+#include <stdint.h>
+#include "../helpers/JSONView.hpp"
+
+namespace DiscordBot
+{
+    class CShard;
+
+    /**
+     * @brief Handler of a gateway event. Receives the shard and the event data ("d") of the payload.
+     */
+    using EventHandler = std::function<void(CShard *shard, const CJSONValue &json)>;
+
+    //All dispatch events https://discord.com/developers/docs/topics/gateway#commands-and-events-gateway-events
+    constexpr const char *GATEWAY_EVENTS[] = 
+    {
+        "READY",
+        "RESUMED",
+        "APPLICATION_COMMAND_CREATE",
+        "APPLICATION_COMMAND_UPDATE",
+        "APPLICATION_COMMAND_DELETE",
+        "APPLICATION_COMMAND_PERMISSIONS_UPDATE",
+        "CHANNEL_CREATE",
+        "CHANNEL_UPDATE",
+        "CHANNEL_DELETE",
+        "CHANNEL_PINS_UPDATE",
+        "THREAD_CREATE",
+        "THREAD_UPDATE",
+        "THREAD_DELETE",
+        "THREAD_LIST_SYNC",
+        "THREAD_MEMBER_UPDATE",
+        "THREAD_MEMBERS_UPDATE",
+        "GUILD_CREATE",
+        "GUILD_UPDATE",
+        "GUILD_DELETE",
+        "GUILD_BAN_ADD",
+        "GUILD_BAN_REMOVE",
+        "GUILD_EMOJIS_UPDATE",
+        "GUILD_STICKERS_UPDATE",
+        "GUILD_INTEGRATIONS_UPDATE",
+        "GUILD_MEMBER_ADD",
+        "GUILD_MEMBER_REMOVE",
+        "GUILD_MEMBER_UPDATE",
+        "GUILD_MEMBERS_CHUNK",
+        "GUILD_ROLE_CREATE",
+        "GUILD_ROLE_UPDATE",
+        "GUILD_ROLE_DELETE",
+        "GUILD_JOIN_REQUEST_DELETE",
+        "INTEGRATION_CREATE",
+        "INTEGRATION_UPDATE",
+        "INTEGRATION_DELETE",
+        "INTERACTION_CREATE",
+        "INVITE_CREATE",
+        "INVITE_DELETE",
+        "MESSAGE_CREATE",
+        "MESSAGE_UPDATE",
+        "MESSAGE_DELETE",
+        "MESSAGE_DELETE_BULK",
+        "MESSAGE_REACTION_ADD",
+        "MESSAGE_REACTION_REMOVE",
+        "MESSAGE_REACTION_REMOVE_ALL",
+        "MESSAGE_REACTION_REMOVE_EMOJI",
+        "PRESENCE_UPDATE",
+        "PRESENCES_REPLACE",
+        "STAGE_INSTANCE_CREATE",
+        "STAGE_INSTANCE_UPDATE",
+        "STAGE_INSTANCE_DELETE",
+        "TYPING_START",
+        "USER_UPDATE",
+        "VOICE_STATE_UPDATE",
+        "VOICE_SERVER_UPDATE",
+        "WEBHOOKS_UPDATE"
+    };
+
+    const uint32_t EVENT_TABLE_SIZE = 512;     //!< Must be a power of two.
+    const size_t MAX_UNKNOWN_NAMES = 64;       //!< Unknown event names which are logged, bounds the memory if garbage is received.
+
+    /**
+     * @brief Seeded FNV-1a hash, usable at compile time.
+     */
+    inline constexpr uint32_t EventHash(const char *Data, uint32_t Seed)
+    {
+        uint32_t Hash = 2166136261u ^ Seed;
+        while (*Data)
+        {
+            Hash ^= (uint8_t)*Data++;
+            Hash *= 16777619u;
+        }
+
+        return Hash;
+    }
+
+    inline constexpr uint32_t EventSlot(const char *Event, uint32_t Seed)
+    {
+        return EventHash(Event, Seed) & (EVENT_TABLE_SIZE - 1);
+    }
+
+    /**
+     * @return Returns true if all known events are mapped to different slots.
+     */
+    inline constexpr bool IsPerfectEventSeed(uint32_t Seed)
+    {
+        bool Used[EVENT_TABLE_SIZE] = {};
+        for (auto &&e : GATEWAY_EVENTS)
+        {
+            uint32_t Slot = EventSlot(e, Seed);
+            if(Used[Slot])
+                return false;
+
+            Used[Slot] = true;
+        }
+
+        return true;
+    }
+
+    inline constexpr uint32_t FindEventSeed()
+    {
+        uint32_t Seed = 0;
+        while (!IsPerfectEventSeed(Seed))
+            Seed++;
+
+        return Seed;
+    }
+
+    //Searched by the compiler, every known event has its own slot.
+    constexpr uint32_t EVENT_SEED = FindEventSeed();
+    static_assert(IsPerfectEventSeed(EVENT_SEED), "No perfect hash seed for the gateway events");
+
+    /**
+     * @brief Maps gateway events to their handlers using a perfect hash over GATEWAY_EVENTS.
+     * Events which are not part of GATEWAY_EVENTS are counted and ignored.
+     */
+    class CEventRegistry
+    {
+        public:
+            CEventRegistry();
+
+            /**
+             * @brief Registers the handler of a gateway event. Replaces the old handler. Must be called before the client runs.
+             * 
+             * @throw CDiscordClientException if the event is not a known gateway event.
+             */
+            void Register(const std::string &Event, EventHandler Handler);
+
+            /**
+             * @brief Calls the handler of the event.
+             * 
+             * @return Returns false if the event is unknown or has no handler.
+             */
+            bool Dispatch(const std::string &Event, CShard *shard, const CJSONValue &json);
+
+            /**
+             * @return Gets the number of received events, which are not part of GATEWAY_EVENTS.
+             */
+            inline uint64_t GetUnknownEventCount() const
+            {
+                return m_UnknownEvents;
+            }
+
+        private:
+            struct SEntry
+            {
+                const char *Name;
+                EventHandler Handler;
+            };
+
+            std::array<SEntry, EVENT_TABLE_SIZE> m_Table;
+            std::atomic<uint64_t> m_UnknownEvents;
+
+            std::mutex m_UnknownLock;
+            std::set<std::string> m_UnknownNames;   //!< Names which are already logged.
+
+            /**
+             * @return Returns the entry of the event or null if the event is unknown.
+             */
+            SEntry *Find(const std::string &Event);
+    };
+} // namespace DiscordBot
+
+
+#endif //EVENTREGISTRY_HPP
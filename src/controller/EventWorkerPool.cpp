@@ -0,0 +1,147 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "EventWorkerPool.hpp"
+#include <Log.hpp>
+#include <algorithm>
+#include <exception>
+
+namespace DiscordBot
+{
+    void CEventWorkerPool::Start(uint32_t Count, uint32_t QueueDepth)
+    {
+        Stop();
+
+        m_QueueDepth = std::max<uint32_t>(QueueDepth, 1);
+        for (uint32_t i = 0; i < Count; i++)
+        {
+            m_Workers.push_back(std::make_shared<SWorker>());
+            m_Workers.back()->Thread = std::thread(&CEventWorkerPool::Run, m_Workers.back());
+        }
+    }
+
+    void CEventWorkerPool::Post(uint64_t Key, Job job, bool Wait)
+    {
+        if(m_Workers.empty())
+        {
+            job();
+            return;
+        }
+
+        //Fibonacci hashing, spreads the ids evenly over the workers.
+        SWorker *Worker = m_Workers[((Key * 0x9E3779B97F4A7C15ull) >> 32) % m_Workers.size()].get();
+        std::unique_lock<std::mutex> lock(Worker->Lock);
+
+        if(Worker->Queue.size() >= m_QueueDepth)
+        {
+            if(!Worker->Saturated)
+            {
+                Worker->Saturated = true;
+                llog << linfo << "Event queue full (" << m_QueueDepth << " events), a handler is too slow" << lendl;
+            }
+
+            //Callers which must not block, e.g. the websocket thread which also receives the heartbeat acks, are queueing beyond the depth.
+            if(!Wait && !Worker->Terminate)
+                m_Spilled++;
+        }
+
+        //Backpressure, the caller waits until the worker catches up.
+        if(Wait)
+            Worker->NotFull.wait(lock, [this, Worker]{ return Worker->Queue.size() < m_QueueDepth || Worker->Terminate; });
+
+        if(Worker->Terminate)
+            return;
+
+        Worker->Queue.push_back(std::move(job));
+        Worker->NotEmpty.notify_one();
+    }
+
+    void CEventWorkerPool::Flush()
+    {
+        for (auto &&e : m_Workers)
+        {
+            std::unique_lock<std::mutex> lock(e->Lock);
+            e->Idle.wait(lock, [&e]{ return (e->Queue.empty() && !e->Busy) || e->Terminate; });
+        }
+    }
+
+    void CEventWorkerPool::Stop()
+    {
+        for (auto &&e : m_Workers)
+        {
+            std::lock_guard<std::mutex> lock(e->Lock);
+            e->Terminate = true;
+            e->Queue.clear();
+            e->NotEmpty.notify_all();
+            e->NotFull.notify_all();
+            e->Idle.notify_all();
+        }
+
+        for (auto &&e : m_Workers)
+        {
+            //A handler may stop the client from inside a worker.
+            if(e->Thread.get_id() == std::this_thread::get_id())
+                e->Thread.detach();
+            else if(e->Thread.joinable())
+                e->Thread.join();
+        }
+
+        m_Workers.clear();
+    }
+
+    void CEventWorkerPool::Run(std::shared_ptr<SWorker> Worker)
+    {
+        std::unique_lock<std::mutex> lock(Worker->Lock);
+        while (true)
+        {
+            Worker->NotEmpty.wait(lock, [&Worker]{ return !Worker->Queue.empty() || Worker->Terminate; });
+            if(Worker->Terminate)
+                break;
+
+            Job job = std::move(Worker->Queue.front());
+            Worker->Queue.pop_front();
+            Worker->Busy = true;
+
+            if(Worker->Queue.empty())
+                Worker->Saturated = false;
+
+            Worker->NotFull.notify_one();
+
+            lock.unlock();
+            try
+            {
+                job();
+            }
+            catch(const std::exception &e)
+            {
+                llog << lerror << "Exception in event handler what(): " << e.what() << lendl;
+            }
+            lock.lock();
+
+            Worker->Busy = false;
+            if(Worker->Queue.empty())
+                Worker->Idle.notify_all();
+        }
+    }
+} // namespace DiscordBot
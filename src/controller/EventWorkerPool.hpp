@@ -0,0 +1,114 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef EVENTWORKERPOOL_HPP
+#define EVENTWORKERPOOL_HPP
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <stdint.h>
+
+namespace DiscordBot
+{
+    /**
+     * @brief Fixed pool of worker threads with one bounded queue per worker. Jobs are mapped to a worker by a key (e.g. the guild id),
+     * so jobs with the same key run in order, while jobs with different keys run in parallel.
+     */
+    class CEventWorkerPool
+    {
+        public:
+            using Job = std::function<void()>;
+
+            CEventWorkerPool() : m_QueueDepth(0), m_Spilled(0) {}
+
+            /**
+             * @brief Starts the workers.
+             * 
+             * @param Count: Number of worker threads. 0 runs all jobs on the thread which posts them.
+             * @param QueueDepth: Max number of pending jobs per worker.
+             */
+            void Start(uint32_t Count, uint32_t QueueDepth);
+
+            /**
+             * @brief Queues a job.
+             * 
+             * @param Key: Jobs with the same key are executed in order.
+             * @param Wait: True to block while the queue of the worker is full. Otherwise the job is queued beyond the depth and counted as spilled.
+             */
+            void Post(uint64_t Key, Job job, bool Wait = true);
+
+            /**
+             * @return Gets the count of jobs, which were queued beyond the depth of a full queue.
+             */
+            uint64_t GetSpilled() const
+            {
+                return m_Spilled;
+            }
+
+            /**
+             * @brief Waits until all queued jobs are done.
+             */
+            void Flush();
+
+            /**
+             * @brief Stops all workers. Pending jobs are dropped.
+             */
+            void Stop();
+
+            ~CEventWorkerPool()
+            {
+                Stop();
+            }
+
+        private:
+            struct SWorker
+            {
+                std::thread Thread;
+                std::mutex Lock;
+                std::condition_variable NotEmpty;
+                std::condition_variable NotFull;
+                std::condition_variable Idle;
+                std::deque<Job> Queue;
+                bool Terminate = false;
+                bool Busy = false;
+                bool Saturated = false;     //!< Limits the log output to one message per overflow.
+            };
+
+            //Shared with the thread, a worker which stops the pool must outlive it.
+            std::vector<std::shared_ptr<SWorker>> m_Workers;
+            uint32_t m_QueueDepth;
+            std::atomic<uint64_t> m_Spilled;
+
+            static void Run(std::shared_ptr<SWorker> Worker);
+    };
+} // namespace DiscordBot
+
+
+#endif //EVENTWORKERPOOL_HPP
@@ -0,0 +1,425 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "FrameCache.hpp"
+#include <config.h>
+#include <Log.hpp>
+#include <opus.h>
+#include <string.h>
+#include <algorithm>
+#include "VoiceStream.hpp"
+
+#ifdef DISCORDBOT_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace DiscordBot
+{
+    CFrameCache::CFrameCache(uint64_t RAMBytes, const std::string &SpillFile, uint64_t SpillBytes) : m_MaxRAM(RAMBytes), m_RAMBytes(0), m_Map(nullptr), m_MapSize(0), m_File(-1), m_SpillPos(0), m_DiskBytes(0), m_Hits(0), m_Misses(0), m_Spills(0), m_Evictions(0)
+    {
+        if(SpillFile.empty() || SpillBytes == 0)
+            return;
+
+#ifdef DISCORDBOT_UNIX
+        m_File = open(SpillFile.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if(m_File < 0 || ftruncate(m_File, SpillBytes) != 0)
+        {
+            llog << lerror << "Failed to create the spill file " << SpillFile << lendl;
+            return;
+        }
+
+        void *Map = mmap(nullptr, SpillBytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_File, 0);
+        if(Map == MAP_FAILED)
+        {
+            llog << lerror << "Failed to map the spill file " << SpillFile << lendl;
+            return;
+        }
+
+        m_Map = (uint8_t*)Map;
+        m_MapSize = SpillBytes;
+#else
+        llog << lerror << "The spill file of the frame cache is only supported on unix" << lendl;
+#endif
+    }
+
+    /**
+     * @return Gets the cache key of a song, which was encoded with the given profile.
+     */
+    std::string CFrameCache::MakeKey(const std::string &Path, const EncoderProfile &Profile)
+    {
+        CEncoderProfile Settings;
+        if(Profile)
+            Settings = *Profile;
+
+        return Path + "|" + std::to_string(CVoiceStream::FREQUENCY) + "/" + std::to_string(CVoiceStream::CHANNEL) + "/" + Settings.GetKey();
+    }
+
+    /**
+     * @return Gets a source which plays the cached song or null if the song isn't cached.
+     */
+    AudioSource CFrameCache::Find(const std::string &Key)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        auto IT = m_Entries.find(Key);
+        if(IT == m_Entries.end())
+        {
+            m_Misses++;
+            return nullptr;
+        }
+
+        m_Hits++;
+        SEntry &Entry = IT->second;
+
+        if(Entry.Frames)
+            m_LRU.splice(m_LRU.begin(), m_LRU, Entry.LRU);
+        else
+        {
+            //The song is played again, so it's moved back into memory.
+            Entry.Frames = Load(Entry);
+            Unspill(Entry);
+
+            m_LRU.push_front(Key);
+            Entry.LRU = m_LRU.begin();
+            m_RAMBytes += Entry.Frames->GetBytes();
+
+            EncodedFrames Frames = Entry.Frames;
+            Evict();
+            return std::make_shared<CCachedAudioSource>(Frames);
+        }
+
+        return std::make_shared<CCachedAudioSource>(Entry.Frames);
+    }
+
+    /**
+     * @brief Wraps a source, which encodes the song for the voice stream.
+     */
+    AudioSource CFrameCache::Record(const std::string &Key, AudioSource Source, EncoderProfile Profile)
+    {
+        return std::make_shared<CRecordingAudioSource>(std::weak_ptr<CFrameCache>(shared_from_this()), Key, Source, m_MaxRAM, Profile);
+    }
+
+    /**
+     * @brief Adds an encoded song. Called from the recording source.
+     */
+    void CFrameCache::Insert(const std::string &Key, EncodedFrames Frames)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        if(Frames->GetBytes() > m_MaxRAM)
+            return;
+
+        auto IT = m_Entries.find(Key);
+        if(IT != m_Entries.end())
+        {
+            //The song was encoded in parallel by another guild.
+            if(IT->second.Frames)
+                return;
+
+            Unspill(IT->second);
+            m_Entries.erase(IT);
+        }
+
+        m_LRU.push_front(Key);
+
+        SEntry &Entry = m_Entries[Key];
+        Entry.Frames = Frames;
+        Entry.LRU = m_LRU.begin();
+        Entry.Offset = 0;
+        Entry.Size = 0;
+        Entry.Count = Frames->Sizes.size();
+
+        m_RAMBytes += Frames->GetBytes();
+        Evict();
+    }
+
+    FrameCacheStats CFrameCache::GetStats()
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        FrameCacheStats Ret = FrameCacheStats(new CFrameCacheStats());
+
+        Ret->Hits = m_Hits;
+        Ret->Misses = m_Misses;
+        Ret->Entries = m_Entries.size();
+        Ret->RAMBytes = m_RAMBytes;
+        Ret->DiskBytes = m_DiskBytes;
+        Ret->Spills = m_Spills;
+        Ret->Evictions = m_Evictions;
+
+        return Ret;
+    }
+
+    /**
+     * @brief Moves the least recently used songs to the spill file or drops them, until the memory budget is kept.
+     */
+    void CFrameCache::Evict()
+    {
+        while (m_RAMBytes > m_MaxRAM && !m_LRU.empty())
+        {
+            std::string Key = m_LRU.back();
+            m_LRU.pop_back();
+
+            auto IT = m_Entries.find(Key);
+            SEntry &Entry = IT->second;
+            m_RAMBytes -= Entry.Frames->GetBytes();
+
+            if(Spill(Key, Entry))
+                m_Spills++;
+            else
+            {
+                m_Entries.erase(IT);
+                m_Evictions++;
+            }
+        }
+    }
+
+    /**
+     * @brief Writes a song into the spill file. Overwrites the oldest songs of the file.
+     */
+    bool CFrameCache::Spill(const std::string &Key, SEntry &Entry)
+    {
+        uint64_t Size = Entry.Frames->GetBytes();
+        if(!m_Map || Size > m_MapSize)
+            return false;
+
+        //The file is written like a ring.
+        if(m_SpillPos + Size > m_MapSize)
+            m_SpillPos = 0;
+
+        uint64_t End = m_SpillPos + Size;
+
+        //Drops the songs which are overwritten.
+        auto IT = m_Spilled.lower_bound(m_SpillPos);
+        if(IT != m_Spilled.begin())
+        {
+            auto Prev = std::prev(IT);
+            if(Prev->first + m_Entries.at(Prev->second).Size > m_SpillPos)
+                IT = Prev;
+        }
+
+        while (IT != m_Spilled.end() && IT->first < End)
+        {
+            m_DiskBytes -= m_Entries.at(IT->second).Size;
+            m_Entries.erase(IT->second);
+            m_Evictions++;
+
+            IT = m_Spilled.erase(IT);
+        }
+
+        const SEncodedFrames &Frames = *Entry.Frames;
+        memcpy(m_Map + m_SpillPos, Frames.Sizes.data(), Frames.Sizes.size() * sizeof(uint16_t));
+        memcpy(m_Map + m_SpillPos + Frames.Sizes.size() * sizeof(uint16_t), Frames.Data.data(), Frames.Data.size());
+
+        Entry.Offset = m_SpillPos;
+        Entry.Size = Size;
+        Entry.Frames = nullptr;
+
+        m_Spilled[m_SpillPos] = Key;
+        m_DiskBytes += Size;
+        m_SpillPos = End;
+
+        return true;
+    }
+
+    /**
+     * @brief Reads a song of the spill file back into memory.
+     */
+    EncodedFrames CFrameCache::Load(const SEntry &Entry)
+    {
+        std::shared_ptr<SEncodedFrames> Ret = std::make_shared<SEncodedFrames>();
+        const uint8_t *Pos = m_Map + Entry.Offset;
+
+        Ret->Sizes.resize(Entry.Count);
+        memcpy(Ret->Sizes.data(), Pos, Entry.Count * sizeof(uint16_t));
+
+        Ret->Data.assign(Pos + Entry.Count * sizeof(uint16_t), Pos + Entry.Size);
+        return Ret;
+    }
+
+    /**
+     * @brief Removes a song of the spill file from the index.
+     */
+    void CFrameCache::Unspill(SEntry &Entry)
+    {
+        auto IT = m_Spilled.find(Entry.Offset);
+        if(Entry.Size == 0 || IT == m_Spilled.end())
+            return;
+
+        m_Spilled.erase(IT);
+        m_DiskBytes -= Entry.Size;
+        Entry.Size = 0;
+    }
+
+    CFrameCache::~CFrameCache()
+    {
+#ifdef DISCORDBOT_UNIX
+        if(m_Map)
+            munmap(m_Map, m_MapSize);
+
+        if(m_File >= 0)
+            close(m_File);
+#endif
+    }
+
+    uint32_t CCachedAudioSource::OnReadOpus(uint8_t *Buf, uint32_t Size)
+    {
+        if(m_Index >= m_Frames->Sizes.size())
+            return 0;
+
+        uint16_t Len = m_Frames->Sizes[m_Index++];
+        const uint8_t *Packet = m_Frames->Data.data() + m_Offset;
+        m_Offset += Len;
+
+        if(Len > Size)
+            return 0;
+
+        memcpy(Buf, Packet, Len);
+        return Len;
+    }
+
+    CRecordingAudioSource::CRecordingAudioSource(std::weak_ptr<CFrameCache> Cache, const std::string &Key, AudioSource Source, uint64_t MaxBytes, EncoderProfile Profile) : m_Cache(Cache), m_Key(Key), m_Source(Source), m_MaxBytes(MaxBytes), m_Encoder(nullptr), m_Mono(false), m_SilentFrames(0), m_Frames(new SEncodedFrames()), m_Ended(false)
+    {
+        m_PCM.resize(CVoiceStream::FREQUENCY * CVoiceStream::CHANNEL * CVoiceStream::MILLISECONDS / 1000);
+
+        m_Encoder = CVoiceStream::CreateEncoder(Profile);
+    }
+
+    uint32_t CRecordingAudioSource::OnReadOpus(uint8_t *Buf, uint32_t Size)
+    {
+        if(m_Ended || !m_Encoder)
+        {
+            Commit();
+            return 0;
+        }
+
+        uint32_t Samples = m_PCM.size() / CVoiceStream::CHANNEL;
+        uint32_t Ret = m_Source->OnRead(m_PCM.data(), Samples);
+        if(Ret < Samples)
+        {
+            m_Ended = true;
+            if(Ret == 0)
+            {
+                Commit();
+                return 0;
+            }
+
+            memset(m_PCM.data() + Ret * CVoiceStream::CHANNEL, 0, (Samples - Ret) * CVoiceStream::CHANNEL * sizeof(uint16_t));
+        }
+
+        uint32_t Len = EncodeFrame(Buf, Size);
+        if(Len == 0)
+            m_Ended = true;
+
+        return Len;
+    }
+
+    uint32_t CRecordingAudioSource::OnRead(uint16_t *Buf, uint32_t Samples)
+    {
+        if(m_Ended)
+        {
+            Commit();
+            return 0;
+        }
+
+        uint32_t Ret = m_Source->OnRead(Buf, Samples);
+        if(Ret < Samples)
+            m_Ended = true;
+
+        //The stream gets the samples directly instead of decoding the recorded packets. Whole frames, e.g. the preroll of a gapless switch, can still be recorded.
+        uint32_t FrameSamples = m_PCM.size() / CVoiceStream::CHANNEL;
+        if(Samples != FrameSamples || !m_Encoder)
+            m_Frames = nullptr;
+        else if(m_Frames && Ret > 0)
+        {
+            memcpy(m_PCM.data(), Buf, Ret * CVoiceStream::CHANNEL * sizeof(uint16_t));
+            memset(m_PCM.data() + Ret * CVoiceStream::CHANNEL, 0, (Samples - Ret) * CVoiceStream::CHANNEL * sizeof(uint16_t));
+
+            if(m_Packet.empty())
+                m_Packet.resize(CVoiceStream::MAX_OPUS_SIZE);
+
+            EncodeFrame(m_Packet.data(), m_Packet.size());
+        }
+
+        if(m_Ended)
+            Commit();
+
+        return Ret;
+    }
+
+    /**
+     * @brief Encodes the frame in m_PCM and adds the packet to the recording.
+     */
+    uint32_t CRecordingAudioSource::EncodeFrame(uint8_t *Buf, uint32_t Size)
+    {
+        uint32_t Samples = m_PCM.size() / CVoiceStream::CHANNEL;
+
+        int32_t Len = CVoiceStream::EncodeFrame(m_Encoder, m_PCM.data(), Samples, Buf, Size, m_Mono, m_SilentFrames);
+
+        //A longer silence is recorded as the silence frame, which the voice stream doesn't send after the first few.
+        if(Len == 0)
+        {
+            memcpy(Buf, CVoiceStream::SILENCE_FRAME, sizeof(CVoiceStream::SILENCE_FRAME));
+            Len = sizeof(CVoiceStream::SILENCE_FRAME);
+        }
+
+        if(Len <= 0)
+        {
+            llog << lerror << "Error during encoding opus data." << lendl;
+            m_Frames = nullptr;
+            return 0;
+        }
+
+        //Songs which are larger than the whole cache aren't recorded.
+        if(m_Frames)
+        {
+            if(m_Frames->GetBytes() + Len + sizeof(uint16_t) > m_MaxBytes)
+                m_Frames = nullptr;
+            else
+            {
+                m_Frames->Data.insert(m_Frames->Data.end(), Buf, Buf + Len);
+                m_Frames->Sizes.push_back(Len);
+            }
+        }
+
+        return Len;
+    }
+
+    /**
+     * @brief Adds the recorded song to the cache.
+     */
+    void CRecordingAudioSource::Commit()
+    {
+        FrameCache Cache = m_Cache.lock();
+        if(Cache && m_Frames && !m_Frames->Sizes.empty())
+            Cache->Insert(m_Key, m_Frames);
+
+        m_Frames = nullptr;
+    }
+
+    CRecordingAudioSource::~CRecordingAudioSource()
+    {
+        if(m_Encoder)
+            opus_encoder_destroy(m_Encoder);
+    }
+} // namespace DiscordBot
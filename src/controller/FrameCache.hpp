@@ -0,0 +1,216 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FRAMECACHE_HPP
+#define FRAMECACHE_HPP
+
+#include <controller/IOpusAudioSource.hpp>
+#include <models/FrameCacheStats.hpp>
+#include <models/EncoderProfile.hpp>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+struct OpusEncoder;
+
+namespace DiscordBot
+{
+    /**
+     * @brief Encoded opus frames of one song.
+     */
+    struct SEncodedFrames
+    {
+        std::vector<uint8_t> Data;      //!< All packets one after another.
+        std::vector<uint16_t> Sizes;    //!< Size of each packet.
+
+        inline uint64_t GetBytes() const
+        {
+            return Data.size() + Sizes.size() * sizeof(uint16_t);
+        }
+    };
+
+    using EncodedFrames = std::shared_ptr<const SEncodedFrames>;
+
+    /**
+     * @brief Cache of encoded songs, which are played in many guilds. The songs are keyed by their path and the encoder settings.
+     * The least recently used songs are moved to a memory mapped spill file, if one is set, or dropped.
+     * 
+     * @note Sources of the cache are opus sources, so the voice stream sends their packets without encoding.
+     */
+    class CFrameCache : public std::enable_shared_from_this<CFrameCache>
+    {
+        public:
+            /**
+             * @param RAMBytes: Max size of the songs in memory.
+             * @param SpillFile: File for the songs which don't fit into memory. Empty to drop them. The file is recreated.
+             * @param SpillBytes: Size of the spill file. The oldest songs in the file are overwritten.
+             */
+            CFrameCache(uint64_t RAMBytes, const std::string &SpillFile, uint64_t SpillBytes);
+
+            /**
+             * @return Gets the cache key of a song, which was encoded with the given profile.
+             */
+            static std::string MakeKey(const std::string &Path, const EncoderProfile &Profile);
+
+            /**
+             * @return Gets a source which plays the cached song or null if the song isn't cached.
+             */
+            AudioSource Find(const std::string &Key);
+
+            /**
+             * @brief Wraps a source, which encodes the song for the voice stream. The song is cached after the source played to its end.
+             */
+            AudioSource Record(const std::string &Key, AudioSource Source, EncoderProfile Profile);
+
+            /**
+             * @brief Adds an encoded song. Called from the recording source.
+             */
+            void Insert(const std::string &Key, EncodedFrames Frames);
+
+            FrameCacheStats GetStats();
+
+            ~CFrameCache();
+
+        private:
+            struct SEntry
+            {
+                EncodedFrames Frames;           //!< Null if the song is in the spill file.
+                std::list<std::string>::iterator LRU;
+                uint64_t Offset;                //!< Position in the spill file.
+                uint64_t Size;                  //!< Size in the spill file.
+                uint32_t Count;                 //!< Count of packets.
+            };
+
+            std::mutex m_Lock;
+            uint64_t m_MaxRAM;
+            std::unordered_map<std::string, SEntry> m_Entries;
+            std::list<std::string> m_LRU;       //!< Songs in memory, most recently used first.
+            uint64_t m_RAMBytes;
+
+            //Spill file.
+            uint8_t *m_Map;
+            uint64_t m_MapSize;
+            int m_File;
+            uint64_t m_SpillPos;
+            std::map<uint64_t, std::string> m_Spilled;  //!< Songs in the spill file by their position.
+            uint64_t m_DiskBytes;
+
+            uint64_t m_Hits;
+            uint64_t m_Misses;
+            uint64_t m_Spills;
+            uint64_t m_Evictions;
+
+            /**
+             * @brief Moves the least recently used songs to the spill file or drops them, until the memory budget is kept.
+             */
+            void Evict();
+
+            /**
+             * @brief Writes a song into the spill file. Overwrites the oldest songs of the file.
+             * 
+             * @return Returns false if the song doesn't fit.
+             */
+            bool Spill(const std::string &Key, SEntry &Entry);
+
+            /**
+             * @brief Reads a song of the spill file back into memory.
+             */
+            EncodedFrames Load(const SEntry &Entry);
+
+            /**
+             * @brief Removes a song of the spill file from the index.
+             */
+            void Unspill(SEntry &Entry);
+    };
+
+    using FrameCache = std::shared_ptr<CFrameCache>;
+
+    /**
+     * @brief Plays a cached song.
+     */
+    class CCachedAudioSource : public IOpusAudioSource
+    {
+        public:
+            CCachedAudioSource(EncodedFrames Frames) : m_Frames(Frames), m_Index(0), m_Offset(0) {}
+
+            uint32_t OnReadOpus(uint8_t *Buf, uint32_t Size) override;
+
+        private:
+            EncodedFrames m_Frames;
+            size_t m_Index;
+            size_t m_Offset;
+    };
+
+    /**
+     * @brief Encodes a song for the voice stream and records the packets. The song is added to the cache after the source played to its end.
+     */
+    class CRecordingAudioSource : public IOpusAudioSource
+    {
+        public:
+            CRecordingAudioSource(std::weak_ptr<CFrameCache> Cache, const std::string &Key, AudioSource Source, uint64_t MaxBytes, EncoderProfile Profile);
+
+            uint32_t OnReadOpus(uint8_t *Buf, uint32_t Size) override;
+
+            /**
+             * @brief Passes the samples of the source through, e.g. if other sources are mixed over the song. Only reads of whole frames are still recorded.
+             */
+            uint32_t OnRead(uint16_t *Buf, uint32_t Samples) override;
+
+            ~CRecordingAudioSource();
+
+        private:
+            std::weak_ptr<CFrameCache> m_Cache;
+            std::string m_Key;
+            AudioSource m_Source;
+            uint64_t m_MaxBytes;
+
+            OpusEncoder *m_Encoder;
+            bool m_Mono;    //!< The encoder is forced to mono packets.
+            uint32_t m_SilentFrames;    //!< Silent frames in a row.
+            std::vector<uint16_t> m_PCM;
+            std::vector<uint8_t> m_Packet;              //!< Packets which are only recorded.
+            std::shared_ptr<SEncodedFrames> m_Frames;   //!< Null if the recording was abandoned.
+            bool m_Ended;
+
+            /**
+             * @brief Encodes the frame in m_PCM and adds the packet to the recording.
+             * 
+             * @return Returns the size of the packet or 0 on an error.
+             */
+            uint32_t EncodeFrame(uint8_t *Buf, uint32_t Size);
+
+            /**
+             * @brief Adds the recorded song to the cache.
+             */
+            void Commit();
+    };
+} // namespace DiscordBot
+
+
+#endif //FRAMECACHE_HPP
@@ -0,0 +1,125 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "GatewayLimiter.hpp"
+#include <Log.hpp>
+
+namespace DiscordBot
+{
+    const uint32_t CGatewayLimiter::LIMIT;
+    const uint32_t CGatewayLimiter::WINDOW;
+    const uint32_t CGatewayLimiter::RESERVED;
+
+    CGatewayLimiter::CGatewayLimiter(Send Call) : m_Timer(0), m_Send(Call) {}
+
+    void CGatewayLimiter::Push(const std::string &Payload, Lane L)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        Clock::time_point Now = Clock::now();
+        Expire(Now);
+
+        if(L == Lane::PRIORITY)
+        {
+            m_Sent.push_back(Now);
+            m_Send(Payload);
+            return;
+        }
+
+        if(L == Lane::NORMAL)
+            m_Normal.push_back(Payload);
+        else
+            m_Background.push_back(Payload);
+
+        SendQueued(Now);
+    }
+
+    void CGatewayLimiter::Reset()
+    {
+        CTimerService::TimerID Timer;
+
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            if(!m_Normal.empty() || !m_Background.empty())
+                llog << linfo << "Dropped " << m_Normal.size() + m_Background.size() << " queued gateway payloads" << lendl;
+
+            m_Sent.clear();
+            m_Normal.clear();
+            m_Background.clear();
+
+            Timer = m_Timer;
+            m_Timer = 0;
+        }
+
+        CTimerService::Get().Cancel(Timer);
+    }
+
+    void CGatewayLimiter::Drain()
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Timer = 0;
+
+        Clock::time_point Now = Clock::now();
+        Expire(Now);
+        SendQueued(Now);
+    }
+
+    void CGatewayLimiter::SendQueued(Clock::time_point Now)
+    {
+        while (m_Sent.size() < LIMIT - RESERVED && (!m_Normal.empty() || !m_Background.empty()))
+        {
+            auto &Queue = !m_Normal.empty() ? m_Normal : m_Background;
+
+            m_Sent.push_back(Now);
+            m_Send(Queue.front());
+            Queue.pop_front();
+        }
+
+        //Waits until the oldest send leaves the window.
+        if(m_Timer == 0 && (!m_Normal.empty() || !m_Background.empty()))
+        {
+            auto Wait = std::chrono::duration_cast<std::chrono::milliseconds>(m_Sent.front() + std::chrono::milliseconds(WINDOW) - Now).count();
+            m_Timer = CTimerService::Get().Schedule((uint32_t)std::max<int64_t>(Wait, 1), std::bind(&CGatewayLimiter::Drain, this));
+        }
+    }
+
+    void CGatewayLimiter::Expire(Clock::time_point Now)
+    {
+        while (!m_Sent.empty() && m_Sent.front() + std::chrono::milliseconds(WINDOW) <= Now)
+            m_Sent.pop_front();
+    }
+
+    CGatewayLimiter::~CGatewayLimiter()
+    {
+        CTimerService::TimerID Timer;
+
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            Timer = m_Timer;
+            m_Timer = 0;
+        }
+
+        if(Timer != 0)
+            CTimerService::Get().Cancel(Timer, true);
+    }
+} // namespace DiscordBot
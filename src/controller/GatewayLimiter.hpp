@@ -0,0 +1,103 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GATEWAYLIMITER_HPP
+#define GATEWAYLIMITER_HPP
+
+#include <mutex>
+#include <deque>
+#include <string>
+#include <chrono>
+#include <functional>
+#include <stdint.h>
+#include "TimerService.hpp"
+
+namespace DiscordBot
+{
+    /**
+     * @brief Send limit of one gateway connection. Discord closes connections which send more than 120 payloads within 60 seconds.
+     * Payloads above the limit are queued and sent from the timer service if the window has space again.
+     */
+    class CGatewayLimiter
+    {
+        public:
+            enum class Lane
+            {
+                PRIORITY,       //!< Heartbeats and session payloads, always sent immediately.
+                NORMAL,         //!< Payloads of the user, e.g. voice state updates.
+                BACKGROUND      //!< Payloads of the library, which are only sent if no normal payload waits.
+            };
+
+            using Send = std::function<void(const std::string &Payload)>;
+
+            /**
+             * @param Call: Writes a payload to the connection. Called while the limiter is locked.
+             */
+            CGatewayLimiter(Send Call);
+
+            /**
+             * @brief Sends a payload or queues it until the window has space.
+             */
+            void Push(const std::string &Payload, Lane L);
+
+            /**
+             * @brief Drops all queued payloads and starts a new window. Called if the connection closes.
+             */
+            void Reset();
+
+            ~CGatewayLimiter();
+
+        private:
+            using Clock = std::chrono::steady_clock;
+
+            static const uint32_t LIMIT = 120;          //!< Max payloads per window.
+            static const uint32_t WINDOW = 60000;       //!< Window in milliseconds.
+            static const uint32_t RESERVED = 5;         //!< Part of the limit which only the priority lane can use.
+
+            std::mutex m_Lock;
+            std::deque<Clock::time_point> m_Sent;       //!< Send times inside the current window.
+            std::deque<std::string> m_Normal;
+            std::deque<std::string> m_Background;
+            CTimerService::TimerID m_Timer;
+            Send m_Send;
+
+            /**
+             * @brief Sends the queued payloads which fit into the window. Called from the timer service.
+             */
+            void Drain();
+
+            /**
+             * @brief Sends as many queued payloads as allowed and schedules the next drain. m_Lock must be locked.
+             */
+            void SendQueued(Clock::time_point Now);
+
+            /**
+             * @brief Removes send times which are outside of the window.
+             */
+            void Expire(Clock::time_point Now);
+    };
+} // namespace DiscordBot
+
+
+#endif //GATEWAYLIMITER_HPP
@@ -0,0 +1,177 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "GatewayRecorder.hpp"
+#include <Log.hpp>
+#include <string.h>
+
+namespace DiscordBot
+{
+    const char RECORD_MAGIC[] = {'D', 'B', 'G', 'W'};
+    const uint32_t RECORD_VERSION = 1;
+    const uint32_t MAX_RECORD_SIZE = 256 * 1024 * 1024;     //!< Protects against corrupted files.
+
+    enum RecordFlags
+    {
+        RECORD_ETF = 1
+    };
+
+    //Serializes integers as little endian.
+    template<class T>
+    inline void AppendLE(std::string &Out, T Val)
+    {
+        for (size_t i = 0; i < sizeof(T); i++)
+            Out += (char)((Val >> (8 * i)) & 0xFF);
+    }
+
+    template<class T>
+    inline T ReadLE(const uint8_t *Data)
+    {
+        T Ret = 0;
+        for (size_t i = 0; i < sizeof(T); i++)
+            Ret |= (T)Data[i] << (8 * i);
+
+        return Ret;
+    }
+
+    //--------------------------Recorder--------------------------//
+
+    bool CGatewayRecorder::Open(const std::string &File, bool Compress)
+    {
+        Close();
+
+        std::lock_guard<std::mutex> lock(m_Lock);
+
+        //"T" writes without compression, but still through the gz interface.
+        m_File = gzopen(File.c_str(), Compress ? "wb6" : "wbT");
+        if(!m_File)
+        {
+            llog << lerror << "Failed to create the recording " << File << lendl;
+            return false;
+        }
+
+        std::string Header(RECORD_MAGIC, sizeof(RECORD_MAGIC));
+        AppendLE(Header, RECORD_VERSION);
+        gzwrite(m_File, Header.data(), (unsigned)Header.size());
+
+        m_Start = std::chrono::steady_clock::now();
+        m_Open = true;
+        llog << linfo << "Recording gateway to " << File << lendl;
+
+        return true;
+    }
+
+    void CGatewayRecorder::Write(uint32_t ShardID, uint32_t ShardCount, bool ETF, const std::string &Data)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        if(!m_File)
+            return;
+
+        uint64_t Timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_Start).count();
+
+        std::string Header;
+        AppendLE(Header, Timestamp);
+        AppendLE(Header, ShardID);
+        AppendLE(Header, ShardCount);
+        AppendLE(Header, (uint8_t)(ETF ? RECORD_ETF : 0));
+        AppendLE(Header, (uint32_t)Data.size());
+
+        gzwrite(m_File, Header.data(), (unsigned)Header.size());
+        gzwrite(m_File, Data.data(), (unsigned)Data.size());
+    }
+
+    void CGatewayRecorder::Close()
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Open = false;
+
+        if(m_File)
+        {
+            gzclose(m_File);
+            m_File = nullptr;
+        }
+    }
+
+    //--------------------------Reader--------------------------//
+
+    bool CGatewayReader::Open(const std::string &File)
+    {
+        if(m_File)
+            gzclose(m_File);
+
+        //Reads compressed and uncompressed files.
+        m_File = gzopen(File.c_str(), "rb");
+        if(!m_File)
+        {
+            llog << lerror << "Failed to open the recording " << File << lendl;
+            return false;
+        }
+
+        uint8_t Header[sizeof(RECORD_MAGIC) + sizeof(uint32_t)];
+        if(!ReadBytes(Header, sizeof(Header)) || memcmp(Header, RECORD_MAGIC, sizeof(RECORD_MAGIC)) != 0 || ReadLE<uint32_t>(Header + sizeof(RECORD_MAGIC)) != RECORD_VERSION)
+        {
+            llog << lerror << File << " is not a gateway recording" << lendl;
+            gzclose(m_File);
+            m_File = nullptr;
+
+            return false;
+        }
+
+        return true;
+    }
+
+    bool CGatewayReader::Read(SGatewayRecord &Record)
+    {
+        //Timestamp, shard id, shard count, flags and size.
+        uint8_t Header[8 + 4 + 4 + 1 + 4];
+        if(!m_File || !ReadBytes(Header, sizeof(Header)))
+            return false;
+
+        Record.Timestamp = ReadLE<uint64_t>(Header);
+        Record.ShardID = ReadLE<uint32_t>(Header + 8);
+        Record.ShardCount = ReadLE<uint32_t>(Header + 12);
+        Record.ETF = (Header[16] & RECORD_ETF) != 0;
+
+        uint32_t Size = ReadLE<uint32_t>(Header + 17);
+        if(Size > MAX_RECORD_SIZE)
+        {
+            llog << lerror << "Corrupted gateway record, size " << Size << lendl;
+            return false;
+        }
+
+        Record.Data.resize(Size);
+        return Size == 0 || ReadBytes(&Record.Data[0], Size);
+    }
+
+    bool CGatewayReader::ReadBytes(void *Buf, unsigned Size)
+    {
+        return gzread(m_File, Buf, Size) == (int)Size;
+    }
+
+    CGatewayReader::~CGatewayReader()
+    {
+        if(m_File)
+            gzclose(m_File);
+    }
+} // namespace DiscordBot
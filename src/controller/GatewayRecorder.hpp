@@ -0,0 +1,121 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef GATEWAYRECORDER_HPP
+#define GATEWAYRECORDER_HPP
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <zlib.h>
+
+namespace DiscordBot
+{
+    /**
+     * @brief A recorded gateway payload.
+     */
+    struct SGatewayRecord
+    {
+        uint64_t Timestamp;     //!< Nanoseconds since the recording started.
+        uint32_t ShardID;
+        uint32_t ShardCount;
+        bool ETF;               //!< True if the data is etf encoded.
+        std::string Data;       //!< Payload after the transport decompression.
+    };
+
+    /**
+     * @brief Writes received gateway payloads with monotonic timestamps to a file.
+     * 
+     * File layout (little endian):
+     *  Header: "DBGW" u32 version
+     *  Record: u64 timestamp, u32 shard id, u32 shard count, u8 flags, u32 size, data
+     */
+    class CGatewayRecorder
+    {
+        public:
+            CGatewayRecorder() : m_File(nullptr), m_Open(false) {}
+
+            /**
+             * @param File: Output file.
+             * @param Compress: True to write a gzip file.
+             * 
+             * @return Returns false if the file can't be created.
+             */
+            bool Open(const std::string &File, bool Compress);
+
+            /**
+             * @brief Appends a payload. Thread safe, all shards are writing to the same file.
+             */
+            void Write(uint32_t ShardID, uint32_t ShardCount, bool ETF, const std::string &Data);
+
+            void Close();
+
+            inline bool IsOpen() const
+            {
+                return m_Open;
+            }
+
+            ~CGatewayRecorder()
+            {
+                Close();
+            }
+
+        private:
+            std::mutex m_Lock;
+            gzFile m_File;
+            std::atomic<bool> m_Open;
+            std::chrono::steady_clock::time_point m_Start;
+    };
+
+    /**
+     * @brief Reads files of CGatewayRecorder. Compressed and uncompressed files are supported.
+     */
+    class CGatewayReader
+    {
+        public:
+            CGatewayReader() : m_File(nullptr) {}
+
+            /**
+             * @return Returns false if the file can't be opened or is not a recording.
+             */
+            bool Open(const std::string &File);
+
+            /**
+             * @return Returns false at the end of the file or if the record is truncated.
+             */
+            bool Read(SGatewayRecord &Record);
+
+            ~CGatewayReader();
+
+        private:
+            gzFile m_File;
+
+            bool ReadBytes(void *Buf, unsigned Size);
+    };
+} // namespace DiscordBot
+
+
+#endif //GATEWAYRECORDER_HPP
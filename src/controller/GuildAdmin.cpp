@@ -134,15 +134,11 @@ namespace DiscordBot
         if(res->statusCode != 200)
             throw CDiscordClientException("Unable to get ban list. Error: " + res->body + " HTTP Code: " + std::to_string(res->statusCode), DiscordClientErrorType::HTTP_ERROR);
 
-        CJSON js;
-        auto list = js.Deserialize<std::vector<std::string>>(res->body);
-
-        for (auto e : list)
+        CJSONView View(res->body);
+        for (auto &&e : View.Root())
         {
-            js.ParseObject(e);
-
-            User user = m_Client->GetUserOrAdd(js.GetValue<std::string>("user"));
-            ret.push_back({js.GetValue<std::string>("reason"), user});
+            User user = m_Client->GetUserOrAdd(e["user"]);
+            ret.push_back({e.GetValue<std::string>("reason"), user});
         }
 
         return ret;        
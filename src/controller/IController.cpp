@@ -117,14 +117,15 @@ namespace DiscordBot
         //TODO: I don't like this mess.
 
         if(!guild)
-            return m_CommandDescs[Cmd].Mode == AccessMode::EVERYBODY;
+            return GetAccessMode(Cmd) == AccessMode::EVERYBODY;
 
-        if (guild->Owner->UserRef->ID == member->UserRef->ID)
+        //The owner of a lazy loaded guild may not be received yet.
+        if (member->UserRef && guild->OwnerID.load() == member->UserRef->ID.load())
             return true;        
 
         std::vector<std::string> RoleIDs = CmdsConfig->GetRoles(guild->ID, Cmd);
         if(RoleIDs.empty())
-            return m_CommandDescs[Cmd].Mode == AccessMode::EVERYBODY;
+            return GetAccessMode(Cmd) == AccessMode::EVERYBODY;
         else
         {
             for (auto &&Id : RoleIDs)
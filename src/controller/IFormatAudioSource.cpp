@@ -0,0 +1,201 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <controller/IFormatAudioSource.hpp>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include "../helpers/AudioKernels.hpp"
+#include "../helpers/Resampler.hpp"
+
+namespace DiscordBot
+{
+    const uint32_t IFormatAudioSource::MAX_CHANNELS;
+
+    IFormatAudioSource::IFormatAudioSource(uint32_t Rate, uint32_t Channels, SampleFormat Format) : m_Rate(std::max(Rate, 1u)), m_Channels(std::min(std::max(Channels, 1u), MAX_CHANNELS)), m_Format(Format), m_Finished(false)
+    {
+        size_t SampleSize = m_Format == SampleFormat::S16 ? sizeof(int16_t) : sizeof(float);
+        m_In.resize(MAX_FRAMES * m_Channels * SampleSize);
+        m_Float.resize(MAX_FRAMES * m_Channels);
+        m_Stereo.resize(MAX_FRAMES * CHANNEL);
+
+        if(m_Rate != FREQUENCY)
+            m_Resampler.reset(new CResampler(m_Rate, FREQUENCY));
+
+        if(m_Channels > CHANNEL)
+        {
+            //Gains of ITU-R BS.775, -3 dB for the center and the surround channels. The LFE is dropped.
+            const float H = 0.70710678f;
+            static const float LEFT[MAX_CHANNELS - CHANNEL][MAX_CHANNELS] = 
+            {
+                {1, 0, H},                          //L R C
+                {1, 0, H, 0},                       //L R BL BR
+                {1, 0, H, H, 0},                    //L R C BL BR
+                {1, 0, H, 0, H, 0},                 //L R C LFE BL BR
+                {1, 0, H, 0, H * H, H, 0},          //L R C LFE BC SL SR
+                {1, 0, H, 0, H, 0, H, 0}            //L R C LFE BL BR SL SR
+            };
+
+            static const float RIGHT[MAX_CHANNELS - CHANNEL][MAX_CHANNELS] = 
+            {
+                {0, 1, H},
+                {0, 1, 0, H},
+                {0, 1, H, 0, H},
+                {0, 1, H, 0, 0, H},
+                {0, 1, H, 0, H * H, 0, H},
+                {0, 1, H, 0, 0, H, 0, H}
+            };
+
+            const float *Left = LEFT[m_Channels - CHANNEL - 1];
+            const float *Right = RIGHT[m_Channels - CHANNEL - 1];
+
+            //The gain keeps the sum of all channels in range.
+            float Sum = 0;
+            for (uint32_t c = 0; c < m_Channels; c++)
+                Sum += Left[c];
+
+            m_Downmix.resize(m_Channels * CHANNEL);
+            for (uint32_t c = 0; c < m_Channels; c++)
+            {
+                m_Downmix[c * CHANNEL] = Left[c] / Sum;
+                m_Downmix[c * CHANNEL + 1] = Right[c] / Sum;
+            }
+        }
+    }
+
+    /**
+     * @brief Converts the audio of OnReadFormat.
+     */
+    uint32_t IFormatAudioSource::OnRead(uint16_t *Buf, uint32_t Samples)
+    {
+        //The source has the format of the voice connection.
+        if(!m_Resampler && m_Channels == CHANNEL && m_Format == SampleFormat::S16)
+        {
+            if(m_Finished)
+                return 0;
+
+            uint32_t Got = 0;
+            while (Got < Samples)
+            {
+                uint32_t Ret = std::min(OnReadFormat(Buf + Got * CHANNEL, Samples - Got), Samples - Got);
+                if(Ret == 0)
+                {
+                    m_Finished = true;
+                    break;
+                }
+
+                Got += Ret;
+            }
+
+            return Got;
+        }
+
+        if(m_Out.size() < (size_t)Samples * CHANNEL)
+            m_Out.resize((size_t)Samples * CHANNEL);
+
+        uint32_t Got = 0;
+        while (Got < Samples)
+        {
+            if(!m_Resampler)
+            {
+                uint32_t Ret = m_Finished ? 0 : ReadStereo(std::min(Samples - Got, MAX_FRAMES));
+                if(Ret == 0)
+                    break;
+
+                memcpy(m_Out.data() + Got * CHANNEL, m_Stereo.data(), Ret * CHANNEL * sizeof(float));
+                Got += Ret;
+                continue;
+            }
+
+            Got += m_Resampler->Pull(m_Out.data() + Got * CHANNEL, Samples - Got);
+            if(Got == Samples || m_Finished)
+                break;
+
+            uint32_t Needed = std::min(std::max(m_Resampler->GetInputFrames(Samples - Got), 1u), MAX_FRAMES);
+            uint32_t Ret = ReadStereo(Needed);
+            if(Ret == 0)
+                m_Resampler->Flush();
+            else
+                m_Resampler->Push(m_Stereo.data(), Ret);
+        }
+
+        CAudioKernels::FloatToS16((int16_t*)Buf, m_Out.data(), Got * CHANNEL);
+        return Got;
+    }
+
+    /**
+     * @brief Reads and converts samples of the source to stereo float.
+     */
+    uint32_t IFormatAudioSource::ReadStereo(uint32_t Frames)
+    {
+        uint32_t Ret = std::min(OnReadFormat(m_In.data(), Frames), Frames);
+        if(Ret == 0)
+        {
+            m_Finished = true;
+            return 0;
+        }
+
+        size_t Count = (size_t)Ret * m_Channels;
+        const float *Samples = (const float*)m_In.data();
+        if(m_Format == SampleFormat::S16)
+        {
+            float *Dst = m_Channels == CHANNEL ? m_Stereo.data() : m_Float.data();
+            CAudioKernels::S16ToFloat(Dst, (const int16_t*)m_In.data(), Count);
+            Samples = Dst;
+        }
+
+        if(m_Channels == 1)
+            CAudioKernels::MonoToStereo(m_Stereo.data(), Samples, Ret);
+        else if(m_Channels == CHANNEL)
+        {
+            if(Samples != m_Stereo.data())
+                memcpy(m_Stereo.data(), Samples, Count * sizeof(float));
+        }
+        else
+        {
+            //Down mix by the matrix of the channel layout.
+            for (uint32_t i = 0; i < Ret; i++)
+            {
+                const float *Frame = Samples + (size_t)i * m_Channels;
+                float Left = 0, Right = 0;
+
+                for (uint32_t c = 0; c < m_Channels; c++)
+                {
+                    Left += Frame[c] * m_Downmix[c * CHANNEL];
+                    Right += Frame[c] * m_Downmix[c * CHANNEL + 1];
+                }
+
+                m_Stereo[i * 2] = Left;
+                m_Stereo[i * 2 + 1] = Right;
+            }
+        }
+
+        return Ret;
+    }
+
+    IFormatAudioSource::~IFormatAudioSource()
+    {
+
+    }
+} // namespace DiscordBot
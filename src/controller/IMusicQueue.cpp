@@ -25,6 +25,7 @@
 #include <controller/IMusicQueue.hpp>
 #include <algorithm>
 #include "../helpers/Helper.hpp"
+#include "FrameCache.hpp"
 
 namespace DiscordBot
 {
@@ -96,6 +97,9 @@ namespace DiscordBot
 
         m_QueueIndex = 0;
         m_QueueSize = 0;
+
+        m_PreparedSong = nullptr;
+        m_Prepared = nullptr;
     }
 
     /**
@@ -107,6 +111,7 @@ namespace DiscordBot
             return nullptr;
 
         SongInfo Info;
+        AudioSource Ret;
 
         {
             std::lock_guard<std::mutex> lock(m_QueueLock);
@@ -115,15 +120,54 @@ namespace DiscordBot
                 OnFinishPlaying(GetSongInternal(Prev));
 
             Info = GetSongInternal(m_QueueIndex++);
+
+            //The song was prepared by PrepareNext().
+            if(Info && Info == m_PreparedSong)
+                Ret = m_Prepared;
+
+            m_PreparedSong = nullptr;
+            m_Prepared = nullptr;
         }
 
-        AudioSource Ret = OnNext(Info);
+        if(Ret)
+            return Ret;
+
+        Ret = Open(Info);
         if(!Ret)
             Wait(Info);
         
         return Ret;
     }
 
+    /**
+     * @brief Prepares the audio source of the next song, while the current one is still playing.
+     */
+    AudioSource IMusicQueue::PrepareNext()
+    {
+        if(m_NeedWait)
+            return nullptr;
+
+        SongInfo Info;
+
+        {
+            std::lock_guard<std::mutex> lock(m_QueueLock);
+            Info = GetSongInternal(m_QueueIndex);
+            if(!Info || Info == m_PreparedSong)
+                return nullptr;
+        }
+
+        //OnNext may be slow, e.g. if it opens a stream.
+        AudioSource Ret = Open(Info);
+
+        std::lock_guard<std::mutex> lock(m_QueueLock);
+        if(!Ret || GetSongInternal(m_QueueIndex) != Info)
+            return nullptr;
+
+        m_PreparedSong = Info;
+        m_Prepared = Ret;
+        return Ret;
+    }
+
     /**
      * @return Returns true if there is a next song.
      */
@@ -164,7 +208,7 @@ namespace DiscordBot
     void IMusicQueue::WaitFinished()
     {
         if(m_NeedWait && m_WaitFinishCallback)
-            m_WaitFinishCallback(m_GuildID, OnNext(m_WaitSong));
+            m_WaitFinishCallback(m_GuildID, Open(m_WaitSong));
 
         m_NeedWait = false;
         m_WaitSong = nullptr;
@@ -182,6 +226,34 @@ namespace DiscordBot
         m_WaitSong = nullptr;
     }
 
+    /**
+     * @brief Gets the audio source of a song from the frame cache or from OnNext.
+     */
+    AudioSource IMusicQueue::Open(SongInfo Info)
+    {
+        std::shared_ptr<CFrameCache> Cache = m_FrameCache;
+        if(!Cache || !Info || Info->Path.empty())
+            return OnNext(Info);
+
+        EncoderProfile Profile;
+        {
+            std::lock_guard<std::mutex> lock(m_ProfileLock);
+            Profile = m_EncoderProfile;
+        }
+
+        std::string Key = CFrameCache::MakeKey(Info->Path, Profile);
+        AudioSource Ret = Cache->Find(Key);
+        if(Ret)
+            return Ret;
+
+        //The song is encoded while it's played and cached afterwards.
+        Ret = OnNext(Info);
+        if(Ret)
+            Ret = Cache->Record(Key, Ret, Profile);
+
+        return Ret;
+    }
+
     /**
      * @brief Needs to call if a song is not ready to play. For example if you download a song on the fly. Should called in Next.
      */
@@ -0,0 +1,146 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <controller/IOpusAudioSource.hpp>
+#include <Log.hpp>
+#include <opus.h>
+#include <string.h>
+#include <algorithm>
+
+namespace DiscordBot
+{
+    const uint32_t IOpusAudioSource::MAX_PACKET_SIZE;
+
+    IOpusAudioSource::IOpusAudioSource() : m_Decoder(nullptr), m_Finished(false), m_PCMPos(0), m_PCMSize(0)
+    {
+        m_Packet.resize(MAX_PACKET_SIZE);
+        m_PCM.resize(MAX_FRAME_SAMPLES * CHANNEL);
+    }
+
+    /**
+     * @brief Decodes the packets to pcm. Used if the packets can't be sent as they are.
+     */
+    uint32_t IOpusAudioSource::OnRead(uint16_t *Buf, uint32_t Samples)
+    {
+        uint32_t Got = 0;
+
+        while (Got < Samples)
+        {
+            if(m_PCMPos == m_PCMSize)
+            {
+                if(m_Finished)
+                    break;
+
+                uint32_t Size = OnReadOpus(m_Packet.data(), m_Packet.size());
+                if(Size == 0)
+                {
+                    m_Finished = true;
+                    break;
+                }
+
+                Decode(m_Packet.data(), Size);
+                continue;
+            }
+
+            uint32_t Count = std::min(Samples - Got, m_PCMSize - m_PCMPos);
+            memcpy(Buf + Got * CHANNEL, m_PCM.data() + m_PCMPos * CHANNEL, Count * CHANNEL * sizeof(uint16_t));
+
+            m_PCMPos += Count;
+            Got += Count;
+        }
+
+        return Got;
+    }
+
+    /**
+     * @brief Called from the voice engine. Reads the next packet, which is sent as it is if it has a duration of 20 ms.
+     */
+    int32_t IOpusAudioSource::ReadPacket(uint8_t *Buf, uint32_t Size, uint16_t *PCM)
+    {
+        if(m_Finished)
+            return 0;
+
+        //Decoded samples are left from the last packet.
+        if(m_PCMPos < m_PCMSize || Size < MAX_PACKET_SIZE)
+            return -1;
+
+        uint32_t Len = OnReadOpus(Buf, Size);
+        if(Len == 0)
+        {
+            m_Finished = true;
+            return 0;
+        }
+
+        if(opus_packet_get_nb_samples(Buf, Len, FREQUENCY) != FRAME_SAMPLES)
+        {
+            Decode(Buf, Len);
+            return -1;
+        }
+
+        if(PCM)
+        {
+            Decode(Buf, Len);
+            memcpy(PCM, m_PCM.data(), FRAME_SAMPLES * CHANNEL * sizeof(uint16_t));
+            m_PCMPos = m_PCMSize;
+        }
+
+        return Len;
+    }
+
+    /**
+     * @brief Decodes a packet into the pcm buffer.
+     */
+    void IOpusAudioSource::Decode(const uint8_t *Packet, uint32_t Size)
+    {
+        m_PCMPos = 0;
+        m_PCMSize = 0;
+
+        if(!m_Decoder)
+        {
+            int err;
+            m_Decoder = opus_decoder_create(FREQUENCY, CHANNEL, &err);
+            if(err)
+            {
+                llog << lerror << "Error to create opus decoder" << lendl;
+                m_Decoder = nullptr;
+                return;
+            }
+        }
+
+        int Ret = opus_decode(m_Decoder, Packet, Size, (opus_int16*)m_PCM.data(), MAX_FRAME_SAMPLES, 0);
+        if(Ret < 0)
+        {
+            llog << lerror << "Skipped invalid opus packet" << lendl;
+            return;
+        }
+
+        m_PCMSize = Ret;
+    }
+
+    IOpusAudioSource::~IOpusAudioSource()
+    {
+        if(m_Decoder)
+            opus_decoder_destroy(m_Decoder);
+    }
+} // namespace DiscordBot
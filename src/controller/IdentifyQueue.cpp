@@ -0,0 +1,179 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "IdentifyQueue.hpp"
+#include <Log.hpp>
+#include <algorithm>
+
+namespace DiscordBot
+{
+    const int CIdentifyQueue::IDENTIFY_DELAY;
+    const int CIdentifyQueue::RESET_INTERVAL;
+    const uint32_t CIdentifyQueue::LOW_PERCENT;
+
+    CIdentifyQueue::CIdentifyQueue() : m_Terminate(false), m_Total(1000), m_Remaining(1000), m_ResetTime(Clock::now()), m_LowNext(Clock::now()), m_Buckets(1, Clock::now())
+    {
+        m_Thread = std::thread(&CIdentifyQueue::Executor, this);
+    }
+
+    void CIdentifyQueue::SetLimits(uint32_t Total, uint32_t Remaining, uint32_t ResetAfter, uint32_t MaxConcurrency)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Total = Total;
+        m_Remaining = Remaining;
+        m_ResetTime = Clock::now() + std::chrono::milliseconds(ResetAfter);
+
+        //A refresh keeps the identify times of the buckets.
+        if(m_Buckets.size() != std::max<uint32_t>(MaxConcurrency, 1))
+            m_Buckets.assign(std::max<uint32_t>(MaxConcurrency, 1), Clock::now());
+
+        llog << linfo << "Session start limit: " << Remaining << "/" << Total << " Reset after: " << ResetAfter << " ms Max concurrency: " << m_Buckets.size() << lendl;
+        m_Signal.notify_all();
+    }
+
+    void CIdentifyQueue::SetOnRefresh(OnRefresh Call)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Refresh = Call;
+    }
+
+    void CIdentifyQueue::Enqueue(uint32_t ShardID, OnIdentify Call)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+
+        auto IT = std::find_if(m_Requests.begin(), m_Requests.end(), [ShardID](const SRequest &e) { return e.ShardID == ShardID; });
+        if(IT != m_Requests.end())
+            IT->Call = Call;
+        else
+            m_Requests.push_back({ShardID, Call});
+
+        m_Signal.notify_all();
+    }
+
+    void CIdentifyQueue::Clear()
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Requests.clear();
+    }
+
+    void CIdentifyQueue::Executor()
+    {
+        std::unique_lock<std::mutex> lock(m_Lock);
+        while (!m_Terminate)
+        {
+            if(m_Requests.empty())
+            {
+                m_Signal.wait(lock);
+                continue;
+            }
+
+            auto Now = Clock::now();
+
+            //The session start limit is reached, wait until discord resets it.
+            if(m_Remaining == 0)
+            {
+                if(Now < m_ResetTime)
+                {
+                    llog << linfo << "Session start limit reached. Waiting " << std::chrono::duration_cast<std::chrono::milliseconds>(m_ResetTime - Now).count() << " ms" << lendl;
+                    m_Signal.wait_until(lock, m_ResetTime);
+                    continue;
+                }
+
+                //The limit is refilled for one day. The refresh replaces the guess with the real limits.
+                m_Remaining = m_Total;
+                m_ResetTime = Now + std::chrono::hours(RESET_INTERVAL);
+
+                if(m_Refresh)
+                {
+                    OnRefresh Refresh = m_Refresh;
+                    lock.unlock();
+                    Refresh();
+                    lock.lock();
+                }
+
+                continue;
+            }
+
+            //Starts the first waiting shard of each free bucket.
+            std::vector<OnIdentify> Calls;
+            Clock::time_point Next = Clock::time_point::max();
+            auto IT = m_Requests.begin();
+            while (IT != m_Requests.end() && m_Remaining > 0)
+            {
+                //Few session starts are left, so they are spread until the reset instead of being used up at once.
+                bool Low = (uint64_t)m_Remaining * 100 <= (uint64_t)m_Total * LOW_PERCENT;
+                if(Low && m_LowNext > Now)
+                {
+                    Next = std::min(Next, m_LowNext);
+                    break;
+                }
+
+                auto &Bucket = m_Buckets[IT->ShardID % m_Buckets.size()];
+                if(Bucket <= Now)
+                {
+                    Bucket = Now + std::chrono::milliseconds(IDENTIFY_DELAY);
+                    m_Remaining--;
+
+                    if(Low)
+                    {
+                        m_LowNext = Now + (m_ResetTime > Now ? (m_ResetTime - Now) / std::max<uint32_t>(m_Remaining, 1) : Clock::duration::zero());
+                        llog << linfo << "Only " << m_Remaining << " of " << m_Total << " session starts left. Next identify in " << std::chrono::duration_cast<std::chrono::milliseconds>(m_LowNext - Now).count() << " ms" << lendl;
+                    }
+
+                    Calls.push_back(IT->Call);
+                    IT = m_Requests.erase(IT);
+                }
+                else
+                {
+                    Next = std::min(Next, Bucket);
+                    IT++;
+                }
+            }
+
+            if(m_Remaining < m_Requests.size())
+                llog << linfo << "Only " << m_Remaining << " session starts left for " << m_Requests.size() << " waiting shards" << lendl;
+
+            //Identifies outside of the lock, so that shards can queue again.
+            lock.unlock();
+            for (auto &&e : Calls)
+                e();
+            lock.lock();
+
+            if(Calls.empty() && Next != Clock::time_point::max() && !m_Terminate)
+                m_Signal.wait_until(lock, Next);
+        }
+    }
+
+    CIdentifyQueue::~CIdentifyQueue()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            m_Terminate = true;
+            m_Signal.notify_all();
+        }
+
+        if(m_Thread.joinable())
+            m_Thread.join();
+    }
+} // namespace DiscordBot
@@ -0,0 +1,114 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef IDENTIFYQUEUE_HPP
+#define IDENTIFYQUEUE_HPP
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <vector>
+#include <list>
+#include <stdint.h>
+
+namespace DiscordBot
+{
+    /**
+     * @brief Schedules the IDENTIFY calls of all shards. Discord allows max_concurrency identifies every 5 seconds,
+     * where each shard belongs to the bucket shard_id % max_concurrency. @see https://discord.com/developers/docs/topics/gateway#session-start-limit-object
+     */
+    class CIdentifyQueue
+    {
+        public:
+            using OnIdentify = std::function<void()>;
+            using OnRefresh = std::function<void()>;
+
+            CIdentifyQueue();
+
+            /**
+             * @brief Sets the limits which are returned from /gateway/bot.
+             * 
+             * @param Total: Total number of session starts the bot is allowed.
+             * @param Remaining: Remaining number of session starts.
+             * @param ResetAfter: Milliseconds after which the limit resets.
+             * @param MaxConcurrency: Number of identify requests allowed per 5 seconds.
+             */
+            void SetLimits(uint32_t Total, uint32_t Remaining, uint32_t ResetAfter, uint32_t MaxConcurrency);
+
+            /**
+             * @brief Sets the callback which is called from the queue thread after the session start limit was reset.
+             * The callback should request /gateway/bot again and pass the new limits to SetLimits.
+             */
+            void SetOnRefresh(OnRefresh Call);
+
+            /**
+             * @brief Queues an identify for a shard. A pending identify of the same shard is replaced.
+             * 
+             * @param ShardID: Shard which wants to identify.
+             * @param Call: Called if the shard is allowed to identify.
+             */
+            void Enqueue(uint32_t ShardID, OnIdentify Call);
+
+            /**
+             * @brief Removes all pending identifies.
+             */
+            void Clear();
+
+            ~CIdentifyQueue();
+
+        private:
+            using Clock = std::chrono::steady_clock;
+
+            static const int IDENTIFY_DELAY = 5000;     //!< Time between two identifies of the same bucket.
+            static const int RESET_INTERVAL = 24;       //!< Hours after which discord resets the session start limit.
+            static const uint32_t LOW_PERCENT = 10;     //!< Below this part of the total, the remaining identifies are spread until the reset.
+
+            struct SRequest
+            {
+                uint32_t ShardID;
+                OnIdentify Call;
+            };
+
+            void Executor();
+
+            std::mutex m_Lock;
+            std::condition_variable m_Signal;
+            bool m_Terminate;
+
+            uint32_t m_Total;
+            uint32_t m_Remaining;
+            Clock::time_point m_ResetTime;
+            Clock::time_point m_LowNext;                //!< Next allowed identify if only few session starts are left.
+            OnRefresh m_Refresh;
+            std::vector<Clock::time_point> m_Buckets;   //!< Next allowed identify per bucket.
+
+            std::list<SRequest> m_Requests;
+            std::thread m_Thread;
+    };
+} // namespace DiscordBot
+
+
+#endif //IDENTIFYQUEUE_HPP
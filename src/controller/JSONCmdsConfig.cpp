@@ -52,6 +52,8 @@ namespace DiscordBot
 
     void CJSONCmdsConfig::AddRoles(const std::string &Guild, const std::string &Command, const std::vector<std::string> &Roles)
     {
+        std::lock_guard<std::mutex> lock(m_Lock);
+
         // m_Database[Guild][Command].insert(m_Database[Guild][Command].end(), Roles.begin(), Roles.end());
 
         std::vector<std::string> &DBRoles = m_CmdDatabase[Guild][Command];
@@ -67,6 +69,8 @@ namespace DiscordBot
 
     std::vector<std::string> CJSONCmdsConfig::GetRoles(const std::string &Guild, const std::string &Command)
     {
+        std::lock_guard<std::mutex> lock(m_Lock);
+
         auto GIT = m_CmdDatabase.find(Guild);
         if (GIT != m_CmdDatabase.end())
         {
@@ -80,6 +84,8 @@ namespace DiscordBot
 
     void CJSONCmdsConfig::DeleteCommand(const std::string &Guild, const std::string &Command)
     {
+        std::lock_guard<std::mutex> lock(m_Lock);
+
         auto GIT = m_CmdDatabase.find(Guild);
         if (GIT != m_CmdDatabase.end())
         {
@@ -93,6 +99,8 @@ namespace DiscordBot
 
     void CJSONCmdsConfig::RemoveRoles(const std::string &Guild, const std::string &Command, const std::vector<std::string> &Roles)
     {
+        std::lock_guard<std::mutex> lock(m_Lock);
+
         auto GIT = m_CmdDatabase.find(Guild);
         if (GIT != m_CmdDatabase.end())
         {
@@ -108,28 +116,35 @@ namespace DiscordBot
 
                 DBRoles.erase(IT, DBRoles.end());
 
+                //Same as DeleteCommand, which can't be called with the lock.
                 if(DBRoles.empty())
-                    DeleteCommand(Guild, Command);
-                else
-                    SaveCmdDB();
+                    GIT->second.erase(CIT);
+
+                SaveCmdDB();
             }
         }
     }
 
     void CJSONCmdsConfig::ChangePrefix(const std::string &Guild, const std::string &Prefix)
     {
+        std::lock_guard<std::mutex> lock(m_Lock);
+
         m_PrefixDatabase[Guild] = Prefix;
         SavePrefixDB();
     }
 
     void CJSONCmdsConfig::RemovePrefix(const std::string &Guild)
     {
+        std::lock_guard<std::mutex> lock(m_Lock);
+
         m_PrefixDatabase.erase(Guild);
         SavePrefixDB();
     }
 
     std::string CJSONCmdsConfig::GetPrefix(const std::string &Guild, const std::string &Default)
     {
+        std::lock_guard<std::mutex> lock(m_Lock);
+
         std::string Ret = Default;
 
         auto IT = m_PrefixDatabase.find(Guild);
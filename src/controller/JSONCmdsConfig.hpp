@@ -27,9 +27,13 @@
 
 #include <controller/ICommandsConfig.hpp>
 #include <JSON.hpp>
+#include <mutex>
 
 namespace DiscordBot
 {
+    /**
+     * @brief Saves the configs in json files. Thread safe, the commands of different guilds are called in parallel.
+     */
     class CJSONCmdsConfig : public ICommandsConfig
     {
         public:
@@ -49,6 +53,8 @@ namespace DiscordBot
             void SaveCmdDB();
             void SavePrefixDB();
 
+            std::mutex m_Lock;  //!< Guards both databases and their files.
+
             using CmdDatabase = std::map<std::string, std::map<std::string, std::vector<std::string>>>;
             CmdDatabase m_CmdDatabase;
 
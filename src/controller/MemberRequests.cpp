@@ -0,0 +1,127 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "MemberRequests.hpp"
+#include <Log.hpp>
+
+namespace DiscordBot
+{
+    std::future<CMemberRequests::Members> CMemberRequests::Add(size_t Batches, std::vector<std::string> &Nonces, uint32_t TimeoutMS)
+    {
+        auto Request = std::make_shared<SRequest>();
+        Request->Pending = Batches;
+        Request->Timeout = 0;
+        std::future<Members> Ret = Request->Promise.get_future();
+
+        if(Batches == 0)
+        {
+            Request->Promise.set_value(Members());
+            return Ret;
+        }
+
+        std::lock_guard<std::mutex> lock(m_Lock);
+        for (size_t i = 0; i < Batches; i++)
+        {
+            //Discord allows nonces up to 32 bytes.
+            std::string Nonce = "m" + std::to_string(m_NextNonce++);
+
+            m_Batches[Nonce] = {Request, 0};
+            Nonces.push_back(Nonce);
+        }
+
+        Request->Nonces = Nonces;
+        Request->Timeout = CTimerService::Get().Schedule(TimeoutMS, std::bind(&CMemberRequests::Expire, this, std::weak_ptr<SRequest>(Request)));
+
+        return Ret;
+    }
+
+    void CMemberRequests::OnChunk(const std::string &Nonce, uint32_t Count, const Members &Chunk)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        auto IT = m_Batches.find(Nonce);
+        if(IT == m_Batches.end())
+            return;
+
+        std::shared_ptr<SRequest> Request = IT->second.Request;
+        Request->Received.insert(Request->Received.end(), Chunk.begin(), Chunk.end());
+
+        //A batch is complete if all chunks are received.
+        IT->second.Chunks++;
+        if(IT->second.Chunks < Count)
+            return;
+
+        m_Batches.erase(IT);
+        if(--Request->Pending == 0)
+        {
+            CTimerService::Get().Cancel(Request->Timeout);
+            Request->Promise.set_value(std::move(Request->Received));
+        }
+    }
+
+    void CMemberRequests::Clear()
+    {
+        std::vector<CTimerService::TimerID> Timeouts;
+
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            for (auto &&e : m_Batches)
+            {
+                //Every request must only be completed once.
+                if(e.second.Request->Pending != 0)
+                {
+                    e.second.Request->Pending = 0;
+                    e.second.Request->Promise.set_value(std::move(e.second.Request->Received));
+                    Timeouts.push_back(e.second.Request->Timeout);
+                }
+            }
+
+            m_Batches.clear();
+        }
+
+        //Waits for running timeouts, so they can't access a destroyed object.
+        for (auto &&e : Timeouts)
+            CTimerService::Get().Cancel(e, true);
+    }
+
+    void CMemberRequests::Expire(std::weak_ptr<SRequest> Request)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        auto Expired = Request.lock();
+        if(!Expired || Expired->Pending == 0)
+            return;
+
+        for (auto &&e : Expired->Nonces)
+            m_Batches.erase(e);
+
+        llog << linfo << "Member request timed out after " << Expired->Received.size() << " member(s)" << lendl;
+
+        Expired->Pending = 0;
+        Expired->Promise.set_value(std::move(Expired->Received));
+    }
+
+    CMemberRequests::~CMemberRequests()
+    {
+        Clear();
+    }
+} // namespace DiscordBot
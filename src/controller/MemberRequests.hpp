@@ -0,0 +1,106 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MEMBERREQUESTS_HPP
+#define MEMBERREQUESTS_HPP
+
+#include <map>
+#include <mutex>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <models/GuildMember.hpp>
+#include "TimerService.hpp"
+
+namespace DiscordBot
+{
+    /**
+     * @brief Assembles the GUILD_MEMBERS_CHUNK events of pending REQUEST_GUILD_MEMBERS calls.
+     * A request can consist of multiple gateway requests (batches), each identified by its own nonce.
+     */
+    class CMemberRequests
+    {
+        public:
+            using Members = std::vector<GuildMember>;
+
+            CMemberRequests() : m_NextNonce(0) {}
+
+            /**
+             * @brief Creates a new request.
+             * 
+             * @param Batches: Number of gateway requests.
+             * @param Nonces: Receives one nonce per gateway request.
+             * @param TimeoutMS: Milliseconds after which the request is completed with the members received so far.
+             * 
+             * @return Returns a future, which is ready if all chunks of all batches are received or the timeout is reached.
+             */
+            std::future<Members> Add(size_t Batches, std::vector<std::string> &Nonces, uint32_t TimeoutMS);
+
+            /**
+             * @brief Adds a received chunk to its request.
+             * 
+             * @param Nonce: Nonce of the chunk.
+             * @param Count: chunk_count of the chunk.
+             * @param Chunk: Members of the chunk.
+             */
+            void OnChunk(const std::string &Nonce, uint32_t Count, const Members &Chunk);
+
+            /**
+             * @brief Completes all pending requests with the members received so far.
+             */
+            void Clear();
+
+            ~CMemberRequests();
+
+        private:
+            struct SRequest
+            {
+                std::promise<Members> Promise;
+                Members Received;
+                size_t Pending;             //!< Number of incomplete batches.
+                std::vector<std::string> Nonces;
+                CTimerService::TimerID Timeout;
+            };
+
+            struct SBatch
+            {
+                std::shared_ptr<SRequest> Request;
+                uint32_t Chunks;            //!< Number of received chunks.
+            };
+
+            std::mutex m_Lock;
+            std::map<std::string, SBatch> m_Batches;
+            uint64_t m_NextNonce;
+
+            /**
+             * @brief Completes a request, whose chunks didn't arrive in time. Called from the timer service.
+             */
+            void Expire(std::weak_ptr<SRequest> Request);
+    };
+} // namespace DiscordBot
+
+
+#endif //MEMBERREQUESTS_HPP
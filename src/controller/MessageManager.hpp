@@ -26,8 +26,11 @@
 #define MESSAGEMANAGER_HPP
 
 #include <queue>
+#include <vector>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <map>
 #include <functional>
 #include <atomic>
@@ -68,7 +71,7 @@ namespace DiscordBot
         public:
             using OnMessageReceive = std::function<void(const MessageBase Msg)>;
 
-            CMessageManager(/* args */) : m_Terminated(false), m_Thread(&CMessageManager::Executor, this) {}
+            CMessageManager(/* args */) : m_Terminated(false), m_NextSeq(0), m_Thread(&CMessageManager::Executor, this) {}
 
             /**
              * @brief Subscribes a message type.
@@ -92,11 +95,16 @@ namespace DiscordBot
                 SendMessage(Msg);
             }
 
+            /**
+             * @brief Queues a message, which is delivered from the message thread after the timeout.
+             * Messages with the same due time are delivered in the order they are posted.
+             * 
+             * @param Timeout: Delay in milliseconds.
+             */
             template<class T>
             void PostMessage(size_t Event, T Value, int Timeout = 0)
             {
                 using Message = std::shared_ptr<TMessage<T>>;
-                std::lock_guard<std::mutex> lock(m_QueueLock);
 
                 Message Msg = Message(new TMessage<T>());
                 Msg->Value = Value;
@@ -104,36 +112,75 @@ namespace DiscordBot
                 Msg->Timeout = Timeout;
                 Msg->CreateddMs = GetTimeMillis();
 
-                m_Queue.push(std::static_pointer_cast<IMessageBase>(Msg));
+                {
+                    std::lock_guard<std::mutex> lock(m_QueueLock);
+                    m_Queue.push({Clock::now() + std::chrono::milliseconds(Timeout), m_NextSeq++, std::static_pointer_cast<IMessageBase>(Msg)});
+                }
+
+                m_Wakeup.notify_one();
             }
 
             ~CMessageManager() 
             {
-                m_Terminated = true;
+                {
+                    std::lock_guard<std::mutex> lock(m_QueueLock);
+                    m_Terminated = true;
+                }
+
+                m_Wakeup.notify_one();
                 if(m_Thread.joinable())
                     m_Thread.join();
             }
 
         private:
+            using Clock = std::chrono::steady_clock;
+
+            struct SQueuedMessage
+            {
+                Clock::time_point Due;
+                uint64_t Seq;           //!< Keeps the post order of messages with the same due time.
+                MessageBase Msg;
+
+                bool operator>(const SQueuedMessage &Other) const
+                {
+                    return Due != Other.Due ? Due > Other.Due : Seq > Other.Seq;
+                }
+            };
+
             void Executor()
             {
+                std::vector<MessageBase> Batch;
+                std::unique_lock<std::mutex> lock(m_QueueLock);
+
                 while (!m_Terminated)
                 {
+                    if(m_Queue.empty())
+                    {
+                        m_Wakeup.wait(lock);
+                        continue;
+                    }
+
+                    //Sleeps until the next message is due or an earlier one is posted.
+                    Clock::time_point Now = Clock::now();
+                    if(m_Queue.top().Due > Now)
                     {
-                        std::lock_guard<std::mutex> lock(m_QueueLock);
-                        if(!m_Queue.empty() && m_Queue.size() > 0)
-                        {
-                            MessageBase Data = m_Queue.front();
-                            m_Queue.pop();
-
-                            if(GetTimeMillis() - Data->CreateddMs > Data->Timeout)
-                                SendMessage(Data);
-                            else
-                                m_Queue.push(Data);
-                        }
+                        m_Wakeup.wait_until(lock, m_Queue.top().Due);
+                        continue;
                     }
 
-                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                    while (!m_Queue.empty() && m_Queue.top().Due <= Now)
+                    {
+                        Batch.push_back(m_Queue.top().Msg);
+                        m_Queue.pop();
+                    }
+
+                    //Callbacks are allowed to post new messages.
+                    lock.unlock();
+                    for (auto &&e : Batch)
+                        SendMessage(e);
+
+                    Batch.clear();
+                    lock.lock();
                 }
             }
 
@@ -153,11 +200,13 @@ namespace DiscordBot
             }
 
             std::atomic<bool> m_Terminated;
-            std::queue<MessageBase> m_Queue;
+            std::priority_queue<SQueuedMessage, std::vector<SQueuedMessage>, std::greater<SQueuedMessage>> m_Queue;
+            uint64_t m_NextSeq;
             std::mutex m_QueueLock;
+            std::condition_variable m_Wakeup;
             std::mutex m_CallbackLock;
-            std::thread m_Thread;
             std::multimap<size_t, OnMessageReceive> m_Callbacks;
+            std::thread m_Thread;
     };
 } // namespace DiscordBot
 
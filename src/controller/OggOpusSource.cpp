@@ -0,0 +1,293 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <controller/OggOpusSource.hpp>
+#include <Log.hpp>
+#include <fstream>
+#include <string.h>
+#include <algorithm>
+
+namespace DiscordBot
+{
+    const uint8_t COggOpusSource::FLAG_CONTINUED;
+    const uint8_t COggOpusSource::FLAG_BOS;
+    const uint8_t COggOpusSource::FLAG_EOS;
+    const size_t COggOpusSource::HEADER_SIZE;
+    const size_t COggOpusSource::CRC_OFFSET;
+
+    COggOpusSource::COggOpusSource(const std::string &File) : COggOpusSource(std::make_shared<std::ifstream>(File, std::ios::binary))
+    {
+        if(!IsOpen())
+            llog << lerror << "Failed to open " << File << lendl;
+    }
+
+    COggOpusSource::COggOpusSource(std::shared_ptr<std::istream> Stream) : m_Stream(Stream), m_HasSerial(false), m_Serial(0), m_RescanPos(0), m_Headers(false), m_PageFlags(0), m_NextPageNo(0), m_PageLost(false), m_Segment(0), m_BodyPos(0)
+    {
+        m_Packet.reserve(MAX_PACKET_SIZE);
+    }
+
+    uint32_t COggOpusSource::OnReadOpus(uint8_t *Buf, uint32_t Size)
+    {
+        while (ReadPacket())
+        {
+            if(m_Headers)
+            {
+                //OpusHead is followed by OpusTags.
+                if(m_Packet.size() >= 8 && memcmp(m_Packet.data(), "OpusHead", 8) == 0)
+                {
+                    if(!ParseHead())
+                        return 0;
+                }
+                else if(m_Packet.size() >= 8 && memcmp(m_Packet.data(), "OpusTags", 8) == 0)
+                    m_Headers = false;
+
+                continue;
+            }
+
+            if(m_Packet.empty() || m_Packet.size() > Size)
+                continue;
+
+            memcpy(Buf, m_Packet.data(), m_Packet.size());
+            return m_Packet.size();
+        }
+
+        return 0;
+    }
+
+    /**
+     * @brief Assembles the next packet of the played logical stream, also over page boundaries.
+     */
+    bool COggOpusSource::ReadPacket()
+    {
+        m_Packet.clear();
+
+        while (true)
+        {
+            if(m_Segment == m_Lacing.size())
+            {
+                bool Continued = !m_Packet.empty();
+                if(!ReadPage())
+                {
+                    m_Lacing.clear();
+                    m_Segment = 0;
+                    return false;
+                }
+
+                //A packet only continues on the directly following page, otherwise its first part is dropped.
+                if(Continued && (!(m_PageFlags & FLAG_CONTINUED) || m_PageLost))
+                    m_Packet.clear();
+
+                //The rest of a packet which started before the joined or a lost page.
+                if(m_Packet.empty() && (m_PageFlags & FLAG_CONTINUED))
+                {
+                    while (m_Segment < m_Lacing.size())
+                    {
+                        m_BodyPos += m_Lacing[m_Segment];
+                        if(m_Lacing[m_Segment++] < 255)
+                            break;
+                    }
+                }
+
+                continue;
+            }
+
+            uint8_t Lace = m_Lacing[m_Segment++];
+            if(m_BodyPos + Lace > m_Body.size())
+                return false;
+
+            m_Packet.insert(m_Packet.end(), m_Body.begin() + m_BodyPos, m_Body.begin() + m_BodyPos + Lace);
+            m_BodyPos += Lace;
+
+            //A lacing value below 255 ends the packet.
+            if(Lace < 255)
+                return true;
+        }
+    }
+
+    /**
+     * @brief Reads from the rescan buffer and then from the stream.
+     */
+    bool COggOpusSource::Read(uint8_t *Buf, size_t Size)
+    {
+        size_t Count = std::min(Size, m_Rescan.size() - m_RescanPos);
+        if(Count > 0)
+        {
+            memcpy(Buf, m_Rescan.data() + m_RescanPos, Count);
+            m_RescanPos += Count;
+
+            if(m_RescanPos == m_Rescan.size())
+            {
+                m_Rescan.clear();
+                m_RescanPos = 0;
+            }
+        }
+
+        return Count == Size || m_Stream->read((char*)Buf + Count, Size - Count);
+    }
+
+    /**
+     * @brief Computes the crc32 of an Ogg page. The crc field of the header must be zeroed.
+     */
+    uint32_t COggOpusSource::PageCRC(const uint8_t *Header, const std::vector<uint8_t> &Lacing, const std::vector<uint8_t> &Body)
+    {
+        //Ogg uses the polynomial 0x04C11DB7 without reflection, an initial value of 0 and no final xor.
+        static const struct STable
+        {
+            uint32_t Values[256];
+
+            STable()
+            {
+                for (uint32_t i = 0; i < 256; i++)
+                {
+                    uint32_t Value = i << 24;
+                    for (int j = 0; j < 8; j++)
+                        Value = (Value & 0x80000000) ? (Value << 1) ^ 0x04C11DB7 : (Value << 1);
+
+                    Values[i] = Value;
+                }
+            }
+        } Table;
+
+        uint32_t CRC = 0;
+        auto Update = [&CRC](const uint8_t *Data, size_t Size)
+        {
+            for (size_t i = 0; i < Size; i++)
+                CRC = (CRC << 8) ^ Table.Values[((CRC >> 24) ^ Data[i]) & 0xFF];
+        };
+
+        Update(Header, HEADER_SIZE);
+        Update(Lacing.data(), Lacing.size());
+        Update(Body.data(), Body.size());
+
+        return CRC;
+    }
+
+    /**
+     * @brief Reads the next page of the played logical stream. Pages with an unknown version or a wrong checksum are skipped.
+     */
+    bool COggOpusSource::ReadPage()
+    {
+        uint8_t Header[HEADER_SIZE];
+        if(!m_Stream)
+            return false;
+
+        while (Read(Header, 4))
+        {
+            //Resyncs to the next capture pattern, works also with streams which can't seek.
+            while (memcmp(Header, "OggS", 4) != 0)
+            {
+                memmove(Header, Header + 1, 3);
+                if(!Read(Header + 3, 1))
+                    return false;
+            }
+
+            if(!Read(Header + 4, HEADER_SIZE - 4))
+                return false;
+
+            uint8_t Flags = Header[5];
+            uint32_t Serial = Header[14] | (Header[15] << 8) | (Header[16] << 16) | ((uint32_t)Header[17] << 24);
+            uint32_t PageNo = Header[18] | (Header[19] << 8) | (Header[20] << 16) | ((uint32_t)Header[21] << 24);
+            uint32_t CRC = Header[22] | (Header[23] << 8) | (Header[24] << 16) | ((uint32_t)Header[25] << 24);
+            uint8_t Segments = Header[26];
+
+            m_Lacing.resize(Segments);
+            if(!Read(m_Lacing.data(), Segments))
+                return false;
+
+            size_t BodySize = 0;
+            for (auto &&e : m_Lacing)
+                BodySize += e;
+
+            m_Body.resize(BodySize);
+            if(!Read(m_Body.data(), BodySize))
+                return false;
+
+            uint8_t Check[HEADER_SIZE];
+            memcpy(Check, Header, HEADER_SIZE);
+            memset(Check + CRC_OFFSET, 0, 4);
+
+            if(Header[4] != 0 || PageCRC(Check, m_Lacing, m_Body) != CRC)
+            {
+                //The capture pattern was random data or the page is damaged. The bytes after the pattern may contain the next page.
+                std::vector<uint8_t> Rescan(Header + 1, Header + HEADER_SIZE);
+                Rescan.insert(Rescan.end(), m_Lacing.begin(), m_Lacing.end());
+                Rescan.insert(Rescan.end(), m_Body.begin(), m_Body.end());
+                Rescan.insert(Rescan.end(), m_Rescan.begin() + m_RescanPos, m_Rescan.end());
+
+                m_Rescan.swap(Rescan);
+                m_RescanPos = 0;
+                continue;
+            }
+
+            //A new logical stream begins. Opus streams are played, others are skipped.
+            if((Flags & FLAG_BOS) && !m_HasSerial && BodySize >= 8 && memcmp(m_Body.data(), "OpusHead", 8) == 0)
+            {
+                m_HasSerial = true;
+                m_Serial = Serial;
+                m_Headers = true;
+            }
+
+            if(!m_HasSerial || Serial != m_Serial)
+                continue;
+
+            m_PageLost = !(Flags & FLAG_BOS) && PageNo != m_NextPageNo;
+            m_NextPageNo = PageNo + 1;
+
+            //The next chained stream may follow.
+            if(Flags & FLAG_EOS)
+                m_HasSerial = false;
+
+            m_PageFlags = Flags;
+            m_Segment = 0;
+            m_BodyPos = 0;
+            return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * @brief Checks the OpusHead packet.
+     */
+    bool COggOpusSource::ParseHead()
+    {
+        //Magic, version, channels, pre-skip, sample rate, gain, mapping family.
+        if(m_Packet.size() < 19)
+        {
+            llog << lerror << "Invalid OpusHead" << lendl;
+            return false;
+        }
+
+        uint8_t Channels = m_Packet[9];
+        uint8_t Mapping = m_Packet[18];
+
+        if(Mapping != 0 || Channels == 0 || Channels > 2)
+        {
+            llog << lerror << "Unsupported opus channel mapping " << (int)Mapping << " with " << (int)Channels << " channels" << lendl;
+            return false;
+        }
+
+        return true;
+    }
+} // namespace DiscordBot
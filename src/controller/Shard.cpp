@@ -0,0 +1,318 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Shard.hpp"
+#include "DiscordClient.hpp"
+#include <Log.hpp>
+#include "../models/Payload.hpp"
+#include "../helpers/Helper.hpp"
+#include "../helpers/JSONView.hpp"
+
+namespace DiscordBot
+{
+    CShard::CShard(CDiscordClient *Client, uint32_t ID, uint32_t Count) : m_Client(Client), m_ID(ID), m_Count(Count), m_Heartbeat(0), m_Terminate(false), m_HeartACKReceived(false), m_Ready(false), m_HeartbeatInterval(0), m_LastSeqNum(-1), m_Compress(false), m_ETF(false), m_Limiter(std::bind(&CShard::Write, this, std::placeholders::_1))
+    {
+        //Disable client side checking.
+        ix::SocketTLSOptions DisabledTrust;
+        DisabledTrust.caFile = "NONE";
+
+        m_Socket.setTLSOptions(DisabledTrust);
+        m_Socket.setOnMessageCallback(std::bind(&CShard::OnWebsocketEvent, this, std::placeholders::_1));
+    }
+
+    void CShard::Connect(const std::string &URL, bool Compress, bool ETF)
+    {
+        m_Compress = Compress;
+        m_ETF = ETF;
+        m_Socket.setUrl(URL);
+        m_Socket.start();
+    }
+
+    void CShard::Reconnect(bool Resume)
+    {
+        if(!Resume)
+            m_SessionID = "";
+
+        //Closes a connection which is still open, e.g. after a missing heartbeat ack.
+        m_Ready = false;
+        m_Socket.stop();
+        m_Socket.start();
+    }
+
+    void CShard::Disconnect()
+    {
+        m_Terminate = true;
+        CTimerService::Get().Cancel(m_Heartbeat, true);
+
+        m_Ready = false;
+        m_Socket.stop();
+    }
+
+    void CShard::SendOP(OPCodes OP, const std::string &D, bool Background)
+    {
+        SPayload Pay;
+        Pay.OP = (uint32_t)OP;
+        Pay.D = D;
+
+        //The session must never wait behind queued requests.
+        CGatewayLimiter::Lane L = CGatewayLimiter::Lane::NORMAL;
+        if(OP == OPCodes::HEARTBEAT || OP == OPCodes::IDENTIFY || OP == OPCodes::RESUME)
+            L = CGatewayLimiter::Lane::PRIORITY;
+        else if(Background)
+            L = CGatewayLimiter::Lane::BACKGROUND;
+
+        try
+        {
+            CJSON json;
+            if(m_ETF)
+                m_Limiter.Push(CETF::FromJSON(json.Serialize(Pay)), L);
+            else
+                m_Limiter.Push(json.Serialize(Pay), L);
+        }
+        catch (const CJSONException &e)
+        {
+            llog << lerror << "Failed to serialize the Payload object. Enumtype: " << GetEnumName(e.GetErrType()) << " what(): " << e.what() << lendl;
+        }
+        catch (const CETFException &e)
+        {
+            llog << lerror << "Failed to encode the Payload object. what(): " << e.what() << lendl;
+        }
+    }
+
+    void CShard::Write(const std::string &Payload)
+    {
+        if(m_ETF)
+            m_Socket.sendBinary(Payload);
+        else
+            m_Socket.send(Payload);
+    }
+
+    void CShard::OnWebsocketEvent(const ix::WebSocketMessagePtr &msg)
+    {
+        switch (msg->type)
+        {
+            case ix::WebSocketMessageType::Open:
+            {
+                //Each connection starts a new zlib stream.
+                m_Inflater.Reset();
+                llog << linfo << "Shard " << m_ID << " websocket opened URI: " << msg->openInfo.uri << " Protocol: " << msg->openInfo.protocol << lendl;
+            }break;
+
+            case ix::WebSocketMessageType::Error:
+            {
+                llog << lerror << "Shard " << m_ID << " websocket error " << msg->errorInfo.reason << lendl;
+            }break;
+
+            case ix::WebSocketMessageType::Close:
+            {
+                m_Terminate = true;
+                CTimerService::Get().Cancel(m_Heartbeat);
+                m_HeartACKReceived = false;
+                m_Ready = false;
+                m_Limiter.Reset();
+                llog << linfo << "Shard " << m_ID << " websocket closed code " << msg->closeInfo.code << " Reason " << msg->closeInfo.reason << lendl;
+            }break;
+
+            case ix::WebSocketMessageType::Message:
+            {
+                if(!m_Compress)
+                    OnMessage(msg->str);
+                else if(m_Inflater.Inflate(msg->str, m_Inflated))
+                    OnMessage(m_Inflated);
+            }break;
+        }
+    }
+
+    void CShard::Replay(const std::string &Data, bool ETF)
+    {
+        m_ETF = ETF;
+
+        GatewayFrame Frame = Decode(Data);
+        if(Frame && (OPCodes)Frame->View->Root().GetValue<uint32_t>("op") == OPCodes::DISPATCH)
+            OnDispatch(Frame);
+    }
+
+    GatewayFrame CShard::Decode(const std::string &Data)
+    {
+        GatewayFrame Frame = GatewayFrame(new SGatewayFrame());
+
+        //The models are json based, etf payloads are transcoded and tokenized in one pass.
+        if(m_ETF)
+        {
+            try
+            {
+                Frame->View = CETF::ToView(Data, Frame->Data);
+            }
+            catch (const CETFException &e)
+            {
+                llog << lerror << "Failed to decode ETF what(): " << e.what() << lendl;
+                return nullptr;
+            }
+
+            return Frame;
+        }
+
+        //The frame is tokenized once, all handlers are reading from this view.
+        try
+        {
+            Frame->Data = Data;
+            Frame->View.reset(new CJSONView(Frame->Data));
+        }
+        catch (const CJSONViewException &e)
+        {
+            llog << lerror << "Failed to parse JSON what(): " << e.what() << lendl;
+            return nullptr;
+        }
+
+        return Frame;
+    }
+
+    void CShard::OnDispatch(GatewayFrame Frame)
+    {
+        CJSONValue Pay = Frame->View->Root();
+        m_LastSeqNum = Pay.GetValue<uint32_t>("s");
+        std::string Event = Pay.GetValue<std::string>("t");
+
+        //The session belongs to the shard, all other informations are shared.
+        if(Event == "READY")
+        {
+            m_SessionID = Pay["d"].GetValue<std::string>("session_id");
+            m_Ready = true;
+        }
+
+        m_Client->OnDispatch(this, Event, Frame);
+    }
+
+    void CShard::OnMessage(const std::string &Data)
+    {
+        if(m_Client->m_Recorder.IsOpen())
+            m_Client->m_Recorder.Write(m_ID, m_Count, m_ETF, Data);
+
+        GatewayFrame Frame = Decode(Data);
+        if(!Frame)
+            return;
+
+        CJSONValue Pay = Frame->View->Root();
+        CJSONValue D = Pay["d"];
+
+        switch ((OPCodes)Pay.GetValue<uint32_t>("op"))
+        {
+            case OPCodes::DISPATCH:
+            {
+                OnDispatch(Frame);
+            }break;
+
+            case OPCodes::HELLO:
+            {
+                m_HeartbeatInterval = D.GetValue<uint32_t>("heartbeat_interval");
+
+                //New sessions must wait for their identify slot.
+                if (m_SessionID->empty())
+                    m_Client->m_IdentifyQueue.Enqueue(m_ID, std::bind(&CShard::SendIdentity, this));
+                else
+                    SendResume();
+
+                m_HeartACKReceived = true;
+                m_Terminate = false;
+
+                CTimerService::Get().Cancel(m_Heartbeat);
+                m_Heartbeat = CTimerService::Get().Schedule(0, std::bind(&CShard::Heartbeat, this), m_HeartbeatInterval);
+            }break;
+
+            case OPCodes::HEARTBEAT_ACK:
+            {
+                m_HeartACKReceived = true;
+            }break;
+
+            //Something is wrong.
+            case OPCodes::INVALID_SESSION:
+            {
+                if (D.Get<bool>())
+                    SendResume();
+                else
+                {
+                    llog << linfo << "INVALID_SESSION CLOSE SOCKET Shard: " << m_ID << lendl;
+                    m_Ready = false;
+                    m_Socket.close();
+                    m_Client->m_EVManger.PostMessage(CDiscordClient::RECONNECT, m_ID, 5000);
+                }
+
+                llog << linfo << "INVALID_SESSION" << lendl;
+            }break;
+        }
+    }
+
+    void CShard::Heartbeat()
+    {
+        if (m_Terminate)
+            return;
+
+        //Start a reconnect. Closing the socket blocks, so the message thread of the client does it.
+        if (!m_HeartACKReceived)
+        {
+            m_Terminate = true;
+            CTimerService::Get().Cancel(m_Heartbeat);
+
+            m_Ready = false;
+            llog << linfo << "Heartbeat not acknowledged Shard: " << m_ID << lendl;
+            m_Client->m_EVManger.PostMessage(CDiscordClient::RESUME, m_ID, 100);
+            return;
+        }
+
+        SendOP(OPCodes::HEARTBEAT, m_LastSeqNum != (uint32_t)-1 ? std::to_string(m_LastSeqNum) : "");
+        m_HeartACKReceived = false;
+    }
+
+    void CShard::SendIdentity()
+    {
+        SIdentify id;
+        id.Token = m_Client->m_Token;
+        id.Properties["$os"] = "linux";
+        id.Properties["$browser"] = "libDiscordBot";
+        id.Properties["$device"] = "libDiscordBot";
+        id.Properties["presence"] = m_Client->CreateUserInfoJSON();
+        id.Intents = (uint32_t)m_Client->m_Intents;
+        id.Shard = {m_ID, m_Count};
+        id.LargeThreshold = m_Client->m_LargeThreshold;
+
+        CJSON json;
+        SendOP(OPCodes::IDENTIFY, json.Serialize(id));
+    }
+
+    void CShard::SendResume()
+    {
+        SResume resume;
+        resume.Token = m_Client->m_Token;
+        resume.SessionID = m_SessionID;
+        resume.Seq = m_LastSeqNum;
+
+        CJSON json;
+        SendOP(OPCodes::RESUME, json.Serialize(resume));
+    }
+
+    CShard::~CShard()
+    {
+        Disconnect();
+    }
+} // namespace DiscordBot
@@ -0,0 +1,266 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SHARD_HPP
+#define SHARD_HPP
+
+#include <string>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <JSON.hpp>
+#include <ixwebsocket/IXWebSocket.h>
+#include <models/atomic.hpp>
+#include "../helpers/ZLibStream.hpp"
+#include "../helpers/ETF.hpp"
+#include "../helpers/JSONView.hpp"
+#include "TimerService.hpp"
+#include "GatewayLimiter.hpp"
+
+namespace DiscordBot
+{
+    class CDiscordClient;
+
+    /**
+     * @brief A received gateway payload. Owns the text, so the view stays valid while the event waits for a worker.
+     */
+    struct SGatewayFrame
+    {
+        std::string Data;
+        std::unique_ptr<CJSONView> View;
+    };
+
+    using GatewayFrame = std::shared_ptr<SGatewayFrame>;
+
+    /**
+     * @brief A single gateway connection. Every shard has its own heartbeat, sequence number and session.
+     * All dispatched events are forwarded to the client, which holds the shared caches.
+     */
+    class CShard
+    {
+        public:
+            //All informations from https://discordapp.com/developers/docs/topics/opcodes-and-status-codes
+            enum class OPCodes
+            {
+                //Name                  Code        Client Action       Description
+                DISPATCH                = 0,        //Receive           An event was dispatched.
+                HEARTBEAT               = 1,        //Send/Receive      Fired periodically by the client to keep the connection alive.
+                IDENTIFY                = 2,        //Send              Starts a new session during the initial handshake.
+                PRESENCE_UPDATE         = 3,        //Send	            Update the client's presence.
+                VOICE_STATE_UPDATE      = 4,        //Send              Used to join/leave or move between voice channels.
+                RESUME                  = 6,        //Send	            Resume a previous session that was disconnected.
+                RECONNECT               = 7,        //Receive	        You should attempt to reconnect and resume immediately.
+                REQUEST_GUILD_MEMBERS   = 8,        //Send	            Request information about offline guild members in a large guild.
+                INVALID_SESSION         = 9,        //Receive	        The session has been invalidated. You should reconnect and identify/resume accordingly.
+                HELLO                   = 10,       //Receive	        Sent immediately after connecting, contains the heartbeat_interval to use.
+                HEARTBEAT_ACK           = 11        //Receive           Sent in response to receiving a heartbeat to acknowledge that it has been received.
+            };
+
+            /**
+             * @brief Identifies the bot.
+             */
+            struct SIdentify
+            {
+                std::string Token;
+                std::map<std::string, std::string> Properties;
+                uint32_t Intents;
+                std::vector<uint32_t> Shard;    //!< [shard_id, num_shards]
+                uint32_t LargeThreshold;        //!< 0 to use discords default.
+
+                void Serialize(CJSON &json) const
+                {
+                    json.AddPair("token", Token);
+                    json.AddPair("properties", Properties);
+                    json.AddPair("intents", Intents);
+                    json.AddPair("shard", Shard);
+
+                    if(LargeThreshold != 0)
+                        json.AddPair("large_threshold", LargeThreshold);
+                }
+            };
+
+            /**
+             * @brief Resumes the bot.
+             */
+            struct SResume
+            {
+                std::string Token;
+                std::string SessionID;
+                uint32_t Seq;
+
+                void Serialize(CJSON &json) const
+                {
+                    json.AddPair("token", Token);
+                    json.AddPair("session_id", SessionID);
+                    json.AddPair("seq", Seq);
+                }
+            };
+
+            /**
+             * @param Client: Client which receives all dispatched events.
+             * @param ID: Shard id.
+             * @param Count: Total number of shards.
+             */
+            CShard(CDiscordClient *Client, uint32_t ID, uint32_t Count);
+
+            /**
+             * @brief Opens the gateway connection.
+             * 
+             * @param URL: Gateway url including the query parameters.
+             * @param Compress: True if the url requests the zlib-stream transport compression.
+             * @param ETF: True if the url requests the etf encoding.
+             */
+            void Connect(const std::string &URL, bool Compress, bool ETF);
+
+            /**
+             * @brief Closes the connection and reconnects to the gateway. Blocks until the old connection is closed.
+             * 
+             * @param Resume: True to resume the old session, false to start a new one.
+             */
+            void Reconnect(bool Resume);
+
+            /**
+             * @brief Stops the heartbeat and closes the gateway connection.
+             */
+            void Disconnect();
+
+            /**
+             * @brief Builds and sends a payload object. Payloads above the send limit of discord are queued.
+             * 
+             * @param Background: True to send the payload only if no other payload waits, e.g. for requests of the library.
+             */
+            void SendOP(OPCodes OP, const std::string &D, bool Background = false);
+
+            /**
+             * @brief Handles a recorded payload without a connection. Only dispatch events are processed.
+             * 
+             * @param Data: Payload after the transport decompression.
+             * @param ETF: True if the payload is etf encoded.
+             */
+            void Replay(const std::string &Data, bool ETF);
+
+            /**
+             * @return Gets the id of this shard.
+             */
+            inline uint32_t GetID() const
+            {
+                return m_ID;
+            }
+
+            /**
+             * @return Gets the total number of shards.
+             */
+            inline uint32_t GetCount() const
+            {
+                return m_Count;
+            }
+
+            /**
+             * @return Returns true if the shard received its READY event.
+             */
+            inline bool IsReady() const
+            {
+                return m_Ready;
+            }
+
+            /**
+             * @return Gets the url of the gateway.
+             */
+            std::string GetURL()
+            {
+                return m_Socket.getUrl();
+            }
+
+            ~CShard();
+
+        private:
+            CDiscordClient *m_Client;
+            uint32_t m_ID;
+            uint32_t m_Count;
+
+            ix::WebSocket m_Socket;
+            std::atomic<CTimerService::TimerID> m_Heartbeat;
+            std::atomic<bool> m_Terminate;
+            std::atomic<bool> m_HeartACKReceived;
+            std::atomic<bool> m_Ready;
+            uint32_t m_HeartbeatInterval;
+            std::atomic<uint32_t> m_LastSeqNum;
+            atomic<std::string> m_SessionID;
+
+            bool m_Compress;
+            CZLibStream m_Inflater;
+            std::string m_Inflated;     //!< Reused buffer for inflated messages.
+            bool m_ETF;
+            CGatewayLimiter m_Limiter;
+
+            /**
+             * @brief Writes a payload to the websocket. Called from the limiter.
+             */
+            void Write(const std::string &Payload);
+
+            /**
+             * @brief Receives all websocket events of this shard.
+             */
+            void OnWebsocketEvent(const ix::WebSocketMessagePtr& msg);
+
+            /**
+             * @brief Parses a gateway message.
+             */
+            void OnMessage(const std::string &Data);
+
+            /**
+             * @brief Decodes and tokenizes a payload.
+             * 
+             * @return Returns null if the payload is invalid.
+             */
+            GatewayFrame Decode(const std::string &Data);
+
+            /**
+             * @brief Updates the session and passes a dispatch event to the client.
+             */
+            void OnDispatch(GatewayFrame Frame);
+
+            /**
+             * @brief Sends a heartbeat. Called from the timer service every heartbeat interval.
+             */
+            void Heartbeat();
+
+            /**
+             * @brief Sends the identity.
+             */
+            void SendIdentity();
+
+            /**
+             * @brief Sends a resume request.
+             */
+            void SendResume();
+    };
+
+    using Shard = std::shared_ptr<CShard>;
+} // namespace DiscordBot
+
+
+#endif //SHARD_HPP
@@ -0,0 +1,141 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "TimerService.hpp"
+#include <Log.hpp>
+#include <stdexcept>
+
+namespace DiscordBot
+{
+    CTimerService &CTimerService::Get()
+    {
+        static CTimerService Service;
+        return Service;
+    }
+
+    CTimerService::CTimerService() : m_NextID(0), m_Running(0), m_Terminate(false)
+    {
+        m_Thread = std::thread(&CTimerService::Run, this);
+    }
+
+    CTimerService::TimerID CTimerService::Schedule(uint32_t DelayMS, Task Call, uint32_t IntervalMS)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        TimerID ID = ++m_NextID;
+        Clock::time_point Due = Clock::now() + std::chrono::milliseconds(DelayMS);
+
+        m_Timers[ID] = {Call, std::chrono::milliseconds(IntervalMS), Due};
+        m_Deadlines.push({Due, ID});
+
+        //Only a new earliest deadline changes the sleep time of the timer thread.
+        if(m_Deadlines.top().ID == ID)
+            m_Wakeup.notify_one();
+
+        return ID;
+    }
+
+    void CTimerService::Cancel(TimerID ID, bool Wait)
+    {
+        std::unique_lock<std::mutex> lock(m_Lock);
+        m_Timers.erase(ID);
+
+        //A task which cancels itself would wait forever.
+        if(Wait && ID != 0 && std::this_thread::get_id() != m_Thread.get_id())
+            m_Finished.wait(lock, [this, ID]() { return m_Running != ID; });
+    }
+
+    void CTimerService::Run()
+    {
+        std::unique_lock<std::mutex> lock(m_Lock);
+
+        while (!m_Terminate)
+        {
+            if(m_Deadlines.empty())
+            {
+                m_Wakeup.wait(lock);
+                continue;
+            }
+
+            SDeadline Next = m_Deadlines.top();
+            auto IT = m_Timers.find(Next.ID);
+
+            //Skips canceled timers.
+            if(IT == m_Timers.end() || IT->second.Due != Next.Time)
+            {
+                m_Deadlines.pop();
+                continue;
+            }
+
+            Clock::time_point Now = Clock::now();
+            if(Next.Time > Now)
+            {
+                m_Wakeup.wait_until(lock, Next.Time);
+                continue;
+            }
+
+            m_Deadlines.pop();
+            Task Call = IT->second.Call;
+
+            if(IT->second.Interval == Clock::duration::zero())
+                m_Timers.erase(IT);
+            else
+            {
+                //Keeps the cadence, but doesn't catch up missed calls.
+                IT->second.Due += IT->second.Interval;
+                if(IT->second.Due <= Now)
+                    IT->second.Due = Now + IT->second.Interval;
+
+                m_Deadlines.push({IT->second.Due, Next.ID});
+            }
+
+            m_Running = Next.ID;
+            lock.unlock();
+
+            try
+            {
+                Call();
+            }
+            catch(const std::exception &e)
+            {
+                llog << lerror << "Timer task failed what(): " << e.what() << lendl;
+            }
+
+            lock.lock();
+            m_Running = 0;
+            m_Finished.notify_all();
+        }
+    }
+
+    CTimerService::~CTimerService()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            m_Terminate = true;
+        }
+
+        m_Wakeup.notify_one();
+        if(m_Thread.joinable())
+            m_Thread.join();
+    }
+} // namespace DiscordBot
@@ -0,0 +1,117 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TIMERSERVICE_HPP
+#define TIMERSERVICE_HPP
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <queue>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+namespace DiscordBot
+{
+    /**
+     * @brief Process-wide timer thread for heartbeats and other periodic work of the gateway and voice connections.
+     * The thread sleeps until the next deadline, so idle connections don't cause any wakeups.
+     */
+    class CTimerService
+    {
+        public:
+            using TimerID = uint64_t;
+            using Task = std::function<void()>;
+
+            /**
+             * @return Gets the timer service of the process.
+             */
+            static CTimerService &Get();
+
+            /**
+             * @brief Schedules a task. All tasks are called from the timer thread and must not block.
+             * 
+             * @param DelayMS: Milliseconds until the first call.
+             * @param Call: Task to execute.
+             * @param IntervalMS: Milliseconds between the following calls. 0 calls the task once.
+             * 
+             * @return Returns the id of the timer, which is never 0.
+             */
+            TimerID Schedule(uint32_t DelayMS, Task Call, uint32_t IntervalMS = 0);
+
+            /**
+             * @brief Cancels a timer. Unknown or finished timers are ignored.
+             * 
+             * @param ID: Id of the timer.
+             * @param Wait: True to wait until a running call of the timer returns. Ignored if called from a task.
+             */
+            void Cancel(TimerID ID, bool Wait = false);
+
+            ~CTimerService();
+
+        private:
+            using Clock = std::chrono::steady_clock;
+
+            struct SDeadline
+            {
+                Clock::time_point Time;
+                TimerID ID;
+
+                bool operator>(const SDeadline &Other) const
+                {
+                    return Time > Other.Time;
+                }
+            };
+
+            struct STimer
+            {
+                Task Call;
+                Clock::duration Interval;
+                Clock::time_point Due;
+            };
+
+            CTimerService();
+
+            void Run();
+
+            std::mutex m_Lock;
+            std::condition_variable m_Wakeup;
+            std::condition_variable m_Finished;
+
+            //Canceled timers are only removed from the map and skipped if their deadline is reached.
+            std::priority_queue<SDeadline, std::vector<SDeadline>, std::greater<SDeadline>> m_Deadlines;
+            std::unordered_map<TimerID, STimer> m_Timers;
+
+            TimerID m_NextID;
+            TimerID m_Running;      //!< Timer which is currently called, 0 if none.
+            bool m_Terminate;
+            std::thread m_Thread;
+    };
+} // namespace DiscordBot
+
+
+#endif //TIMERSERVICE_HPP
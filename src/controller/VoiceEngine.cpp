@@ -0,0 +1,558 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "VoiceEngine.hpp"
+#include <Log.hpp>
+#include <algorithm>
+#include <cmath>
+#include <string.h>
+#include "../helpers/Helper.hpp"
+
+#ifdef DISCORDBOT_UNIX
+#include <netdb.h>
+#include <netinet/in.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#else
+#include <windows.h>
+#endif
+
+namespace DiscordBot
+{
+    /**
+     * @return Gets the cpu time of the calling thread in microseconds.
+     */
+    static uint64_t GetThreadCPUUS()
+    {
+#ifdef DISCORDBOT_UNIX
+        timespec Time;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &Time);
+        return (uint64_t)Time.tv_sec * 1000000 + Time.tv_nsec / 1000;
+#else
+        FILETIME Creation, Exit, Kernel, User;
+        GetThreadTimes(GetCurrentThread(), &Creation, &Exit, &Kernel, &User);
+
+        uint64_t Ticks = ((uint64_t)Kernel.dwHighDateTime << 32 | Kernel.dwLowDateTime) + ((uint64_t)User.dwHighDateTime << 32 | User.dwLowDateTime);
+        return Ticks / 10;
+#endif
+    }
+
+    void CVoicePacing::OnSent(Clock::time_point Deadline, Clock::time_point Sent)
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        int64_t Lateness = std::chrono::duration_cast<std::chrono::microseconds>(Sent - Deadline).count();
+
+        m_Stats.Packets++;
+        if(Lateness > CVoiceStream::MILLISECONDS * 500)
+            m_Stats.LateFrames++;
+
+        if(Lateness > 0)
+            m_Stats.MaxLatenessUS = std::max<uint64_t>(m_Stats.MaxLatenessUS, Lateness);
+
+        //Difference between the send interval and the deadline interval.
+        if(m_HasLast)
+        {
+            double Diff = (double)std::chrono::duration_cast<std::chrono::microseconds>((Sent - m_LastSent) - (Deadline - m_LastDeadline)).count();
+            m_Stats.JitterUS += (std::fabs(Diff) - m_Stats.JitterUS) / 16.0;
+        }
+
+        m_LastDeadline = Deadline;
+        m_LastSent = Sent;
+        m_HasLast = true;
+    }
+
+    void CVoicePacing::OnIdle()
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_HasLast = false;
+    }
+
+    CVoiceConnectionStats CVoicePacing::GetStats()
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        return m_Stats;
+    }
+
+    CVoiceEngine &CVoiceEngine::Get()
+    {
+        static CVoiceEngine Engine;
+        return Engine;
+    }
+
+    CVoiceEngine::CVoiceEngine() : m_Terminate(false), m_Next(0), m_TickCPU(0), m_Wanted(0), m_Busy(0)
+    {
+        m_Socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+        sockaddr_in Local;
+        memset(&Local, 0, sizeof(Local));
+        Local.sin_family = AF_INET;
+        Local.sin_addr.s_addr = htonl(INADDR_ANY);
+        Local.sin_port = 0;
+
+        if(bind(m_Socket, (sockaddr*)&Local, sizeof(Local)) != 0)
+            llog << lerror << "Failed to bind the voice socket" << lendl;
+
+        //Neither the tick thread nor the workers may block on the socket.
+#ifdef DISCORDBOT_UNIX
+        fcntl(m_Socket, F_SETFL, fcntl(m_Socket, F_GETFL, 0) | O_NONBLOCK);
+#else
+        u_long NonBlocking = 1;
+        ioctlsocket(m_Socket, FIONBIO, &NonBlocking);
+#endif
+
+        //The tick thread is the first encoder.
+        uint32_t Count = std::max(std::thread::hardware_concurrency(), 1u);
+        for (uint32_t i = 1; i < Count; i++)
+            m_Workers.push_back(std::thread(&CVoiceEngine::Work, this));
+
+        m_Events.Start(1, 1024);
+        m_Thread = std::thread(&CVoiceEngine::Run, this);
+    }
+
+    bool CVoiceEngine::Resolve(const std::string &Host, uint16_t Port, SAddress &Out)
+    {
+        addrinfo Hints;
+        memset(&Hints, 0, sizeof(Hints));
+        Hints.ai_family = AF_INET;
+        Hints.ai_socktype = SOCK_DGRAM;
+
+        addrinfo *Res = nullptr;
+        if(getaddrinfo(Host.c_str(), std::to_string(Port).c_str(), &Hints, &Res) != 0 || !Res)
+            return false;
+
+        memset(&Out.Addr, 0, sizeof(Out.Addr));
+        memcpy(&Out.Addr, Res->ai_addr, Res->ai_addrlen);
+        Out.Len = (socklen_t)Res->ai_addrlen;
+
+        freeaddrinfo(Res);
+        return true;
+    }
+
+    void CVoiceEngine::Add(VoiceStream Stream, const SAddress &Server, VoicePacing Pacing, OnFinish Finish, OnSwitch Switch)
+    {
+        auto Entry = std::make_shared<SEntry>();
+        Entry->Stream = Stream;
+        Entry->Server = Server;
+        Entry->Pacing = Pacing;
+        Entry->Finish = Finish;
+        Entry->Switch = Switch;
+        Entry->Finished = false;
+
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Streams.push_back(Entry);
+        m_Stats.Streams = m_Streams.size();
+        m_Wakeup.notify_one();
+    }
+
+    bool CVoiceEngine::Remove(const VoiceStream &Stream)
+    {
+        Stream->Stop();
+
+        std::lock_guard<std::mutex> lock(m_Lock);
+        auto IT = std::find_if(m_Streams.begin(), m_Streams.end(), [&Stream](const std::shared_ptr<SEntry> &e) { return e->Stream == Stream; });
+        if(IT == m_Streams.end())
+            return false;
+
+        //The order of the streams doesn't matter.
+        std::swap(*IT, m_Streams.back());
+        m_Streams.pop_back();
+        m_Stats.Streams = m_Streams.size();
+        return true;
+    }
+
+    void CVoiceEngine::Discover(uint32_t SSRC, const SAddress &Server, OnDiscovered Call)
+    {
+        uint8_t Packet[DISCOVERY_SIZE] = {0};
+        Packet[1] = 0x1;    //Type
+        Packet[3] = 70;     //Length field
+
+        //The SSRC is sent in big endian.
+        Packet[4] = (SSRC >> 24) & 0xFF;
+        Packet[5] = (SSRC >> 16) & 0xFF;
+        Packet[6] = (SSRC >> 8) & 0xFF;
+        Packet[7] = SSRC & 0xFF;
+
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            m_Discoveries[SSRC] = {Call, GetTimeMillis() + DISCOVERY_TIMEOUT};
+            m_Wakeup.notify_one();
+        }
+
+        if(sendto(m_Socket, (const char*)Packet, sizeof(Packet), 0, (const sockaddr*)&Server.Addr, Server.Len) < 0)
+            llog << lerror << "Failed to send the ip discovery request" << lendl;
+    }
+
+    VoiceStats CVoiceEngine::GetStats()
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        return VoiceStats(new CVoiceStats(m_Stats));
+    }
+
+    void CVoiceEngine::SleepUntil(Clock::time_point Time)
+    {
+#ifdef __linux__
+        //The steady clock of libstdc++ and libc++ is CLOCK_MONOTONIC, so the deadline can be used directly.
+        int64_t NS = std::chrono::duration_cast<std::chrono::nanoseconds>(Time.time_since_epoch()).count();
+
+        timespec Deadline;
+        Deadline.tv_sec = NS / 1000000000;
+        Deadline.tv_nsec = NS % 1000000000;
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &Deadline, nullptr) == EINTR);
+#else
+        std::this_thread::sleep_until(Time);
+#endif
+    }
+
+    void CVoiceEngine::Run()
+    {
+        const Clock::duration Interval = std::chrono::milliseconds(CVoiceStream::MILLISECONDS);
+        Clock::time_point Next = Clock::now();
+
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_Lock);
+
+                //Sleeps until there is something to do.
+                if(m_Streams.empty() && m_Discoveries.empty())
+                {
+                    m_Wakeup.wait(lock, [this]() { return m_Terminate || !m_Streams.empty() || !m_Discoveries.empty(); });
+                    Next = Clock::now();
+                }
+
+                if(m_Terminate)
+                    break;
+
+                std::lock_guard<std::mutex> tick(m_TickLock);
+                m_Tick = m_Streams;
+            }
+
+            Clock::time_point Start = Clock::now();
+            Receive();
+
+            if(!m_Tick.empty())
+            {
+                //The packets of this tick were encoded in the previous ticks, so the send doesn't wait for the encoders.
+                m_TickCPU = 0;
+                Send(Next);
+
+                //Wakes only as many workers as the number of streams is worth.
+                {
+                    std::lock_guard<std::mutex> lock(m_TickLock);
+                    m_Next = 0;
+                    m_Wanted = std::min<size_t>(m_Workers.size(), (m_Tick.size() - 1) / STREAMS_PER_WORKER);
+                }
+
+                m_TickStart.notify_all();
+                Process();
+
+                {
+                    std::unique_lock<std::mutex> lock(m_TickLock);
+
+                    //Workers which didn't wake up in time aren't needed anymore.
+                    m_Wanted = 0;
+                    m_TickDone.wait(lock, [this]() { return m_Busy == 0; });
+                }
+
+                for (auto &&e : m_Tick)
+                {
+                    if(e->Stream->TakeSwitched() && e->Switch)
+                        m_Events.Post((uint64_t)e.get(), e->Switch);
+
+                    if(e->Finished && Remove(e->Stream) && e->Finish)
+                        m_Events.Post((uint64_t)e.get(), e->Finish);
+                }
+
+                //Keeps the capacity, so the next tick doesn't allocate.
+                {
+                    std::lock_guard<std::mutex> lock(m_TickLock);
+                    m_Tick.clear();
+                }
+
+                uint64_t CPU = m_TickCPU;
+                std::lock_guard<std::mutex> lock(m_Lock);
+                m_Stats.Ticks++;
+                m_Stats.TickCPUUS = CPU;
+                m_Stats.TotalTickCPUUS += CPU;
+                m_Stats.MaxTickCPUUS = std::max(m_Stats.MaxTickCPUUS, CPU);
+                m_Stats.TickUS = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - Start).count();
+            }
+
+            Next += Interval;
+            Clock::time_point Now = Clock::now();
+
+            //Missed ticks are run immediately, so the streams catch up. After a long stall the missed ticks are dropped.
+            if(Now - Next >= Interval * MAX_CATCHUP)
+            {
+                uint64_t Missed = (Now - Next) / Interval;
+                Next += Interval * Missed;
+
+                std::lock_guard<std::mutex> lock(m_Lock);
+                m_Stats.SkippedTicks += Missed;
+            }
+            else if(Next > Now)
+                SleepUntil(Next);
+        }
+    }
+
+    void CVoiceEngine::Work()
+    {
+        std::unique_lock<std::mutex> lock(m_TickLock);
+
+        while (true)
+        {
+            m_TickStart.wait(lock, [this]() { return m_Wanted > 0 || m_Terminate; });
+            if(m_Terminate)
+                break;
+
+            m_Wanted--;
+            m_Busy++;
+            lock.unlock();
+
+            Process();
+
+            lock.lock();
+            m_Busy--;
+            if(m_Busy == 0)
+                m_TickDone.notify_all();
+        }
+    }
+
+    void CVoiceEngine::Process()
+    {
+        uint64_t Start = GetThreadCPUUS();
+        size_t Count = m_Tick.size();
+
+        for (size_t i = m_Next++; i < Count; i = m_Next++)
+            m_Tick[i]->Finished = !m_Tick[i]->Stream->Tick();
+
+        m_TickCPU += GetThreadCPUUS() - Start;
+    }
+
+    void CVoiceEngine::Send(Clock::time_point Deadline)
+    {
+        uint64_t CPUStart = GetThreadCPUUS();
+        uint64_t Packets = 0;
+        uint64_t Errors = 0;
+
+#ifdef __linux__
+        mmsghdr Msgs[SEND_BATCH];
+        iovec Vecs[SEND_BATCH];
+        SEntry *Batch[SEND_BATCH];
+        bool Failed[SEND_BATCH];
+        size_t i = 0;
+
+        while (i < m_Tick.size())
+        {
+            unsigned int Count = 0;
+            for (; i < m_Tick.size() && Count < SEND_BATCH; i++)
+            {
+                SEntry &Entry = *m_Tick[i];
+
+                //Sent straight from the slot of the stream.
+                const CVoiceStream::SPacket *Packet = Entry.Stream->GetPacket();
+                if(!Packet)
+                {
+                    Entry.Pacing->OnIdle();
+                    continue;
+                }
+
+                Vecs[Count].iov_base = (void*)Packet->Data;
+                Vecs[Count].iov_len = Packet->Size;
+
+                memset(&Msgs[Count], 0, sizeof(mmsghdr));
+                Msgs[Count].msg_hdr.msg_name = (void*)&Entry.Server.Addr;
+                Msgs[Count].msg_hdr.msg_namelen = Entry.Server.Len;
+                Msgs[Count].msg_hdr.msg_iov = &Vecs[Count];
+                Msgs[Count].msg_hdr.msg_iovlen = 1;
+                Failed[Count] = false;
+                Batch[Count++] = &Entry;
+            }
+
+            //A full socket buffer drops the rest of the batch, late audio is useless anyway.
+            //Any other error belongs to the first unsent message (e.g. an unreachable server), the others are still sent.
+            unsigned int Sent = 0;
+            while (Sent < Count)
+            {
+                int Ret = sendmmsg(m_Socket, Msgs + Sent, Count - Sent, 0);
+                if(Ret > 0)
+                    Sent += Ret;
+                else if(Ret == 0 || errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+                else if(errno != EINTR)
+                    Failed[Sent++] = true;
+            }
+
+            Clock::time_point Now = Clock::now();
+            for (unsigned int j = 0; j < Sent; j++)
+            {
+                if(Failed[j])
+                    Errors++;
+                else
+                {
+                    Batch[j]->Pacing->OnSent(Deadline, Now);
+                    Packets++;
+                }
+            }
+
+            //Sent or not, the packets of this tick are outdated.
+            for (unsigned int j = 0; j < Count; j++)
+                Batch[j]->Stream->PopPacket();
+
+            Errors += Count - Sent;
+        }
+#else
+        for (auto &&e : m_Tick)
+        {
+            const CVoiceStream::SPacket *Packet = e->Stream->GetPacket();
+            if(!Packet)
+            {
+                e->Pacing->OnIdle();
+                continue;
+            }
+
+            if(sendto(m_Socket, (const char*)Packet->Data, Packet->Size, 0, (const sockaddr*)&e->Server.Addr, e->Server.Len) < 0)
+                Errors++;
+            else
+            {
+                e->Pacing->OnSent(Deadline, Clock::now());
+                Packets++;
+            }
+
+            e->Stream->PopPacket();
+        }
+#endif
+
+        m_TickCPU += GetThreadCPUUS() - CPUStart;
+
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_Stats.Packets += Packets;
+        m_Stats.SendErrors += Errors;
+    }
+
+    void CVoiceEngine::Receive()
+    {
+        uint8_t Data[DISCOVERY_SIZE];
+        struct SResult
+        {
+            uint32_t SSRC;
+            OnDiscovered Call;
+            std::string IP;
+            uint16_t Port;
+        };
+
+        std::vector<SResult> Results;
+
+        while (true)
+        {
+            int Ret = recvfrom(m_Socket, (char*)Data, sizeof(Data), 0, nullptr, nullptr);
+            if(Ret < 0)
+                break;
+
+            //Voice servers also send other packets, only discovery responses are of interest.
+            if(Ret != DISCOVERY_SIZE || Data[1] != 0x2)
+                continue;
+
+            uint32_t SSRC = ((uint32_t)Data[4] << 24) | ((uint32_t)Data[5] << 16) | ((uint32_t)Data[6] << 8) | Data[7];
+
+            std::string IP; 
+            for (size_t i = 8; i < 72; i++)
+            {
+                if(!Data[i])
+                    break;
+
+                IP += Data[i];
+            }
+
+            //The port is sent in big endian.
+            uint16_t Port = (Data[72] << 8) | Data[73];
+
+            std::lock_guard<std::mutex> lock(m_Lock);
+            auto IT = m_Discoveries.find(SSRC);
+            if(IT != m_Discoveries.end())
+            {
+                Results.push_back({SSRC, IT->second.Call, IP, Port});
+                m_Discoveries.erase(IT);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            int64_t Now = GetTimeMillis();
+
+            for (auto IT = m_Discoveries.begin(); IT != m_Discoveries.end();)
+            {
+                if(IT->second.Timeout > Now)
+                {
+                    IT++;
+                    continue;
+                }
+
+                Results.push_back({IT->first, IT->second.Call, "", 0});
+                IT = m_Discoveries.erase(IT);
+            }
+        }
+
+        for (auto &&e : Results)
+        {
+            OnDiscovered Call = e.Call;
+            std::string IP = e.IP;
+            uint16_t Port = e.Port;
+
+            m_Events.Post(e.SSRC, [Call, IP, Port]() { Call(IP, Port); });
+        }
+    }
+
+    CVoiceEngine::~CVoiceEngine()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Lock);
+            std::lock_guard<std::mutex> tick(m_TickLock);
+            m_Terminate = true;
+        }
+
+        m_Wakeup.notify_all();
+        m_TickStart.notify_all();
+
+        if(m_Thread.joinable())
+            m_Thread.join();
+
+        for (auto &&e : m_Workers)
+        {
+            if(e.joinable())
+                e.join();
+        }
+
+        m_Events.Stop();
+
+#ifdef DISCORDBOT_UNIX
+        close(m_Socket);
+#else
+        closesocket(m_Socket);
+#endif
+    }
+} // namespace DiscordBot
@@ -0,0 +1,248 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VOICEENGINE_HPP
+#define VOICEENGINE_HPP
+
+#include <config.h>
+#include <models/VoiceStats.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+#include "EventWorkerPool.hpp"
+#include "VoiceStream.hpp"
+
+#ifdef DISCORDBOT_UNIX
+#include <sys/socket.h>
+#else
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#endif
+
+namespace DiscordBot
+{
+    /**
+     * @brief Measures the pacing of the packets of one voice connection. Shared by all streams of the connection.
+     */
+    class CVoicePacing
+    {
+        public:
+            using Clock = std::chrono::steady_clock;
+
+            CVoicePacing() : m_HasLast(false) {}
+
+            /**
+             * @brief Called by the voice engine after a packet was sent.
+             * 
+             * @param Deadline: Start of the tick of the packet.
+             * @param Sent: Time after the send.
+             */
+            void OnSent(Clock::time_point Deadline, Clock::time_point Sent);
+
+            /**
+             * @brief Called by the voice engine for ticks without a packet. The following packet isn't compared with the last one.
+             */
+            void OnIdle();
+
+            CVoiceConnectionStats GetStats();
+
+        private:
+            std::mutex m_Lock;
+            CVoiceConnectionStats m_Stats;
+            Clock::time_point m_LastDeadline;
+            Clock::time_point m_LastSent;
+            bool m_HasLast;
+    };
+
+    using VoicePacing = std::shared_ptr<CVoicePacing>;
+
+    /**
+     * @brief Process-wide engine for the audio of all voice connections. One thread ticks every 20 ms and sends the due packets of all streams
+     * together over one shared udp socket. Afterwards a fixed pool of workers encodes the frames for the next ticks.
+     * The number of threads depends on the cores and not on the guilds.
+     * 
+     * The ticks are paced with absolute deadlines, missed ticks after a short stall are sent immediately.
+     */
+    class CVoiceEngine
+    {
+        public:
+            using OnFinish = std::function<void()>;
+            using OnSwitch = std::function<void()>;
+
+            /**
+             * @brief Called with the external address of the engine socket or an empty ip on a timeout.
+             */
+            using OnDiscovered = std::function<void(const std::string &IP, uint16_t Port)>;
+
+            struct SAddress
+            {
+                sockaddr_storage Addr;
+                socklen_t Len;
+            };
+
+            /**
+             * @return Gets the voice engine of the process.
+             */
+            static CVoiceEngine &Get();
+
+            /**
+             * @brief Resolves the udp address of a voice server.
+             * 
+             * @return Returns false if the host can't be resolved.
+             */
+            static bool Resolve(const std::string &Host, uint16_t Port, SAddress &Out);
+
+            /**
+             * @brief Starts sending a stream.
+             * 
+             * @param Stream: Stream to send.
+             * @param Server: Voice server of the stream.
+             * @param Pacing: Receives the send times of the packets.
+             * @param Finish: Called if the stream ends by itself. Not called if the stream is removed.
+             * @param Switch: Called if the stream continued with its next source.
+             */
+            void Add(VoiceStream Stream, const SAddress &Server, VoicePacing Pacing, OnFinish Finish, OnSwitch Switch);
+
+            /**
+             * @brief Stops a stream. The packet of a running tick may still be sent.
+             * 
+             * @return Returns false if the stream is unknown or already finished.
+             */
+            bool Remove(const VoiceStream &Stream);
+
+            /**
+             * @brief Sends an ip discovery request from the engine socket. Discord expects the audio from the discovered address.
+             * 
+             * @param SSRC: SSRC of the voice connection, used to assign the response.
+             * @param Server: Voice server of the connection.
+             * @param Call: Called with the result. Replaces a pending discovery of the same SSRC.
+             */
+            void Discover(uint32_t SSRC, const SAddress &Server, OnDiscovered Call);
+
+            /**
+             * @return Gets a copy of the current statistics.
+             */
+            VoiceStats GetStats();
+
+            ~CVoiceEngine();
+
+        private:
+#ifdef DISCORDBOT_UNIX
+            using SocketHandle = int;
+#else
+            using SocketHandle = SOCKET;
+#endif
+
+            using Clock = std::chrono::steady_clock;
+
+            static const uint32_t MAX_CATCHUP = 5;             //!< Missed ticks which are caught up, longer stalls are skipped.
+            static const uint32_t STREAMS_PER_WORKER = 16;     //!< Streams of a tick which a woken worker should at least encode.
+            static const uint32_t SEND_BATCH = 64;             //!< Max packets per sendmmsg call.
+            static const uint32_t DISCOVERY_TIMEOUT = 5000;    //!< Milliseconds to wait for the ip discovery response.
+            static const size_t DISCOVERY_SIZE = 74;           //!< Size of the ip discovery packet.
+
+            struct SEntry
+            {
+                VoiceStream Stream;
+                SAddress Server;
+                VoicePacing Pacing;
+                OnFinish Finish;
+                OnSwitch Switch;
+                bool Finished;
+            };
+
+            struct SDiscovery
+            {
+                OnDiscovered Call;
+                int64_t Timeout;
+            };
+
+            CVoiceEngine();
+
+            /**
+             * @brief Tick thread.
+             */
+            void Run();
+
+            /**
+             * @brief Worker thread, helps the tick thread to encode the streams.
+             */
+            void Work();
+
+            /**
+             * @brief Fills the buffers of the streams of the current tick until all are taken.
+             */
+            void Process();
+
+            /**
+             * @brief Sleeps until the given time.
+             */
+            static void SleepUntil(Clock::time_point Time);
+
+            /**
+             * @brief Sends the packets of all streams of the current tick.
+             * 
+             * @param Deadline: Start of the tick.
+             */
+            void Send(Clock::time_point Deadline);
+
+            /**
+             * @brief Reads all ip discovery responses.
+             */
+            void Receive();
+
+            std::mutex m_Lock;
+            std::condition_variable m_Wakeup;
+            std::vector<std::shared_ptr<SEntry>> m_Streams;
+            std::unordered_map<uint32_t, SDiscovery> m_Discoveries;
+            CVoiceStats m_Stats;
+            bool m_Terminate;
+
+            //State of the current tick, shared with the workers.
+            std::mutex m_TickLock;
+            std::condition_variable m_TickStart;
+            std::condition_variable m_TickDone;
+            std::vector<std::shared_ptr<SEntry>> m_Tick;
+            std::atomic<size_t> m_Next;
+            std::atomic<uint64_t> m_TickCPU;
+            uint32_t m_Wanted;      //!< Workers which should join the current tick.
+            uint32_t m_Busy;        //!< Workers which are inside the current tick.
+
+            SocketHandle m_Socket;
+
+            CEventWorkerPool m_Events;  //!< Calls the callbacks, so the controller never blocks a tick.
+            std::vector<std::thread> m_Workers;
+            std::thread m_Thread;
+    };
+} // namespace DiscordBot
+
+
+#endif //VOICEENGINE_HPP
@@ -29,36 +29,37 @@
 #include <sodium.h>
 #include <time.h>
 #include <stdlib.h>
-#include <queue>
 #include "../helpers/Helper.hpp"
 
 namespace DiscordBot
 {
-    const int CVoiceSocket::MILLISECONDS;
 
     /**
      * @param json: JSON from VOICE_SERVER_UPDATE event,
      * @param SessionID: Session ID of the bot voice state.
      * @param ClientID: Bot client ID.
      */
-    CVoiceSocket::CVoiceSocket(CJSON &json, const std::string &SessionID, const std::string &ClientID) : m_Terminate(false), m_HeartACKReceived(false), m_LastSeqNum(-1), m_Stop(true), m_Reconnect(false)
+    CVoiceSocket::CVoiceSocket(const CJSONValue &json, const std::string &SessionID, const std::string &ClientID) : m_Heartbeat(0), m_Terminate(false), m_HeartACKReceived(false), m_LastSeqNum(-1), m_Pacing(new CVoicePacing()), m_Mixer(new CAudioMixer(CVoiceStream::CHANNEL, CVoiceStream::FREQUENCY * CVoiceStream::MILLISECONDS / 1000)), m_PreBuffer(2), m_Reconnect(false)
     {
-        m_EVManager.SubscribeMessage(RESUME, std::bind(&CVoiceSocket::OnMessageReceive, this, std::placeholders::_1));   
-
         m_Token = json.GetValue<std::string>("token");
         m_GuildID = json.GetValue<std::string>("guild_id");
         m_SessionID = SessionID;
         m_ClientID = ClientID;
 
         std::string URL = json.GetValue<std::string>("endpoint");
-        size_t Pos = URL.find(":");
-        URL = URL.substr(0, Pos);
+
+        //Endpoints with a scheme are used as they are, e.g. endpoints of a local test server.
+        if(URL.find("://") == std::string::npos)
+        {
+            size_t Pos = URL.find(":");
+            URL = "wss://" + URL.substr(0, Pos);
+        }
 
         ix::SocketTLSOptions DisabledTrust;
         DisabledTrust.caFile = "NONE";
 
         m_Socket.setTLSOptions(DisabledTrust);
-        m_Socket.setUrl("wss://" + URL + "/?v=4");
+        m_Socket.setUrl(URL + "/?v=4");
         m_Socket.setOnMessageCallback(std::bind(&CVoiceSocket::OnWebsocketEvent, this, std::placeholders::_1));
         m_Socket.start();
     }
@@ -69,6 +70,22 @@ namespace DiscordBot
      * @param Source: Audiosource which is send to discord.
      */
     void CVoiceSocket::StartSpeaking(AudioSource Source)
+    {
+        Play(Source, nullptr);
+    }
+
+    /**
+     * @brief Starts to play a broadcast. Stops the old stream.
+     */
+    void CVoiceSocket::StartBroadcast(AudioBroadcast Broadcast)
+    {
+        Play(nullptr, Broadcast);
+    }
+
+    /**
+     * @brief Starts a new stream of either the source or the broadcast.
+     */
+    void CVoiceSocket::Play(AudioSource Source, AudioBroadcast Broadcast)
     {
         /*
             Assign the audio source only, if the connection is not etablished. 
@@ -76,277 +93,201 @@ namespace DiscordBot
         */
         if(m_SecKey.empty())
         {
+            std::lock_guard<std::mutex> lock(m_StreamLock);
             m_Source = Source;
+            m_Broadcast = Broadcast;
             return;
         }
 
         //Stops the old audio source.
-        if(!m_Stop)
-            StopSpeaking();
+        bool Playing;
+        EncoderProfile Profile;
+        {
+            std::lock_guard<std::mutex> lock(m_StreamLock);
+            Playing = m_Stream != nullptr;
+            Profile = m_Profile;
+        }
 
-        m_Pause = false;
-        m_Stop = false;
+        if(Playing)
+            StopStream();
 
-        m_Source = Source;
+        VoiceStream Stream;
+        if(Broadcast)
+            Stream = VoiceStream(new CVoiceStream(Broadcast, m_SSRC, m_SecKey, m_PreBuffer, m_Mixer, Profile));
+        else
+            Stream = VoiceStream(new CVoiceStream(Source, m_SSRC, m_SecKey, m_PreBuffer, m_Mixer, Profile));
 
-        //We must first begin speaking before we can send audio.
+        {
+            std::lock_guard<std::mutex> lock(m_StreamLock);
+            m_Source = Source;
+            m_Broadcast = Broadcast;
+            m_Stream = Stream;
+        }
+
+        //We must first begin speaking before we can send audio. The first packet follows after at least one tick.
         SetSpeaking(true);
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        m_Playback = std::thread(&CVoiceSocket::Playback, this);
+
+        //The engine may outlive this socket.
+        std::weak_ptr<CVoiceSocket> Weak = shared_from_this();
+        CVoiceStream *Ptr = Stream.get();
+
+        CVoiceEngine::Get().Add(Stream, m_Server, m_Pacing, [Weak, Ptr]()
+        {
+            VoiceSocket Socket = Weak.lock();
+            if(Socket)
+                Socket->OnStreamFinished(Ptr);
+        },
+        [Weak, Ptr]()
+        {
+            VoiceSocket Socket = Weak.lock();
+            if(Socket)
+                Socket->OnStreamSwitched(Ptr);
+        });
     }
 
     /**
-     * @brief Pause the sending of audio.
+     * @brief Mixes a source over the current audio, with the same encoder. Starts a stream if nothing is playing.
      */
-    void CVoiceSocket::PauseSpeaking()
+    void CVoiceSocket::MixSource(AudioSource Source, float Gain)
     {
-        m_Pause = true;
-        SetSpeaking(false);
+        m_Mixer->Add(Source, Gain);
+
+        //Started in the SESSION_DESCRIPTION event.
+        if(m_SecKey.empty())
+            return;
+
+        bool Playing;
+        {
+            std::lock_guard<std::mutex> lock(m_StreamLock);
+            Playing = m_Stream != nullptr;
+        }
+
+        if(!Playing)
+            StartSpeaking(nullptr);
     }
 
     /**
-     * @brief Resumes the sending of audio.
+     * @brief Sets the source which follows the current one without a gap.
      */
-    void CVoiceSocket::ResumeSpeaking()
+    bool CVoiceSocket::SetNextSource(AudioSource Source)
     {
-        SetSpeaking(true);
-        m_Pause = false;
+        std::lock_guard<std::mutex> lock(m_StreamLock);
+        if(!m_Stream)
+            return false;
+
+        m_Stream->SetNextSource(Source);
+        return true;
     }
 
     /**
-     * @brief Stops the sending of audio. Raise a OnSpeakFinish event.
+     * @brief Pause the sending of audio.
      */
-    void CVoiceSocket::StopSpeaking()
+    void CVoiceSocket::PauseSpeaking()
     {
-        m_Stop = true;
-        if(m_Playback.joinable())
-            m_Playback.join();
+        {
+            std::lock_guard<std::mutex> lock(m_StreamLock);
+            if(m_Stream)
+                m_Stream->SetPause(true);
+        }
 
         SetSpeaking(false);
-
-        if(m_Source)
-            m_Callback(m_GuildID);
-
-        m_Source = nullptr;
     }
 
     /**
-     * @brief Informates Discord that the bot begins to speak or is finish with speaking.
+     * @brief Resumes the sending of audio.
      */
-    void CVoiceSocket::SetSpeaking(bool Speak)
+    void CVoiceSocket::ResumeSpeaking()
     {
-        CJSON json;
-
-        if(Speak)
-            json.AddPair("speaking", 1);    //Speaks with microphone. See https://discord.com/developers/docs/topics/voice-connections#speaking
-        else
-            json.AddPair("speaking", 0);
-
-        json.AddPair("delay", 0);
-        json.AddPair("ssrc", m_SSRC);
+        SetSpeaking(true);
 
-        SendOP(OPCodes::SPEAKING, json.Serialize());
+        std::lock_guard<std::mutex> lock(m_StreamLock);
+        if(m_Stream)
+            m_Stream->SetPause(false);
     }
 
     /**
-     * @brief Encode, encrypt and send audio data.
+     * @brief Stops the sending of audio and removes all mixed sources. Raise a OnSpeakFinish event.
      */
-    void CVoiceSocket::Playback()
+    void CVoiceSocket::StopSpeaking()
     {
-        int err;
-        OpusEncoder *Encoder = opus_encoder_create(FREQUENCY, CHANNEL, OPUS_APPLICATION_VOIP, &err);
-        if(err)
-        {
-            llog << lerror << "Error to create opus encoder" << lendl;
-            return;
-        }
-
-        //Reserve buffer size for 20 ms.
-        size_t Size = FREQUENCY * CHANNEL * MILLISECONDS / 1000;   //20 Milliseconds.
-        uint16_t *Buf = new uint16_t[Size];
-        uint8_t *OpusBuf = new uint8_t[Size];
-
-        //RTP Header informations.
-        uint16_t Seq = 0;
-        int Timestamp = 0;
-
-        //Needed for the calculation of the send timeout.
-        int64_t LastSendTime = GetTimeMillis();
-        float LastSpeechTime = MILLISECONDS;
+        m_Mixer->Clear();
+        StopStream();
+    }
 
-        std::mutex DataQueueLock;
-        std::queue<std::string> DataQueue;
-        std::atomic<bool> Terminate(false);
-        bool EncodingFinish = false;
+    /**
+     * @brief Stops the current stream. Keeps the mixed sources.
+     */
+    void CVoiceSocket::StopStream()
+    {
+        bool Playing;
+        VoiceStream Stream;
 
-        //Send logic.
-        auto SenderLambda = [this, &DataQueueLock, &DataQueue, &Terminate]() mutable
         {
-            while (!Terminate)
-            {
-                int64_t Before = GetTimeMillis();
-                std::queue<std::string> Queue;
-                {
-                    std::lock_guard<std::mutex> lock(DataQueueLock);
-                    std::swap( DataQueue, Queue );
-                }
-
-                while(!Queue.empty())
-                {
-                    auto Data = Queue.front();
-                    Queue.pop();
+            std::lock_guard<std::mutex> lock(m_StreamLock);
+            Playing = m_Source || m_Broadcast;
+            Stream = m_Stream;
 
-                    ssize_t Sended = 0;
-                    while (Sended < Data.size())
-                    {
-                        // llog << linfo << "Sended: " << Sended << lendl;
-                        ssize_t SendRet = m_UDPSocket.sendto(Data.substr(Sended));
-                        if(SendRet == -1)
-                            break;
+            m_Source = nullptr;
+            m_Broadcast = nullptr;
+            m_Stream = nullptr;
+        }
 
-                        Sended += SendRet;
-                    }
+        if(Stream)
+            CVoiceEngine::Get().Remove(Stream);
 
-                    int64_t Wait = GetTimeMillis() - Before;
-                    Wait = Wait < 0 ? MILLISECONDS : Wait;
-                    Before += MILLISECONDS;
+        SetSpeaking(false);
 
-                    std::this_thread::sleep_for(std::chrono::milliseconds(MILLISECONDS - Wait));
-                }
-            }
-        };
+        if(Playing)
+            m_Callback(m_GuildID);
+    }
 
-        std::thread Sender;
+    /**
+     * @brief Called from the voice engine if a stream has sent all of its audio.
+     */
+    void CVoiceSocket::OnStreamFinished(CVoiceStream *Stream)
+    {
+        bool Playing;
 
-        while (!m_Stop)
         {
-            //Pause the audio.
-            if(m_Pause)
-            {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                continue;
-            }
+            std::lock_guard<std::mutex> lock(m_StreamLock);
 
-            bool Wait = false;
+            //The stream was already replaced.
+            if(m_Stream.get() != Stream)
+                return;
 
-            {
-                std::lock_guard<std::mutex> lock(DataQueueLock);
-                if(DataQueue.size() >= PACKET_CACHE)
-                    Wait = true;
-            }
-
-            if(Wait)
-            {
-                if(!Sender.joinable())
-                    Sender = std::thread(SenderLambda);
-
-                std::this_thread::sleep_for(std::chrono::milliseconds(MILLISECONDS * 2));
-                continue;
-            }
-
-            if(!EncodingFinish)
-            {
-                uint32_t Ret = m_Source->OnRead(Buf, Size / 2);
-                opus_int32 OpusSize = opus_encode(Encoder, (opus_int16*)Buf, Size / 2, OpusBuf, Size);
-                if(OpusSize > 2)
-                {
-                    ++Seq;
-                    std::string Data(RTPHEADERSIZE + OpusSize + crypto_secretbox_MACBYTES, '\0');
-                    Data[0] = 0x80;
-                    Data[1] = 0x78;
-
-                    /*-------------------RTP HEADER-------------------*/
-
-                    uint16_t SeqBig = Seq;
-                    int TimestampBig = Timestamp;
-                    int SSRCBig = m_SSRC;
-
-                    if(IsLittleEndian())
-                    {
-                        SeqBig = ChangeEndianess(SeqBig);
-                        TimestampBig = ChangeEndianess(TimestampBig);
-                        SSRCBig = ChangeEndianess(SSRCBig);
-                    }
-                        
-                    //Copies the data to the buffer.
-                    char *BigC = (char *)&SeqBig;
-                    for (char i = 0; i < sizeof(uint16_t); i++)
-                        Data[i + 2] = BigC[i];
-
-                    BigC = (char *)&TimestampBig;
-                    for (char i = 0; i < sizeof(int); i++)
-                        Data[i + 4] = BigC[i];
-
-                    BigC = (char *)&SSRCBig;
-                    for (char i = 0; i < sizeof(int); i++)
-                        Data[i + 8] = BigC[i];
-
-                    /*-------------------RTP HEADER-------------------*/
-
-                    char Nonce[NONCESIZE];
-                    memcpy(Nonce, &Data[0], RTPHEADERSIZE);
-                    memset(Nonce + RTPHEADERSIZE, 0, RTPHEADERSIZE);
-
-                    Timestamp += Ret;
-
-                    //Encrypts the audio.
-                    crypto_secretbox_easy((uint8_t*)Data.data() + RTPHEADERSIZE, OpusBuf, OpusSize, (uint8_t*)Nonce, m_SecKey.data());
-
-                    {
-                        std::lock_guard<std::mutex> lock(DataQueueLock);
-                        DataQueue.push(Data);
-                    }
-                }
-                else if(OpusSize == -1)
-                {
-                    llog << lerror << "Error during encoding opus data." << lendl;
-                    break;
-                }  
-                else
-                    llog << linfo << "DTX" << lendl;
-
-                if(Ret < (Size / 2))
-                    EncodingFinish = true;  
-            }
-            else if(!Sender.joinable())
-                Sender = std::thread(SenderLambda);
-
-            {
-                std::lock_guard<std::mutex> lock(DataQueueLock);
-                if(DataQueue.empty())
-                {
-                    llog << linfo << "Finish playing. Seq: " << Seq << lendl;
-                    break;
-                }
-            }
+            Playing = m_Source || m_Broadcast;
+            m_Source = nullptr;
+            m_Broadcast = nullptr;
+            m_Stream = nullptr;
         }
 
-        delete[] Buf;
-        delete[] OpusBuf;
-
-        opus_encoder_destroy(Encoder);
-        SetSpeaking(false);
-
-        Terminate = true;
-        if(Sender.joinable())
-            Sender.join();
+        //A source was mixed after the stream had finished its encoding.
+        if(!m_Mixer->Empty())
+            StartSpeaking(nullptr);
+        else
+            SetSpeaking(false);
 
-        m_Callback(m_GuildID);
-        m_Source = nullptr;
+        //The end of the main source was already reported, if the mixer continued without it.
+        if(Playing)
+            m_Callback(m_GuildID);
     }
 
     /**
-     * @brief Handles async. Messages.
+     * @brief Informates Discord that the bot begins to speak or is finish with speaking.
      */
-    void CVoiceSocket::OnMessageReceive(MessageBase Msg)
+    void CVoiceSocket::SetSpeaking(bool Speak)
     {
-        switch (Msg->Event)
-        {
-            case RESUME:
-            {
-                m_Socket.start();
-            }break;
-        }
+        CJSON json;
+
+        if(Speak)
+            json.AddPair("speaking", 1);    //Speaks with microphone. See https://discord.com/developers/docs/topics/voice-connections#speaking
+        else
+            json.AddPair("speaking", 0);
+
+        json.AddPair("delay", 0);
+        json.AddPair("ssrc", m_SSRC);
+
+        SendOP(OPCodes::SPEAKING, json.Serialize());
     }
 
     /**
@@ -384,6 +325,7 @@ namespace DiscordBot
             case ix::WebSocketMessageType::Close:
             {
                 m_Terminate = true;
+                CTimerService::Get().Cancel(m_Heartbeat);
                 llog << linfo << "Websocket closed code " <<  msg->closeInfo.code << " Reason " <<  msg->closeInfo.reason << lendl;
             }break;
         
@@ -409,8 +351,16 @@ namespace DiscordBot
                         json.ParseObject(Pay.D);
                         m_SecKey = json.GetValue<std::vector<uint8_t>>("secret_key");
 
-                        if(m_Source)
-                            StartSpeaking(m_Source);
+                        AudioSource Source;
+                        AudioBroadcast Broadcast;
+                        {
+                            std::lock_guard<std::mutex> lock(m_StreamLock);
+                            Source = m_Source;
+                            Broadcast = m_Broadcast;
+                        }
+
+                        if(Source || Broadcast || !m_Mixer->Empty())
+                            Play(Source, Broadcast);
 
                         llog << linfo << "Voice channel connected" << lendl;
                     }break;
@@ -424,71 +374,19 @@ namespace DiscordBot
                             m_SSRC = json.GetValue<int>("ssrc");
 
                             std::string errmsg;
-                            if(!m_UDPSocket.init(json.GetValue<std::string>("ip"), json.GetValue<int>("port"), errmsg))
-                                llog << lerror << "Failed to create socket. " << errmsg << lendl;
+                            std::string IP = json.GetValue<std::string>("ip");
+                            if(!CVoiceEngine::Resolve(IP, json.GetValue<int>("port"), m_Server))
+                                llog << lerror << "Failed to resolve the voice server " << IP << lendl;
                             else
                             {
-                                uint8_t Packet[74] = {0};
-                                Packet[1] = 0x1;    //Type
-                                Packet[3] = 70;     //Length field
-
-                                int SSRCBig = m_SSRC;
-
-                                if(IsLittleEndian())
-                                    SSRCBig = ChangeEndianess(SSRCBig);
-
-                                char *SSRC = (char *)&SSRCBig;
-                                for (char i = 0; i < sizeof(int); i++)
-                                    Packet[i + 4] = SSRC[i];
-
-                                //Request IP discovery.
-                                m_UDPSocket.sendto(std::string((char*)Packet, sizeof(Packet)));  
-                                std::thread([this]() mutable
+                                //Request IP discovery. The audio must be sent from the discovered address.
+                                std::weak_ptr<CVoiceSocket> Weak = shared_from_this();
+                                CVoiceEngine::Get().Discover(m_SSRC, m_Server, [Weak](const std::string &IP, uint16_t Port)
                                 {
-                                    std::vector<uint8_t> Data(sizeof(Packet));
-
-                                    while (true)
-                                    {
-                                        ssize_t Ret = m_UDPSocket.recvfrom((char*)&Data[0], Data.size());
-                                        if(Ret > 0)
-                                        {
-                                            std::string IP; 
-                                            for (size_t i = 8; i < Data.size(); i++)
-                                            {
-                                                if(!Data[i])
-                                                    break;
-
-                                                IP += Data[i];
-                                            }
-
-                                            short Port;
-                                            char Shift = 8;
-
-                                            for (size_t i = 72; i < Data.size(); i++)
-                                            {
-                                                Port = (Data[i] << Shift);
-                                                Shift -= Shift;
-                                            }
-
-                                            CJSON json;
-                                            json.AddPair("address", IP);
-                                            json.AddPair("port", Port);
-                                            json.AddPair("mode", std::string("xsalsa20_poly1305"));
-
-                                            std::string JData = json.Serialize();
-
-                                            json.AddPair("protocol", std::string("udp"));
-                                            json.AddJSON("data", JData);
-
-                                            SendOP(OPCodes::SELECT_PROTOCOL, json.Serialize());
-                                            break;
-                                        }
-                                        else if(Ret < 0 && m_UDPSocket.isWaitNeeded())
-                                            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                                        else if(Ret < 0)
-                                            break;
-                                    }
-                                }).detach();          
+                                    VoiceSocket Socket = Weak.lock();
+                                    if(Socket)
+                                        Socket->OnDiscovered(IP, Port);
+                                });
                             }
                         }
                         catch(const CJSONException& e)
@@ -535,10 +433,8 @@ namespace DiscordBot
                         m_HeartACKReceived = true;
                         m_Terminate = false;
 
-                        if(m_Heartbeat.joinable())
-                            m_Heartbeat.join();
-
-                        m_Heartbeat = std::thread(&CVoiceSocket::Heartbeat, this);
+                        CTimerService::Get().Cancel(m_Heartbeat);
+                        m_Heartbeat = CTimerService::Get().Schedule(0, std::bind(&CVoiceSocket::Heartbeat, this), m_HeartbeatInterval);
                     }break;
 
                     case OPCodes::HEARTBEAT_ACK:
@@ -551,41 +447,87 @@ namespace DiscordBot
     }
 
     /**
-     * @brief Sends a heartbeat.
+     * @brief Sends a heartbeat. Called from the timer service.
      */
     void CVoiceSocket::Heartbeat()
     {
-        while (!m_Terminate)
+        if(m_Terminate)
+            return;
+
+        //Start a reconnect.
+        if(!m_HeartACKReceived)
         {
-            //Start a reconnect.
-            if(!m_HeartACKReceived)
-            {
-                m_Reconnect = true;
-                m_Socket.stop();
-                m_Terminate = true;
+            m_Reconnect = true;
+            m_Terminate = true;
+            CTimerService::Get().Cancel(m_Heartbeat);
+
+            //Closing the socket blocks, so the timer thread only reports the lost connection.
+            llog << linfo << "Voice heartbeat not acknowledged Guild: " << m_GuildID << lendl;
+            if(m_OnConnectionLost)
+                m_OnConnectionLost(m_GuildID);
+
+            return;
+        }
+
+        SendOP(OPCodes::HEARTBEAT, "5");
+        m_HeartACKReceived = false;
+    }
+
+    /**
+     * @brief Selects the udp protocol with the external address of the voice engine.
+     */
+    void CVoiceSocket::OnDiscovered(const std::string &IP, uint16_t Port)
+    {
+        if(IP.empty())
+        {
+            llog << lerror << "IP discovery timed out" << lendl;
+            return;
+        }
 
-                m_EVManager.PostMessage(RESUME, 0, 100);
-                break;
-            }
+        CJSON json;
+        json.AddPair("address", IP);
+        json.AddPair("port", Port);
+        json.AddPair("mode", std::string("xsalsa20_poly1305"));
+
+        std::string JData = json.Serialize();
+
+        json.AddPair("protocol", std::string("udp"));
+        json.AddJSON("data", JData);
+
+        SendOP(OPCodes::SELECT_PROTOCOL, json.Serialize());
+    }
 
-            SendOP(OPCodes::HEARTBEAT, "5");
-            m_HeartACKReceived = false;
+    /**
+     * @brief Called from the voice engine if a stream continued with its next source.
+     */
+    void CVoiceSocket::OnStreamSwitched(CVoiceStream *Stream)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_StreamLock);
+            if(m_Stream.get() != Stream)
+                return;
 
-            //Terminateable timeout.
-            int64_t Beg = GetTimeMillis();
-            while (((GetTimeMillis() - Beg) < m_HeartbeatInterval) && !m_Terminate)
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            m_Source = m_Stream->GetAudioSource();
+            m_Broadcast = nullptr;
         }
+
+        //The old source is finished, the new one is already playing.
+        m_Callback(m_GuildID);
+    }
+
+    void CVoiceSocket::Resume()
+    {
+        m_Reconnect = true;
+        m_Socket.stop();
+        m_Socket.start();
     }
 
     CVoiceSocket::~CVoiceSocket()
     {
         StopSpeaking();
         m_Terminate = true;
-        if(m_Heartbeat.joinable())
-            m_Heartbeat.join();
+        CTimerService::Get().Cancel(m_Heartbeat, true);
 
-        m_UDPSocket.close();
         m_Socket.stop();
     }
 } // namespace DiscordBot
@@ -27,20 +27,23 @@
 
 #include <JSON.hpp>
 #include <controller/IAudioSource.hpp>
+#include <models/EncoderProfile.hpp>
 #include <ixwebsocket/IXWebSocket.h>
 #include <ixwebsocket/IXNetSystem.h>
-#include <ixwebsocket/IXUdpSocket.h>
 #include <atomic>
-#include "MessageManager.hpp"
+#include <mutex>
+#include "../helpers/JSONView.hpp"
+#include "TimerService.hpp"
+#include "VoiceEngine.hpp"
 
 namespace DiscordBot
 {    
     using OnStopSpeaking = std::function<void(const std::string&)>;
 
     /**
-     * @brief Manages all voice events. Also encode and encrypts audio. 
+     * @brief Manages all voice events. The audio is encoded and encrypted by the voice engine.
      */
-    class CVoiceSocket
+    class CVoiceSocket : public std::enable_shared_from_this<CVoiceSocket>
     {
         public:
             //All informations from https://discordapp.com/developers/docs/topics/opcodes-and-status-codes#voice
@@ -60,12 +63,14 @@ namespace DiscordBot
                 CLIENT_DISCONNECT       = 13        //server            A client has disconnected from the voice channel
             };
 
+            static const uint32_t RESUME_DELAY = 100;          //!< Milliseconds between a lost connection and the resume.
+
             /**
              * @param json: JSON from VOICE_SERVER_UPDATE event,
              * @param SessionID: Session ID of the bot voice state.
              * @param ClientID: Bot client ID.
              */
-            CVoiceSocket(CJSON &json, const std::string &SessionID, const std::string &ClientID);
+            CVoiceSocket(const CJSONValue &json, const std::string &SessionID, const std::string &ClientID);
 
             /**
              * @brief Sets the callback which is called if the audio source finished.
@@ -76,12 +81,83 @@ namespace DiscordBot
             }
 
             /**
-             * @brief Starts a new audio stream. Stops the old one.
+             * @brief Sets the callback which is called from the timer service if the heartbeat isn't acknowledged.
+             * The callback must not block and should call Resume() from another thread.
+             */
+            void SetOnConnectionLost(OnStopSpeaking call)
+            {
+                m_OnConnectionLost = call;
+            }
+
+            /**
+             * @brief Closes the websocket and resumes the voice session. Blocks until the old connection is closed.
+             */
+            void Resume();
+
+            /**
+             * @brief Sets the number of frames which are encoded before the first packet is sent. Used by the next StartSpeaking().
+             */
+            void SetPreBuffer(uint32_t Frames)
+            {
+                m_PreBuffer = Frames;
+            }
+
+            /**
+             * @brief Sets the settings of the encoder. Used by the next StartSpeaking().
+             */
+            void SetEncoderProfile(EncoderProfile Profile)
+            {
+                std::lock_guard<std::mutex> lock(m_StreamLock);
+                m_Profile = Profile;
+            }
+
+            /**
+             * @brief Starts a new audio stream. Stops the old one. Returns immediately, the stream is sent by the voice engine.
+             * The mixed sources continue in the new stream.
              * 
-             * @param Source: Audiosource which is send to discord.
+             * @param Source: Audiosource which is send to discord. Null if only the mixed sources should play.
              */
             void StartSpeaking(AudioSource Source);
 
+            /**
+             * @brief Starts to play a broadcast. Stops the old stream. The frames of the broadcast are only encrypted for this connection.
+             */
+            void StartBroadcast(AudioBroadcast Broadcast);
+
+            /**
+             * @brief Mixes a source over the current audio, with the same encoder. Starts a stream if nothing is playing.
+             * 
+             * @param Gain: Value between 0.0 and 1.0.
+             */
+            void MixSource(AudioSource Source, float Gain);
+
+            /**
+             * @brief Changes the gain of a mixed source.
+             * 
+             * @return Returns false if the source isn't mixed.
+             */
+            bool SetMixGain(AudioSource Source, float Gain)
+            {
+                return m_Mixer->SetGain(Source, Gain);
+            }
+
+            /**
+             * @brief Removes a mixed source.
+             * 
+             * @return Returns false if the source isn't mixed.
+             */
+            bool RemoveMixSource(AudioSource Source)
+            {
+                return m_Mixer->Remove(Source);
+            }
+
+            /**
+             * @brief Sets the source which follows the current one without a gap. Raises a OnSpeakFinish event if the current source ends.
+             * 
+             * @return Returns false if nothing is playing.
+             */
+            bool SetNextSource(AudioSource Source);
+
             /**
              * @brief Pause the sending of audio.
              */
@@ -93,7 +169,7 @@ namespace DiscordBot
             void ResumeSpeaking();
 
             /**
-             * @brief Stops the sending of audio. Raise a OnSpeakFinish event.
+             * @brief Stops the sending of audio and removes all mixed sources. Raise a OnSpeakFinish event.
              */
             void StopSpeaking();
 
@@ -102,53 +178,49 @@ namespace DiscordBot
              */
             AudioSource GetAudioSource()
             {
+                std::lock_guard<std::mutex> lock(m_StreamLock);
                 return m_Source;
             }
 
-            ~CVoiceSocket();
-        private:
-            static const int FREQUENCY = 48000;     //!< Supported sample rate of Discord.
-            static const int CHANNEL = 2;           //!< Supported channel count of Discord.
-            static const int MILLISECONDS = 20;     //!< Time of samples wich will be send.
-            static const int RTPHEADERSIZE = 12;    //!< Size of the rtp header.
-            static const int NONCESIZE = RTPHEADERSIZE * 2; //!< Size of the key salt.
-            static const int PACKET_CACHE = 1000 / MILLISECONDS;    //!< Cache Packets for 1 second.
-
-            enum
+            /**
+             * @return Gets the pacing statistics of all audio which was sent over this connection.
+             */
+            CVoiceConnectionStats GetStats()
             {
-                RESUME
-            };
+                return m_Pacing->GetStats();
+            }
 
-            CMessageManager m_EVManager;
+            ~CVoiceSocket();
+        private:
             OnStopSpeaking m_Callback;
+            OnStopSpeaking m_OnConnectionLost;
 
             std::string m_Token;
             std::string m_ClientID;
             std::string m_GuildID;
             ix::WebSocket m_Socket;
-            ix::UdpSocket m_UDPSocket;
-            std::thread m_Heartbeat;
+            CVoiceEngine::SAddress m_Server;
+            std::atomic<CTimerService::TimerID> m_Heartbeat;
             std::atomic<bool> m_Terminate;
             std::atomic<bool> m_HeartACKReceived;
             uint32_t m_HeartbeatInterval;
             std::atomic<uint32_t> m_LastSeqNum;
             std::string m_SessionID;
 
+            std::mutex m_StreamLock;
             AudioSource m_Source;
-            std::atomic<bool> m_Stop;
-            std::atomic<bool> m_Pause;
+            AudioBroadcast m_Broadcast;
+            VoiceStream m_Stream;
+            VoicePacing m_Pacing;
+            AudioMixer m_Mixer;
+            EncoderProfile m_Profile;
+            std::atomic<uint32_t> m_PreBuffer;
             std::atomic<bool> m_Reconnect;
-            std::thread m_Playback;
 
             std::vector<uint8_t> m_SecKey;
 
             uint32_t m_SSRC;
 
-            /**
-             * @brief Handles async. Messages.
-             */
-            void OnMessageReceive(MessageBase Msg);
-
             /**
              * @brief Builds and sends a payload object.
              */
@@ -160,14 +232,34 @@ namespace DiscordBot
             void OnWebsocketEvent(const ix::WebSocketMessagePtr& msg);
 
             /**
-             * @brief Sends a heartbeat.
+             * @brief Sends a heartbeat. Called from the timer service every heartbeat interval.
              */
             void Heartbeat();
 
             /**
-             * @brief Encode, encrypt and send audio data.
+             * @brief Selects the udp protocol with the external address of the voice engine.
+             */
+            void OnDiscovered(const std::string &IP, uint16_t Port);
+
+            /**
+             * @brief Starts a new stream of either the source or the broadcast.
+             */
+            void Play(AudioSource Source, AudioBroadcast Broadcast);
+
+            /**
+             * @brief Stops the current stream. Keeps the mixed sources.
+             */
+            void StopStream();
+
+            /**
+             * @brief Called from the voice engine if a stream has sent all of its audio.
+             */
+            void OnStreamFinished(CVoiceStream *Stream);
+
+            /**
+             * @brief Called from the voice engine if a stream continued with its next source.
              */
-            void Playback();
+            void OnStreamSwitched(CVoiceStream *Stream);
 
             /**
              * @brief Informates Discord that the bot begins to speak or is finish with speaking.
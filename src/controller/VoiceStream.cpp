@@ -0,0 +1,404 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "VoiceStream.hpp"
+#include <Log.hpp>
+#include <opus.h>
+#include <sodium.h>
+#include <string.h>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include "../helpers/Helper.hpp"
+#include "../helpers/AudioKernels.hpp"
+
+namespace DiscordBot
+{
+    const int CVoiceStream::MILLISECONDS;
+    const uint32_t CVoiceStream::MAX_PREBUFFER;
+    const uint32_t CVoiceStream::MAX_BUFFER;
+    const uint32_t CVoiceStream::SILENCE_FRAMES;
+    const uint16_t CVoiceStream::SILENCE_PEAK;
+    const uint8_t CVoiceStream::SILENCE_FRAME[3] = {0xF8, 0xFF, 0xFE};
+    static_assert(CVoiceStream::MACSIZE == crypto_secretbox_MACBYTES, "Unexpected size of the authentication tag");
+
+    CVoiceStream::CVoiceStream(AudioSource Source, uint32_t SSRC, const std::vector<uint8_t> &Key, uint32_t PreBuffer, AudioMixer Mixer, EncoderProfile Profile) : m_Source(Source), m_Switched(false), m_BroadcastFrame(0), m_Prerolled(false), m_CarryPos(0), m_CarrySize(0), m_CarryEnd(false), m_SSRC(SSRC), m_SecKey(Key), m_Stop(false), m_Pause(false), m_Encoder(nullptr), m_Mono(false), m_SilentPCM(0), m_Mixer(Mixer), m_Seq(0), m_Timestamp(0), m_SilentFrames(0), m_EncodingFinished(false), m_Started(false), m_EncodeAvgUS(0), m_EncodeDevUS(0)
+    {
+        m_PreBuffer = std::min(std::max(PreBuffer, 1u), MAX_PREBUFFER);
+        m_Depth = m_PreBuffer;
+
+        //Reserve buffer size for 20 ms.
+        m_PCM.resize(FREQUENCY * CHANNEL * MILLISECONDS / 1000);
+        m_Carry.resize(m_PCM.size());
+
+        //The SSRC never changes, so only the first 8 bytes of the header are written per packet.
+        uint32_t SSRCBig = IsLittleEndian() ? (uint32_t)ChangeEndianess((int)m_SSRC) : m_SSRC;
+        for (size_t i = 0; i < RING_SIZE; i++)
+            memcpy(m_Packets.At(i).Data + 8, &SSRCBig, sizeof(SSRCBig));
+
+        m_Encoder = CreateEncoder(Profile);
+    }
+
+    CVoiceStream::CVoiceStream(AudioBroadcast Broadcast, uint32_t SSRC, const std::vector<uint8_t> &Key, uint32_t PreBuffer, AudioMixer Mixer, EncoderProfile Profile) : CVoiceStream(AudioSource(), SSRC, Key, PreBuffer, Mixer, Profile)
+    {
+        m_Broadcast = Broadcast;
+        m_BroadcastFrame = m_Broadcast->Join(m_PreBuffer);
+    }
+
+    OpusEncoder *CVoiceStream::CreateEncoder(const EncoderProfile &Profile)
+    {
+        CEncoderProfile Settings;
+        if(Profile)
+            Settings = *Profile;
+
+        int Application = OPUS_APPLICATION_AUDIO;
+        switch (Settings.Application)
+        {
+            case EncoderApplication::VOIP: Application = OPUS_APPLICATION_VOIP; break;
+            case EncoderApplication::LOWDELAY: Application = OPUS_APPLICATION_RESTRICTED_LOWDELAY; break;
+            default: break;
+        }
+
+        int err;
+        OpusEncoder *Encoder = opus_encoder_create(FREQUENCY, CHANNEL, Application, &err);
+        if(err)
+        {
+            llog << lerror << "Error to create opus encoder" << lendl;
+            return nullptr;
+        }
+
+        if(Settings.Bitrate != 0)
+            opus_encoder_ctl(Encoder, OPUS_SET_BITRATE(std::min<uint32_t>(std::max<uint32_t>(Settings.Bitrate, 500), 512000)));
+
+        opus_encoder_ctl(Encoder, OPUS_SET_COMPLEXITY(std::min<uint32_t>(Settings.Complexity, 10)));
+        opus_encoder_ctl(Encoder, OPUS_SET_PACKET_LOSS_PERC(std::min<uint32_t>(Settings.PacketLossPerc, 100)));
+        opus_encoder_ctl(Encoder, OPUS_SET_INBAND_FEC(Settings.FEC ? 1 : 0));
+        opus_encoder_ctl(Encoder, OPUS_SET_DTX(Settings.DTX ? 1 : 0));
+        opus_encoder_ctl(Encoder, OPUS_SET_VBR(Settings.VBR ? 1 : 0));
+
+        return Encoder;
+    }
+
+    int32_t CVoiceStream::EncodeFrame(OpusEncoder *Encoder, const uint16_t *PCM, uint32_t Samples, uint8_t *Out, uint32_t Size, bool &Mono, uint32_t &SilentFrames)
+    {
+        if(CAudioKernels::PeakLevel((const int16_t*)PCM, Samples * CHANNEL) <= SILENCE_PEAK)
+        {
+            if(SilentFrames > SILENCE_FRAMES)
+                return 0;
+
+            //The next audio starts with a fresh encoder, like the decoder after the silence frames.
+            if(++SilentFrames > SILENCE_FRAMES)
+            {
+                opus_encoder_ctl(Encoder, OPUS_RESET_STATE);
+                return 0;
+            }
+        }
+        else
+            SilentFrames = 0;
+
+        //Mono sources are encoded as mono, which needs less cpu time and bitrate.
+        bool IsMono = CAudioKernels::IsDualMono((const int16_t*)PCM, Samples);
+        if(IsMono != Mono)
+        {
+            opus_encoder_ctl(Encoder, OPUS_SET_FORCE_CHANNELS(IsMono ? 1 : OPUS_AUTO));
+            Mono = IsMono;
+        }
+
+        return opus_encode(Encoder, (const opus_int16*)PCM, Samples, Out, Size);
+    }
+
+    /**
+     * @brief Fills the buffer for the next ticks. Called every 20 ms by the voice engine after the packets of the tick are sent.
+     */
+    bool CVoiceStream::Tick()
+    {
+        if(m_Stop || !m_Encoder)
+            return false;
+
+        if(m_Pause)
+            return true;
+
+        if(!m_Prepared)
+        {
+            std::lock_guard<std::mutex> lock(m_SourceLock);
+            m_Prepared = std::move(m_NextSource);
+        }
+
+        //The carry buffer is free after the pre-rolled frame of the last switch is consumed.
+        if(m_Prepared && !m_Prerolled && m_CarryPos == m_CarrySize)
+            Preroll();
+
+        while (!m_EncodingFinished && m_Packets.Size() < m_Depth)
+        {
+            auto Start = std::chrono::steady_clock::now();
+            if(!Encode())
+                return false;
+
+            UpdateDepth(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - Start).count());
+        }
+
+        //The first packet is sent in the next tick.
+        if(!m_Started && (m_Packets.Size() >= m_PreBuffer || m_EncodingFinished))
+            m_Started = true;
+
+        if(m_EncodingFinished && m_Packets.Size() == 0)
+        {
+            llog << linfo << "Finish playing. Seq: " << m_Seq << lendl;
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Adapts the buffer depth to the encoding time of the last frame.
+     */
+    void CVoiceStream::UpdateDepth(int64_t EncodeUS)
+    {
+        //Same smoothing as the retransmission timeout of TCP.
+        double Diff = EncodeUS - m_EncodeAvgUS;
+        m_EncodeAvgUS += Diff / 8.0;
+        m_EncodeDevUS += (std::fabs(Diff) - m_EncodeDevUS) / 4.0;
+
+        //A frame must be ready one tick before it's due, slower encodes need more frames ahead.
+        uint32_t Needed = (uint32_t)std::ceil((m_EncodeAvgUS + 4 * m_EncodeDevUS) / (MILLISECONDS * 1000));
+        m_Depth = std::min(std::max(Needed, m_PreBuffer), MAX_BUFFER);
+    }
+
+    /**
+     * @brief Reads, encodes and encrypts one frame into the packet cache.
+     */
+    bool CVoiceStream::Encode()
+    {
+        SPacket *Packet = m_Packets.Back();
+        if(!Packet)
+            return true;
+
+        uint32_t Samples = m_PCM.size() / CHANNEL;
+        bool Mixing = m_Mixer && !m_Mixer->Empty();
+
+        //The opus frame is written behind the tag, so it can be encrypted in place.
+        uint8_t *Payload = Packet->Data + RTPHEADERSIZE;
+        opus_int32 OpusSize = 0;
+        uint32_t Ret = 0;
+        bool Passthrough = false;
+
+        //A broadcast frame is encoded once for all connections. Only mixed sources need an own encoding.
+        if(m_Broadcast)
+            Ret = m_Broadcast->Read(m_BroadcastFrame, Payload + MACSIZE, OpusSize, Mixing ? m_PCM.data() : nullptr);
+        else if(m_Source)
+        {
+            //Pre-encoded packets are sent as they are, if nothing is mixed and no pre-rolled samples are left.
+            IOpusAudioSource *Opus = nullptr;
+            if(!Mixing && (m_Prerolled || (m_CarryPos == m_CarrySize && !m_CarryEnd)))
+                Opus = dynamic_cast<IOpusAudioSource*>(m_Source.get());
+
+            int32_t Size = Opus ? Opus->ReadPacket(Payload + MACSIZE, MAX_OPUS_SIZE) : -1;
+            if(Size > 0)
+            {
+                OpusSize = Size;
+                Ret = Samples;
+                Passthrough = true;
+            }
+            else
+                Ret = Read(m_PCM.data(), Samples);
+        }
+
+        if(!Passthrough && (!m_Broadcast || Mixing))
+        {
+            //The mixer and the encoder need silence after the end of the source.
+            if(Ret < Samples)
+                memset(m_PCM.data() + Ret * CHANNEL, 0, (Samples - Ret) * CHANNEL * sizeof(uint16_t));
+
+            if(Mixing)
+            {
+                uint32_t Mixed = m_Mixer->Mix(m_PCM.data(), Samples);
+
+                //The mixed sources continue alone, the owner is informed like for a switch.
+                if((m_Source || m_Broadcast) && Ret < Samples && Mixed == Samples)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(m_SourceLock);
+                        m_Source = nullptr;
+                    }
+
+                    m_Broadcast = nullptr;
+                    m_Switched = true;
+                }
+
+                Ret = std::max(Ret, Mixed);
+            }
+
+            //The empty frame after the end isn't sent.
+            OpusSize = Ret > 0 ? EncodeFrame(m_Encoder, m_PCM.data(), Samples, Payload + MACSIZE, MAX_OPUS_SIZE, m_Mono, m_SilentPCM) : 0;
+        }
+
+        if(OpusSize < 0)
+        {
+            llog << lerror << "Error during encoding opus data." << lendl;
+            return false;
+        }
+
+        //Silence and dtx frames are replaced by five silence frames, afterwards nothing is sent until the audio resumes.
+        bool Silence = OpusSize <= 2 || (OpusSize == sizeof(SILENCE_FRAME) && memcmp(Payload + MACSIZE, SILENCE_FRAME, sizeof(SILENCE_FRAME)) == 0);
+        if(Silence)
+        {
+            OpusSize = 0;
+            if(Ret > 0 && m_SilentFrames < SILENCE_FRAMES)
+            {
+                memcpy(Payload + MACSIZE, SILENCE_FRAME, sizeof(SILENCE_FRAME));
+                OpusSize = sizeof(SILENCE_FRAME);
+            }
+
+            m_SilentFrames = std::min(m_SilentFrames + 1, SILENCE_FRAMES);
+        }
+        else
+            m_SilentFrames = 0;
+
+        if(OpusSize > 0)
+        {
+            ++m_Seq;
+
+            //Version 2, payload type 120, sequence and timestamp with one store.
+            uint64_t Header = (0x80ull << 56) | (0x78ull << 48) | ((uint64_t)m_Seq << 32) | m_Timestamp;
+            if(IsLittleEndian())
+                Header = ChangeEndianess(Header);
+
+            memcpy(Packet->Data, &Header, sizeof(Header));
+
+            uint8_t Nonce[NONCESIZE] = {0};
+            memcpy(Nonce, Packet->Data, RTPHEADERSIZE);
+
+            m_Timestamp += Ret;
+
+            //Encrypts the audio, libsodium allows overlapping buffers.
+            crypto_secretbox_easy(Payload, Payload + MACSIZE, OpusSize, Nonce, m_SecKey.data());
+
+            Packet->Size = RTPHEADERSIZE + MACSIZE + OpusSize;
+            m_Packets.Push();
+        }
+        else if(Ret > 0)
+        {
+            //The frame is skipped, but its time passes.
+            m_Timestamp += Ret;
+
+            Packet->Size = 0;
+            m_Packets.Push();
+        }
+
+        if(Ret < Samples)
+            m_EncodingFinished = true;
+
+        return true;
+    }
+
+    /**
+     * @brief Reads a frame. Continues with the next source if the current one ends.
+     */
+    uint32_t CVoiceStream::Read(uint16_t *Buf, uint32_t Samples)
+    {
+        uint32_t Got = 0;
+
+        while (Got < Samples)
+        {
+            uint32_t Want = Samples - Got;
+
+            //Pre-rolled samples of the current source come first. Until the switch, the carry buffer belongs to the next source.
+            if(!m_Prerolled && m_CarryPos < m_CarrySize)
+            {
+                uint32_t Count = std::min(Want, m_CarrySize - m_CarryPos);
+                memcpy(Buf + Got * CHANNEL, m_Carry.data() + m_CarryPos * CHANNEL, Count * CHANNEL * sizeof(uint16_t));
+
+                m_CarryPos += Count;
+                Got += Count;
+
+                if(m_CarryPos < m_CarrySize || !m_CarryEnd)
+                    continue;
+            }
+            else
+            {
+                //A source which already ended inside its pre-rolled frame isn't read again.
+                uint32_t Ret = (!m_Prerolled && m_CarryEnd) ? 0 : m_Source->OnRead(Buf + Got * CHANNEL, Want);
+                Got += Ret;
+
+                if(Ret == Want)
+                    break;
+            }
+
+            //The current source is finished, the next one fills the rest of the frame.
+            if(!SwitchSource())
+                break;
+        }
+
+        return Got;
+    }
+
+    /**
+     * @brief Reads the first frame of the next source into the carry buffer.
+     */
+    void CVoiceStream::Preroll()
+    {
+        uint32_t Samples = m_Carry.size() / CHANNEL;
+
+        m_CarrySize = m_Prepared->OnRead(m_Carry.data(), Samples);
+        m_CarryPos = 0;
+        m_CarryEnd = m_CarrySize < Samples;
+        m_Prerolled = true;
+    }
+
+    /**
+     * @brief Makes the next source the current one.
+     */
+    bool CVoiceStream::SwitchSource()
+    {
+        if(!m_Prepared)
+        {
+            std::lock_guard<std::mutex> lock(m_SourceLock);
+            m_Prepared = std::move(m_NextSource);
+        }
+
+        if(!m_Prepared)
+            return false;
+
+        //Sources which were set during this tick aren't pre-rolled yet.
+        if(!m_Prerolled)
+            Preroll();
+
+        {
+            std::lock_guard<std::mutex> lock(m_SourceLock);
+            m_Source = std::move(m_Prepared);
+        }
+
+        m_Prepared = nullptr;
+        m_Prerolled = false;
+        m_Switched = true;
+        return true;
+    }
+
+    CVoiceStream::~CVoiceStream()
+    {
+        if(m_Encoder)
+            opus_encoder_destroy(m_Encoder);
+    }
+} // namespace DiscordBot
@@ -0,0 +1,284 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef VOICESTREAM_HPP
+#define VOICESTREAM_HPP
+
+#include <controller/IAudioSource.hpp>
+#include <controller/AudioBroadcast.hpp>
+#include <controller/IOpusAudioSource.hpp>
+#include <models/EncoderProfile.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+#include "../helpers/SPSCRing.hpp"
+#include "AudioMixer.hpp"
+
+struct OpusEncoder;
+
+namespace DiscordBot
+{
+    /**
+     * @brief Playback state of one voice connection. Encodes and encrypts one audio frame per tick of the voice engine.
+     * 
+     * @note Ticks of one stream never run in parallel, so the encoding state needs no lock. The packets are passed to the sending thread of the engine
+     * through a ring of preallocated slots, so the steady state doesn't allocate.
+     */
+    class CVoiceStream
+    {
+        public:
+            static const int FREQUENCY = 48000;     //!< Supported sample rate of Discord.
+            static const int CHANNEL = 2;           //!< Supported channel count of Discord.
+            static const int MILLISECONDS = 20;     //!< Time of samples wich will be send.
+            static const int RTPHEADERSIZE = 12;    //!< Size of the rtp header.
+            static const int MACSIZE = 16;          //!< Size of the authentication tag of crypto_secretbox.
+            static const int MAX_OPUS_SIZE = 1275;  //!< Max size of an opus frame.
+            static const int MAX_PACKET_SIZE = RTPHEADERSIZE + MACSIZE + MAX_OPUS_SIZE;
+
+            struct SPacket
+            {
+                uint16_t Size;
+                uint8_t Data[MAX_PACKET_SIZE];
+            };
+
+            static const uint32_t MAX_PREBUFFER = 3;    //!< Max frames which are encoded before the first packet is sent.
+            static const uint32_t SILENCE_FRAMES = 5;   //!< Silence frames which are sent before the transmission pauses.
+            static const uint16_t SILENCE_PEAK = 8;     //!< Frames up to this peak level are digital silence. Only the first SILENCE_FRAMES are encoded.
+            static const uint8_t SILENCE_FRAME[3];      //!< Opus frame of silence, which Discord expects before a pause of the transmission.
+
+            /**
+             * @param Source: Audiosource which is send to discord. May be null if only the mixer plays.
+             * @param SSRC: SSRC of the voice connection.
+             * @param Key: Secret key from the session description.
+             * @param PreBuffer: Frames to encode before the first packet is sent. Between 1 and MAX_PREBUFFER.
+             * @param Mixer: Sources which are mixed over the main source, may be null. The stream plays until the main source and the mixer are finished.
+             * @param Profile: Settings of the encoder. Null uses the defaults of CEncoderProfile with the opus default bitrate.
+             */
+            CVoiceStream(AudioSource Source, uint32_t SSRC, const std::vector<uint8_t> &Key, uint32_t PreBuffer, AudioMixer Mixer = nullptr, EncoderProfile Profile = nullptr);
+
+            /**
+             * @brief Plays a broadcast. The stream only adds the rtp header and the encryption to the frames of the broadcast, unless the mixer plays.
+             * 
+             * @param Broadcast: Broadcast which is joined live.
+             */
+            CVoiceStream(AudioBroadcast Broadcast, uint32_t SSRC, const std::vector<uint8_t> &Key, uint32_t PreBuffer, AudioMixer Mixer = nullptr, EncoderProfile Profile = nullptr);
+
+            /**
+             * @brief Creates an encoder for 48 kHz stereo with the settings of the profile.
+             * 
+             * @param Profile: Settings of the encoder. Null uses the defaults of CEncoderProfile.
+             * 
+             * @return Returns null on error. Free the encoder with opus_encoder_destroy.
+             */
+            static OpusEncoder *CreateEncoder(const EncoderProfile &Profile);
+
+            /**
+             * @brief Encodes a stereo frame. Mono frames are encoded as mono. Silence is encoded like audio for SILENCE_FRAMES frames in a row,
+             * so short pauses keep the state of the encoder. Afterwards the encoder is reset and nothing is encoded until the audio resumes.
+             * 
+             * @param Mono: State of the encoder, true if it's forced to mono packets. Starts with false.
+             * @param SilentFrames: State of the encoder, silent frames in a row. Starts with 0.
+             * 
+             * @return Returns the size of the opus frame, 0 during a longer silence, negative on an encoder error.
+             */
+            static int32_t EncodeFrame(OpusEncoder *Encoder, const uint16_t *PCM, uint32_t Samples, uint8_t *Out, uint32_t Size, bool &Mono, uint32_t &SilentFrames);
+
+            /**
+             * @brief Fills the buffer for the next ticks. Called every 20 ms by the voice engine after the packets of the tick are sent.
+             * 
+             * @return Returns false if the source is finished and all packets are sent, or if the stream was stopped.
+             */
+            bool Tick();
+
+            /**
+             * @brief Sender only. Gets the packet which is due in this tick.
+             * 
+             * @return Returns null if the stream is paused, still buffering, empty or pauses the transmission during silence.
+             */
+            const SPacket *GetPacket()
+            {
+                if(!m_Started || m_Pause)
+                    return nullptr;
+
+                //Slots without a packet keep the pace during silence.
+                const SPacket *Packet = m_Packets.Front();
+                if(Packet && Packet->Size == 0)
+                {
+                    m_Packets.Pop();
+                    return nullptr;
+                }
+
+                return Packet;
+            }
+
+            /**
+             * @brief Sender only. Releases the packet of GetPacket().
+             */
+            void PopPacket()
+            {
+                m_Packets.Pop();
+            }
+
+            /**
+             * @return Gets the current buffer depth in frames, which adapts to the jitter of the encoding time.
+             */
+            uint32_t GetBufferDepth() const
+            {
+                return m_Depth;
+            }
+
+            /**
+             * @brief Pauses or resumes the stream.
+             */
+            void SetPause(bool Pause)
+            {
+                m_Pause = Pause;
+            }
+
+            /**
+             * @brief Stops the stream. The next tick returns false.
+             */
+            void Stop()
+            {
+                m_Stop = true;
+            }
+
+            /**
+             * @return Gets the source which is currently playing.
+             */
+            AudioSource GetAudioSource()
+            {
+                std::lock_guard<std::mutex> lock(m_SourceLock);
+                return m_Source;
+            }
+
+            /**
+             * @brief Sets the source which follows the current one. The stream pre-rolls its first frame in the background
+             * and switches inside the frame in which the current source ends, so there is no gap. The encoder and the rtp state are kept.
+             * 
+             * @note Replaces a next source which is not yet playing.
+             */
+            void SetNextSource(AudioSource Source)
+            {
+                std::lock_guard<std::mutex> lock(m_SourceLock);
+                m_NextSource = Source;
+            }
+
+            /**
+             * @return Returns true once after the stream switched to the next source, or after the main source ended while the mixer continues.
+             */
+            bool TakeSwitched()
+            {
+                return m_Switched.exchange(false);
+            }
+
+            ~CVoiceStream();
+
+        private:
+            static const int NONCESIZE = RTPHEADERSIZE * 2; //!< Size of the key salt.
+            static const uint32_t MAX_BUFFER = 1000 / MILLISECONDS;    //!< Buffers at most 1 second.
+            static const size_t RING_SIZE = 64;     //!< Must be larger than the max buffer.
+
+            std::mutex m_SourceLock;
+            AudioSource m_Source;
+            AudioSource m_NextSource;
+            std::atomic<bool> m_Switched;
+
+            AudioBroadcast m_Broadcast;
+            uint64_t m_BroadcastFrame;  //!< Next frame of the broadcast.
+
+            //Next source, owned by the encoding thread. Its first frame is pre-rolled into the carry buffer.
+            AudioSource m_Prepared;
+            bool m_Prerolled;   //!< The carry buffer holds the first frame of m_Prepared. Otherwise it holds the rest of the current source's first frame.
+            std::vector<uint16_t> m_Carry;
+            uint32_t m_CarryPos;
+            uint32_t m_CarrySize;
+            bool m_CarryEnd;    //!< The source ended inside the carry buffer.
+
+            uint32_t m_SSRC;
+            std::vector<uint8_t> m_SecKey;
+
+            std::atomic<bool> m_Stop;
+            std::atomic<bool> m_Pause;
+
+            OpusEncoder *m_Encoder;
+            bool m_Mono;    //!< The encoder is forced to mono packets.
+            uint32_t m_SilentPCM;   //!< Silent frames in a row, which were passed to the encoder.
+            std::vector<uint16_t> m_PCM;
+            AudioMixer m_Mixer;
+
+            //RTP Header informations.
+            uint16_t m_Seq;
+            uint32_t m_Timestamp;
+            uint32_t m_SilentFrames;    //!< Silent packets in a row.
+
+            CSPSCRing<SPacket, RING_SIZE> m_Packets;
+            bool m_EncodingFinished;
+            std::atomic<bool> m_Started;
+
+            //Adaptive buffer depth.
+            uint32_t m_PreBuffer;
+            std::atomic<uint32_t> m_Depth;
+            double m_EncodeAvgUS;   //!< Smoothed encoding time of a frame.
+            double m_EncodeDevUS;   //!< Smoothed mean deviation of the encoding time.
+
+            /**
+             * @brief Reads, encodes and encrypts one frame into the packet cache.
+             * 
+             * @return Returns false on an encoder error.
+             */
+            bool Encode();
+
+            /**
+             * @brief Reads a frame. Continues with the next source if the current one ends.
+             * 
+             * @return Returns the read samples, less than requested if there is no next source.
+             */
+            uint32_t Read(uint16_t *Buf, uint32_t Samples);
+
+            /**
+             * @brief Reads the first frame of the next source into the carry buffer.
+             */
+            void Preroll();
+
+            /**
+             * @brief Makes the next source the current one.
+             * 
+             * @return Returns false if there is no next source.
+             */
+            bool SwitchSource();
+
+            /**
+             * @brief Adapts the buffer depth to the encoding time of the last frame.
+             */
+            void UpdateDepth(int64_t EncodeUS);
+    };
+
+    using VoiceStream = std::shared_ptr<CVoiceStream>;
+} // namespace DiscordBot
+
+
+#endif //VOICESTREAM_HPP
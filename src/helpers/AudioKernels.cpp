@@ -0,0 +1,669 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "AudioKernels.hpp"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define AUDIOKERNELS_SSE2
+    #include <immintrin.h>
+
+    //GCC and clang build the AVX2 path for every x86 target and select it at runtime.
+    #if defined(__GNUC__) && !defined(__AVX2__)
+        #define AUDIOKERNELS_AVX2
+        #define AUDIOKERNELS_AVX2_TARGET __attribute__((target("avx2")))
+        #define AUDIOKERNELS_HAS_AVX2() (__builtin_cpu_init(), __builtin_cpu_supports("avx2") != 0)
+    #elif defined(__AVX2__)
+        #define AUDIOKERNELS_AVX2
+        #define AUDIOKERNELS_AVX2_TARGET
+        #define AUDIOKERNELS_HAS_AVX2() true
+    #endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define AUDIOKERNELS_NEON
+    #include <arm_neon.h>
+#endif
+
+namespace DiscordBot
+{
+    const uint16_t CAudioKernels::UNITY_GAIN;
+
+    namespace
+    {
+#ifdef AUDIOKERNELS_SSE2
+        //(x * Gain) >> 15 of the signed 32 bit product, like the scalar path.
+        inline __m128i ScaleSSE2(__m128i x, __m128i Gain)
+        {
+            __m128i Hi = _mm_mulhi_epi16(x, Gain);
+            __m128i Lo = _mm_mullo_epi16(x, Gain);
+            return _mm_or_si128(_mm_slli_epi16(Hi, 1), _mm_srli_epi16(Lo, 15));
+        }
+
+        size_t MixSSE2(int16_t *Dst, const int16_t *Src, size_t Count, uint16_t Gain)
+        {
+            size_t i = 0;
+            __m128i G = _mm_set1_epi16((int16_t)Gain);
+
+            for (; i + 8 <= Count; i += 8)
+            {
+                __m128i s = _mm_loadu_si128((const __m128i*)(Src + i));
+                __m128i d = _mm_loadu_si128((const __m128i*)(Dst + i));
+
+                if(Gain != CAudioKernels::UNITY_GAIN)
+                    s = ScaleSSE2(s, G);
+
+                _mm_storeu_si128((__m128i*)(Dst + i), _mm_adds_epi16(d, s));
+            }
+
+            return i;
+        }
+
+        size_t S16ToFloatSSE2(float *Dst, const int16_t *Src, size_t Count)
+        {
+            size_t i = 0;
+            __m128 Scale = _mm_set1_ps(1.f / 32768.f);
+
+            for (; i + 8 <= Count; i += 8)
+            {
+                __m128i x = _mm_loadu_si128((const __m128i*)(Src + i));
+
+                //Sign extends the samples to 32 bit.
+                __m128i Lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+                __m128i Hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+
+                _mm_storeu_ps(Dst + i, _mm_mul_ps(_mm_cvtepi32_ps(Lo), Scale));
+                _mm_storeu_ps(Dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(Hi), Scale));
+            }
+
+            return i;
+        }
+
+        //The float is clamped first, because the conversion of too large values returns INT32_MIN.
+        inline __m128i ToS32SSE2(__m128 x)
+        {
+            x = _mm_mul_ps(x, _mm_set1_ps(32768.f));
+            x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-32768.f)), _mm_set1_ps(32767.f));
+            return _mm_cvtps_epi32(x);
+        }
+
+        size_t FloatToS16SSE2(int16_t *Dst, const float *Src, size_t Count)
+        {
+            size_t i = 0;
+            for (; i + 8 <= Count; i += 8)
+            {
+                __m128i Lo = ToS32SSE2(_mm_loadu_ps(Src + i));
+                __m128i Hi = ToS32SSE2(_mm_loadu_ps(Src + i + 4));
+                _mm_storeu_si128((__m128i*)(Dst + i), _mm_packs_epi32(Lo, Hi));
+            }
+
+            return i;
+        }
+
+        size_t MonoToStereoSSE2(float *Dst, const float *Src, size_t Frames)
+        {
+            size_t i = 0;
+            for (; i + 4 <= Frames; i += 4)
+            {
+                __m128 x = _mm_loadu_ps(Src + i);
+                _mm_storeu_ps(Dst + i * 2, _mm_unpacklo_ps(x, x));
+                _mm_storeu_ps(Dst + i * 2 + 4, _mm_unpackhi_ps(x, x));
+            }
+
+            return i;
+        }
+
+        size_t DotStereoSSE2(const float *Samples, const float *Coeffs, size_t Count, float &Left, float &Right)
+        {
+            size_t i = 0;
+            __m128 Acc0 = _mm_setzero_ps();
+            __m128 Acc1 = _mm_setzero_ps();
+
+            for (; i + 8 <= Count; i += 8)
+            {
+                Acc0 = _mm_add_ps(Acc0, _mm_mul_ps(_mm_loadu_ps(Samples + i), _mm_loadu_ps(Coeffs + i)));
+                Acc1 = _mm_add_ps(Acc1, _mm_mul_ps(_mm_loadu_ps(Samples + i + 4), _mm_loadu_ps(Coeffs + i + 4)));
+            }
+
+            //The even lanes are the left channel.
+            float Sums[4];
+            _mm_storeu_ps(Sums, _mm_add_ps(Acc0, Acc1));
+            Left = Sums[0] + Sums[2];
+            Right = Sums[1] + Sums[3];
+
+            return i;
+        }
+
+        size_t PeakSSE2(const int16_t *Samples, size_t Count, int32_t &Max, int32_t &Min)
+        {
+            size_t i = 0;
+            __m128i Hi = _mm_setzero_si128();
+            __m128i Lo = _mm_setzero_si128();
+
+            for (; i + 8 <= Count; i += 8)
+            {
+                __m128i x = _mm_loadu_si128((const __m128i*)(Samples + i));
+                Hi = _mm_max_epi16(Hi, x);
+                Lo = _mm_min_epi16(Lo, x);
+            }
+
+            int16_t His[8], Los[8];
+            _mm_storeu_si128((__m128i*)His, Hi);
+            _mm_storeu_si128((__m128i*)Los, Lo);
+            Max = *std::max_element(His, His + 8);
+            Min = *std::min_element(Los, Los + 8);
+
+            return i;
+        }
+
+        size_t DualMonoSSE2(const int16_t *Samples, size_t Frames, bool &Equal)
+        {
+            size_t i = 0;
+            __m128i Diff = _mm_setzero_si128();
+
+            //Compares every sample with the other channel of its frame.
+            for (; i + 4 <= Frames; i += 4)
+            {
+                __m128i x = _mm_loadu_si128((const __m128i*)(Samples + i * 2));
+                __m128i Swapped = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xB1), 0xB1);
+                Diff = _mm_or_si128(Diff, _mm_xor_si128(x, Swapped));
+            }
+
+            Equal = _mm_movemask_epi8(_mm_cmpeq_epi8(Diff, _mm_setzero_si128())) == 0xFFFF;
+            return i;
+        }
+#endif
+
+#ifdef AUDIOKERNELS_AVX2
+        AUDIOKERNELS_AVX2_TARGET size_t MixAVX2(int16_t *Dst, const int16_t *Src, size_t Count, uint16_t Gain)
+        {
+            size_t i = 0;
+            __m256i G = _mm256_set1_epi16((int16_t)Gain);
+
+            for (; i + 16 <= Count; i += 16)
+            {
+                __m256i s = _mm256_loadu_si256((const __m256i*)(Src + i));
+                __m256i d = _mm256_loadu_si256((const __m256i*)(Dst + i));
+
+                if(Gain != CAudioKernels::UNITY_GAIN)
+                {
+                    __m256i Hi = _mm256_mulhi_epi16(s, G);
+                    __m256i Lo = _mm256_mullo_epi16(s, G);
+                    s = _mm256_or_si256(_mm256_slli_epi16(Hi, 1), _mm256_srli_epi16(Lo, 15));
+                }
+
+                _mm256_storeu_si256((__m256i*)(Dst + i), _mm256_adds_epi16(d, s));
+            }
+
+            return i;
+        }
+
+        AUDIOKERNELS_AVX2_TARGET size_t S16ToFloatAVX2(float *Dst, const int16_t *Src, size_t Count)
+        {
+            size_t i = 0;
+            __m256 Scale = _mm256_set1_ps(1.f / 32768.f);
+
+            for (; i + 8 <= Count; i += 8)
+            {
+                __m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(Src + i)));
+                _mm256_storeu_ps(Dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), Scale));
+            }
+
+            return i;
+        }
+
+        AUDIOKERNELS_AVX2_TARGET inline __m256i ToS32AVX2(__m256 x)
+        {
+            x = _mm256_mul_ps(x, _mm256_set1_ps(32768.f));
+            x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-32768.f)), _mm256_set1_ps(32767.f));
+            return _mm256_cvtps_epi32(x);
+        }
+
+        AUDIOKERNELS_AVX2_TARGET size_t FloatToS16AVX2(int16_t *Dst, const float *Src, size_t Count)
+        {
+            size_t i = 0;
+            for (; i + 16 <= Count; i += 16)
+            {
+                __m256i Lo = ToS32AVX2(_mm256_loadu_ps(Src + i));
+                __m256i Hi = ToS32AVX2(_mm256_loadu_ps(Src + i + 8));
+
+                //The pack works per 128 bit lane, so the quadwords are put back in order.
+                __m256i Packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(Lo, Hi), 0xD8);
+                _mm256_storeu_si256((__m256i*)(Dst + i), Packed);
+            }
+
+            return i;
+        }
+
+        AUDIOKERNELS_AVX2_TARGET size_t MonoToStereoAVX2(float *Dst, const float *Src, size_t Frames)
+        {
+            size_t i = 0;
+            for (; i + 8 <= Frames; i += 8)
+            {
+                __m256 x = _mm256_loadu_ps(Src + i);
+                __m256 Lo = _mm256_unpacklo_ps(x, x);
+                __m256 Hi = _mm256_unpackhi_ps(x, x);
+
+                _mm256_storeu_ps(Dst + i * 2, _mm256_permute2f128_ps(Lo, Hi, 0x20));
+                _mm256_storeu_ps(Dst + i * 2 + 8, _mm256_permute2f128_ps(Lo, Hi, 0x31));
+            }
+
+            return i;
+        }
+
+        AUDIOKERNELS_AVX2_TARGET size_t DotStereoAVX2(const float *Samples, const float *Coeffs, size_t Count, float &Left, float &Right)
+        {
+            size_t i = 0;
+            __m256 Acc0 = _mm256_setzero_ps();
+            __m256 Acc1 = _mm256_setzero_ps();
+
+            for (; i + 16 <= Count; i += 16)
+            {
+                Acc0 = _mm256_add_ps(Acc0, _mm256_mul_ps(_mm256_loadu_ps(Samples + i), _mm256_loadu_ps(Coeffs + i)));
+                Acc1 = _mm256_add_ps(Acc1, _mm256_mul_ps(_mm256_loadu_ps(Samples + i + 8), _mm256_loadu_ps(Coeffs + i + 8)));
+            }
+
+            __m256 Acc = _mm256_add_ps(Acc0, Acc1);
+            __m128 Sum = _mm_add_ps(_mm256_castps256_ps128(Acc), _mm256_extractf128_ps(Acc, 1));
+
+            float Sums[4];
+            _mm_storeu_ps(Sums, Sum);
+            Left = Sums[0] + Sums[2];
+            Right = Sums[1] + Sums[3];
+
+            return i;
+        }
+
+        AUDIOKERNELS_AVX2_TARGET size_t PeakAVX2(const int16_t *Samples, size_t Count, int32_t &Max, int32_t &Min)
+        {
+            size_t i = 0;
+            __m256i Hi = _mm256_setzero_si256();
+            __m256i Lo = _mm256_setzero_si256();
+
+            for (; i + 16 <= Count; i += 16)
+            {
+                __m256i x = _mm256_loadu_si256((const __m256i*)(Samples + i));
+                Hi = _mm256_max_epi16(Hi, x);
+                Lo = _mm256_min_epi16(Lo, x);
+            }
+
+            int16_t His[16], Los[16];
+            _mm256_storeu_si256((__m256i*)His, Hi);
+            _mm256_storeu_si256((__m256i*)Los, Lo);
+            Max = *std::max_element(His, His + 16);
+            Min = *std::min_element(Los, Los + 16);
+
+            return i;
+        }
+
+        AUDIOKERNELS_AVX2_TARGET size_t DualMonoAVX2(const int16_t *Samples, size_t Frames, bool &Equal)
+        {
+            size_t i = 0;
+            __m256i Diff = _mm256_setzero_si256();
+
+            for (; i + 8 <= Frames; i += 8)
+            {
+                __m256i x = _mm256_loadu_si256((const __m256i*)(Samples + i * 2));
+                __m256i Swapped = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, 0xB1), 0xB1);
+                Diff = _mm256_or_si256(Diff, _mm256_xor_si256(x, Swapped));
+            }
+
+            Equal = _mm256_testz_si256(Diff, Diff) != 0;
+            return i;
+        }
+
+        const bool HAS_AVX2 = AUDIOKERNELS_HAS_AVX2();
+#endif
+
+#ifdef AUDIOKERNELS_NEON
+        size_t MixNEON(int16_t *Dst, const int16_t *Src, size_t Count, uint16_t Gain)
+        {
+            size_t i = 0;
+            int16x8_t G = vdupq_n_s16((int16_t)Gain);
+
+            for (; i + 8 <= Count; i += 8)
+            {
+                int16x8_t s = vld1q_s16(Src + i);
+                int16x8_t d = vld1q_s16(Dst + i);
+
+                //Doubling high half, which is (x * Gain) >> 15.
+                if(Gain != CAudioKernels::UNITY_GAIN)
+                    s = vqdmulhq_s16(s, G);
+
+                vst1q_s16(Dst + i, vqaddq_s16(d, s));
+            }
+
+            return i;
+        }
+
+        size_t S16ToFloatNEON(float *Dst, const int16_t *Src, size_t Count)
+        {
+            size_t i = 0;
+            for (; i + 8 <= Count; i += 8)
+            {
+                int16x8_t x = vld1q_s16(Src + i);
+                vst1q_f32(Dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), 1.f / 32768.f));
+                vst1q_f32(Dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), 1.f / 32768.f));
+            }
+
+            return i;
+        }
+
+#if defined(__aarch64__)
+        //Only armv8 converts with rounding to the nearest value like the scalar path.
+        inline int32x4_t ToS32NEON(float32x4_t x)
+        {
+            x = vmulq_n_f32(x, 32768.f);
+            x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(-32768.f)), vdupq_n_f32(32767.f));
+            return vcvtnq_s32_f32(x);
+        }
+
+        size_t FloatToS16NEON(int16_t *Dst, const float *Src, size_t Count)
+        {
+            size_t i = 0;
+            for (; i + 8 <= Count; i += 8)
+            {
+                int16x4_t Lo = vqmovn_s32(ToS32NEON(vld1q_f32(Src + i)));
+                int16x4_t Hi = vqmovn_s32(ToS32NEON(vld1q_f32(Src + i + 4)));
+                vst1q_s16(Dst + i, vcombine_s16(Lo, Hi));
+            }
+
+            return i;
+        }
+#endif
+
+        size_t MonoToStereoNEON(float *Dst, const float *Src, size_t Frames)
+        {
+            size_t i = 0;
+            for (; i + 4 <= Frames; i += 4)
+            {
+                float32x4_t x = vld1q_f32(Src + i);
+                float32x4x2_t Zip = vzipq_f32(x, x);
+                vst1q_f32(Dst + i * 2, Zip.val[0]);
+                vst1q_f32(Dst + i * 2 + 4, Zip.val[1]);
+            }
+
+            return i;
+        }
+
+        size_t DotStereoNEON(const float *Samples, const float *Coeffs, size_t Count, float &Left, float &Right)
+        {
+            size_t i = 0;
+            float32x4_t Acc0 = vdupq_n_f32(0.f);
+            float32x4_t Acc1 = vdupq_n_f32(0.f);
+
+            for (; i + 8 <= Count; i += 8)
+            {
+                Acc0 = vmlaq_f32(Acc0, vld1q_f32(Samples + i), vld1q_f32(Coeffs + i));
+                Acc1 = vmlaq_f32(Acc1, vld1q_f32(Samples + i + 4), vld1q_f32(Coeffs + i + 4));
+            }
+
+            float Sums[4];
+            vst1q_f32(Sums, vaddq_f32(Acc0, Acc1));
+            Left = Sums[0] + Sums[2];
+            Right = Sums[1] + Sums[3];
+
+            return i;
+        }
+
+        size_t PeakNEON(const int16_t *Samples, size_t Count, int32_t &Max, int32_t &Min)
+        {
+            size_t i = 0;
+            int16x8_t Hi = vdupq_n_s16(0);
+            int16x8_t Lo = vdupq_n_s16(0);
+
+            for (; i + 8 <= Count; i += 8)
+            {
+                int16x8_t x = vld1q_s16(Samples + i);
+                Hi = vmaxq_s16(Hi, x);
+                Lo = vminq_s16(Lo, x);
+            }
+
+            int16_t His[8], Los[8];
+            vst1q_s16(His, Hi);
+            vst1q_s16(Los, Lo);
+            Max = *std::max_element(His, His + 8);
+            Min = *std::min_element(Los, Los + 8);
+
+            return i;
+        }
+
+        size_t DualMonoNEON(const int16_t *Samples, size_t Frames, bool &Equal)
+        {
+            size_t i = 0;
+            int16x8_t Diff = vdupq_n_s16(0);
+
+            for (; i + 4 <= Frames; i += 4)
+            {
+                int16x8_t x = vld1q_s16(Samples + i * 2);
+                Diff = vorrq_s16(Diff, veorq_s16(x, vrev32q_s16(x)));
+            }
+
+            uint64x2_t Bits = vreinterpretq_u64_s16(Diff);
+            Equal = (vgetq_lane_u64(Bits, 0) | vgetq_lane_u64(Bits, 1)) == 0;
+            return i;
+        }
+#endif
+    }
+
+    /**
+     * @return Converts a gain between 0.0 and 1.0 to Q15. Other values are clamped.
+     */
+    uint16_t CAudioKernels::ToGain(float Gain)
+    {
+        Gain = std::min(std::max(Gain, 0.f), 1.f);
+        return (uint16_t)(Gain * UNITY_GAIN + 0.5f);
+    }
+
+    /**
+     * @brief Scales the source by the gain and adds it to the destination with saturation.
+     */
+    void CAudioKernels::MixSaturate(int16_t *Dst, const int16_t *Src, size_t Count, uint16_t Gain)
+    {
+        Gain = std::min(Gain, UNITY_GAIN);
+        size_t Done = 0;
+
+#if defined(AUDIOKERNELS_AVX2)
+        if(HAS_AVX2)
+            Done = MixAVX2(Dst, Src, Count, Gain);
+        else
+            Done = MixSSE2(Dst, Src, Count, Gain);
+#elif defined(AUDIOKERNELS_SSE2)
+        Done = MixSSE2(Dst, Src, Count, Gain);
+#elif defined(AUDIOKERNELS_NEON)
+        Done = MixNEON(Dst, Src, Count, Gain);
+#endif
+
+        MixSaturateScalar(Dst + Done, Src + Done, Count - Done, Gain);
+    }
+
+    void CAudioKernels::MixSaturateScalar(int16_t *Dst, const int16_t *Src, size_t Count, uint16_t Gain)
+    {
+        for (size_t i = 0; i < Count; i++)
+        {
+            int32_t s = Src[i];
+            if(Gain != UNITY_GAIN)
+                s = (s * Gain) >> 15;
+
+            int32_t Sum = Dst[i] + s;
+            Dst[i] = (int16_t)std::min(std::max(Sum, (int32_t)INT16_MIN), (int32_t)INT16_MAX);
+        }
+    }
+
+    /**
+     * @brief Converts 16 bit samples to float samples between -1.0 and 1.0.
+     */
+    void CAudioKernels::S16ToFloat(float *Dst, const int16_t *Src, size_t Count)
+    {
+        size_t Done = 0;
+
+#if defined(AUDIOKERNELS_AVX2)
+        if(HAS_AVX2)
+            Done = S16ToFloatAVX2(Dst, Src, Count);
+        else
+            Done = S16ToFloatSSE2(Dst, Src, Count);
+#elif defined(AUDIOKERNELS_SSE2)
+        Done = S16ToFloatSSE2(Dst, Src, Count);
+#elif defined(AUDIOKERNELS_NEON)
+        Done = S16ToFloatNEON(Dst, Src, Count);
+#endif
+
+        for (size_t i = Done; i < Count; i++)
+            Dst[i] = Src[i] * (1.f / 32768.f);
+    }
+
+    /**
+     * @brief Converts float samples to 16 bit samples. Rounds to the nearest value and saturates samples outside of -1.0 and 1.0.
+     */
+    void CAudioKernels::FloatToS16(int16_t *Dst, const float *Src, size_t Count)
+    {
+        size_t Done = 0;
+
+#if defined(AUDIOKERNELS_AVX2)
+        if(HAS_AVX2)
+            Done = FloatToS16AVX2(Dst, Src, Count);
+        else
+            Done = FloatToS16SSE2(Dst, Src, Count);
+#elif defined(AUDIOKERNELS_SSE2)
+        Done = FloatToS16SSE2(Dst, Src, Count);
+#elif defined(AUDIOKERNELS_NEON) && defined(__aarch64__)
+        Done = FloatToS16NEON(Dst, Src, Count);
+#endif
+
+        FloatToS16Scalar(Dst + Done, Src + Done, Count - Done);
+    }
+
+    /**
+     * @brief Copies every mono sample to both channels of an interleaved stereo buffer.
+     */
+    void CAudioKernels::MonoToStereo(float *Dst, const float *Src, size_t Frames)
+    {
+        size_t Done = 0;
+
+#if defined(AUDIOKERNELS_AVX2)
+        if(HAS_AVX2)
+            Done = MonoToStereoAVX2(Dst, Src, Frames);
+        else
+            Done = MonoToStereoSSE2(Dst, Src, Frames);
+#elif defined(AUDIOKERNELS_SSE2)
+        Done = MonoToStereoSSE2(Dst, Src, Frames);
+#elif defined(AUDIOKERNELS_NEON)
+        Done = MonoToStereoNEON(Dst, Src, Frames);
+#endif
+
+        for (size_t i = Done; i < Frames; i++)
+        {
+            Dst[i * 2] = Src[i];
+            Dst[i * 2 + 1] = Src[i];
+        }
+    }
+
+    /**
+     * @brief Filters interleaved stereo samples. Used by the resampler.
+     */
+    void CAudioKernels::DotStereo(const float *Samples, const float *Coeffs, size_t Count, float &Left, float &Right)
+    {
+        size_t Done = 0;
+        Left = 0.f;
+        Right = 0.f;
+
+#if defined(AUDIOKERNELS_AVX2)
+        if(HAS_AVX2)
+            Done = DotStereoAVX2(Samples, Coeffs, Count, Left, Right);
+        else
+            Done = DotStereoSSE2(Samples, Coeffs, Count, Left, Right);
+#elif defined(AUDIOKERNELS_SSE2)
+        Done = DotStereoSSE2(Samples, Coeffs, Count, Left, Right);
+#elif defined(AUDIOKERNELS_NEON)
+        Done = DotStereoNEON(Samples, Coeffs, Count, Left, Right);
+#endif
+
+        for (size_t i = Done; i + 1 < Count; i += 2)
+        {
+            Left += Samples[i] * Coeffs[i];
+            Right += Samples[i + 1] * Coeffs[i + 1];
+        }
+    }
+
+    /**
+     * @return Gets the largest absolute value of the samples.
+     */
+    uint16_t CAudioKernels::PeakLevel(const int16_t *Samples, size_t Count)
+    {
+        int32_t Max = 0, Min = 0;
+        size_t Done = 0;
+
+#if defined(AUDIOKERNELS_AVX2)
+        if(HAS_AVX2)
+            Done = PeakAVX2(Samples, Count, Max, Min);
+        else
+            Done = PeakSSE2(Samples, Count, Max, Min);
+#elif defined(AUDIOKERNELS_SSE2)
+        Done = PeakSSE2(Samples, Count, Max, Min);
+#elif defined(AUDIOKERNELS_NEON)
+        Done = PeakNEON(Samples, Count, Max, Min);
+#endif
+
+        for (size_t i = Done; i < Count; i++)
+        {
+            Max = std::max<int32_t>(Max, Samples[i]);
+            Min = std::min<int32_t>(Min, Samples[i]);
+        }
+
+        return (uint16_t)std::max(Max, -Min);
+    }
+
+    /**
+     * @return Returns true if both channels of the interleaved stereo samples are equal.
+     */
+    bool CAudioKernels::IsDualMono(const int16_t *Samples, size_t Frames)
+    {
+        bool Equal = true;
+        size_t Done = 0;
+
+#if defined(AUDIOKERNELS_AVX2)
+        if(HAS_AVX2)
+            Done = DualMonoAVX2(Samples, Frames, Equal);
+        else
+            Done = DualMonoSSE2(Samples, Frames, Equal);
+#elif defined(AUDIOKERNELS_SSE2)
+        Done = DualMonoSSE2(Samples, Frames, Equal);
+#elif defined(AUDIOKERNELS_NEON)
+        Done = DualMonoNEON(Samples, Frames, Equal);
+#endif
+
+        for (size_t i = Done; i < Frames && Equal; i++)
+            Equal = Samples[i * 2] == Samples[i * 2 + 1];
+
+        return Equal;
+    }
+
+    void CAudioKernels::FloatToS16Scalar(int16_t *Dst, const float *Src, size_t Count)
+    {
+        for (size_t i = 0; i < Count; i++)
+        {
+            float s = std::min(std::max(Src[i] * 32768.f, -32768.f), 32767.f);
+            Dst[i] = (int16_t)std::nearbyint(s);
+        }
+    }
+} // namespace DiscordBot
@@ -0,0 +1,111 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef AUDIOKERNELS_HPP
+#define AUDIOKERNELS_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace DiscordBot
+{
+    /**
+     * @brief Vectorized kernels for pcm audio. Uses SSE2 and AVX2 on x86 and NEON on arm. The integer kernels return the same samples on all paths,
+     * the float kernels may differ from the scalar path in the last bit, because the sums are added in a different order.
+     */
+    class CAudioKernels
+    {
+        public:
+            static const uint16_t UNITY_GAIN = 1 << 15;   //!< Gain of 1.0 in Q15.
+
+            /**
+             * @return Converts a gain between 0.0 and 1.0 to Q15. Other values are clamped.
+             */
+            static uint16_t ToGain(float Gain);
+
+            /**
+             * @brief Scales the source by the gain and adds it to the destination with saturation.
+             * 
+             * @param Dst: Mix buffer.
+             * @param Src: Samples to add.
+             * @param Count: Count of samples of both buffers, all channels included.
+             * @param Gain: Gain in Q15, at most UNITY_GAIN.
+             */
+            static void MixSaturate(int16_t *Dst, const int16_t *Src, size_t Count, uint16_t Gain);
+
+            /**
+             * @brief Converts 16 bit samples to float samples between -1.0 and 1.0.
+             * 
+             * @param Count: Count of samples, all channels included.
+             */
+            static void S16ToFloat(float *Dst, const int16_t *Src, size_t Count);
+
+            /**
+             * @brief Converts float samples to 16 bit samples. Rounds to the nearest value and saturates samples outside of -1.0 and 1.0.
+             * 
+             * @param Count: Count of samples, all channels included.
+             */
+            static void FloatToS16(int16_t *Dst, const float *Src, size_t Count);
+
+            /**
+             * @brief Copies every mono sample to both channels of an interleaved stereo buffer.
+             * 
+             * @param Dst: Buffer for Frames * 2 samples.
+             * @param Frames: Count of mono samples.
+             */
+            static void MonoToStereo(float *Dst, const float *Src, size_t Frames);
+
+            /**
+             * @brief Filters interleaved stereo samples. Used by the resampler.
+             * 
+             * @param Samples: Interleaved stereo samples.
+             * @param Coeffs: Coefficients, which are duplicated for both channels. (c0, c0, c1, c1, ...)
+             * @param Count: Count of floats of both buffers, all channels included.
+             * @param Left: Receives the sum of the left channel.
+             * @param Right: Receives the sum of the right channel.
+             */
+            static void DotStereo(const float *Samples, const float *Coeffs, size_t Count, float &Left, float &Right);
+
+            /**
+             * @return Gets the largest absolute value of the samples.
+             * 
+             * @param Count: Count of samples, all channels included.
+             */
+            static uint16_t PeakLevel(const int16_t *Samples, size_t Count);
+
+            /**
+             * @return Returns true if both channels of the interleaved stereo samples are equal.
+             * 
+             * @param Frames: Samples per channel.
+             */
+            static bool IsDualMono(const int16_t *Samples, size_t Frames);
+
+        private:
+            static void MixSaturateScalar(int16_t *Dst, const int16_t *Src, size_t Count, uint16_t Gain);
+            static void FloatToS16Scalar(int16_t *Dst, const float *Src, size_t Count);
+    };
+} // namespace DiscordBot
+
+
+#endif //AUDIOKERNELS_HPP
@@ -0,0 +1,657 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ETF.hpp"
+#include <string.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits>
+
+namespace DiscordBot
+{
+    //--------------------------Reader--------------------------//
+
+    void CETF::SReader::Require(size_t Len)
+    {
+        if(Size - Pos < Len)
+            throw CETFException("Unexpected end of etf data");
+    }
+
+    uint8_t CETF::SReader::U8()
+    {
+        Require(1);
+        return Data[Pos++];
+    }
+
+    uint16_t CETF::SReader::U16()
+    {
+        Require(2);
+        uint16_t Ret = (uint16_t)((Data[Pos] << 8) | Data[Pos + 1]);
+        Pos += 2;
+
+        return Ret;
+    }
+
+    uint32_t CETF::SReader::U32()
+    {
+        Require(4);
+        uint32_t Ret = ((uint32_t)Data[Pos] << 24) | ((uint32_t)Data[Pos + 1] << 16) | ((uint32_t)Data[Pos + 2] << 8) | (uint32_t)Data[Pos + 3];
+        Pos += 4;
+
+        return Ret;
+    }
+
+    //--------------------------Decoding--------------------------//
+
+    //Protects the stack against deeply nested payloads, same as CJSONView.
+    const uint32_t MAX_DEPTH = 512;
+
+    std::string CETF::ToJSON(const std::string &Data)
+    {
+        SReader In = {(const uint8_t*)Data.data(), Data.size(), 0};
+        if(In.U8() != FORMAT_VERSION)
+            throw CETFException("Unsupported etf version");
+
+        std::string Ret;
+        Ret.reserve(Data.size() * 2);
+        DecodeTerm(In, Ret, false, 0, nullptr);
+
+        return Ret;
+    }
+
+    std::unique_ptr<CJSONView> CETF::ToView(const std::string &Data, std::string &JSON)
+    {
+        SReader In = {(const uint8_t*)Data.data(), Data.size(), 0};
+        if(In.U8() != FORMAT_VERSION)
+            throw CETFException("Unsupported etf version");
+
+        std::unique_ptr<CJSONView> Ret(new CJSONView());
+
+        //Rough guesses to avoid most reallocations.
+        Ret->m_Tokens.reserve(Data.size() / 4 + 1);
+        JSON.clear();
+        JSON.reserve(Data.size() * 2);
+
+        DecodeTerm(In, JSON, false, 0, Ret.get());
+        if(JSON.size() >= (uint32_t)-1)
+            throw CETFException("Json text too large");
+
+        //The buffer doesn't move anymore, the tokens are only offsets.
+        Ret->m_Data = JSON.data();
+        Ret->m_Size = JSON.size();
+
+        return Ret;
+    }
+
+    void CETF::DecodeTerm(SReader &In, std::string &Out, bool Key, uint32_t Depth, CJSONView *View)
+    {
+        if(Depth > MAX_DEPTH)
+            throw CETFException("Etf nested too deep");
+
+        //Tokens are accessed by index, the vector may grow while the children are decoded.
+        uint32_t Index = 0;
+        if(View)
+        {
+            Index = (uint32_t)View->m_Tokens.size();
+            View->m_Tokens.push_back({JSONType::NONE, false, (uint32_t)Out.size(), 0, 0, 0});
+        }
+
+        JSONType Type = Key ? JSONType::STRING : JSONType::NUMBER;
+        bool Escaped = false;
+        uint32_t Size = 0;
+
+        uint8_t Tag = In.U8();
+        switch (Tag)
+        {
+            case SMALL_INTEGER_EXT:
+            case INTEGER_EXT:
+            {
+                int64_t Val = Tag == SMALL_INTEGER_EXT ? In.U8() : (int32_t)In.U32();
+
+                if(Key)
+                    Out += '"';
+
+                Out += std::to_string(Val);
+
+                if(Key)
+                    Out += '"';
+            }break;
+
+            case NEW_FLOAT_EXT:
+            {
+                uint64_t Bits = ((uint64_t)In.U32() << 32);
+                Bits |= In.U32();
+
+                double Val;
+                memcpy(&Val, &Bits, sizeof(Val));
+
+                char Buf[32];
+                snprintf(Buf, sizeof(Buf), Key ? "\"%.17g\"" : "%.17g", Val);
+                Out += Buf;
+            }break;
+
+            case FLOAT_EXT:
+            {
+                In.Require(31);
+                const char *Beg = (const char*)In.Data + In.Pos;
+                In.Pos += 31;
+
+                std::string Val(Beg, strnlen(Beg, 31));
+                Out += Key ? "\"" + Val + "\"" : Val;
+            }break;
+
+            case ATOM_EXT:
+            case ATOM_UTF8_EXT:
+            case SMALL_ATOM_EXT:
+            case SMALL_ATOM_UTF8_EXT:
+            {
+                size_t Len = (Tag == ATOM_EXT || Tag == ATOM_UTF8_EXT) ? In.U16() : In.U8();
+                In.Require(Len);
+
+                const char *Atom = (const char*)In.Data + In.Pos;
+                In.Pos += Len;
+
+                if(Key)
+                    Escaped = AppendString(Atom, Len, Out);
+                else
+                    Type = DecodeAtom(Atom, Len, Out, Escaped);
+            }break;
+
+            case SMALL_TUPLE_EXT:
+            case LARGE_TUPLE_EXT:
+            case LIST_EXT:
+            {
+                if(Key)
+                    throw CETFException("Unsupported map key");
+
+                uint32_t Count = Tag == SMALL_TUPLE_EXT ? In.U8() : In.U32();
+                In.Require(Count);
+
+                Out += '[';
+                for (uint32_t i = 0; i < Count; i++)
+                {
+                    if(i != 0)
+                        Out += ',';
+
+                    DecodeTerm(In, Out, false, Depth + 1, View);
+                }
+                Out += ']';
+
+                //Proper lists ends with an empty list.
+                if(Tag == LIST_EXT)
+                {
+                    std::string Tail;
+                    DecodeTerm(In, Tail, false, Depth + 1, nullptr);
+                }
+
+                Type = JSONType::ARRAY;
+                Size = Count;
+            }break;
+
+            case NIL_EXT:
+            {
+                if(Key)
+                    throw CETFException("Unsupported map key");
+
+                Out += "[]";
+                Type = JSONType::ARRAY;
+            }break;
+
+            //List of bytes.
+            case STRING_EXT:
+            {
+                if(Key)
+                    throw CETFException("Unsupported map key");
+
+                uint16_t Len = In.U16();
+                In.Require(Len);
+
+                Out += '[';
+                for (uint16_t i = 0; i < Len; i++)
+                {
+                    if(i != 0)
+                        Out += ',';
+
+                    uint32_t Beg = (uint32_t)Out.size();
+                    Out += std::to_string(In.Data[In.Pos++]);
+
+                    if(View)
+                        View->m_Tokens.push_back({JSONType::NUMBER, false, Beg, (uint32_t)Out.size(), (uint32_t)View->m_Tokens.size() + 1, 0});
+                }
+                Out += ']';
+
+                Type = JSONType::ARRAY;
+                Size = Len;
+            }break;
+
+            case BINARY_EXT:
+            {
+                uint32_t Len = In.U32();
+                In.Require(Len);
+
+                Escaped = AppendString((const char*)In.Data + In.Pos, Len, Out);
+                In.Pos += Len;
+                Type = JSONType::STRING;
+            }break;
+
+            //Snowflakes are sent as big integers, the models are using strings.
+            case SMALL_BIG_EXT:
+            case LARGE_BIG_EXT:
+            {
+                uint32_t Len = Tag == SMALL_BIG_EXT ? In.U8() : In.U32();
+                uint8_t Sign = In.U8();
+                In.Require(Len);
+
+                if(Len > sizeof(uint64_t))
+                    throw CETFException("Big integer exceeds 64 bits");
+
+                uint64_t Val = 0;
+                for (uint32_t i = 0; i < Len; i++)
+                    Val |= (uint64_t)In.Data[In.Pos + i] << (8 * i);
+
+                In.Pos += Len;
+
+                Out += '"';
+                if(Sign)
+                    Out += '-';
+
+                Out += std::to_string(Val);
+                Out += '"';
+                Type = JSONType::STRING;
+            }break;
+
+            case MAP_EXT:
+            {
+                if(Key)
+                    throw CETFException("Unsupported map key");
+
+                uint32_t Count = In.U32();
+                In.Require(Count);
+
+                Out += '{';
+                for (uint32_t i = 0; i < Count; i++)
+                {
+                    if(i != 0)
+                        Out += ',';
+
+                    DecodeTerm(In, Out, true, Depth + 1, View);
+                    Out += ':';
+                    DecodeTerm(In, Out, false, Depth + 1, View);
+                }
+                Out += '}';
+
+                Type = JSONType::OBJECT;
+                Size = Count;
+            }break;
+
+            default:
+            {
+                throw CETFException("Unsupported etf tag " + std::to_string(Tag));
+            }break;
+        }
+
+        if(View)
+        {
+            auto &Token = View->m_Tokens[Index];
+            Token.Type = Type;
+            Token.Escaped = Escaped;
+            Token.End = (uint32_t)Out.size();
+            Token.Next = (uint32_t)View->m_Tokens.size();
+            Token.Size = Size;
+        }
+    }
+
+    JSONType CETF::DecodeAtom(const char *Atom, size_t Len, std::string &Out, bool &Escaped)
+    {
+        if((Len == 3 && memcmp(Atom, "nil", 3) == 0) || (Len == 4 && memcmp(Atom, "null", 4) == 0))
+        {
+            Out += "null";
+            return JSONType::NUL;
+        }
+        else if((Len == 4 && memcmp(Atom, "true", 4) == 0) || (Len == 5 && memcmp(Atom, "false", 5) == 0))
+        {
+            Out.append(Atom, Len);
+            return JSONType::BOOL;
+        }
+
+        Escaped = AppendString(Atom, Len, Out);
+        return JSONType::STRING;
+    }
+
+    bool CETF::AppendString(const char *Str, size_t Len, std::string &Out)
+    {
+        static const char HEX[] = "0123456789abcdef";
+
+        size_t Beg = Out.size();
+        Out += '"';
+        for (size_t i = 0; i < Len; i++)
+        {
+            unsigned char c = (unsigned char)Str[i];
+            switch (c)
+            {
+                case '"': Out += "\\\""; break;
+                case '\\': Out += "\\\\"; break;
+                case '\n': Out += "\\n"; break;
+                case '\r': Out += "\\r"; break;
+                case '\t': Out += "\\t"; break;
+
+                default:
+                {
+                    if(c < 0x20)
+                    {
+                        Out += "\\u00";
+                        Out += HEX[c >> 4];
+                        Out += HEX[c & 0xF];
+                    }
+                    else
+                        Out += (char)c;
+                }break;
+            }
+        }
+        Out += '"';
+
+        //Every escape sequence makes the text longer than the input.
+        return Out.size() - Beg != Len + 2;
+    }
+
+    //--------------------------Encoding--------------------------//
+
+    static inline void SkipWhitespaces(const std::string &JSON, size_t &Pos)
+    {
+        while (Pos < JSON.size() && isspace((unsigned char)JSON[Pos]))
+            Pos++;
+    }
+
+    std::string CETF::FromJSON(const std::string &JSON)
+    {
+        std::string Ret;
+        Ret.reserve(JSON.size());
+        Ret += (char)FORMAT_VERSION;
+
+        size_t Pos = 0;
+        EncodeValue(JSON, Pos, Ret);
+
+        return Ret;
+    }
+
+    void CETF::EncodeValue(const std::string &JSON, size_t &Pos, std::string &Out)
+    {
+        SkipWhitespaces(JSON, Pos);
+        if(Pos >= JSON.size())
+            throw CETFException("Unexpected end of json");
+
+        switch (JSON[Pos])
+        {
+            case '{':
+            case '[':
+            {
+                bool IsMap = JSON[Pos] == '{';
+                char End = IsMap ? '}' : ']';
+                Pos++;
+
+                //The size is written after all elements are encoded.
+                size_t Beg = Out.size();
+                Out += (char)(IsMap ? MAP_EXT : LIST_EXT);
+                AppendU32(0, Out);
+
+                uint32_t Count = 0;
+                SkipWhitespaces(JSON, Pos);
+                if(Pos < JSON.size() && JSON[Pos] == End)
+                    Pos++;
+                else
+                {
+                    while (true)
+                    {
+                        if(IsMap)
+                        {
+                            SkipWhitespaces(JSON, Pos);
+                            AppendBinary(ParseString(JSON, Pos), Out);
+
+                            SkipWhitespaces(JSON, Pos);
+                            if(Pos >= JSON.size() || JSON[Pos] != ':')
+                                throw CETFException("Missing ':' in json object");
+
+                            Pos++;
+                        }
+
+                        EncodeValue(JSON, Pos, Out);
+                        Count++;
+
+                        SkipWhitespaces(JSON, Pos);
+                        if(Pos >= JSON.size())
+                            throw CETFException("Unexpected end of json");
+
+                        char c = JSON[Pos++];
+                        if(c == End)
+                            break;
+                        else if(c != ',')
+                            throw CETFException("Missing ',' in json");
+                    }
+                }
+
+                if(!IsMap && Count == 0)
+                {
+                    Out.resize(Beg);
+                    Out += (char)NIL_EXT;
+                    break;
+                }
+
+                for (int i = 0; i < 4; i++)
+                    Out[Beg + 1 + i] = (char)((Count >> (24 - 8 * i)) & 0xFF);
+
+                //Proper list tail.
+                if(!IsMap)
+                    Out += (char)NIL_EXT;
+            }break;
+
+            case '"':
+            {
+                AppendBinary(ParseString(JSON, Pos), Out);
+            }break;
+
+            case 't':
+            case 'f':
+            case 'n':
+            {
+                const char *Atom = JSON[Pos] == 't' ? "true" : (JSON[Pos] == 'f' ? "false" : "null");
+                size_t Len = strlen(Atom);
+
+                if(JSON.compare(Pos, Len, Atom) != 0)
+                    throw CETFException("Invalid json literal");
+
+                Pos += Len;
+
+                //Erlang uses nil instead of null.
+                if(JSON[Pos - Len] == 'n')
+                    Atom = "nil";
+
+                Out += (char)SMALL_ATOM_UTF8_EXT;
+                Out += (char)strlen(Atom);
+                Out += Atom;
+            }break;
+
+            default:
+            {
+                EncodeNumber(JSON, Pos, Out);
+            }break;
+        }
+    }
+
+    void CETF::EncodeNumber(const std::string &JSON, size_t &Pos, std::string &Out)
+    {
+        size_t Beg = Pos;
+        bool IsFloat = false;
+
+        while (Pos < JSON.size() && strchr("+-0123456789.eE", JSON[Pos]))
+        {
+            if(JSON[Pos] == '.' || JSON[Pos] == 'e' || JSON[Pos] == 'E')
+                IsFloat = true;
+
+            Pos++;
+        }
+
+        if(Beg == Pos)
+            throw CETFException("Invalid json value");
+
+        std::string Num = JSON.substr(Beg, Pos - Beg);
+
+        if(IsFloat)
+        {
+            double Val = strtod(Num.c_str(), nullptr);
+            uint64_t Bits;
+            memcpy(&Bits, &Val, sizeof(Bits));
+
+            Out += (char)NEW_FLOAT_EXT;
+            AppendU32((uint32_t)(Bits >> 32), Out);
+            AppendU32((uint32_t)Bits, Out);
+            return;
+        }
+
+        bool Negative = Num[0] == '-';
+        uint64_t Val = strtoull(Negative ? Num.c_str() + 1 : Num.c_str(), nullptr, 10);
+
+        if(!Negative && Val <= 0xFF)
+        {
+            Out += (char)SMALL_INTEGER_EXT;
+            Out += (char)Val;
+        }
+        else if((!Negative && Val <= (uint64_t)std::numeric_limits<int32_t>::max()) || (Negative && Val <= (uint64_t)std::numeric_limits<int32_t>::max() + 1))
+        {
+            Out += (char)INTEGER_EXT;
+            AppendU32((uint32_t)(Negative ? -(int64_t)Val : (int64_t)Val), Out);
+        }
+        else
+        {
+            std::string Digits;
+            while (Val)
+            {
+                Digits += (char)(Val & 0xFF);
+                Val >>= 8;
+            }
+
+            Out += (char)SMALL_BIG_EXT;
+            Out += (char)Digits.size();
+            Out += (char)(Negative ? 1 : 0);
+            Out += Digits;
+        }
+    }
+
+    std::string CETF::ParseString(const std::string &JSON, size_t &Pos)
+    {
+        if(Pos >= JSON.size() || JSON[Pos] != '"')
+            throw CETFException("Expected json string");
+
+        std::string Ret;
+        Pos++;
+
+        while (Pos < JSON.size() && JSON[Pos] != '"')
+        {
+            char c = JSON[Pos++];
+            if(c != '\\')
+            {
+                Ret += c;
+                continue;
+            }
+
+            if(Pos >= JSON.size())
+                break;
+
+            c = JSON[Pos++];
+            switch (c)
+            {
+                case 'b': Ret += '\b'; break;
+                case 'f': Ret += '\f'; break;
+                case 'n': Ret += '\n'; break;
+                case 'r': Ret += '\r'; break;
+                case 't': Ret += '\t'; break;
+
+                case 'u':
+                {
+                    if(Pos + 4 > JSON.size())
+                        throw CETFException("Invalid json unicode escape");
+
+                    uint32_t CP = strtoul(JSON.substr(Pos, 4).c_str(), nullptr, 16);
+                    Pos += 4;
+
+                    //Surrogate pair.
+                    if(CP >= 0xD800 && CP <= 0xDBFF && Pos + 6 <= JSON.size() && JSON[Pos] == '\\' && JSON[Pos + 1] == 'u')
+                    {
+                        uint32_t Low = strtoul(JSON.substr(Pos + 2, 4).c_str(), nullptr, 16);
+                        Pos += 6;
+                        CP = 0x10000 + ((CP - 0xD800) << 10) + (Low - 0xDC00);
+                    }
+
+                    //Encodes the code point as utf-8.
+                    if(CP < 0x80)
+                        Ret += (char)CP;
+                    else if(CP < 0x800)
+                    {
+                        Ret += (char)(0xC0 | (CP >> 6));
+                        Ret += (char)(0x80 | (CP & 0x3F));
+                    }
+                    else if(CP < 0x10000)
+                    {
+                        Ret += (char)(0xE0 | (CP >> 12));
+                        Ret += (char)(0x80 | ((CP >> 6) & 0x3F));
+                        Ret += (char)(0x80 | (CP & 0x3F));
+                    }
+                    else
+                    {
+                        Ret += (char)(0xF0 | (CP >> 18));
+                        Ret += (char)(0x80 | ((CP >> 12) & 0x3F));
+                        Ret += (char)(0x80 | ((CP >> 6) & 0x3F));
+                        Ret += (char)(0x80 | (CP & 0x3F));
+                    }
+                }break;
+
+                default:
+                {
+                    Ret += c;
+                }break;
+            }
+        }
+
+        if(Pos >= JSON.size())
+            throw CETFException("Unterminated json string");
+
+        Pos++;
+        return Ret;
+    }
+
+    void CETF::AppendBinary(const std::string &Str, std::string &Out)
+    {
+        Out += (char)BINARY_EXT;
+        AppendU32((uint32_t)Str.size(), Out);
+        Out += Str;
+    }
+
+    void CETF::AppendU32(uint32_t Val, std::string &Out)
+    {
+        Out += (char)(Val >> 24);
+        Out += (char)((Val >> 16) & 0xFF);
+        Out += (char)((Val >> 8) & 0xFF);
+        Out += (char)(Val & 0xFF);
+    }
+} // namespace DiscordBot
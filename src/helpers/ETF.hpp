@@ -0,0 +1,139 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ETF_HPP
+#define ETF_HPP
+
+#include <string>
+#include <memory>
+#include <stdexcept>
+#include <stdint.h>
+#include "JSONView.hpp"
+
+namespace DiscordBot
+{
+    class CETFException : public std::exception
+    {
+        public:
+            CETFException(const std::string &Msg) : m_Msg(Msg) {}
+
+            const char *what() const noexcept override
+            {
+                return m_Msg.c_str();
+            }
+
+        private:
+            std::string m_Msg;
+    };
+
+    /**
+     * @brief Encoder and decoder for the erlang term format, which is used by the gateway if encoding=etf is set.
+     * 
+     * @see https://erlang.org/doc/apps/erts/erl_ext_dist.html
+     * @see https://discord.com/developers/docs/topics/gateway#etf-erlang-term-format
+     */
+    class CETF
+    {
+        public:
+            /**
+             * @brief Converts a gateway payload to json. Snowflakes, which are sent as big integers, are converted to json strings.
+             * 
+             * @throw CETFException on invalid data.
+             */
+            static std::string ToJSON(const std::string &Data);
+
+            /**
+             * @brief Converts a gateway payload to json and fills the tokens of the view while decoding, so the json text isn't tokenized a second time.
+             * 
+             * @param Data: Etf payload.
+             * @param JSON: Receives the json text. The view points into it, so it must outlive the view and must not be modified.
+             * 
+             * @throw CETFException on invalid data.
+             */
+            static std::unique_ptr<CJSONView> ToView(const std::string &Data, std::string &JSON);
+
+            /**
+             * @brief Converts a json payload to etf. Strings are encoded as binaries, true, false and null as atoms.
+             * 
+             * @throw CETFException on invalid json.
+             */
+            static std::string FromJSON(const std::string &JSON);
+
+        private:
+            //Erlang external term format tags.
+            enum Tags
+            {
+                FORMAT_VERSION      = 131,
+                NEW_FLOAT_EXT       = 70,
+                SMALL_INTEGER_EXT   = 97,
+                INTEGER_EXT         = 98,
+                FLOAT_EXT           = 99,
+                ATOM_EXT            = 100,
+                SMALL_TUPLE_EXT     = 104,
+                LARGE_TUPLE_EXT     = 105,
+                NIL_EXT             = 106,
+                STRING_EXT          = 107,
+                LIST_EXT            = 108,
+                BINARY_EXT          = 109,
+                SMALL_BIG_EXT       = 110,
+                LARGE_BIG_EXT       = 111,
+                SMALL_ATOM_EXT      = 115,
+                MAP_EXT             = 116,
+                ATOM_UTF8_EXT       = 118,
+                SMALL_ATOM_UTF8_EXT = 119
+            };
+
+            struct SReader
+            {
+                const uint8_t *Data;
+                size_t Size;
+                size_t Pos;
+
+                void Require(size_t Len);
+                uint8_t U8();
+                uint16_t U16();
+                uint32_t U32();
+            };
+
+            /**
+             * @param View: Receives the tokens of the decoded values, if not null.
+             */
+            static void DecodeTerm(SReader &In, std::string &Out, bool Key, uint32_t Depth, CJSONView *View);
+            static JSONType DecodeAtom(const char *Atom, size_t Len, std::string &Out, bool &Escaped);
+
+            /**
+             * @return Returns true if the string contains escape sequences.
+             */
+            static bool AppendString(const char *Str, size_t Len, std::string &Out);
+
+            static void EncodeValue(const std::string &JSON, size_t &Pos, std::string &Out);
+            static void EncodeNumber(const std::string &JSON, size_t &Pos, std::string &Out);
+            static std::string ParseString(const std::string &JSON, size_t &Pos);
+            static void AppendBinary(const std::string &Str, std::string &Out);
+            static void AppendU32(uint32_t Val, std::string &Out);
+    };
+} // namespace DiscordBot
+
+
+#endif //ETF_HPP
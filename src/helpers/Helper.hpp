@@ -28,6 +28,8 @@
 #include <stdint.h>
 #include <chrono>
 #include <algorithm>
+#include <string>
+#include <stdlib.h>
 
 namespace DiscordBot
 {
@@ -51,6 +53,17 @@ namespace DiscordBot
         return (S2 << 16) + S1;
     }
 
+    /**
+     * @return Returns the numeric value of a snowflake id or 0 if the id is empty or invalid.
+     */
+    inline uint64_t ParseSnowflake(const std::string &ID)
+    {
+        char *End = nullptr;
+        uint64_t Ret = strtoull(ID.c_str(), &End, 10);
+
+        return (End && *End == '\0') ? Ret : 0;
+    }
+
     inline std::string ToLower(std::string Str)
     {
         std::transform(Str.begin(), Str.end(), Str.begin(), tolower);
@@ -79,6 +92,15 @@ namespace DiscordBot
         return ((Val << 24) & 0xFF000000) | ((Val >> 24) & 0xFF) | ((Val << 8) & 0x00FF0000) | ((Val >> 8) & 0xFF00);
     }
 
+    inline uint64_t ChangeEndianess(uint64_t Val)
+    {
+#if defined(_MSC_VER)
+        return _byteswap_uint64(Val);
+#else
+        return __builtin_bswap64(Val);
+#endif
+    }
+
 } // namespace DiscordBot
 
 
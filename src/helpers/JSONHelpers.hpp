@@ -30,6 +30,7 @@
 #include <models/atomic.hpp>
 #include <map>
 #include <JSON.hpp>
+#include "JSONView.hpp"
 #include <string>
 #include <type_traits>
 #include <utility>
@@ -42,7 +43,7 @@ namespace DiscordBot
     typename std::result_of<FN&(T)>::type operator|(const T &obj, FN f);
 
     template<class T>
-    T operator|(atomic<std::map<std::string, T>> &map, const std::string &js);
+    T operator|(atomic<std::map<std::string, T>> &map, const CJSONValue &js);
 
     template<class JSType, class T>
     T& operator>>(const JSType &js, T &obj);
@@ -54,16 +55,13 @@ namespace DiscordBot
     atomic<std::map<std::string, T>>& operator>>(const T &obj, atomic<std::map<std::string, T>> &map);
 
     template<class T>
-    std::pair<std::string, atomic<std::map<std::string, T>>&> operator&(const std::string &js, atomic<std::map<std::string, T>> &map);
+    std::pair<CJSONValue, atomic<std::map<std::string, T>>&> operator&(const CJSONValue &js, atomic<std::map<std::string, T>> &map);
 
     //--------------------------JSON Parsing--------------------------//
 
     template<class T>
-    typename std::enable_if<std::is_same<T, User>::value, User>::type Deserialize(const std::string &JS)
+    typename std::enable_if<std::is_same<T, User>::value, User>::type Deserialize(const CJSONValue &json)
     {
-        CJSON json;
-        json.ParseObject(JS);
-
         User Ret = User(new CUser());
 
         Ret->ID = json.GetValue<std::string>("id");
@@ -91,11 +89,8 @@ namespace DiscordBot
     }
 
     template<class T>
-    typename std::enable_if<std::is_same<T, Role>::value, Role>::type Deserialize(const std::string &JS)
+    typename std::enable_if<std::is_same<T, Role>::value, Role>::type Deserialize(const CJSONValue &json)
     {
-        CJSON json;
-        json.ParseObject(JS);
-
         Role ret = Role(new CRole());
 
         ret->ID = json.GetValue<std::string>("id");
@@ -111,24 +106,19 @@ namespace DiscordBot
     }
 
     template<class T>
-    typename std::enable_if<std::is_same<T, Channel>::value, Channel>::type Deserialize(std::pair<std::string, atomic<std::map<std::string, User>>&> js)
+    typename std::enable_if<std::is_same<T, Channel>::value, Channel>::type Deserialize(std::pair<CJSONValue, atomic<std::map<std::string, User>>&> js)
     {
         Channel Ret = Channel(new CChannel());
-
-        CJSON json;
-        json.ParseObject(js.first);
+        const CJSONValue &json = js.first;
 
         Ret->ID = json.GetValue<std::string>("id");
         Ret->Type = (ChannelTypes)json.GetValue<int>("type");
         Ret->GuildID = json.GetValue<std::string>("guild_id");
         Ret->Position = json.GetValue<int>("position");
 
-        std::vector<std::string> Array = json.GetValue<std::vector<std::string>>("permission_overwrites");
-        for (auto &&e : Array)
+        for (auto &&jov : json["permission_overwrites"])
         {
             PermissionOverwrites ov = PermissionOverwrites(new CPermissionOverwrites());
-            CJSON jov;
-            jov.ParseObject(e);
 
             ov->ID = jov.GetValue<std::string>("id");
             ov->Type = jov.GetValue<std::string>("type");
@@ -146,8 +136,7 @@ namespace DiscordBot
         Ret->UserLimit = json.GetValue<int>("user_limit");
         Ret->RateLimit = json.GetValue<int>("rate_limit_per_user");
 
-        Array = json.GetValue<std::vector<std::string>>("recipients");
-        for (auto &&e : Array)
+        for (auto &&e : json["recipients"])
         {
             User user = js.second | e;
             Ret->Recipients->push_back(user);
@@ -195,14 +184,12 @@ namespace DiscordBot
      * @return Returns the json object as c++ object.
      */
     template<class T>
-    inline T operator|(atomic<std::map<std::string, T>> &map, const std::string &js)
+    inline T operator|(atomic<std::map<std::string, T>> &map, const CJSONValue &js)
     {
-        CJSON json;
-        json.ParseObject(js);
-
         T Ret;
 
-        auto IT = map->find(json.GetValue<std::string>("id"));
+        auto lock = map.Lock();
+        auto IT = map->find(js.GetValue<std::string>("id"));
         if(IT != map->end())
             Ret = IT->second;
         else 
@@ -245,10 +232,10 @@ namespace DiscordBot
     }
 
     /**
-     * @brief Combines a json string and a map to a pair.
+     * @brief Combines a json value and a map to a pair.
      */
     template<class T>
-    inline std::pair<std::string, atomic<std::map<std::string, T>>&> operator&(const std::string &js, atomic<std::map<std::string, T>> &map)
+    inline std::pair<CJSONValue, atomic<std::map<std::string, T>>&> operator&(const CJSONValue &js, atomic<std::map<std::string, T>> &map)
     {
         return {js, map};
     }
@@ -0,0 +1,454 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "JSONView.hpp"
+#include <string.h>
+#include <stdlib.h>
+
+namespace DiscordBot
+{
+    //Protects the stack against deeply nested payloads.
+    const uint32_t MAX_DEPTH = 512;
+
+    //--------------------------View--------------------------//
+
+    CJSONView::CJSONView(const char *Data, size_t Size) : m_Data(Data), m_Size(Size)
+    {
+        if(Size >= (uint32_t)-1)
+            throw CJSONViewException("Json text too large", 0);
+
+        //Rough guess to avoid most reallocations.
+        m_Tokens.reserve(Size / 8 + 1);
+
+        size_t Pos = 0;
+        ParseValue(Pos, 0);
+
+        SkipWhitespaces(Pos);
+        if(Pos != m_Size)
+            throw CJSONViewException("Unexpected data after json value", Pos);
+    }
+
+    void CJSONView::ParseValue(size_t &Pos, uint32_t Depth)
+    {
+        SkipWhitespaces(Pos);
+        if(Pos >= m_Size)
+            throw CJSONViewException("Unexpected end of json", Pos);
+
+        if(Depth > MAX_DEPTH)
+            throw CJSONViewException("Json nested too deep", Pos);
+
+        //Tokens are accessed by index, the vector may grow while the children are parsed.
+        uint32_t Index = (uint32_t)m_Tokens.size();
+        m_Tokens.push_back({JSONType::NONE, false, (uint32_t)Pos, 0, 0, 0});
+
+        switch (m_Data[Pos])
+        {
+            case '{':
+            case '[':
+            {
+                bool IsObject = m_Data[Pos] == '{';
+                char End = IsObject ? '}' : ']';
+                m_Tokens[Index].Type = IsObject ? JSONType::OBJECT : JSONType::ARRAY;
+                Pos++;
+
+                uint32_t Size = 0;
+                SkipWhitespaces(Pos);
+                if(Pos < m_Size && m_Data[Pos] == End)
+                    Pos++;
+                else
+                {
+                    while (true)
+                    {
+                        if(IsObject)
+                        {
+                            SkipWhitespaces(Pos);
+                            if(Pos >= m_Size || m_Data[Pos] != '"')
+                                throw CJSONViewException("Expected key", Pos);
+
+                            ParseString(Pos);
+
+                            SkipWhitespaces(Pos);
+                            if(Pos >= m_Size || m_Data[Pos] != ':')
+                                throw CJSONViewException("Missing ':'", Pos);
+
+                            Pos++;
+                        }
+
+                        ParseValue(Pos, Depth + 1);
+                        Size++;
+
+                        SkipWhitespaces(Pos);
+                        if(Pos >= m_Size)
+                            throw CJSONViewException("Unexpected end of json", Pos);
+
+                        char c = m_Data[Pos++];
+                        if(c == End)
+                            break;
+                        else if(c != ',')
+                            throw CJSONViewException("Missing ','", Pos - 1);
+                    }
+                }
+
+                m_Tokens[Index].Size = Size;
+            }break;
+
+            case '"':
+            {
+                //ParseString adds its own token.
+                m_Tokens.pop_back();
+                ParseString(Pos);
+                return;
+            }break;
+
+            case 't':
+            case 'f':
+            case 'n':
+            {
+                const char *Literal = m_Data[Pos] == 't' ? "true" : (m_Data[Pos] == 'f' ? "false" : "null");
+                size_t Len = strlen(Literal);
+
+                if(m_Size - Pos < Len || memcmp(m_Data + Pos, Literal, Len) != 0)
+                    throw CJSONViewException("Invalid literal", Pos);
+
+                m_Tokens[Index].Type = Literal[0] == 'n' ? JSONType::NUL : JSONType::BOOL;
+                Pos += Len;
+            }break;
+
+            default:
+            {
+                size_t Beg = Pos;
+                while (Pos < m_Size && strchr("+-0123456789.eE", m_Data[Pos]) && m_Data[Pos] != '\0')
+                    Pos++;
+
+                if(Beg == Pos)
+                    throw CJSONViewException("Invalid value", Pos);
+
+                m_Tokens[Index].Type = JSONType::NUMBER;
+            }break;
+        }
+
+        m_Tokens[Index].End = (uint32_t)Pos;
+        m_Tokens[Index].Next = (uint32_t)m_Tokens.size();
+    }
+
+    void CJSONView::ParseString(size_t &Pos)
+    {
+        SToken Token = {JSONType::STRING, false, (uint32_t)Pos, 0, 0, 0};
+        Pos++;
+
+        while (Pos < m_Size && m_Data[Pos] != '"')
+        {
+            if(m_Data[Pos] == '\\')
+            {
+                Token.Escaped = true;
+                Pos++;
+            }
+
+            Pos++;
+        }
+
+        if(Pos >= m_Size)
+            throw CJSONViewException("Unterminated string", Token.Begin);
+
+        Pos++;
+        Token.End = (uint32_t)Pos;
+        Token.Next = (uint32_t)m_Tokens.size() + 1;
+        m_Tokens.push_back(Token);
+    }
+
+    void CJSONView::SkipWhitespaces(size_t &Pos) const
+    {
+        while (Pos < m_Size && (m_Data[Pos] == ' ' || m_Data[Pos] == '\n' || m_Data[Pos] == '\r' || m_Data[Pos] == '\t'))
+            Pos++;
+    }
+
+    std::string CJSONView::Unescape(const SToken &Token) const
+    {
+        const char *Beg = m_Data + Token.Begin + 1;
+        const char *End = m_Data + Token.End - 1;
+
+        if(!Token.Escaped)
+            return std::string(Beg, End);
+
+        std::string Ret;
+        Ret.reserve(End - Beg);
+
+        while (Beg < End)
+        {
+            char c = *Beg++;
+            if(c != '\\' || Beg >= End)
+            {
+                Ret += c;
+                continue;
+            }
+
+            c = *Beg++;
+            switch (c)
+            {
+                case 'b': Ret += '\b'; break;
+                case 'f': Ret += '\f'; break;
+                case 'n': Ret += '\n'; break;
+                case 'r': Ret += '\r'; break;
+                case 't': Ret += '\t'; break;
+
+                case 'u':
+                {
+                    if(End - Beg < 4)
+                        return Ret;
+
+                    uint32_t CP = strtoul(std::string(Beg, 4).c_str(), nullptr, 16);
+                    Beg += 4;
+
+                    //Surrogate pair.
+                    if(CP >= 0xD800 && CP <= 0xDBFF && End - Beg >= 6 && Beg[0] == '\\' && Beg[1] == 'u')
+                    {
+                        uint32_t Low = strtoul(std::string(Beg + 2, 4).c_str(), nullptr, 16);
+                        Beg += 6;
+                        CP = 0x10000 + ((CP - 0xD800) << 10) + (Low - 0xDC00);
+                    }
+
+                    //Encodes the code point as utf-8.
+                    if(CP < 0x80)
+                        Ret += (char)CP;
+                    else if(CP < 0x800)
+                    {
+                        Ret += (char)(0xC0 | (CP >> 6));
+                        Ret += (char)(0x80 | (CP & 0x3F));
+                    }
+                    else if(CP < 0x10000)
+                    {
+                        Ret += (char)(0xE0 | (CP >> 12));
+                        Ret += (char)(0x80 | ((CP >> 6) & 0x3F));
+                        Ret += (char)(0x80 | (CP & 0x3F));
+                    }
+                    else
+                    {
+                        Ret += (char)(0xF0 | (CP >> 18));
+                        Ret += (char)(0x80 | ((CP >> 12) & 0x3F));
+                        Ret += (char)(0x80 | ((CP >> 6) & 0x3F));
+                        Ret += (char)(0x80 | (CP & 0x3F));
+                    }
+                }break;
+
+                default:
+                {
+                    Ret += c;
+                }break;
+            }
+        }
+
+        return Ret;
+    }
+
+    //--------------------------Value--------------------------//
+
+    CJSONValue::Iterator &CJSONValue::Iterator::operator++()
+    {
+        m_Index = m_View->m_Tokens[m_Index].Next;
+        return *this;
+    }
+
+    CJSONValue CJSONValue::operator[](const char *Key) const
+    {
+        if(GetType() != JSONType::OBJECT)
+            return CJSONValue();
+
+        const auto &Tokens = m_View->m_Tokens;
+        size_t Len = strlen(Key);
+        uint32_t i = m_Index + 1;
+
+        for (uint32_t j = 0; j < Tokens[m_Index].Size; j++)
+        {
+            const auto &KeyToken = Tokens[i];
+            bool Match;
+
+            if(KeyToken.Escaped)
+                Match = m_View->Unescape(KeyToken) == Key;
+            else
+                Match = (KeyToken.End - KeyToken.Begin - 2) == Len && memcmp(m_View->m_Data + KeyToken.Begin + 1, Key, Len) == 0;
+
+            if(Match)
+                return CJSONValue(m_View, i + 1);
+
+            //Skips the key and the value.
+            i = Tokens[i + 1].Next;
+        }
+
+        return CJSONValue();
+    }
+
+    JSONType CJSONValue::GetType() const
+    {
+        if(!m_View || m_Index == INVALID)
+            return JSONType::NONE;
+
+        return m_View->m_Tokens[m_Index].Type;
+    }
+
+    size_t CJSONValue::Size() const
+    {
+        JSONType Type = GetType();
+        if(Type != JSONType::OBJECT && Type != JSONType::ARRAY)
+            return 0;
+
+        return m_View->m_Tokens[m_Index].Size;
+    }
+
+    std::string CJSONValue::GetRaw() const
+    {
+        if(GetType() == JSONType::NONE)
+            return "";
+
+        const auto &Token = m_View->m_Tokens[m_Index];
+        return std::string(m_View->m_Data + Token.Begin, m_View->m_Data + Token.End);
+    }
+
+    CJSONValue::Iterator CJSONValue::begin() const
+    {
+        if(GetType() != JSONType::ARRAY)
+            return end();
+
+        return Iterator(m_View, m_Index + 1);
+    }
+
+    CJSONValue::Iterator CJSONValue::end() const
+    {
+        if(GetType() != JSONType::ARRAY)
+            return Iterator(m_View, INVALID);
+
+        return Iterator(m_View, m_View->m_Tokens[m_Index].Next);
+    }
+
+    bool CJSONValue::GetInteger(int64_t &Val) const
+    {
+        JSONType Type = GetType();
+        if(Type != JSONType::NUMBER && Type != JSONType::STRING)
+            return false;
+
+        const auto &Token = m_View->m_Tokens[m_Index];
+        const char *Beg = m_View->m_Data + Token.Begin;
+        const char *End = m_View->m_Data + Token.End;
+
+        if(Type == JSONType::STRING)
+        {
+            Beg++;
+            End--;
+        }
+
+        bool Negative = Beg < End && *Beg == '-';
+        if(Negative)
+            Beg++;
+
+        uint64_t Ret = 0;
+        for (; Beg < End && *Beg >= '0' && *Beg <= '9'; Beg++)
+            Ret = Ret * 10 + (*Beg - '0');
+
+        Val = Negative ? -(int64_t)Ret : (int64_t)Ret;
+        return true;
+    }
+
+    template<>
+    std::string CJSONValue::Get<std::string>() const
+    {
+        switch (GetType())
+        {
+            case JSONType::NONE:
+            case JSONType::NUL:
+                return "";
+
+            case JSONType::STRING:
+                return m_View->Unescape(m_View->m_Tokens[m_Index]);
+
+            default:
+                return GetRaw();
+        }
+    }
+
+    template<>
+    bool CJSONValue::Get<bool>() const
+    {
+        return GetType() == JSONType::BOOL && m_View->m_Data[m_View->m_Tokens[m_Index].Begin] == 't';
+    }
+
+    template<>
+    int64_t CJSONValue::Get<int64_t>() const
+    {
+        int64_t Ret = 0;
+        GetInteger(Ret);
+
+        return Ret;
+    }
+
+    template<>
+    uint64_t CJSONValue::Get<uint64_t>() const
+    {
+        return (uint64_t)Get<int64_t>();
+    }
+
+    template<>
+    int CJSONValue::Get<int>() const
+    {
+        return (int)Get<int64_t>();
+    }
+
+    template<>
+    uint32_t CJSONValue::Get<uint32_t>() const
+    {
+        return (uint32_t)Get<int64_t>();
+    }
+
+    template<>
+    double CJSONValue::Get<double>() const
+    {
+        JSONType Type = GetType();
+        if(Type != JSONType::NUMBER && Type != JSONType::STRING)
+            return 0;
+
+        return strtod(Get<std::string>().c_str(), nullptr);
+    }
+
+    template<>
+    std::vector<std::string> CJSONValue::Get<std::vector<std::string>>() const
+    {
+        std::vector<std::string> Ret;
+        Ret.reserve(Size());
+
+        for (auto &&e : *this)
+            Ret.push_back(e.Get<std::string>());
+
+        return Ret;
+    }
+
+    template<>
+    std::vector<int> CJSONValue::Get<std::vector<int>>() const
+    {
+        std::vector<int> Ret;
+        Ret.reserve(Size());
+
+        for (auto &&e : *this)
+            Ret.push_back(e.Get<int>());
+
+        return Ret;
+    }
+} // namespace DiscordBot
@@ -0,0 +1,213 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef JSONVIEW_HPP
+#define JSONVIEW_HPP
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <stdint.h>
+#include <stddef.h>
+
+namespace DiscordBot
+{
+    class CJSONView;
+
+    class CJSONViewException : public std::exception
+    {
+        public:
+            CJSONViewException(const std::string &Msg, size_t Pos) : m_Msg(Msg + " at offset " + std::to_string(Pos)) {}
+
+            const char *what() const noexcept override
+            {
+                return m_Msg.c_str();
+            }
+
+        private:
+            std::string m_Msg;
+    };
+
+    enum class JSONType : uint8_t
+    {
+        NONE,       //!< Missing value.
+        OBJECT,
+        ARRAY,
+        STRING,
+        NUMBER,
+        BOOL,
+        NUL
+    };
+
+    /**
+     * @brief Handle to a value inside a CJSONView. Cheap to copy, valid as long as the view and its buffer are alive.
+     * Missing values behave like null, so lookups can be chained without checks. (e.g.: json["user"]["id"])
+     */
+    class CJSONValue
+    {
+        public:
+            class Iterator
+            {
+                public:
+                    Iterator(const CJSONView *View, uint32_t Index) : m_View(View), m_Index(Index) {}
+
+                    CJSONValue operator*() const
+                    {
+                        return CJSONValue(m_View, m_Index);
+                    }
+
+                    Iterator &operator++();
+
+                    bool operator!=(const Iterator &other) const
+                    {
+                        return m_Index != other.m_Index;
+                    }
+
+                private:
+                    const CJSONView *m_View;
+                    uint32_t m_Index;
+            };
+
+            CJSONValue() : m_View(nullptr), m_Index(INVALID) {}
+            CJSONValue(const CJSONView *View, uint32_t Index) : m_View(View), m_Index(Index) {}
+
+            /**
+             * @return Returns the value of a object member or a missing value.
+             */
+            CJSONValue operator[](const char *Key) const;
+
+            /**
+             * @return Returns the type of this value. JSONType::NONE if the value is missing.
+             */
+            JSONType GetType() const;
+
+            /**
+             * @return Returns true if the value is missing or null.
+             */
+            inline bool IsNull() const
+            {
+                JSONType Type = GetType();
+                return Type == JSONType::NONE || Type == JSONType::NUL;
+            }
+
+            /**
+             * @return Returns the number of array elements or object members.
+             */
+            size_t Size() const;
+
+            /**
+             * @return Returns the unparsed json text of this value. Copies the text.
+             */
+            std::string GetRaw() const;
+
+            /**
+             * @brief Converts this value. Strings are unescaped, objects and arrays are returned as json text (std::string only), missing values and null are returned as default values.
+             * Numbers inside strings are converted, because discord sends some integers as strings.
+             */
+            template<class T>
+            T Get() const;
+
+            /**
+             * @brief Same as (*this)[Key].Get<T>(), matches the CJSON interface.
+             */
+            template<class T>
+            inline T GetValue(const char *Key) const
+            {
+                return (*this)[Key].Get<T>();
+            }
+
+            /**
+             * @brief Iterates the elements of an array. Empty for all other types.
+             */
+            Iterator begin() const;
+            Iterator end() const;
+
+        private:
+            static const uint32_t INVALID = (uint32_t)-1;
+
+            const CJSONView *m_View;
+            uint32_t m_Index;
+
+            bool GetInteger(int64_t &Val) const;
+    };
+
+    /**
+     * @brief Tokenizes a json text once into a flat token array. The tokens only store offsets into the buffer, nothing is copied until a value is requested.
+     * The buffer must outlive the view and all values of it.
+     * 
+     * @note Etf payloads are tokenized by CETF::ToView while they are decoded.
+     */
+    class CJSONView
+    {
+        friend class CJSONValue;
+        friend class CETF;
+
+        public:
+            /**
+             * @throw CJSONViewException on invalid json.
+             */
+            CJSONView(const char *Data, size_t Size);
+            explicit CJSONView(const std::string &Data) : CJSONView(Data.data(), Data.size()) {}
+
+            inline CJSONValue Root() const
+            {
+                return CJSONValue(this, 0);
+            }
+
+        private:
+            struct SToken
+            {
+                JSONType Type;
+                bool Escaped;       //!< Strings only, true if the string contains escape sequences.
+                uint32_t Begin;     //!< Offset of the first character, including quotes and brackets.
+                uint32_t End;       //!< Offset after the last character.
+                uint32_t Next;      //!< Index of the token after this value and all its children.
+                uint32_t Size;      //!< Number of array elements or object members.
+            };
+
+            const char *m_Data;
+            size_t m_Size;
+            std::vector<SToken> m_Tokens;
+
+            CJSONView() : m_Data(nullptr), m_Size(0) {}
+
+            void ParseValue(size_t &Pos, uint32_t Depth);
+            void ParseString(size_t &Pos);
+            void SkipWhitespaces(size_t &Pos) const;
+            std::string Unescape(const SToken &Token) const;
+    };
+
+    template<> std::string CJSONValue::Get<std::string>() const;
+    template<> bool CJSONValue::Get<bool>() const;
+    template<> int CJSONValue::Get<int>() const;
+    template<> uint32_t CJSONValue::Get<uint32_t>() const;
+    template<> int64_t CJSONValue::Get<int64_t>() const;
+    template<> uint64_t CJSONValue::Get<uint64_t>() const;
+    template<> double CJSONValue::Get<double>() const;
+    template<> std::vector<std::string> CJSONValue::Get<std::vector<std::string>>() const;
+    template<> std::vector<int> CJSONValue::Get<std::vector<int>>() const;
+} // namespace DiscordBot
+
+
+#endif //JSONVIEW_HPP
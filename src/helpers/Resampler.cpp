@@ -0,0 +1,146 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "Resampler.hpp"
+#include "AudioKernels.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace DiscordBot
+{
+    const uint32_t CResampler::TAPS;
+    const uint32_t CResampler::MAX_PHASES;
+
+    namespace
+    {
+        uint32_t GCD(uint32_t a, uint32_t b)
+        {
+            while (b != 0)
+            {
+                uint32_t t = a % b;
+                a = b;
+                b = t;
+            }
+
+            return a;
+        }
+    }
+
+    CResampler::CResampler(uint32_t InRate, uint32_t OutRate) : m_Pos(0), m_Phase(0)
+    {
+        uint32_t Div = GCD(InRate, OutRate);
+        m_L = OutRate / Div;
+        m_M = InRate / Div;
+        m_Phases = std::min(m_L, MAX_PHASES);
+
+        //Prototype lowpass with Phases * TAPS coefficients at Phases times the input rate. The cutoff is below the lower nyquist frequency of both rates.
+        const double PI = 3.14159265358979323846;
+        size_t Count = (size_t)m_Phases * TAPS;
+        double Cutoff = 0.45 * std::min(InRate, OutRate) / ((double)InRate * m_Phases);
+        double Center = (Count - 1) / 2.0;
+
+        std::vector<double> Proto(Count);
+        double Sum = 0;
+        for (size_t i = 0; i < Count; i++)
+        {
+            double x = i - Center;
+            double Sinc = x == 0 ? 2 * Cutoff : std::sin(2 * PI * Cutoff * x) / (PI * x);
+            double Window = 0.42 - 0.5 * std::cos(2 * PI * i / (Count - 1)) + 0.08 * std::cos(4 * PI * i / (Count - 1));
+
+            Proto[i] = Sinc * Window;
+            Sum += Proto[i];
+        }
+
+        //Every phase gets a gain of about 1.0. The coefficients are reversed, so that the filter runs forward over the history.
+        m_Coeffs.resize(Count * 2);
+        for (uint32_t p = 0; p < m_Phases; p++)
+        {
+            for (uint32_t k = 0; k < TAPS; k++)
+            {
+                float c = (float)(Proto[p + (size_t)k * m_Phases] * m_Phases / Sum);
+                size_t Idx = ((size_t)p * TAPS + (TAPS - 1 - k)) * 2;
+
+                m_Coeffs[Idx] = c;
+                m_Coeffs[Idx + 1] = c;
+            }
+        }
+
+        //Aligns the center of the filter with the first input sample.
+        m_History.assign((TAPS / 2 - 1) * 2, 0.f);
+    }
+
+    /**
+     * @brief Adds input samples.
+     */
+    void CResampler::Push(const float *In, uint32_t Frames)
+    {
+        m_History.insert(m_History.end(), In, In + Frames * 2);
+    }
+
+    /**
+     * @brief Adds silence after the last input samples, so that the filter returns all of them.
+     */
+    void CResampler::Flush()
+    {
+        m_History.insert(m_History.end(), (TAPS / 2) * 2, 0.f);
+    }
+
+    /**
+     * @brief Filters the added samples.
+     */
+    uint32_t CResampler::Pull(float *Out, uint32_t Frames)
+    {
+        size_t Available = m_History.size() / 2;
+        uint32_t Got = 0;
+
+        while (Got < Frames && m_Pos + TAPS <= Available)
+        {
+            size_t Phase = (uint64_t)m_Phase * m_Phases / m_L;
+            CAudioKernels::DotStereo(m_History.data() + m_Pos * 2, m_Coeffs.data() + Phase * TAPS * 2, TAPS * 2, Out[Got * 2], Out[Got * 2 + 1]);
+            Got++;
+
+            m_Phase += m_M;
+            m_Pos += m_Phase / m_L;
+            m_Phase %= m_L;
+        }
+
+        //Drops the samples which no filter needs anymore.
+        size_t Drop = std::min(m_Pos, Available);
+        m_History.erase(m_History.begin(), m_History.begin() + Drop * 2);
+        m_Pos -= Drop;
+
+        return Got;
+    }
+
+    /**
+     * @return Gets the input samples per channel, which are needed for the given count of output samples.
+     */
+    uint32_t CResampler::GetInputFrames(uint32_t OutFrames) const
+    {
+        uint64_t Needed = ((uint64_t)OutFrames * m_M + m_Phase + m_L - 1) / m_L + m_Pos + TAPS;
+        size_t Available = m_History.size() / 2;
+
+        return Needed > Available ? (uint32_t)(Needed - Available) : 0;
+    }
+} // namespace DiscordBot
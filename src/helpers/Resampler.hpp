@@ -0,0 +1,87 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef RESAMPLER_HPP
+#define RESAMPLER_HPP
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace DiscordBot
+{
+    /**
+     * @brief Polyphase resampler for interleaved stereo float samples.
+     * 
+     * @note The ratio of the rates is reduced to OutRate / InRate = L / M. Every output sample is a filter of TAPS input samples with one of the L phases
+     * of a windowed sinc lowpass. Ratios with more than MAX_PHASES phases use the nearest lower of MAX_PHASES phases, the rate stays exact.
+     */
+    class CResampler
+    {
+        public:
+            static const uint32_t TAPS = 32;            //!< Input samples per output sample.
+            static const uint32_t MAX_PHASES = 1024;
+
+            CResampler(uint32_t InRate, uint32_t OutRate);
+
+            /**
+             * @brief Adds input samples.
+             * 
+             * @param Frames: Samples per channel.
+             */
+            void Push(const float *In, uint32_t Frames);
+
+            /**
+             * @brief Adds silence after the last input samples, so that the filter returns all of them.
+             */
+            void Flush();
+
+            /**
+             * @brief Filters the added samples.
+             * 
+             * @param Frames: Max samples per channel.
+             * 
+             * @return Returns the filled samples per channel. Less than Frames if more input is needed.
+             */
+            uint32_t Pull(float *Out, uint32_t Frames);
+
+            /**
+             * @return Gets the input samples per channel, which are needed for the given count of output samples.
+             */
+            uint32_t GetInputFrames(uint32_t OutFrames) const;
+
+        private:
+            uint32_t m_L;
+            uint32_t m_M;
+            uint32_t m_Phases;              //!< Phases of the filter, at most MAX_PHASES.
+
+            std::vector<float> m_Coeffs;    //!< TAPS coefficients per phase, duplicated for both channels.
+            std::vector<float> m_History;   //!< Interleaved stereo input.
+            size_t m_Pos;                   //!< First input sample of the next filter.
+            uint32_t m_Phase;
+    };
+} // namespace DiscordBot
+
+
+#endif //RESAMPLER_HPP
@@ -0,0 +1,119 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SPSCRING_HPP
+#define SPSCRING_HPP
+
+#include <atomic>
+#include <stddef.h>
+
+namespace DiscordBot
+{
+    /**
+     * @brief Lock-free ring of preallocated slots for exactly one producer and one consumer thread.
+     * The slots are filled and read in place, so passing an element never allocates or copies.
+     * 
+     * @tparam T: Slot type.
+     * @tparam N: Number of slots, must be a power of two.
+     */
+    template<class T, size_t N>
+    class CSPSCRing
+    {
+        static_assert(N != 0 && (N & (N - 1)) == 0, "The slot count must be a power of two");
+
+        public:
+            CSPSCRing() : m_Head(0), m_Tail(0) {}
+
+            /**
+             * @brief Producer only. Gets the next free slot, which is published by Push().
+             * 
+             * @return Returns null if the ring is full.
+             */
+            T *Back()
+            {
+                size_t Tail = m_Tail.load(std::memory_order_relaxed);
+                if(Tail - m_Head.load(std::memory_order_acquire) == N)
+                    return nullptr;
+
+                return &m_Slots[Tail & (N - 1)];
+            }
+
+            /**
+             * @brief Producer only. Publishes the slot of Back().
+             */
+            void Push()
+            {
+                m_Tail.store(m_Tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+
+            /**
+             * @brief Consumer only. Gets the oldest published slot, which is released by Pop().
+             * 
+             * @return Returns null if the ring is empty.
+             */
+            T *Front()
+            {
+                size_t Head = m_Head.load(std::memory_order_relaxed);
+                if(Head == m_Tail.load(std::memory_order_acquire))
+                    return nullptr;
+
+                return &m_Slots[Head & (N - 1)];
+            }
+
+            /**
+             * @brief Consumer only. Releases the slot of Front().
+             */
+            void Pop()
+            {
+                m_Head.store(m_Head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+
+            /**
+             * @return Gets the number of published slots.
+             */
+            size_t Size() const
+            {
+                return m_Tail.load(std::memory_order_acquire) - m_Head.load(std::memory_order_acquire);
+            }
+
+            /**
+             * @brief Direct access to a slot, e.g. to initialize constant parts. Must not be used while the ring is in use.
+             */
+            T &At(size_t Index)
+            {
+                return m_Slots[Index & (N - 1)];
+            }
+
+        private:
+            T m_Slots[N];
+
+            //Separate cache lines, so the producer and the consumer don't invalidate each other.
+            std::atomic<size_t> m_Head;
+            char m_Padding[64 - sizeof(std::atomic<size_t>)];
+            std::atomic<size_t> m_Tail;
+    };
+} // namespace DiscordBot
+
+
+#endif //SPSCRING_HPP
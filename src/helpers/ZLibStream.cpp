@@ -0,0 +1,110 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "ZLibStream.hpp"
+#include <string.h>
+#include <Log.hpp>
+
+namespace DiscordBot
+{
+    CZLibStream::CZLibStream()
+    {
+        memset(&m_Stream, 0, sizeof(m_Stream));
+        if(inflateInit(&m_Stream) != Z_OK)
+            llog << lerror << "Failed to initialize zlib: " << (m_Stream.msg ? m_Stream.msg : "") << lendl;
+    }
+
+    void CZLibStream::Reset()
+    {
+        inflateReset(&m_Stream);
+        m_Pending.clear();
+    }
+
+    bool CZLibStream::Inflate(const std::string &In, std::string &Out)
+    {
+        //Every message ends with the zlib suffix 00 00 FF FF.
+        bool Complete = In.size() >= 4 && memcmp(In.data() + In.size() - 4, "\x00\x00\xFF\xFF", 4) == 0;
+
+        if(!Complete)
+        {
+            m_Pending.append(In);
+            return false;
+        }
+
+        if(m_Pending.empty())
+            return Inflate(In.data(), In.size(), Out);
+
+        m_Pending.append(In);
+        bool Ret = Inflate(m_Pending.data(), m_Pending.size(), Out);
+        m_Pending.clear();
+
+        return Ret;
+    }
+
+    bool CZLibStream::Inflate(const char *Data, size_t Size, std::string &Out)
+    {
+        //The buffer keeps its capacity, so the growth happens only for the first large messages.
+        size_t Written = 0;
+        if(Out.capacity() < Size * 4)
+            Out.reserve(Size * 4);
+
+        Out.resize(Out.capacity());
+
+        m_Stream.next_in = (Bytef*)Data;
+        m_Stream.avail_in = (uInt)Size;
+
+        do
+        {
+            if(Written == Out.size())
+                Out.resize(Out.size() * 2);
+
+            m_Stream.next_out = (Bytef*)&Out[Written];
+            m_Stream.avail_out = (uInt)(Out.size() - Written);
+
+            int Ret = inflate(&m_Stream, Z_SYNC_FLUSH);
+            if(Ret != Z_OK && Ret != Z_BUF_ERROR)
+            {
+                llog << lerror << "Failed to inflate gateway message: " << (m_Stream.msg ? m_Stream.msg : "") << lendl;
+                Out.clear();
+                Reset();
+
+                return false;
+            }
+
+            Written = Out.size() - m_Stream.avail_out;
+
+            //No progress possible, the message is complete.
+            if(Ret == Z_BUF_ERROR && m_Stream.avail_out > 0)
+                break;
+        } while (m_Stream.avail_in > 0 || m_Stream.avail_out == 0);
+
+        Out.resize(Written);
+        return true;
+    }
+
+    CZLibStream::~CZLibStream()
+    {
+        inflateEnd(&m_Stream);
+    }
+} // namespace DiscordBot
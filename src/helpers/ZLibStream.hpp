@@ -0,0 +1,69 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef ZLIBSTREAM_HPP
+#define ZLIBSTREAM_HPP
+
+#include <string>
+#include <zlib.h>
+
+namespace DiscordBot
+{
+    /**
+     * @brief Inflates a zlib-stream transport. One context is shared by all messages of a connection.
+     * 
+     * @see https://discord.com/developers/docs/topics/gateway#transport-compression
+     */
+    class CZLibStream
+    {
+        public:
+            CZLibStream();
+
+            /**
+             * @brief Resets the inflate context. Must be called for every new connection.
+             */
+            void Reset();
+
+            /**
+             * @brief Inflates a received frame.
+             * 
+             * @param In: Compressed websocket frame.
+             * @param Out: Buffer which receives the message. The buffer is reused, so pass the same buffer for every call.
+             * 
+             * @return Returns true if a complete message was inflated. False if the message is incomplete or the data is corrupted.
+             */
+            bool Inflate(const std::string &In, std::string &Out);
+
+            ~CZLibStream();
+
+        private:
+            bool Inflate(const char *Data, size_t Size, std::string &Out);
+
+            z_stream m_Stream;
+            std::string m_Pending;  //!< Frames of an incomplete message.
+    };
+} // namespace DiscordBot
+
+
+#endif //ZLIBSTREAM_HPP
@@ -0,0 +1,174 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define CLOG_IMPLEMENTATION
+#include <Log.hpp>
+#include "../src/controller/VoiceStream.hpp"
+#include <controller/IOpusAudioSource.hpp>
+#include <sodium.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <math.h>
+
+using namespace DiscordBot;
+
+//Samples per channel of one frame of the stream.
+static const uint32_t FRAME = CVoiceStream::FREQUENCY / 50;
+static const uint8_t TOC = 0xFC;   //!< Celt fullband, 20 ms, stereo, one frame.
+static const uint32_t TAG_SIZE = 40;
+
+/**
+ * @brief Opus source with tagged packets, which are sent as they are. Decoded packets aren't tagged.
+ */
+class CTaggedSource : public IOpusAudioSource
+{
+    public:
+        CTaggedSource(char Name, uint32_t Frames) : m_Name(Name), m_Frames(Frames), m_Frame(0) {}
+
+        uint32_t OnReadOpus(uint8_t *Buf, uint32_t Size) override
+        {
+            if(m_Frame == m_Frames)
+                return 0;
+
+            memset(Buf, 0, TAG_SIZE);
+            Buf[0] = TOC;
+            Buf[1] = 'T';
+            Buf[2] = (uint8_t)m_Name;
+            Buf[3] = (uint8_t)m_Frame++;
+
+            return TAG_SIZE;
+        }
+
+    private:
+        char m_Name;
+        uint32_t m_Frames;
+        uint32_t m_Frame;
+};
+
+/**
+ * @brief Plays a tone for the given samples.
+ */
+class CToneSource : public IAudioSource
+{
+    public:
+        CToneSource(uint32_t Samples) : m_Samples(Samples), m_Pos(0) {}
+
+        uint32_t OnRead(uint16_t *Buf, uint32_t Samples) override
+        {
+            uint32_t Ret = std::min(Samples, m_Samples - m_Pos);
+            for (uint32_t i = 0; i < Ret; i++, m_Pos++)
+                Buf[i * 2] = Buf[i * 2 + 1] = (uint16_t)(int16_t)(8000 * sin(m_Pos * 0.0575));
+
+            return Ret;
+        }
+
+    private:
+        uint32_t m_Samples;
+        uint32_t m_Pos;
+};
+
+/**
+ * @brief Plays the first source, sets the second one as next source after the first tick, like the prefetch of the music queue.
+ * 
+ * @return Returns the decrypted packets, tagged packets as name and frame, others as '*'.
+ */
+static std::vector<std::string> Play(AudioSource First, AudioSource Next)
+{
+    std::vector<uint8_t> Key(crypto_secretbox_KEYBYTES, 7);
+    CVoiceStream Stream(First, 1, Key, 1);
+    std::vector<std::string> Ret;
+
+    bool Running = true;
+    for (uint32_t Tick = 0; Running && Tick < 1000; Tick++)
+    {
+        Running = Stream.Tick();
+        if(Tick == 0)
+            Stream.SetNextSource(Next);
+
+        //Skipped slots of silence return null, too.
+        for (size_t i = 0; i < 64; i++)
+        {
+            const CVoiceStream::SPacket *Packet = Stream.GetPacket();
+            if(!Packet)
+                continue;
+
+            uint8_t Nonce[crypto_secretbox_NONCEBYTES] = {0};
+            memcpy(Nonce, Packet->Data, CVoiceStream::RTPHEADERSIZE);
+
+            uint32_t Size = Packet->Size - CVoiceStream::RTPHEADERSIZE;
+            std::vector<uint8_t> Opus(Size);
+            crypto_secretbox_open_easy(Opus.data(), Packet->Data + CVoiceStream::RTPHEADERSIZE, Size, Nonce, Key.data());
+
+            Size -= CVoiceStream::MACSIZE;
+            if(Size == TAG_SIZE && Opus[0] == TOC && Opus[1] == 'T')
+                Ret.push_back(std::string(1, (char)Opus[2]) + std::to_string(Opus[3]));
+            else
+                Ret.push_back("*");
+
+            Stream.PopPacket();
+        }
+    }
+
+    return Ret;
+}
+
+static bool Check(const std::string &Name, const std::vector<std::string> &Frames, const std::vector<std::string> &Expected)
+{
+    bool Ret = Frames == Expected;
+    std::cout << (Ret ? "[PASS] " : "[FAIL] ") << Name << ":";
+    for (auto &&e : Frames)
+        std::cout << " " << e;
+
+    std::cout << std::endl;
+    return Ret;
+}
+
+int main()
+{
+    if(sodium_init() < 0)
+        return 1;
+
+    bool Ret = true;
+
+    //The first frame of the next song is decoded for the gapless switch, the others are sent as they are.
+    std::vector<std::string> Expected;
+    for (int i = 0; i < 10; i++)
+        Expected.push_back("A" + std::to_string(i));
+
+    Expected.push_back("*");
+    for (int i = 1; i < 10; i++)
+        Expected.push_back("B" + std::to_string(i));
+
+    Ret &= Check("Order of pre-encoded songs", Play(AudioSource(new CTaggedSource('A', 10)), AudioSource(new CTaggedSource('B', 10))), Expected);
+
+    //Both songs are played completely.
+    Ret &= Check("Count of pcm songs", Play(AudioSource(new CToneSource(FRAME * 10)), AudioSource(new CToneSource(FRAME * 10))), std::vector<std::string>(20, "*"));
+
+    //A next song, which is shorter than a frame, doesn't cut the current one.
+    Ret &= Check("Short next song", Play(AudioSource(new CToneSource(FRAME * 10)), AudioSource(new CToneSource(FRAME / 4))), std::vector<std::string>(11, "*"));
+
+    return Ret ? 0 : 1;
+}
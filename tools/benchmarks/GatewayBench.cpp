@@ -0,0 +1,167 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "../../src/controller/GatewayRecorder.hpp"
+#include "../../src/helpers/ETF.hpp"
+
+#define CLOG_IMPLEMENTATION
+#include <Log.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <vector>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace DiscordBot;
+
+static void PrintUsage(const char *Name)
+{
+    std::cout << "Usage: " << Name << " [options] <recording>\n"
+              << "  --passes <n>          Decodes of the whole recording (Default 10)\n";
+}
+
+/**
+ * @return Gets the nanoseconds per payload of the decoder.
+ */
+static double Measure(const std::vector<std::string> &Payloads, uint32_t Passes, const std::function<size_t(const std::string&)> &Decode)
+{
+    volatile size_t Sink = 0;
+
+    auto Start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < Passes; i++)
+    {
+        for (auto &&e : Payloads)
+            Sink += Decode(e);
+    }
+
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count() / (Passes * Payloads.size());
+}
+
+int main(int argc, char const *argv[])
+{
+    uint32_t Passes = 10;
+    std::string File;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if(strcmp(argv[i], "--passes") == 0 && i + 1 < argc)
+            Passes = std::max((uint32_t)strtoul(argv[++i], nullptr, 10), 1u);
+        else if(argv[i][0] != '-' && File.empty())
+            File = argv[i];
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    CGatewayReader Reader;
+    if(File.empty() || !Reader.Open(File))
+    {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+
+    //Json recordings are encoded, so every recording can be used. The json of etf recordings is the baseline of a json gateway.
+    std::vector<std::string> Payloads;
+    std::vector<std::string> JSONPayloads;
+    size_t Bytes = 0;
+    size_t JSONBytes = 0;
+    SGatewayRecord Record;
+
+    while (Reader.Read(Record))
+    {
+        //Both decoders must return the same json, invalid payloads are skipped.
+        try
+        {
+            std::string Data = Record.ETF ? Record.Data : CETF::FromJSON(Record.Data);
+            std::string Transcoded = CETF::ToJSON(Data);
+            CJSONView View(Transcoded);
+
+            std::string JSON;
+            CETF::ToView(Data, JSON);
+            if(JSON != Transcoded)
+            {
+                std::cout << "Decoders differ at payload " << Payloads.size() << std::endl;
+                return 1;
+            }
+
+            std::string Original = Record.ETF ? Transcoded : Record.Data;
+
+            Bytes += Data.size();
+            JSONBytes += Original.size();
+            Payloads.push_back(std::move(Data));
+            JSONPayloads.push_back(std::move(Original));
+        }
+        catch (const std::exception &e)
+        {
+            std::cout << "Skipped invalid payload what(): " << e.what() << std::endl;
+        }
+    }
+
+    if(Payloads.empty())
+    {
+        std::cout << "No payloads in " << File << std::endl;
+        return 1;
+    }
+
+    double Plain = Measure(JSONPayloads, Passes, [](const std::string &Data)
+    {
+        CJSONView View(Data);
+
+        return View.Root().Size();
+    });
+
+    double Transcode = Measure(Payloads, Passes, [](const std::string &Data)
+    {
+        std::string JSON = CETF::ToJSON(Data);
+        CJSONView View(JSON);
+
+        return View.Root().Size();
+    });
+
+    double Direct = Measure(Payloads, Passes, [](const std::string &Data)
+    {
+        std::string JSON;
+        auto View = CETF::ToView(Data, JSON);
+
+        return View->Root().Size();
+    });
+
+    //Average payload size in bytes, divided by ns per payload, is GB/s. Each decoder is measured against the size of its own input.
+    double Avg = (double)Bytes / Payloads.size();
+    double JSONAvg = (double)JSONBytes / JSONPayloads.size();
+    std::cout << Payloads.size() << " payload(s), " << Bytes << " bytes of etf, " << JSONBytes << " bytes of json\n"
+              << std::left << std::setw(24) << "decoder" << std::right << std::setw(12) << "ns/payload" << std::setw(12) << "MB/s" << "\n" << std::fixed << std::setprecision(1)
+              << std::left << std::setw(24) << "CJSONView (json)" << std::right << std::setw(12) << Plain << std::setw(12) << JSONAvg * 1000 / Plain << "\n"
+              << std::left << std::setw(24) << "ToJSON + CJSONView" << std::right << std::setw(12) << Transcode << std::setw(12) << Avg * 1000 / Transcode << "\n"
+              << std::left << std::setw(24) << "ToView" << std::right << std::setw(12) << Direct << std::setw(12) << Avg * 1000 / Direct << "\n"
+              << "Speedup " << Transcode / Direct << "x, etf costs " << Direct / Plain << "x of json" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,169 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "../../src/helpers/AudioKernels.hpp"
+#include "../../src/helpers/Resampler.hpp"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <vector>
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace DiscordBot;
+
+//Samples of one 20 ms stereo frame of the voice connection.
+static const size_t FRAME = 960 * 2;
+
+static void PrintUsage(const char *Name)
+{
+    std::cout << "Usage: " << Name << " [options]\n"
+              << "  --frames <n>          Frames per kernel (Default 100000)\n";
+}
+
+/**
+ * @return Gets the nanoseconds per frame of the call.
+ */
+static double Measure(uint32_t Frames, const std::function<void()> &Call)
+{
+    //Warms up the caches.
+    for (uint32_t i = 0; i < std::min(Frames, 1000u); i++)
+        Call();
+
+    auto Start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < Frames; i++)
+        Call();
+
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - Start).count() / Frames;
+}
+
+static void Print(const std::string &Name, double Scalar, double Kernel)
+{
+    std::cout << std::left << std::setw(16) << Name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << Scalar << std::setw(12) << Kernel << std::setw(10) << Scalar / Kernel << "x\n";
+}
+
+//----------------------------Scalar references----------------------------//
+
+static void MixSaturateRef(int16_t *Dst, const int16_t *Src, size_t Count, uint16_t Gain)
+{
+    for (size_t i = 0; i < Count; i++)
+    {
+        int32_t Sample = Gain == CAudioKernels::UNITY_GAIN ? Src[i] : (Src[i] * Gain) >> 15;
+        Dst[i] = (int16_t)std::min(32767, std::max(-32768, Dst[i] + Sample));
+    }
+}
+
+static void S16ToFloatRef(float *Dst, const int16_t *Src, size_t Count)
+{
+    for (size_t i = 0; i < Count; i++)
+        Dst[i] = Src[i] * (1.f / 32768.f);
+}
+
+static void FloatToS16Ref(int16_t *Dst, const float *Src, size_t Count)
+{
+    for (size_t i = 0; i < Count; i++)
+        Dst[i] = (int16_t)std::min(32767.f, std::max(-32768.f, roundf(Src[i] * 32768.f)));
+}
+
+static void MonoToStereoRef(float *Dst, const float *Src, size_t Frames)
+{
+    for (size_t i = 0; i < Frames; i++)
+        Dst[i * 2] = Dst[i * 2 + 1] = Src[i];
+}
+
+static uint16_t PeakLevelRef(const int16_t *Samples, size_t Count)
+{
+    int32_t Peak = 0;
+    for (size_t i = 0; i < Count; i++)
+        Peak = std::max(Peak, std::abs((int32_t)Samples[i]));
+
+    return (uint16_t)Peak;
+}
+
+static bool IsDualMonoRef(const int16_t *Samples, size_t Frames)
+{
+    for (size_t i = 0; i < Frames; i++)
+    {
+        if(Samples[i * 2] != Samples[i * 2 + 1])
+            return false;
+    }
+
+    return true;
+}
+
+int main(int argc, char const *argv[])
+{
+    uint32_t Frames = 100000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if(i + 1 >= argc || strcmp(argv[i], "--frames") != 0)
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+
+        Frames = std::max((uint32_t)strtoul(argv[++i], nullptr, 10), 1u);
+    }
+
+    std::vector<int16_t> A(FRAME), B(FRAME), Mono(FRAME);
+    std::vector<float> F(FRAME), Out(FRAME);
+    for (size_t i = 0; i < FRAME; i++)
+    {
+        A[i] = (int16_t)(rand() % 65536 - 32768);
+        B[i] = (int16_t)(rand() % 65536 - 32768);
+        Mono[i] = (int16_t)(i / 2 * 37);    //The dual mono check has to look at the whole frame.
+        F[i] = (rand() % 20001 - 10000) / 9000.f;
+    }
+
+    volatile uint32_t Sink = 0;
+    uint16_t Gain = CAudioKernels::ToGain(0.6f);
+
+    std::cout << std::left << std::setw(16) << "ns/frame" << std::right << std::setw(12) << "scalar" << std::setw(12) << "kernel" << std::setw(11) << "speedup\n";
+    Print("MixSaturate", Measure(Frames, [&]() { MixSaturateRef(A.data(), B.data(), FRAME, Gain); }), Measure(Frames, [&]() { CAudioKernels::MixSaturate(A.data(), B.data(), FRAME, Gain); }));
+    Print("S16ToFloat", Measure(Frames, [&]() { S16ToFloatRef(Out.data(), A.data(), FRAME); }), Measure(Frames, [&]() { CAudioKernels::S16ToFloat(Out.data(), A.data(), FRAME); }));
+    Print("FloatToS16", Measure(Frames, [&]() { FloatToS16Ref(A.data(), F.data(), FRAME); }), Measure(Frames, [&]() { CAudioKernels::FloatToS16(A.data(), F.data(), FRAME); }));
+    Print("MonoToStereo", Measure(Frames, [&]() { MonoToStereoRef(Out.data(), F.data(), FRAME / 2); }), Measure(Frames, [&]() { CAudioKernels::MonoToStereo(Out.data(), F.data(), FRAME / 2); }));
+    Print("PeakLevel", Measure(Frames, [&]() { Sink += PeakLevelRef(B.data(), FRAME); }), Measure(Frames, [&]() { Sink += CAudioKernels::PeakLevel(B.data(), FRAME); }));
+    Print("IsDualMono", Measure(Frames, [&]() { Sink += IsDualMonoRef(Mono.data(), FRAME / 2); }), Measure(Frames, [&]() { Sink += CAudioKernels::IsDualMono(Mono.data(), FRAME / 2); }));
+
+    //Resamples 20 ms of 44100 Hz per frame.
+    CResampler Resampler(44100, 48000);
+    std::vector<float> In(882 * 2);
+    for (auto &&e : In)
+        e = (rand() % 20001 - 10000) / 10000.f;
+
+    double Resample = Measure(Frames, [&]()
+    {
+        Resampler.Push(In.data(), 882);
+        Sink += Resampler.Pull(Out.data(), FRAME / 2);
+    });
+
+    std::cout << std::left << std::setw(16) << "Resampler" << std::right << std::setw(24) << std::fixed << std::setprecision(1) << Resample << "  (44100 Hz to 48000 Hz)\n";
+    return 0;
+}
@@ -0,0 +1,560 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "MockServer.hpp"
+#include "../../src/helpers/Helper.hpp"
+#include <Log.hpp>
+#include <fstream>
+#include <sstream>
+#include <functional>
+
+namespace DiscordBot
+{
+    const char *NOT_FOUND = "{\"message\":\"404: Not Found\",\"code\":0}";
+
+    CMockServer::CMockServer(const SMockServerConfig &Config) : m_Config(Config), m_Guilds(Config.Guilds), m_Gateway(Config.Port + 1, Config.Host, 64, 4096), m_REST(Config.Port, Config.Host, 64, 4096), m_NextID(1)
+    {
+        m_Gateway.setOnClientMessageCallback(std::bind(&CMockServer::OnGatewayMessage, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+        m_REST.setOnConnectionCallback(std::bind(&CMockServer::OnRequest, this, std::placeholders::_1, std::placeholders::_2));
+    }
+
+    bool CMockServer::LoadScript(const std::string &File)
+    {
+        std::ifstream In(File);
+        if(!In.is_open())
+        {
+            llog << lerror << "Failed to open script " << File << lendl;
+            return false;
+        }
+
+        std::string Line;
+        size_t LineNr = 0;
+        while (std::getline(In, Line))
+        {
+            LineNr++;
+            size_t Beg = Line.find_first_not_of(" \t\r");
+            if(Beg == std::string::npos || Line[Beg] == '#')
+                continue;
+
+            std::istringstream Fields(Line);
+            SScriptedResponse Response;
+            std::string Path;
+
+            if(!(Fields >> Response.Method >> Path >> Response.Status))
+            {
+                llog << lerror << "Invalid script line " << LineNr << ": " << Line << lendl;
+                return false;
+            }
+
+            std::getline(Fields, Response.Body);
+            Beg = Response.Body.find_first_not_of(" \t");
+            Response.Body = Beg == std::string::npos ? "" : Response.Body.substr(Beg);
+
+            size_t End = Response.Body.find_last_not_of("\r");
+            Response.Body = End == std::string::npos ? "" : Response.Body.substr(0, End + 1);
+
+            Response.Path = SplitPath(Path);
+            m_Script.push_back(Response);
+        }
+
+        llog << linfo << "Loaded " << m_Script.size() << " scripted response(s)" << lendl;
+        return true;
+    }
+
+    bool CMockServer::Start()
+    {
+        auto Res = m_REST.listen();
+        if(!Res.first)
+        {
+            llog << lerror << "Failed to open the rest port " << m_Config.Port << ": " << Res.second << lendl;
+            return false;
+        }
+
+        Res = m_Gateway.listen();
+        if(!Res.first)
+        {
+            llog << lerror << "Failed to open the gateway port " << m_Config.Port + 1 << ": " << Res.second << lendl;
+            return false;
+        }
+
+        m_REST.start();
+        m_Gateway.start();
+
+        llog << linfo << "REST api: http://" << m_Config.Host << ":" << m_Config.Port << "/api Gateway: ws://" << m_Config.Host << ":" << m_Config.Port + 1 << lendl;
+        return true;
+    }
+
+    void CMockServer::Wait()
+    {
+        m_REST.wait();
+    }
+
+    void CMockServer::Stop()
+    {
+        m_Gateway.stop();
+        m_REST.stop();
+    }
+
+    /*------------------------Gateway------------------------*/
+
+    void CMockServer::OnGatewayMessage(std::shared_ptr<ix::ConnectionState> State, ix::WebSocket &Socket, const ix::WebSocketMessagePtr &Msg)
+    {
+        switch (Msg->type)
+        {
+            case ix::WebSocketMessageType::Open:
+            {
+                const std::string &URI = Msg->openInfo.uri;
+                if(URI.find("encoding=etf") != std::string::npos || URI.find("compress=") != std::string::npos)
+                {
+                    llog << lerror << "Only json without transport compression is supported: " << URI << lendl;
+                    Socket.close(4002, "Unsupported encoding");
+                    return;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(m_SessionsLock);
+                    m_Sessions[State->getId()] = std::shared_ptr<SSession>(new SSession{0, 1, 0, 0, ""});
+                }
+
+                SendOP(Socket, HELLO, "{\"heartbeat_interval\":" + std::to_string(m_Config.HeartbeatInterval) + "}");
+            }break;
+
+            case ix::WebSocketMessageType::Close:
+            {
+                std::lock_guard<std::mutex> lock(m_SessionsLock);
+                m_Sessions.erase(State->getId());
+            }break;
+
+            case ix::WebSocketMessageType::Message:
+            {
+                std::shared_ptr<SSession> Session;
+
+                {
+                    std::lock_guard<std::mutex> lock(m_SessionsLock);
+                    auto IT = m_Sessions.find(State->getId());
+                    if(IT == m_Sessions.end())
+                        return;
+
+                    Session = IT->second;
+                }
+
+                try
+                {
+                    CJSONView View(Msg->str);
+                    CJSONValue D = View.Root()["d"];
+
+                    switch (View.Root().GetValue<int>("op"))
+                    {
+                        case HEARTBEAT:
+                        {
+                            SendOP(Socket, HEARTBEAT_ACK, "null");
+                        }break;
+
+                        case IDENTIFY:
+                        {
+                            OnIdentify(*Session, Socket, D);
+                        }break;
+
+                        case REQUEST_GUILD_MEMBERS:
+                        {
+                            OnRequestMembers(*Session, Socket, D);
+                        }break;
+
+                        case RESUME:
+                        {
+                            //The connection state is lost after a disconnect, so every resume succeeds.
+                            Session->SessionID = D.GetValue<std::string>("session_id");
+                            Session->Seq = D.GetValue<uint32_t>("seq");
+                            SendDispatch(*Session, Socket, "RESUMED", "{}");
+                        }break;
+
+                        default:
+                        {
+                            llog << ldebug << "Ignored gateway op " << View.Root().GetValue<int>("op") << lendl;
+                        }break;
+                    }
+                }
+                catch(const CJSONViewException &e)
+                {
+                    llog << lerror << "Invalid gateway payload: " << e.what() << lendl;
+                    Socket.close(4002, "Decode error");
+                }
+            }break;
+        }
+    }
+
+    void CMockServer::OnIdentify(SSession &Session, ix::WebSocket &Socket, const CJSONValue &D)
+    {
+        std::vector<int> Shard = D["shard"].Get<std::vector<int>>();
+        if(Shard.size() == 2 && Shard[1] > 0 && Shard[0] >= 0 && Shard[0] < Shard[1])
+        {
+            Session.ShardID = (uint32_t)Shard[0];
+            Session.ShardCount = (uint32_t)Shard[1];
+        }
+
+        Session.LargeThreshold = D.GetValue<uint32_t>("large_threshold");
+        Session.SessionID = NextID();
+        Session.Seq = 0;
+
+        std::vector<uint32_t> Guilds;
+        for (uint32_t i = 0; i < m_Config.Guilds.Guilds; i++)
+        {
+            if(m_Guilds.GetShard(i, Session.ShardCount) == Session.ShardID)
+                Guilds.push_back(i);
+        }
+
+        std::string Ready = "{\"v\":8,\"user\":" + m_Guilds.CreateBotUser() + ",\"private_channels\":[],\"guilds\":[";
+        for (size_t i = 0; i < Guilds.size(); i++)
+        {
+            if(i != 0)
+                Ready += ',';
+
+            Ready += "{\"id\":\"" + m_Guilds.GetGuildID(Guilds[i]) + "\",\"unavailable\":true}";
+        }
+
+        Ready += "],\"session_id\":\"" + Session.SessionID + "\",\"shard\":[" + std::to_string(Session.ShardID) + "," + std::to_string(Session.ShardCount) + "]}";
+
+        llog << linfo << "Shard " << Session.ShardID << "/" << Session.ShardCount << " identified, sending " << Guilds.size() << " guild(s)" << lendl;
+        SendDispatch(Session, Socket, "READY", Ready);
+
+        for (auto &&e : Guilds)
+            SendDispatch(Session, Socket, "GUILD_CREATE", m_Guilds.CreateGuild(e, Session.LargeThreshold));
+    }
+
+    void CMockServer::OnRequestMembers(SSession &Session, ix::WebSocket &Socket, const CJSONValue &D)
+    {
+        const size_t CHUNK_SIZE = 1000;
+
+        std::vector<std::string> Members;
+        std::vector<std::string> NotFound;
+        uint32_t Guild;
+
+        if(m_Guilds.GetGuildIndex(D.GetValue<std::string>("guild_id"), Guild))
+        {
+            if(D["user_ids"].GetType() == JSONType::ARRAY)
+            {
+                for (auto &&e : D["user_ids"])
+                {
+                    std::string Member = m_Guilds.CreateMember(Guild, e.Get<std::string>());
+                    if(Member.empty())
+                        NotFound.push_back(e.Get<std::string>());
+                    else
+                        Members.push_back(Member);
+                }
+            }
+            else
+                Members = m_Guilds.FindMembers(Guild, D.GetValue<std::string>("query"), D.GetValue<uint32_t>("limit"));
+        }
+
+        size_t Count = std::max<size_t>((Members.size() + CHUNK_SIZE - 1) / CHUNK_SIZE, 1);
+        std::string Nonce = D["nonce"].GetRaw();
+
+        for (size_t i = 0; i < Count; i++)
+        {
+            std::string Chunk = "{\"guild_id\":\"" + D.GetValue<std::string>("guild_id") + "\",\"members\":[";
+            for (size_t j = i * CHUNK_SIZE; j < std::min(Members.size(), (i + 1) * CHUNK_SIZE); j++)
+            {
+                if(j != i * CHUNK_SIZE)
+                    Chunk += ',';
+
+                Chunk += Members[j];
+            }
+
+            Chunk += "],\"chunk_index\":" + std::to_string(i) + ",\"chunk_count\":" + std::to_string(Count);
+
+            //Ids which aren't members are sent with the last chunk.
+            if(i + 1 == Count && !NotFound.empty())
+            {
+                Chunk += ",\"not_found\":[";
+                for (size_t j = 0; j < NotFound.size(); j++)
+                    Chunk += (j != 0 ? ",\"" : "\"") + NotFound[j] + "\"";
+
+                Chunk += "]";
+            }
+
+            if(!Nonce.empty())
+                Chunk += ",\"nonce\":" + Nonce;
+
+            Chunk += "}";
+            SendDispatch(Session, Socket, "GUILD_MEMBERS_CHUNK", Chunk);
+        }
+    }
+
+    void CMockServer::SendOP(ix::WebSocket &Socket, OPCodes OP, const std::string &D)
+    {
+        Socket.sendText("{\"op\":" + std::to_string((int)OP) + ",\"d\":" + D + "}");
+    }
+
+    void CMockServer::SendDispatch(SSession &Session, ix::WebSocket &Socket, const std::string &Event, const std::string &D)
+    {
+        Session.Seq++;
+
+        std::string Payload;
+        Payload.reserve(D.size() + Event.size() + 48);
+        Payload += "{\"op\":0,\"s\":" + std::to_string(Session.Seq) + ",\"t\":\"" + Event + "\",\"d\":";
+        Payload += D;
+        Payload += '}';
+
+        Socket.sendText(Payload);
+    }
+
+    /*------------------------REST------------------------*/
+
+    ix::HttpResponsePtr CMockServer::OnRequest(ix::HttpRequestPtr Request, std::shared_ptr<ix::ConnectionState> State)
+    {
+        std::vector<std::string> Path = SplitPath(Request->uri.substr(0, Request->uri.find('?')));
+        if(!Path.empty() && Path.front() == "api")
+            Path.erase(Path.begin());
+
+        //Versioned base urls like /api/v8 are accepted too.
+        if(!Path.empty() && Path.front().size() > 1 && Path.front()[0] == 'v' && isdigit((unsigned char)Path.front()[1]))
+            Path.erase(Path.begin());
+
+        ix::WebSocketHttpHeaders Headers;
+        Headers["Content-Type"] = "application/json";
+
+        //One bucket per route and major parameter.
+        std::string Bucket = Request->method + " /" + (Path.size() > 0 ? Path[0] : "") + "/" + (Path.size() > 1 ? Path[1] : "");
+        int Status = 404;
+        std::string Body;
+
+        if(!ConsumeBucket(Bucket, Headers))
+        {
+            Status = 429;
+            Body = "{\"message\":\"You are being rate limited.\",\"retry_after\":" + Headers["X-RateLimit-Reset-After"] + ",\"global\":false}";
+        }
+        else
+        {
+            bool Scripted = false;
+            for (auto &&e : m_Script)
+            {
+                if(e.Method == Request->method && MatchPath(e.Path, Path))
+                {
+                    Status = e.Status;
+                    Body = e.Body;
+                    Scripted = true;
+                    break;
+                }
+            }
+
+            if(!Scripted)
+            {
+                try
+                {
+                    Body = HandleRoute(Request->method, Path, Request->body, Status);
+                }
+                catch(const CJSONViewException &e)
+                {
+                    Status = 400;
+                    Body = "{\"message\":\"400: Bad Request\",\"code\":50109}";
+                }
+            }
+        }
+
+        llog << ldebug << Request->method << " " << Request->uri << " " << Status << lendl;
+
+        std::string Description;
+        switch (Status)
+        {
+            case 200: Description = "OK"; break;
+            case 201: Description = "Created"; break;
+            case 204: Description = "No Content"; break;
+            case 400: Description = "Bad Request"; break;
+            case 404: Description = "Not Found"; break;
+            case 429: Description = "Too Many Requests"; break;
+        }
+
+        return ix::HttpResponsePtr(new ix::HttpResponse(Status, Description, ix::HttpErrorCode::Ok, Headers, Body));
+    }
+
+    std::string CMockServer::HandleRoute(const std::string &Method, const std::vector<std::string> &Path, const std::string &Body, int &Status)
+    {
+        size_t Size = Path.size();
+        Status = 404;
+
+        if(Method == "GET" && Size == 2 && Path[0] == "gateway" && Path[1] == "bot")
+        {
+            Status = 200;
+            return "{\"url\":\"ws://" + m_Config.Host + ":" + std::to_string(m_Config.Port + 1) + "\",\"shards\":" + std::to_string(m_Config.Shards) +
+                   ",\"session_start_limit\":{\"total\":1000,\"remaining\":1000,\"reset_after\":86400000,\"max_concurrency\":16}}";
+        }
+        else if(Size >= 2 && Path[0] == "guilds")
+        {
+            uint32_t Guild;
+            if(!m_Guilds.GetGuildIndex(Path[1], Guild))
+                return "{\"message\":\"Unknown Guild\",\"code\":10004}";
+
+            if(Size == 4 && Path[2] == "members" && Method == "GET")
+            {
+                std::string Member = m_Guilds.CreateMember(Guild, Path[3]);
+                if(Member.empty())
+                    return "{\"message\":\"Unknown Member\",\"code\":10007}";
+
+                Status = 200;
+                return Member;
+            }
+            else if(Size == 4 && Path[2] == "members" && (Method == "PATCH" || Method == "DELETE"))
+                Status = 204;
+            else if(Size == 5 && Path[2] == "members" && Path[3] == "@me" && Path[4] == "nick" && Method == "PATCH")
+            {
+                Status = 200;
+                return Body;
+            }
+            else if(Size == 3 && Path[2] == "bans" && Method == "GET")
+            {
+                Status = 200;
+                return "[]";
+            }
+            else if(Size == 4 && Path[2] == "bans" && (Method == "PUT" || Method == "DELETE"))
+                Status = 204;
+            else if(Size == 3 && Path[2] == "channels" && Method == "POST")
+            {
+                CJSONView View(Body);
+                std::string Name = View.Root()["name"].GetRaw();
+
+                Status = 201;
+                return "{\"id\":\"" + NextID() + "\",\"type\":" + std::to_string(View.Root().GetValue<int>("type")) + ",\"guild_id\":\"" + Path[1] +
+                       "\",\"position\":0,\"permission_overwrites\":[],\"name\":" + (Name.empty() ? "\"channel\"" : Name) + ",\"parent_id\":null}";
+            }
+            else
+                return NOT_FOUND;
+
+            return "";
+        }
+        else if(Size >= 2 && Path[0] == "channels")
+        {
+            if(Size == 2 && (Method == "PATCH" || Method == "DELETE"))
+            {
+                std::string Name;
+                if(!Body.empty())
+                {
+                    CJSONView View(Body);
+                    Name = View.Root()["name"].GetRaw();
+                }
+
+                Status = 200;
+                return "{\"id\":\"" + Path[1] + "\",\"type\":0,\"position\":0,\"permission_overwrites\":[],\"name\":" + (Name.empty() ? "\"channel\"" : Name) + ",\"parent_id\":null}";
+            }
+            else if(Size == 3 && Path[2] == "messages" && Method == "POST")
+            {
+                CJSONView View(Body);
+                std::string Content = View.Root()["content"].GetRaw();
+
+                Status = 200;
+                return "{\"id\":\"" + NextID() + "\",\"channel_id\":\"" + Path[1] + "\",\"author\":" + m_Guilds.CreateBotUser() + ",\"content\":" + (Content.empty() ? "\"\"" : Content) +
+                       ",\"timestamp\":\"2020-01-01T00:00:00.000000+00:00\",\"edited_timestamp\":null,\"tts\":false,\"mention_everyone\":false,\"mentions\":[],\"mention_roles\":[],\"attachments\":[],\"embeds\":[],\"pinned\":false,\"type\":0}";
+            }
+        }
+        else if(Size == 3 && Path[0] == "users" && Path[1] == "@me" && Path[2] == "channels" && Method == "POST")
+        {
+            CJSONView View(Body);
+            std::string Recipient = View.Root().GetValue<std::string>("recipient_id");
+            uint32_t User = (uint32_t)((ParseSnowflake(Recipient) >> 22) - 1);
+
+            Status = 200;
+            return "{\"id\":\"" + NextID() + "\",\"type\":1,\"last_message_id\":null,\"recipients\":[" + m_Guilds.CreateUser(User) + "]}";
+        }
+
+        return NOT_FOUND;
+    }
+
+    bool CMockServer::ConsumeBucket(const std::string &Bucket, ix::WebSocketHttpHeaders &Headers)
+    {
+        if(m_Config.RateLimit == 0)
+            return true;
+
+        int64_t Now = GetTimeMillis();
+        std::lock_guard<std::mutex> lock(m_BucketsLock);
+
+        SBucket &Info = m_Buckets[Bucket];
+        if(Info.ResetAt <= Now)
+        {
+            Info.Remaining = m_Config.RateLimit;
+            Info.ResetAt = Now + m_Config.RateLimitWindow;
+        }
+
+        bool Ret = Info.Remaining > 0;
+        if(Ret)
+            Info.Remaining--;
+
+        std::ostringstream Hash;
+        Hash << std::hex << std::hash<std::string>()(Bucket);
+
+        Headers["X-RateLimit-Limit"] = std::to_string(m_Config.RateLimit);
+        Headers["X-RateLimit-Remaining"] = std::to_string(Info.Remaining);
+        Headers["X-RateLimit-Reset"] = std::to_string(Info.ResetAt / 1000.0);
+        Headers["X-RateLimit-Reset-After"] = std::to_string((Info.ResetAt - Now) / 1000.0);
+        Headers["X-RateLimit-Bucket"] = Hash.str();
+
+        if(!Ret)
+            Headers["Retry-After"] = std::to_string((Info.ResetAt - Now + 999) / 1000);
+
+        return Ret;
+    }
+
+    std::string CMockServer::NextID()
+    {
+        //Worker id 31 is never used by the synthetic guilds.
+        return std::to_string((m_NextID++ << 22) | (31 << 17));
+    }
+
+    std::vector<std::string> CMockServer::SplitPath(const std::string &Path)
+    {
+        std::vector<std::string> Ret;
+        size_t Beg = 0;
+
+        while (Beg < Path.size())
+        {
+            size_t End = Path.find('/', Beg);
+            if(End == std::string::npos)
+                End = Path.size();
+
+            if(End > Beg)
+                Ret.push_back(Path.substr(Beg, End - Beg));
+
+            Beg = End + 1;
+        }
+
+        return Ret;
+    }
+
+    bool CMockServer::MatchPath(const std::vector<std::string> &Pattern, const std::vector<std::string> &Path)
+    {
+        if(Pattern.size() != Path.size())
+            return false;
+
+        for (size_t i = 0; i < Pattern.size(); i++)
+        {
+            if(Pattern[i] != "*" && Pattern[i] != Path[i])
+                return false;
+        }
+
+        return true;
+    }
+
+    CMockServer::~CMockServer()
+    {
+        Stop();
+    }
+} // namespace DiscordBot
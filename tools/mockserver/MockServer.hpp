@@ -0,0 +1,159 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef MOCKSERVER_HPP
+#define MOCKSERVER_HPP
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <ixwebsocket/IXHttpServer.h>
+#include <ixwebsocket/IXWebSocketServer.h>
+#include "../../src/helpers/JSONView.hpp"
+#include "SyntheticGuilds.hpp"
+
+namespace DiscordBot
+{
+    struct SMockServerConfig
+    {
+        std::string Host;
+        int Port;                       //!< Port of the rest api. The gateway listens on Port + 1.
+        uint32_t Shards;                //!< Recommended shard count of /gateway/bot.
+        uint32_t HeartbeatInterval;     //!< Heartbeat interval in ms.
+        uint32_t RateLimit;             //!< Requests per bucket and window. 0 disables the rate limit.
+        uint32_t RateLimitWindow;       //!< Length of the rate limit window in ms.
+        SSyntheticConfig Guilds;
+    };
+
+    /**
+     * @brief Local replacement of the discord gateway and rest api for offline load tests.
+     * The gateway speaks plain json without transport compression.
+     */
+    class CMockServer
+    {
+        public:
+            CMockServer(const SMockServerConfig &Config);
+
+            /**
+             * @brief Loads scripted rest responses, which are checked before the built-in routes.
+             * Each line has the format "METHOD PATH STATUS BODY". A * inside the path matches one segment. Lines starting with # are ignored.
+             * 
+             * @return Returns false if the file can't be opened or a line is invalid.
+             */
+            bool LoadScript(const std::string &File);
+
+            /**
+             * @brief Starts the gateway and the rest server.
+             * 
+             * @return Returns false if a port can't be opened.
+             */
+            bool Start();
+
+            /**
+             * @brief Blocks until the servers are stopped.
+             */
+            void Wait();
+            void Stop();
+
+            ~CMockServer();
+
+        private:
+            enum OPCodes
+            {
+                DISPATCH,
+                HEARTBEAT,
+                IDENTIFY,
+                PRESENCE_UPDATE,
+                VOICE_STATE_UPDATE,
+                RESUME = 6,
+                RECONNECT,
+                REQUEST_GUILD_MEMBERS,
+                INVALID_SESSION,
+                HELLO,
+                HEARTBEAT_ACK
+            };
+
+            struct SSession
+            {
+                uint32_t ShardID;
+                uint32_t ShardCount;
+                uint32_t Seq;
+                uint32_t LargeThreshold;
+                std::string SessionID;
+            };
+
+            struct SScriptedResponse
+            {
+                std::string Method;
+                std::vector<std::string> Path;
+                int Status;
+                std::string Body;
+            };
+
+            struct SBucket
+            {
+                uint32_t Remaining;
+                int64_t ResetAt;
+            };
+
+            SMockServerConfig m_Config;
+            CSyntheticGuilds m_Guilds;
+            ix::WebSocketServer m_Gateway;
+            ix::HttpServer m_REST;
+            std::vector<SScriptedResponse> m_Script;
+            std::atomic<uint64_t> m_NextID;
+
+            std::mutex m_SessionsLock;
+            std::map<std::string, std::shared_ptr<SSession>> m_Sessions;
+
+            std::mutex m_BucketsLock;
+            std::map<std::string, SBucket> m_Buckets;
+
+            void OnGatewayMessage(std::shared_ptr<ix::ConnectionState> State, ix::WebSocket &Socket, const ix::WebSocketMessagePtr &Msg);
+            void OnIdentify(SSession &Session, ix::WebSocket &Socket, const CJSONValue &D);
+            void OnRequestMembers(SSession &Session, ix::WebSocket &Socket, const CJSONValue &D);
+            void SendOP(ix::WebSocket &Socket, OPCodes OP, const std::string &D);
+            void SendDispatch(SSession &Session, ix::WebSocket &Socket, const std::string &Event, const std::string &D);
+
+            ix::HttpResponsePtr OnRequest(ix::HttpRequestPtr Request, std::shared_ptr<ix::ConnectionState> State);
+            std::string HandleRoute(const std::string &Method, const std::vector<std::string> &Path, const std::string &Body, int &Status);
+
+            /**
+             * @brief Consumes one request of the bucket and adds the rate limit headers.
+             * 
+             * @return Returns false if the bucket is exhausted.
+             */
+            bool ConsumeBucket(const std::string &Bucket, ix::WebSocketHttpHeaders &Headers);
+
+            std::string NextID();
+            static std::vector<std::string> SplitPath(const std::string &Path);
+            static bool MatchPath(const std::vector<std::string> &Pattern, const std::vector<std::string> &Path);
+    };
+} // namespace DiscordBot
+
+
+#endif //MOCKSERVER_HPP
@@ -0,0 +1,222 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "SyntheticGuilds.hpp"
+#include <algorithm>
+#include <stdlib.h>
+
+namespace DiscordBot
+{
+    const char *JOINED_AT = "2020-01-01T00:00:00.000000+00:00";
+
+    uint64_t CSyntheticGuilds::Snowflake(uint64_t Index, Kind Type)
+    {
+        //The index is stored inside the timestamp bits and the type inside the worker id bits.
+        return ((Index + 1) << 22) | ((uint64_t)Type << 17);
+    }
+
+    uint32_t CSyntheticGuilds::GetShard(uint32_t Guild, uint32_t ShardCount) const
+    {
+        return (uint32_t)((Snowflake(Guild, GUILD) >> 22) % ShardCount);
+    }
+
+    bool CSyntheticGuilds::GetGuildIndex(const std::string &ID, uint32_t &Guild) const
+    {
+        uint64_t Val = strtoull(ID.c_str(), nullptr, 10);
+        if((Val & 0x3FFFFF) != ((uint64_t)GUILD << 17) || (Val >> 22) == 0 || (Val >> 22) > m_Config.Guilds)
+            return false;
+
+        Guild = (uint32_t)((Val >> 22) - 1);
+        return true;
+    }
+
+    std::string CSyntheticGuilds::GetGuildID(uint32_t Guild) const
+    {
+        return std::to_string(Snowflake(Guild, GUILD));
+    }
+
+    std::string CSyntheticGuilds::CreateBotUser() const
+    {
+        return "{\"id\":\"" + std::to_string(Snowflake(0, BOT)) + "\",\"username\":\"MockBot\",\"discriminator\":\"0001\",\"avatar\":null,\"bot\":true,\"verified\":true,\"flags\":0}";
+    }
+
+    std::string CSyntheticGuilds::CreateUser(uint32_t User) const
+    {
+        std::string Ret;
+        AppendUser(Ret, User);
+        return Ret;
+    }
+
+    std::string CSyntheticGuilds::CreateGuild(uint32_t Guild, uint32_t LargeThreshold) const
+    {
+        bool Large = LargeThreshold != 0 && m_Config.Members + 1 > LargeThreshold;
+        std::string ID = GetGuildID(Guild);
+
+        std::string Ret;
+        Ret.reserve(256 + (Large ? 0 : m_Config.Members * 220) + m_Config.Channels * 220 + m_Config.Roles * 160);
+
+        Ret += "{\"id\":\"" + ID + "\",\"name\":\"Guild " + std::to_string(Guild) + "\",\"icon\":null,\"owner_id\":\"" + std::to_string(Snowflake(0, USER)) + "\"";
+        Ret += ",\"region\":\"europe\",\"joined_at\":\"" + std::string(JOINED_AT) + "\",\"unavailable\":false";
+        Ret += ",\"large\":" + std::string(Large ? "true" : "false") + ",\"member_count\":" + std::to_string(m_Config.Members + 1);
+
+        Ret += ",\"roles\":[";
+        for (uint32_t i = 0; i < m_Config.Roles; i++)
+        {
+            if(i != 0)
+                Ret += ',';
+
+            AppendRole(Ret, Guild, i);
+        }
+
+        Ret += "],\"channels\":[";
+        for (uint32_t i = 0; i < m_Config.Channels; i++)
+        {
+            if(i != 0)
+                Ret += ',';
+
+            AppendChannel(Ret, Guild, i);
+        }
+
+        //Large guilds only contain the bot like discord, the rest must be requested.
+        Ret += "],\"members\":[";
+        AppendBotMember(Ret, Guild);
+        if(!Large)
+        {
+            for (uint32_t i = 0; i < m_Config.Members; i++)
+            {
+                Ret += ',';
+                AppendMember(Ret, Guild, i);
+            }
+        }
+
+        Ret += "],\"voice_states\":[";
+        uint32_t VoiceStates = m_Config.Channels > 4 ? std::min(m_Config.VoiceStates, m_Config.Members) : 0;
+        std::string ChannelID = std::to_string(Snowflake((uint64_t)Guild * m_Config.Channels + 4, CHANNEL));
+        for (uint32_t i = 0; i < VoiceStates; i++)
+        {
+            if(i != 0)
+                Ret += ',';
+
+            Ret += "{\"guild_id\":\"" + ID + "\",\"channel_id\":\"" + ChannelID + "\",\"user_id\":\"" + std::to_string(Snowflake(i, USER));
+            Ret += "\",\"session_id\":\"mock" + std::to_string(i) + "\",\"deaf\":false,\"mute\":false,\"self_deaf\":false,\"self_mute\":false,\"self_video\":false,\"suppress\":false}";
+        }
+
+        Ret += "],\"presences\":[]}";
+        return Ret;
+    }
+
+    std::string CSyntheticGuilds::CreateMember(uint32_t Guild, const std::string &UserID) const
+    {
+        uint64_t Val = strtoull(UserID.c_str(), nullptr, 10);
+        uint64_t Index = (Val >> 22) - 1;
+        std::string Ret;
+
+        if(Val == Snowflake(0, BOT))
+            AppendBotMember(Ret, Guild);
+        else if((Val & 0x3FFFFF) == ((uint64_t)USER << 17) && (Val >> 22) != 0 && Index < m_Config.Members)
+            AppendMember(Ret, Guild, (uint32_t)Index);
+
+        return Ret;
+    }
+
+    std::vector<std::string> CSyntheticGuilds::FindMembers(uint32_t Guild, const std::string &Query, uint32_t Limit) const
+    {
+        std::vector<std::string> Ret;
+        if(Limit == 0)
+            Limit = m_Config.Members + 1;
+
+        if(std::string("MockBot").compare(0, Query.size(), Query) == 0)
+        {
+            Ret.emplace_back();
+            AppendBotMember(Ret.back(), Guild);
+        }
+
+        for (uint32_t i = 0; i < m_Config.Members && Ret.size() < Limit; i++)
+        {
+            if(("User" + std::to_string(i)).compare(0, Query.size(), Query) == 0)
+            {
+                Ret.emplace_back();
+                AppendMember(Ret.back(), Guild, i);
+            }
+        }
+
+        return Ret;
+    }
+
+    std::string CSyntheticGuilds::CreateChannel(uint32_t Guild, uint32_t Channel) const
+    {
+        std::string Ret;
+        AppendChannel(Ret, Guild, Channel);
+        return Ret;
+    }
+
+    void CSyntheticGuilds::AppendUser(std::string &Out, uint32_t User) const
+    {
+        std::string Discriminator = std::to_string(User % 9999 + 1);
+        Discriminator.insert(0, 4 - Discriminator.size(), '0');
+
+        Out += "{\"id\":\"" + std::to_string(Snowflake(User, USER)) + "\",\"username\":\"User" + std::to_string(User) + "\",\"discriminator\":\"" + Discriminator + "\",\"avatar\":null,\"public_flags\":0}";
+    }
+
+    void CSyntheticGuilds::AppendMember(std::string &Out, uint32_t Guild, uint32_t User) const
+    {
+        Out += "{\"user\":";
+        AppendUser(Out, User);
+        Out += ",\"nick\":null,\"roles\":[";
+
+        if(m_Config.Roles > 1)
+            Out += "\"" + std::to_string(Snowflake((uint64_t)Guild * m_Config.Roles + 1 + User % (m_Config.Roles - 1), ROLE)) + "\"";
+
+        Out += "],\"joined_at\":\"" + std::string(JOINED_AT) + "\",\"premium_since\":null,\"deaf\":false,\"mute\":false}";
+    }
+
+    void CSyntheticGuilds::AppendBotMember(std::string &Out, uint32_t Guild) const
+    {
+        Out += "{\"user\":" + CreateBotUser() + ",\"nick\":null,\"roles\":[],\"joined_at\":\"" + std::string(JOINED_AT) + "\",\"premium_since\":null,\"deaf\":false,\"mute\":false}";
+    }
+
+    void CSyntheticGuilds::AppendChannel(std::string &Out, uint32_t Guild, uint32_t Channel) const
+    {
+        bool Voice = (Channel % 5) == 4;
+        std::string Name = (Voice ? "voice-" : "text-") + std::to_string(Channel);
+
+        Out += "{\"id\":\"" + std::to_string(Snowflake((uint64_t)Guild * m_Config.Channels + Channel, CHANNEL)) + "\",\"type\":" + (Voice ? "2" : "0");
+        Out += ",\"guild_id\":\"" + GetGuildID(Guild) + "\",\"position\":" + std::to_string(Channel) + ",\"permission_overwrites\":[],\"name\":\"" + Name + "\"";
+
+        if(Voice)
+            Out += ",\"bitrate\":64000,\"user_limit\":0,\"parent_id\":null}";
+        else
+            Out += ",\"topic\":null,\"nsfw\":false,\"last_message_id\":null,\"rate_limit_per_user\":0,\"parent_id\":null}";
+    }
+
+    void CSyntheticGuilds::AppendRole(std::string &Out, uint32_t Guild, uint32_t Role) const
+    {
+        //The @everyone role has the id of the guild.
+        std::string ID = Role == 0 ? GetGuildID(Guild) : std::to_string(Snowflake((uint64_t)Guild * m_Config.Roles + Role, ROLE));
+        std::string Name = Role == 0 ? "@everyone" : "Role " + std::to_string(Role);
+
+        Out += "{\"id\":\"" + ID + "\",\"name\":\"" + Name + "\",\"color\":0,\"hoist\":false,\"position\":" + std::to_string(Role);
+        Out += ",\"permissions\":\"" + std::string(Role == 0 ? "104324673" : "104324689") + "\",\"managed\":false,\"mentionable\":false}";
+    }
+} // namespace DiscordBot
@@ -0,0 +1,116 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef SYNTHETICGUILDS_HPP
+#define SYNTHETICGUILDS_HPP
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace DiscordBot
+{
+    struct SSyntheticConfig
+    {
+        uint32_t Guilds;        //!< Number of guilds the bot is member of.
+        uint32_t Members;       //!< Members per guild without the bot.
+        uint32_t Channels;      //!< Channels per guild. Every fifth channel is a voice channel.
+        uint32_t Roles;         //!< Roles per guild including @everyone.
+        uint32_t VoiceStates;   //!< Members per guild which are connected to the first voice channel.
+    };
+
+    /**
+     * @brief Generates deterministic guilds, which are served by the mock server.
+     * All guilds share the same user pool, so user n is member of every guild.
+     */
+    class CSyntheticGuilds
+    {
+        public:
+            CSyntheticGuilds(const SSyntheticConfig &Config) : m_Config(Config) {}
+
+            /**
+             * @return Returns the shard which receives the guild. (Guild ID >> 22) % ShardCount
+             */
+            uint32_t GetShard(uint32_t Guild, uint32_t ShardCount) const;
+
+            /**
+             * @brief Converts a guild id to the guild index.
+             * 
+             * @return Returns false if the id doesn't belong to a generated guild.
+             */
+            bool GetGuildIndex(const std::string &ID, uint32_t &Guild) const;
+
+            std::string GetGuildID(uint32_t Guild) const;
+            std::string CreateBotUser() const;
+            std::string CreateUser(uint32_t User) const;
+
+            /**
+             * @brief Creates the payload of a GUILD_CREATE event.
+             * 
+             * @param LargeThreshold: Guilds with more members only contain the bot member. 0 sends all members.
+             */
+            std::string CreateGuild(uint32_t Guild, uint32_t LargeThreshold) const;
+
+            /**
+             * @brief Creates a guild member object.
+             * 
+             * @return Returns an empty string if the user isn't member of the guild.
+             */
+            std::string CreateMember(uint32_t Guild, const std::string &UserID) const;
+
+            /**
+             * @brief Searches the members of a guild, whose username starts with the query.
+             * 
+             * @param Limit: Max number of members. 0 for no limit.
+             * 
+             * @return Returns the guild member objects.
+             */
+            std::vector<std::string> FindMembers(uint32_t Guild, const std::string &Query, uint32_t Limit) const;
+
+            std::string CreateChannel(uint32_t Guild, uint32_t Channel) const;
+
+        private:
+            enum Kind
+            {
+                GUILD = 1,
+                CHANNEL,
+                ROLE,
+                USER,
+                BOT
+            };
+
+            SSyntheticConfig m_Config;
+
+            static uint64_t Snowflake(uint64_t Index, Kind Type);
+
+            void AppendUser(std::string &Out, uint32_t User) const;
+            void AppendMember(std::string &Out, uint32_t Guild, uint32_t User) const;
+            void AppendBotMember(std::string &Out, uint32_t Guild) const;
+            void AppendChannel(std::string &Out, uint32_t Guild, uint32_t Channel) const;
+            void AppendRole(std::string &Out, uint32_t Guild, uint32_t Role) const;
+    };
+} // namespace DiscordBot
+
+
+#endif //SYNTHETICGUILDS_HPP
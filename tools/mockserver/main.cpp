@@ -0,0 +1,111 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2020 Christian Tost
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "MockServer.hpp"
+
+#define CLOG_IMPLEMENTATION
+#include <Log.hpp>
+
+#include <iostream>
+#include <algorithm>
+#include <ixwebsocket/IXNetSystem.h>
+#include <string.h>
+#include <stdlib.h>
+
+using namespace DiscordBot;
+
+static void PrintUsage(const char *Name)
+{
+    std::cout << "Usage: " << Name << " [options]\n"
+              << "  --host <host>         Listen address (Default 127.0.0.1)\n"
+              << "  --port <port>         Port of the rest api, the gateway uses port + 1 (Default 8080)\n"
+              << "  --shards <n>          Recommended shard count (Default 1)\n"
+              << "  --guilds <n>          Number of guilds (Default 1)\n"
+              << "  --members <n>         Members per guild (Default 50000)\n"
+              << "  --channels <n>        Channels per guild (Default 50)\n"
+              << "  --roles <n>           Roles per guild (Default 20)\n"
+              << "  --voice-states <n>    Connected voice members per guild (Default 0)\n"
+              << "  --heartbeat <ms>      Heartbeat interval (Default 41250)\n"
+              << "  --rate-limit <n>      Requests per bucket and window, 0 disables the limit (Default 50)\n"
+              << "  --rate-window <ms>    Rate limit window (Default 1000)\n"
+              << "  --script <file>       Scripted rest responses\n";
+}
+
+int main(int argc, char const *argv[])
+{
+    SMockServerConfig Config = {"127.0.0.1", 8080, 1, 41250, 50, 1000, {1, 50000, 50, 20, 0}};
+    std::string Script;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if(i + 1 >= argc)
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+
+        const char *Arg = argv[i];
+        const char *Val = argv[++i];
+        uint32_t Num = (uint32_t)strtoul(Val, nullptr, 10);
+
+        if(strcmp(Arg, "--host") == 0)
+            Config.Host = Val;
+        else if(strcmp(Arg, "--port") == 0)
+            Config.Port = (int)Num;
+        else if(strcmp(Arg, "--shards") == 0)
+            Config.Shards = std::max(Num, 1u);
+        else if(strcmp(Arg, "--guilds") == 0)
+            Config.Guilds.Guilds = Num;
+        else if(strcmp(Arg, "--members") == 0)
+            Config.Guilds.Members = Num;
+        else if(strcmp(Arg, "--channels") == 0)
+            Config.Guilds.Channels = Num;
+        else if(strcmp(Arg, "--roles") == 0)
+            Config.Guilds.Roles = std::max(Num, 1u);
+        else if(strcmp(Arg, "--voice-states") == 0)
+            Config.Guilds.VoiceStates = Num;
+        else if(strcmp(Arg, "--heartbeat") == 0)
+            Config.HeartbeatInterval = std::max(Num, 1u);
+        else if(strcmp(Arg, "--rate-limit") == 0)
+            Config.RateLimit = Num;
+        else if(strcmp(Arg, "--rate-window") == 0)
+            Config.RateLimitWindow = std::max(Num, 1u);
+        else if(strcmp(Arg, "--script") == 0)
+            Script = Val;
+        else
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    ix::initNetSystem();
+
+    CMockServer Server(Config);
+    if((!Script.empty() && !Server.LoadScript(Script)) || !Server.Start())
+        return 1;
+
+    Server.Wait();
+    return 0;
+}